@@ -27,7 +27,7 @@ const char *CONFIG_FILE = "./conf/crs.conf";
 
 Config        g_conf;
 job_tracker * g_job_tracker = NULL;
-int           g_sim_period;
+int           g_sim_period;  // in milliseconds
 int           g_nmaps;
 int           g_nreduces;
 int           g_metrics_win;
@@ -47,6 +47,8 @@ void create_job_tracker()
 	g_nmaps = g_conf.lookup("cluster.total_maps");
 	g_nreduces = g_conf.lookup("cluster.total_reduces");
 	g_job_tracker = new job_tracker(g_nmaps, g_nreduces);
+	// for the utilizations and the schedule
+	g_job_tracker->set_record_times(true);
 	if (!g_job_tracker->set_metrics(
 		    g_metrics.size()? g_metrics.c_str(): NULL, g_metrics_win)) {
 		ULIB_FATAL("failed to set metrics");
@@ -98,17 +100,15 @@ void create_pools()
 			exit(EXIT_FAILURE);
 		}
 		pool::sched_mode sched;
-		if (sched_mode == "fair")
-			sched = pool::SCHED_FAIR;
-		else if (sched_mode == "fcfs" || sched_mode == "fifo")
-			sched = pool::SCHED_FCFS;
-		else {
+		if (pool::sched_from_str(sched_mode.c_str(), &sched)) {
 			ULIB_WARNING("invalid scheduling mode:%s for pool %s",
 				     sched_mode.c_str(), name.c_str());
 			exit(EXIT_FAILURE);
 		}
+		// timeouts are given in milliseconds, same as the job generator
 		colossal::pool &p = g_job_tracker->add_pool(
-			name, min_share_timeout, fair_share_timeout,
+			name, to_sim_time(min_share_timeout * TICKS_PER_MSEC),
+			to_sim_time(fair_share_timeout * TICKS_PER_MSEC),
 			weight, map_min_share, reduce_min_share, sched);
 		job_generator gen(job_arrival_rate, logmean_maps_per_job, logmean_reduces_per_job,
 				  logsd_maps_per_job, logsd_reduces_per_job, logmean_map_duration,
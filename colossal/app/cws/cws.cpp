@@ -32,9 +32,18 @@ job_tracker * g_job_tracker = NULL;
 int           g_nmaps;
 int           g_nreduces;
 int           g_metrics_win;
+sim_time      g_metrics_interval = 0;
 string        g_metrics;
 string        g_input;
 string        g_output;
+string        g_capacity;
+string        g_decisions;
+bool          g_windowed = false;
+bool          g_fluid = false;
+bool          g_fluid_check = false;
+sim_time      g_start;
+sim_time      g_end;
+sim_time      g_lookback = 0;
 
 void initialize_simulator()
 {
@@ -42,6 +51,96 @@ void initialize_simulator()
 	g_output  = (const char *)g_conf.lookup("simulator.output");
 	g_metrics = (const char *)g_conf.lookup("simulator.metrics");
 	g_metrics_win = g_conf.lookup("simulator.metrics_win");
+	double interval;
+	if (g_conf.lookupValue("simulator.metrics_interval", interval))
+		g_metrics_interval = to_sim_time(interval * TICKS_PER_MSEC);
+	g_conf.lookupValue("simulator.capacity", g_capacity);
+	g_conf.lookupValue("simulator.decisions", g_decisions);
+	g_conf.lookupValue("simulator.fluid", g_fluid);
+	g_conf.lookupValue("simulator.fluid_check", g_fluid_check);
+
+	// optional simulation window, given in milliseconds
+	double start, end, lookback;
+	if (g_conf.lookupValue("simulator.start", start) &&
+	    g_conf.lookupValue("simulator.end", end)) {
+		g_windowed = true;
+		g_start = to_sim_time(start * TICKS_PER_MSEC);
+		g_end = to_sim_time(end * TICKS_PER_MSEC);
+		if (g_conf.lookupValue("simulator.lookback", lookback))
+			g_lookback = to_sim_time(lookback * TICKS_PER_MSEC);
+	}
+}
+
+// optional transformation of the workload as it is loaded, times in
+// milliseconds
+void add_transforms(workload_loader *loader)
+{
+	if (!g_conf.exists("transforms"))
+		return;
+	const Setting &stages = g_conf.lookup("transforms");
+	for (int i = 0; i < stages.getLength(); ++i) {
+		const Setting &st = stages[i];
+		string type, pool, dst;
+		double factor = 1, fraction = 1, jitter = 0, cap = -1, origin = -1;
+		int copies = 1;
+		long long seed = 0;
+		st.lookupValue("type", type);
+		bool selected = st.lookupValue("pool", pool);
+		st.lookupValue("factor", factor);
+		st.lookupValue("fraction", fraction);
+		st.lookupValue("jitter", jitter);
+		st.lookupValue("cap", cap);
+		st.lookupValue("origin", origin);
+		st.lookupValue("copies", copies);
+		st.lookupValue("seed", seed);
+		if (factor <= 0) {
+			ULIB_FATAL("invalid factor of transform %d", i);
+			exit(EXIT_FAILURE);
+		}
+		const char *p = selected? pool.c_str(): NULL;
+		sim_time jt = to_sim_time(jitter * TICKS_PER_MSEC);
+		if (type == "sample")
+			loader->add_transform(new sample_transform(fraction, p, seed));
+		else if (type == "scale_arrivals")
+			loader->add_transform(new scale_arrivals_transform(factor, jt, p, seed));
+		else if (type == "time_compress")
+			loader->add_transform(new time_compress_transform(
+						      factor, origin < 0? -1: to_sim_time(origin * TICKS_PER_MSEC)));
+		else if (type == "pool_replicate") {
+			if (!selected) {
+				ULIB_FATAL("pool_replicate needs a pool");
+				exit(EXIT_FAILURE);
+			}
+			if (!st.lookupValue("to", dst))
+				dst = pool;
+			loader->add_transform(new pool_replicate_transform(
+						      p, dst.c_str(), copies, jt, seed));
+		} else if (type == "duration_scale")
+			loader->add_transform(new duration_scale_transform(
+						      factor, cap < 0? -1: to_sim_time(cap * TICKS_PER_MSEC), p));
+		else {
+			ULIB_FATAL("unknown transform type %s", type.c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+int load_workload()
+{
+	workload_loader loader(workload_loader::FORMAT_PTIME);
+	add_transforms(&loader);
+	// the block locations are keyed by the task names
+	loader.set_keep_ids(g_conf.exists("cluster.blocks"));
+	if (!g_windowed)
+		return loader.load(g_input.c_str(), &g_job_tracker->getpools());
+
+	// include tasks created shortly before the window so that the
+	// cluster is not empty when the window begins
+	loader.set_window(g_start - g_lookback, g_end);
+	if (loader.load(g_input.c_str(), &g_job_tracker->getpools()))
+		return -1;
+	cerr << "Loaded " << loader.records() << " tasks in window" << endl;
+	return 0;
 }
 
 void create_job_tracker()
@@ -49,11 +148,134 @@ void create_job_tracker()
 	g_nmaps = g_conf.lookup("cluster.total_maps");
 	g_nreduces = g_conf.lookup("cluster.total_reduces");
 	g_job_tracker = new job_tracker(g_nmaps, g_nreduces);
+	// the times of the tasks are only kept for the schedule
+	g_job_tracker->set_record_times(g_output.size() > 0);
 	if (!g_job_tracker->set_metrics(
-		    g_metrics.size()? g_metrics.c_str(): NULL, g_metrics_win)) {
+		    g_metrics.size()? g_metrics.c_str(): NULL, g_metrics_win,
+		    g_metrics_interval)) {
 		ULIB_FATAL("failed to set metrics");
 		exit(EXIT_FAILURE);
 	}
+	if (g_decisions.size() &&
+	    !g_job_tracker->set_decisions(g_decisions.c_str())) {
+		ULIB_FATAL("failed to set the decision log");
+		exit(EXIT_FAILURE);
+	}
+
+	// optional node model, which replaces the slot totals
+	if (g_conf.exists("cluster")) {
+		int nodes = g_conf.lookup("cluster.nodes");
+		int npr = g_conf.lookup("cluster.nodes_per_rack");
+		int maps = g_conf.lookup("cluster.map_slots");
+		int reduces = g_conf.lookup("cluster.reduce_slots");
+		cluster *c = new cluster(nodes, npr, maps, reduces);
+		double ms, rack = c->factor(cluster::LOCALITY_RACK);
+		double off_rack = c->factor(cluster::LOCALITY_OFF_RACK);
+		int replicas;
+		string blocks;
+		if (g_conf.lookupValue("cluster.delay", ms))
+			c->set_delay(to_sim_time(ms * TICKS_PER_MSEC));
+		g_conf.lookupValue("cluster.rack_factor", rack);
+		g_conf.lookupValue("cluster.off_rack_factor", off_rack);
+		c->set_inflation(rack, off_rack);
+		if (g_conf.lookupValue("cluster.replicas", replicas))
+			c->set_replicas(replicas);
+		if (g_conf.lookupValue("cluster.blocks", blocks) &&
+		    import_blocks(blocks.c_str(), c)) {
+			ULIB_FATAL("failed to load block locations");
+			exit(EXIT_FAILURE);
+		}
+		g_nmaps = c->slots(task::TASK_TYPE_MAP);
+		g_nreduces = c->slots(task::TASK_TYPE_REDUCE);
+		g_job_tracker->set_cluster(c);
+	}
+
+	// optional container mode with DRF, memory in MB
+	if (g_conf.exists("containers")) {
+		resource cap(g_conf.lookup("containers.memory"), g_conf.lookup("containers.vcores"));
+		resource map(g_conf.lookup("containers.map_memory"),
+			     g_conf.lookup("containers.map_vcores"));
+		resource reduce(g_conf.lookup("containers.reduce_memory"),
+				g_conf.lookup("containers.reduce_vcores"));
+		if (!g_job_tracker->set_containers(cap, map, reduce)) {
+			ULIB_FATAL("failed to set the containers");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// optional reduce slow-start
+	double slowstart;
+	if (g_conf.lookupValue("simulator.slowstart", slowstart))
+		g_job_tracker->set_slowstart(slowstart);
+
+	// optional preemption victims and restart overhead in milliseconds
+	string victims;
+	double overhead = 0;
+	g_conf.lookupValue("simulator.restart_overhead", overhead);
+	g_conf.lookupValue("simulator.victims", victims);
+	if (victims.size() && victims != "fair" && victims != "min_lost") {
+		ULIB_FATAL("unknown victims %s", victims.c_str());
+		exit(EXIT_FAILURE);
+	}
+	g_job_tracker->set_preemption(victims == "min_lost"? engine::VICTIM_MIN_LOST: engine::VICTIM_FAIR,
+				      to_sim_time(overhead * TICKS_PER_MSEC));
+
+	// optional speculative execution, times in milliseconds
+	if (g_conf.exists("speculation")) {
+		spec_params params;
+		double ms;
+		g_conf.lookupValue("speculation.slow_ratio", params.slow_ratio);
+		g_conf.lookupValue("speculation.cap", params.cap);
+		if (g_conf.lookupValue("speculation.min_runtime", ms))
+			params.min_runtime = to_sim_time(ms * TICKS_PER_MSEC);
+		if (g_conf.lookupValue("speculation.interval", ms))
+			params.interval = to_sim_time(ms * TICKS_PER_MSEC);
+		if (!g_job_tracker->set_speculation(params)) {
+			ULIB_FATAL("failed to set speculation");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+// optional asynchronous logging of the engine
+void start_logger()
+{
+	if (!g_conf.exists("log"))
+		return;
+	string file, level;
+	bool binary = false;
+	g_conf.lookupValue("log.file", file);
+	g_conf.lookupValue("log.binary", binary);
+	if (g_conf.lookupValue("log.level", level)) {
+		int lv = logger::level_from_str(level.c_str());
+		if (lv < 0) {
+			ULIB_FATAL("unknown log level %s", level.c_str());
+			exit(EXIT_FAILURE);
+		}
+		logger::set_level((log_level)lv);
+	}
+	if (g_conf.exists("log.kinds")) {
+		const Setting &kinds = g_conf.lookup("log.kinds");
+		uint32_t mask = 0;
+		for (int i = 0; i < kinds.getLength(); ++i) {
+			int k = logger::kind_from_str(kinds[i]);
+			if (k < 0) {
+				ULIB_FATAL("unknown log kind %s", (const char *)kinds[i]);
+				exit(EXIT_FAILURE);
+			}
+			mask |= 1u << k;
+		}
+		logger::set_kinds(mask);
+	}
+	if (g_conf.exists("log.pools")) {
+		const Setting &pools = g_conf.lookup("log.pools");
+		for (int i = 0; i < pools.getLength(); ++i)
+			logger::add_pool(pool::id_from_str(pools[i]));
+	}
+	if (logger::start(file.size()? file.c_str(): NULL, binary)) {
+		ULIB_FATAL("failed to start the logger");
+		exit(EXIT_FAILURE);
+	}
 }
 
 void create_pools()
@@ -80,17 +302,23 @@ void create_pools()
 			exit(EXIT_FAILURE);
 		}
 		pool::sched_mode sched;
-		if (sched_mode == "fair")
-			sched = pool::SCHED_FAIR;
-		else if (sched_mode == "fcfs" || sched_mode == "fifo")
-			sched = pool::SCHED_FCFS;
-		else {
+		if (pool::sched_from_str(sched_mode.c_str(), &sched)) {
 			ULIB_WARNING("invalid scheduling mode:%s for pool %s",
 				     sched_mode.c_str(), name.c_str());
 			exit(EXIT_FAILURE);
 		}
-		g_job_tracker->add_pool(name, min_share_timeout, fair_share_timeout,
-					weight, map_min_share, reduce_min_share, sched);
+		// timeouts are given in milliseconds, same as the trace
+		colossal::pool &p = g_job_tracker->add_pool(
+			name, to_sim_time(min_share_timeout * TICKS_PER_MSEC),
+			to_sim_time(fair_share_timeout * TICKS_PER_MSEC),
+			weight, map_min_share, reduce_min_share, sched);
+		// optional containers of the pool
+		resource &map = p.containers[task::TASK_TYPE_MAP];
+		resource &reduce = p.containers[task::TASK_TYPE_REDUCE];
+		pool.lookupValue("map_memory", map[resource::RESOURCE_MEMORY]);
+		pool.lookupValue("map_vcores", map[resource::RESOURCE_VCORES]);
+		pool.lookupValue("reduce_memory", reduce[resource::RESOURCE_MEMORY]);
+		pool.lookupValue("reduce_vcores", reduce[resource::RESOURCE_VCORES]);
 	}
 	g_job_tracker->scale_minshares();
 	cerr << "Loaded settings for " << npools << " pools" << endl;
@@ -120,6 +348,57 @@ void calc_utils()
 	}
 }
 
+void calc_preemptions()
+{
+	static const char *types[] = { "reduce", "map" };  // by task::task_type
+
+	job_tracker::pool_container_type &pools = g_job_tracker->getpools();
+	for (job_tracker::pool_container_type::const_iterator pit = pools.begin();
+	     pit != pools.end(); ++pit) {
+		for (int tt = task::TASK_TYPE_NUM - 1; tt >= 0; --tt) {
+			const preempt_stats &ps = pit->preempts[tt];
+			cout << "> Pool " << pit->name << " " << types[tt] << " preemptions:"
+			     << ps.preempted
+			     << " lost:" << ps.lost / TICKS_PER_MSEC
+			     << " overhead:" << ps.overhead / TICKS_PER_MSEC
+			     << " useful:" << ps.useful / TICKS_PER_MSEC
+			     << " efficiency:" << ps.efficiency() << endl;
+		}
+	}
+}
+
+// Estimate the schedule by the fluid model, and report its error
+// against the engine if asked
+void approximate()
+{
+	job_tracker::pool_container_type copy;
+	job_tracker::pool_container_type *pools = &g_job_tracker->getpools();
+	if (g_fluid_check) {
+		copy = *pools;
+		pools = &copy;
+	}
+
+	cerr << "Approximating workload ..." << endl;
+	fluid_model fm(g_nmaps, g_nreduces);
+	fm.process(pools);
+	cerr << "Breakpoints:" << fm.breakpoints() << endl;
+
+	if (g_fluid_check) {
+		cerr << "Processing workload ..." << endl;
+		g_job_tracker->process();
+		fluid_error err = fluid_model::error(*pools, g_job_tracker->getpools());
+		cout << "Job latency error of " << err.jobs << " jobs:"
+		     << " mean:" << err.mape
+		     << " bias:" << err.bias
+		     << " max:" << err.max << endl;
+	}
+
+	if (g_output.size()) {
+		export_schedule(g_output.c_str(), *pools);
+		cerr << "Saved estimated schedule to output " << g_output << endl;
+	}
+}
+
 int main()
 {
 	try {
@@ -137,24 +416,56 @@ int main()
 		initialize_simulator();
 		create_job_tracker();
 		create_pools();
+		start_logger();
 	} catch (const SettingNotFoundException &e) {
 		cerr << "Missing a setting in configuration file" << endl;
 		exit(EXIT_FAILURE);
 	}
 
-	if (import_workload1(g_input.c_str(), &g_job_tracker->getpools())) {
+	if (load_workload()) {
 		cerr << "Unable to load workload" << endl;
 		exit(EXIT_FAILURE);
 	}
 
+	if (g_capacity.size() &&
+	    import_capacity(g_capacity.c_str(), g_job_tracker)) {
+		cerr << "Unable to load capacity timeline" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if (g_fluid) {
+		approximate();
+		logger::stop();
+		delete g_job_tracker;
+		return 0;
+	}
+
 	cerr << "Processing workload ..." << endl;
 	g_job_tracker->process();
+	logger::stop();
+
+	if (g_conf.exists("cluster")) {
+		cerr << "Map launches:";
+		for (int i = 0; i < cluster::LOCALITY_NUM; ++i)
+			cerr << " " << cluster::locality_str((cluster::locality)i) << ":"
+			     << g_job_tracker->launches((cluster::locality)i);
+		cerr << endl;
+	}
 
-	cerr << "Calculating utilizations ..." << endl;
-	calc_utils();
+	const spec_stats &spec = g_job_tracker->speculation();
+	if (spec.launched)
+		cerr << "Backups launched:" << spec.launched
+		     << " won:" << spec.won
+		     << " killed:" << spec.killed
+		     << " slot time:" << spec.slot_time << endl;
 
-	export_schedule(g_output.c_str(), g_job_tracker->getpools());
-	cerr << "Saved schedule to output " << g_output << endl;
+	calc_preemptions();
+	if (g_output.size()) {
+		cerr << "Calculating utilizations ..." << endl;
+		calc_utils();
+		export_schedule(g_output.c_str(), g_job_tracker->getpools());
+		cerr << "Saved schedule to output " << g_output << endl;
+	}
 
 	delete g_job_tracker;
 
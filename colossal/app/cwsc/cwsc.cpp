@@ -16,6 +16,7 @@
 #include <cmath>
 #include <cstdio>
 #include <string>
+#include <vector>
 #include <cstdlib>
 #include <iostream>
 #include <libconfig.h++>
@@ -34,6 +35,11 @@ int           g_metrics_win;
 string        g_metrics;
 string        g_input;
 string        g_output;
+bool          g_windowed = false;
+sim_time      g_start;
+sim_time      g_end;
+sim_time      g_lookback = 0;
+int           g_nthreads = 0;
 job_tracker * g_job_tracker = NULL;
 
 void initialize_simulator()
@@ -42,6 +48,33 @@ void initialize_simulator()
 	g_output  = (const char *)g_conf.lookup("simulator.output");
 	g_metrics = (const char *)g_conf.lookup("simulator.metrics");
 	g_metrics_win = g_conf.lookup("simulator.metrics_win");
+	g_conf.lookupValue("simulator.threads", g_nthreads);
+
+	// optional simulation window, given in milliseconds
+	double start, end, lookback;
+	if (g_conf.lookupValue("simulator.start", start) &&
+	    g_conf.lookupValue("simulator.end", end)) {
+		g_windowed = true;
+		g_start = to_sim_time(start * TICKS_PER_MSEC);
+		g_end = to_sim_time(end * TICKS_PER_MSEC);
+		if (g_conf.lookupValue("simulator.lookback", lookback))
+			g_lookback = to_sim_time(lookback * TICKS_PER_MSEC);
+	}
+}
+
+int load_workload()
+{
+	if (!g_windowed)
+		return import_workload(g_input.c_str(), &g_job_tracker->getpools());
+
+	// include tasks created shortly before the window so that the
+	// cluster is not empty when the window begins
+	workload_loader loader(workload_loader::FORMAT_STFT);
+	loader.set_window(g_start - g_lookback, g_end);
+	if (loader.load(g_input.c_str(), &g_job_tracker->getpools()))
+		return -1;
+	cerr << "Loaded " << loader.records() << " tasks in window" << endl;
+	return 0;
 }
 
 void create_job_tracker()
@@ -49,6 +82,8 @@ void create_job_tracker()
 	g_nmaps = g_conf.lookup("cluster.total_maps");
 	g_nreduces = g_conf.lookup("cluster.total_reduces");
 	g_job_tracker = new job_tracker(g_nmaps, g_nreduces);
+	// the schedule is compared task by task
+	g_job_tracker->set_record_times(true);
 	if (!g_job_tracker->set_metrics(
 		    g_metrics.size()? g_metrics.c_str(): NULL, g_metrics_win)) {
 		ULIB_FATAL("failed to set metrics");
@@ -80,16 +115,15 @@ void create_pools()
 			exit(EXIT_FAILURE);
 		}
 		pool::sched_mode sched;
-		if (sched_mode == "fair")
-			sched = pool::SCHED_FAIR;
-		else if (sched_mode == "fcfs" || sched_mode == "fifo")
-			sched = pool::SCHED_FCFS;
-		else {
+		if (pool::sched_from_str(sched_mode.c_str(), &sched)) {
 			ULIB_WARNING("invalid scheduling mode:%s for pool %s",
 				     sched_mode.c_str(), name.c_str());
 			exit(EXIT_FAILURE);
 		}
-		g_job_tracker->add_pool(name, min_share_timeout, fair_share_timeout,
+		// timeouts are given in milliseconds, same as the trace
+		g_job_tracker->add_pool(name,
+					to_sim_time(min_share_timeout * TICKS_PER_MSEC),
+					to_sim_time(fair_share_timeout * TICKS_PER_MSEC),
 					weight, map_min_share, reduce_min_share, sched);
 	}
 	g_job_tracker->scale_minshares();
@@ -120,6 +154,74 @@ void calc_utils()
 	}
 }
 
+void print_accuracy(const char *prefix, const accuracy_stats &st)
+{
+	cout << prefix << " jobs:" << st.jobs
+	     << " mape:" << st.mape << " bias:" << st.bias
+	     << " p50:" << st.p50 << " p90:" << st.p90
+	     << " p99:" << st.p99 << " max:" << st.max << endl;
+}
+
+// Error of the simulated job completion times against the trace
+void calc_accuracy(const engine::pool_container_type &old)
+{
+	const job_tracker::pool_container_type &pools = g_job_tracker->getpools();
+	vector<accuracy_stats> stats;
+	print_accuracy("Job completion time error", accuracy_evaluator::compare(old, pools, &stats));
+	size_t i = 0;
+	for (job_tracker::pool_container_type::const_iterator pit = pools.begin();
+	     pit != pools.end(); ++pit, ++i)
+		print_accuracy((">> Pool " + pit->name).c_str(), stats[i]);
+}
+
+// Evaluate the calibrations of the optional calibrations list, all
+// against the same loaded trace
+void calibrate(const engine::pool_container_type &old)
+{
+	if (!g_conf.exists("calibrations"))
+		return;
+	accuracy_evaluator eval(old, g_nthreads);
+	const Setting &cals = g_conf.lookup("calibrations");
+	for (int i = 0; i < cals.getLength(); ++i) {
+		const Setting &cal = cals[i];
+		string name;
+		int nmaps = g_nmaps;
+		int nreduces = g_nreduces;
+		double mto, fto;
+		if (!cal.lookupValue("name", name)) {
+			cerr << "Missing name for calibration " << i << endl;
+			exit(EXIT_FAILURE);
+		}
+		cal.lookupValue("total_maps", nmaps);
+		cal.lookupValue("total_reduces", nreduces);
+		// timeouts are given in milliseconds, and default to those of the pools
+		sim_time ms_timeout = calibration::KEEP;
+		sim_time hf_timeout = calibration::KEEP;
+		if (cal.lookupValue("min_share_timeout", mto))
+			ms_timeout = to_sim_time(mto * TICKS_PER_MSEC);
+		if (cal.lookupValue("fair_share_timeout", fto))
+			hf_timeout = to_sim_time(fto * TICKS_PER_MSEC);
+		eval.add(calibration(name, nmaps, nreduces, ms_timeout, hf_timeout));
+	}
+
+	cerr << "Evaluating " << eval.size() << " calibrations ..." << endl;
+	eval.run();
+
+	job_tracker::pool_container_type &pools = g_job_tracker->getpools();
+	for (size_t i = 0; i < eval.size(); ++i) {
+		const calibration &c = eval.config(i);
+		cout << "Calibration " << c.name << " maps:" << c.nmaps
+		     << " reduces:" << c.nreduces << endl;
+		print_accuracy("> Job completion time error", eval.overall(i));
+		size_t k = 0;
+		for (job_tracker::pool_container_type::const_iterator pit = pools.begin();
+		     pit != pools.end(); ++pit, ++k)
+			print_accuracy((">> Pool " + pit->name).c_str(), eval.pool_stats(i, k));
+	}
+	if (eval.best() >= 0)
+		cout << "Best calibration:" << eval.config(eval.best()).name << endl;
+}
+
 int export_comparison(const char *file,
 		      const engine::pool_container_type &old,
 		      const engine::pool_container_type &res)
@@ -142,29 +244,25 @@ int export_comparison(const char *file,
 				cerr << "Job ids mismatch:" << jit->id << ", " << jit1->id << endl;
 				return -1;
 			}
-			for (job::task_container_type::const_iterator tit = jit->tasks[task::TASK_TYPE_MAP].begin(),
-				     tit1 = jit1->tasks[task::TASK_TYPE_MAP].begin();
-			     tit != jit->tasks[task::TASK_TYPE_MAP].end(); ++tit, ++tit1) {
-				if (tit->id != tit1->id) {
-					cerr << "Task ids mismatch:" << tit->id << ", " << tit1->id << endl;
-					return -1;
+			static const task::task_type types[] = { task::TASK_TYPE_MAP, task::TASK_TYPE_REDUCE };
+			for (size_t i = 0; i < sizeof(types)/sizeof(types[0]); ++i) {
+				task::task_type type = types[i];
+				const job::task_container_type &tasks = jit->tasks[type];
+				const job::task_container_type &tasks1 = jit1->tasks[type];
+				const fs_context &ctx = type == task::TASK_TYPE_MAP? jit->fs_ctx_map: jit->fs_ctx_reduce;
+				for (size_t k = 0; k < tasks.size(); ++k) {
+					uint64_t id = jit->task_id(type, k);
+					if (k >= tasks1.size() || id != jit1->task_id(type, k)) {
+						cerr << "Task ids mismatch:" << id << endl;
+						return -1;
+					}
+					// pool job task type ctime ptime stime stime1 ftime ftime1
+					fprintf(fp, "%s\t%016llx:%lf\t%016llx\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\t%lld\n",
+						pit->name.c_str(), jit->id, ctx.weight, (unsigned long long)id, type,
+						(long long)tasks.ctime(k), (long long)tasks.ptime(k),
+						(long long)tasks.stime(k), (long long)tasks1.stime(k),
+						(long long)tasks.ftime(k), (long long)tasks1.ftime(k));
 				}
-				// pool job task:weight:ctime type ctime ptime stime stime1 ftime ftime1
-				fprintf(fp, "%s\t%016llx:%lf\t%016llx\t%d\t%f\t%f\t%f\t%f\t%f\t%f\n",
-					pit->name.c_str(), jit->id, jit->fs_ctx_map.weight, tit->id, task::TASK_TYPE_MAP,
-					tit->ctime, tit->ptime, tit->stime, tit1->stime, tit->ftime, tit1->ftime);
-			}
-			for (job::task_container_type::const_iterator tit = jit->tasks[task::TASK_TYPE_REDUCE].begin(),
-				     tit1 = jit1->tasks[task::TASK_TYPE_REDUCE].begin();
-			     tit != jit->tasks[task::TASK_TYPE_REDUCE].end(); ++tit, ++tit1) {
-				if (tit->id != tit1->id) {
-					cerr << "Task ids mismatch:" << tit->id << ", " << tit1->id << endl;
-					return -1;
-				}
-				// pool job task type ctime ptime stime stime1 ftime ftime1
-				fprintf(fp, "%s\t%016llx:%lf\t%016llx\t%d\t%f\t%f\t%f\t%f\t%f\t%f\n",
-					pit->name.c_str(), jit->id, jit->fs_ctx_reduce.weight, tit->id, task::TASK_TYPE_REDUCE,
-					tit->ctime, tit->ptime, tit->stime, tit1->stime, tit->ftime, tit1->ftime);
 			}
 		}
 	}
@@ -196,7 +294,7 @@ int main()
 		exit(EXIT_FAILURE);
 	}
 
-	if (import_workload(g_input.c_str(), &g_job_tracker->getpools())) {
+	if (load_workload()) {
 		cerr << "Unable to load workload" << endl;
 		exit(EXIT_FAILURE);
 	}
@@ -204,11 +302,14 @@ int main()
 	cerr << "Loaded workload, backing up ..." << endl;
 	job_tracker::pool_container_type old = g_job_tracker->getpools();
 
+	calibrate(old);
+
 	cerr << "Processing workload ..." << endl;
 
 	g_job_tracker->process();
 
 	calc_utils();
+	calc_accuracy(old);
 
 	if (!export_comparison(g_output.c_str(), old, g_job_tracker->getpools()))
 		cerr << "Saved comparison to " << g_output << endl;
@@ -0,0 +1,219 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+// Shadow simulation daemon
+// Follows a live cluster from the task submission, start and finish
+// updates sent by clients, and answers queries of predicted job and
+// pool finish times.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <pthread.h>
+#include <libconfig.h++>
+#include <rpclib.h>
+#include <colossal/colossal.hpp>
+#include "protocol.hpp"
+
+using namespace std;
+using namespace colossal;
+using namespace libconfig;
+using namespace rpclib;
+
+const char *CONFIG_FILE = "./conf/cwsd.conf";
+
+Config           g_conf;
+shadow_tracker * g_tracker = NULL;
+pthread_mutex_t  g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void create_tracker()
+{
+	int nmaps = g_conf.lookup("cluster.total_maps");
+	int nreduces = g_conf.lookup("cluster.total_reduces");
+	g_tracker = new shadow_tracker(nmaps, nreduces);
+}
+
+void create_pools()
+{
+	const Setting &pools = g_conf.lookup("pools");
+	int npools = pools.getLength();
+	for (int i = 0; i < npools; ++i) {
+		const Setting &pool = pools[i];
+		string name;
+		string sched_mode;
+		double min_share_timeout;
+		double fair_share_timeout;
+		double weight;
+		int    map_min_share;
+		int    reduce_min_share;
+		if (!(pool.lookupValue("name", name) &&
+		      pool.lookupValue("sched_mode", sched_mode) &&
+		      pool.lookupValue("min_share_timeout", min_share_timeout) &&
+		      pool.lookupValue("fair_share_timeout", fair_share_timeout) &&
+		      pool.lookupValue("weight", weight) &&
+		      pool.lookupValue("map_min_share", map_min_share) &&
+		      pool.lookupValue("reduce_min_share", reduce_min_share))) {
+			cerr << "Missing pool settings for pool " << i << endl;
+			exit(EXIT_FAILURE);
+		}
+		pool::sched_mode sched;
+		if (pool::sched_from_str(sched_mode.c_str(), &sched)) {
+			ULIB_WARNING("invalid scheduling mode:%s for pool %s",
+				     sched_mode.c_str(), name.c_str());
+			exit(EXIT_FAILURE);
+		}
+		// timeouts are given in milliseconds, same as the trace
+		g_tracker->follow_pool(name,
+				       to_sim_time(min_share_timeout * TICKS_PER_MSEC),
+				       to_sim_time(fair_share_timeout * TICKS_PER_MSEC),
+				       weight, map_min_share, reduce_min_share, sched);
+	}
+	g_tracker->scale_minshares();
+	cerr << "Loaded settings for " << npools << " pools" << endl;
+}
+
+static inline int64_t to_msec(sim_time t)
+{
+	return t < 0? -1: t / TICKS_PER_MSEC;
+}
+
+int apply(const shadow_update &u)
+{
+	switch (u.op) {
+	case OP_SUBMIT: {
+		task t;
+		t.ctime = u.time * TICKS_PER_MSEC;
+		t.ptime = u.ptime * TICKS_PER_MSEC;
+		t.stime = -1;
+		t.ftime = -1;
+		return g_tracker->submit(u.pid, u.jid, u.tid, u.weight,
+					 u.type == task::TASK_TYPE_MAP?
+					 task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE, t);
+	}
+	case OP_START:
+		return g_tracker->start(u.tid, u.time * TICKS_PER_MSEC);
+	case OP_FINISH:
+		return g_tracker->finish(u.tid, u.time * TICKS_PER_MSEC);
+	}
+	ULIB_WARNING("unknown update operation:%u", u.op);
+	return -1;
+}
+
+class update_cb : public rpc_callback {
+public:
+	virtual int
+	operator()(unsigned char id, const void *buf, int len, rpc_resp &res)
+	{
+		shadow_update u;
+		int32_t n = 0;
+
+		// packed messages are not aligned
+		pthread_mutex_lock(&g_lock);
+		for (int off = 0; off + (int)sizeof(u) <= len; off += sizeof(u)) {
+			memcpy(&u, (const char *)buf + off, sizeof(u));
+			if (apply(u) == 0)
+				++n;
+		}
+		pthread_mutex_unlock(&g_lock);
+
+		return res.put(id, &n, sizeof(n));
+	}
+};
+
+class predict_cb : public rpc_callback {
+public:
+	virtual int
+	operator()(unsigned char id, const void *buf, int len, rpc_resp &res)
+	{
+		if (len != sizeof(uint64_t)) {
+			ULIB_WARNING("invalid prediction query of %d bytes", len);
+			return -1;
+		}
+
+		uint64_t qid;
+		memcpy(&qid, buf, sizeof(qid));
+
+		pthread_mutex_lock(&g_lock);
+		int64_t fin = to_msec(id == RPC_PREDICT_JOB?
+				      g_tracker->predict_job(qid):
+				      g_tracker->predict_pool(qid));
+		pthread_mutex_unlock(&g_lock);
+
+		return res.put(id, &fin, sizeof(fin));
+	}
+};
+
+class status_cb : public rpc_callback {
+public:
+	virtual int
+	operator()(unsigned char id, const void *, int, rpc_resp &res)
+	{
+		shadow_status st;
+
+		pthread_mutex_lock(&g_lock);
+		st.now = to_msec(g_tracker->now());
+		st.jobs = g_tracker->jobs();
+		st.tasks = g_tracker->tasks();
+		pthread_mutex_unlock(&g_lock);
+
+		return res.put(id, &st, sizeof(st));
+	}
+};
+
+int main()
+{
+	try {
+		g_conf.readFile(CONFIG_FILE);
+	} catch (const FileIOException &e) {
+		cerr << "I/O error while reading " << CONFIG_FILE << endl;
+		exit(EXIT_FAILURE);
+	} catch(const ParseException &pex) {
+		cerr << "Parse error at " << pex.getFile() << ":" << pex.getLine()
+		     << " - " << pex.getError() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	int port;
+	int workers;
+	try {
+		create_tracker();
+		create_pools();
+		port = g_conf.lookup("server.port");
+		workers = g_conf.lookup("server.workers");
+	} catch (const SettingNotFoundException &e) {
+		cerr << "Missing a setting in configuration file" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	update_cb  ucb;
+	predict_cb pcb;
+	status_cb  scb;
+	rpc_proto  prot;
+	prot.add_stub(8, RPC_UPDATE, &ucb, RPC_PREDICT_JOB, &pcb,
+		      RPC_PREDICT_POOL, &pcb, RPC_STATUS, &scb);
+
+	rpc_server svr(workers, port, prot);
+	if (svr.start()) {
+		cerr << "Unable to start the server on port " << port << endl;
+		exit(EXIT_FAILURE);
+	}
+	cerr << "Listening on port " << port << " ..." << endl;
+	svr.join();
+
+	delete g_tracker;
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+// Replay client of the shadow simulation daemon
+// Feeds a recorded trace to the daemon as submission, start and finish
+// updates in time order. After each batch, the finish time of the job
+// last submitted is queried and compared with the recorded one.
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/time.h>
+#include <ulib/hash_open.h>
+#include <ulib/util_log.h>
+#include <rpclib.h>
+#include <colossal/colossal.hpp>
+#include "protocol.hpp"
+
+using namespace std;
+using namespace colossal;
+using namespace rpclib;
+
+bool update_less(const shadow_update &a, const shadow_update &b)
+{
+	if (a.time != b.time)
+		return a.time < b.time;
+	return a.op < b.op;
+}
+
+// Load the trace in the FORMAT_STFT format as updates
+// Recorded job finish times are saved to @fin.
+int load_updates(const char *file, vector<shadow_update> *updates,
+		 ulib::open_hash_map<uint64_t, int64_t> *fin)
+{
+	FILE *fp = fopen(file, "r");
+	if (fp == NULL) {
+		ULIB_WARNING("cannot open %s for reading", file);
+		return -1;
+	}
+
+	char line[4096];
+	char pstr[1024], jstr[1024], prio[64], tstr[1024], type[64];
+	double ctime, stime, ftime;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%1023[^\t]\t%1023[^:]:%63s\t%1023s\t%63s\t%lf\t%lf\t%lf",
+			   pstr, jstr, prio, tstr, type, &ctime, &stime, &ftime) != 8) {
+			ULIB_WARNING("Error encounterred while parsing a line:%s", line);
+			fclose(fp);
+			return -1;
+		}
+		shadow_update u;
+		u.type = strcmp(type, "MAP") == 0? task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE;
+		u.pid = pool::id_from_str(pstr);
+		u.jid = job::id_from_str(jstr);
+		u.tid = task::id_from_str(tstr);
+		u.weight = strcmp(prio, "VERY_HIGH") == 0? 4.0:
+			(strcmp(prio, "HIGH") == 0? 2.0: 1.0);
+		u.ptime = (int64_t)(ftime - stime);
+		u.op = OP_SUBMIT;
+		u.time = (int64_t)ctime;
+		updates->push_back(u);
+		u.op = OP_START;
+		u.time = (int64_t)stime;
+		updates->push_back(u);
+		u.op = OP_FINISH;
+		u.time = (int64_t)ftime;
+		updates->push_back(u);
+
+		int64_t &f = (*fin)[u.jid];
+		f = max(f, u.time);
+	}
+	fclose(fp);
+
+	stable_sort(updates->begin(), updates->end(), update_less);
+	return 0;
+}
+
+// Issue a single RPC call on a new connection
+int call(rpc_client &cli, rpc_call2 *rpc)
+{
+	int s = cli.connect();
+	if (s < 0)
+		return -1;
+	int ret = cli(s, 1, rpc);
+	close(s);
+	return ret;
+}
+
+double now_usec()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 4) {
+		fprintf(stderr, "usage: %s host port trace [batch]\n", argv[0]);
+		return -1;
+	}
+	const char *host = argv[1];
+	const char *port = argv[2];
+	size_t batch = argc > 4? atoi(argv[4]): 1000;
+	size_t max_batch = rpc_client::MAX_REQ_LEN / sizeof(shadow_update) / 2;
+	if (batch == 0 || batch > max_batch)
+		batch = max_batch;
+
+	vector<shadow_update> updates;
+	ulib::open_hash_map<uint64_t, int64_t> fin;
+	if (load_updates(argv[3], &updates, &fin))
+		return -1;
+	fprintf(stderr, "Loaded %lu updates of %lu jobs\n",
+		(unsigned long)updates.size(), (unsigned long)fin.size());
+
+	rpc_client cli;
+	if (cli.resolve(host, port)) {
+		ULIB_WARNING("failed to resolve %s:%s", host, port);
+		return -1;
+	}
+
+	size_t nquery = 0;
+	double abserr = 0;
+	double latency = 0;
+	for (size_t i = 0; i < updates.size(); i += batch) {
+		size_t n = min(batch, updates.size() - i);
+		int32_t applied = 0;
+		rpc_call2 update(RPC_UPDATE, &updates[i], n * sizeof(shadow_update),
+				 &applied, sizeof(applied));
+		if (call(cli, &update)) {
+			ULIB_WARNING("failed to send updates");
+			return -1;
+		}
+		if (applied != (int32_t)n)
+			ULIB_WARNING("%d of %lu updates were rejected",
+				     (int)(n - applied), (unsigned long)n);
+
+		// query the job last submitted in the batch
+		const shadow_update *last = NULL;
+		for (size_t j = i + n; j > i; --j) {
+			if (updates[j - 1].op == OP_SUBMIT) {
+				last = &updates[j - 1];
+				break;
+			}
+		}
+		if (last == NULL)
+			continue;
+		int64_t pred = -1;
+		rpc_call2 query(RPC_PREDICT_JOB, &last->jid, sizeof(last->jid),
+				&pred, sizeof(pred));
+		double start = now_usec();
+		if (call(cli, &query)) {
+			ULIB_WARNING("failed to query job %016llx", (unsigned long long)last->jid);
+			return -1;
+		}
+		latency += now_usec() - start;
+		if (pred < 0)
+			continue;  // the job has finished
+		abserr += labs(pred - fin[last->jid]);
+		++nquery;
+	}
+
+	shadow_status st;
+	memset(&st, 0, sizeof(st));
+	rpc_call2 status(RPC_STATUS, NULL, 0, &st, sizeof(st));
+	if (call(cli, &status)) {
+		ULIB_WARNING("failed to query the status");
+		return -1;
+	}
+
+	printf("Queries: %lu\n", (unsigned long)nquery);
+	printf("Mean absolute error: %.3f ms\n", nquery? abserr / nquery: 0);
+	printf("Mean query latency: %.3f ms\n", nquery? latency / nquery / 1000: 0);
+	printf("Shadow state: now=%lld, %llu jobs, %llu tasks\n",
+	       (long long)st.now, (unsigned long long)st.jobs,
+	       (unsigned long long)st.tasks);
+
+	return 0;
+}
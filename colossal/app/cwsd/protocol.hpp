@@ -0,0 +1,53 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+// Wire protocol between the shadow simulation daemon and its clients
+// All times are in milliseconds, same as the traces.
+
+#ifndef _CWSD_PROTOCOL_H
+#define _CWSD_PROTOCOL_H
+
+#include <stdint.h>
+
+enum cwsd_rpc {
+	RPC_UPDATE = 1,    // shadow_update[] -> int32_t number applied
+	RPC_PREDICT_JOB,   // uint64_t job id -> int64_t finish time, -1 if unknown
+	RPC_PREDICT_POOL,  // uint64_t pool id -> int64_t finish time, -1 if idle
+	RPC_STATUS         // none -> shadow_status
+};
+
+enum cwsd_op {
+	OP_SUBMIT = 0,  // uses all fields, ptime is an estimate
+	OP_START,       // uses tid and time
+	OP_FINISH       // uses tid and time
+};
+
+struct shadow_update {
+	uint32_t op;
+	uint32_t type;    // task::task_type
+	uint64_t pid;     // pool::id_from_str() of the pool name
+	uint64_t jid;
+	uint64_t tid;
+	double   weight;  // job weight
+	int64_t  time;    // ctime, stime or ftime depending on op
+	int64_t  ptime;
+};
+
+struct shadow_status {
+	int64_t  now;
+	uint64_t jobs;
+	uint64_t tasks;
+};
+
+#endif
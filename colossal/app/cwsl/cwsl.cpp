@@ -0,0 +1,153 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+// Decoder of binary simulator logs
+// Writes the records of a log written by logger in text, optionally
+// filtered by level, event kind, pool and time, or counts them.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] LOG\n"
+		"  -l LEVEL  minimum level: debug, notice, warning or fatal\n"
+		"  -k LIST   event kinds, e.g. preempt,capacity\n"
+		"  -p LIST   pool names, records of other pools are skipped\n"
+		"  -s MSEC   skip records before this time\n"
+		"  -e MSEC   skip records at or after this time\n"
+		"  -c        count the records by level and kind instead\n",
+		prog);
+}
+
+// Parse a comma-separated list into a kind mask, or pool ids
+static bool parse_kinds(const char *str, uint32_t *mask)
+{
+	*mask = 0;
+	std::string s(str);
+	for (size_t pos = 0; pos <= s.size();) {
+		size_t end = s.find(',', pos);
+		if (end == std::string::npos)
+			end = s.size();
+		int k = logger::kind_from_str(s.substr(pos, end - pos).c_str());
+		if (k < 0)
+			return false;
+		*mask |= 1u << k;
+		pos = end + 1;
+	}
+	return true;
+}
+
+static void parse_pools(const char *str, std::vector<uint64_t> *pools)
+{
+	std::string s(str);
+	for (size_t pos = 0; pos <= s.size();) {
+		size_t end = s.find(',', pos);
+		if (end == std::string::npos)
+			end = s.size();
+		pools->push_back(pool::id_from_str(s.c_str() + pos, end - pos));
+		pos = end + 1;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int level = LEVEL_DEBUG;
+	uint32_t kinds = ~0u;
+	std::vector<uint64_t> pools;
+	sim_time start = 0;
+	sim_time end = -1;
+	bool count = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "l:k:p:s:e:ch")) != -1) {
+		switch (opt) {
+		case 'l':
+			level = logger::level_from_str(optarg);
+			if (level < 0) {
+				fprintf(stderr, "unknown level %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'k':
+			if (!parse_kinds(optarg, &kinds)) {
+				fprintf(stderr, "unknown kind in %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'p': parse_pools(optarg, &pools); break;
+		case 's': start = to_sim_time(atof(optarg) * TICKS_PER_MSEC); break;
+		case 'e': end = to_sim_time(atof(optarg) * TICKS_PER_MSEC); break;
+		case 'c': count = true; break;
+		default:
+			usage(argv[0]);
+			return opt == 'h'? EXIT_SUCCESS: EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	log_reader reader;
+	if (reader.open(argv[optind]))
+		return EXIT_FAILURE;
+
+	unsigned long long counts[LEVEL_FATAL + 1][KIND_NUM];
+	memset(counts, 0, sizeof(counts));
+
+	log_record r;
+	std::string line;
+	int ret;
+	while ((ret = reader.next(&r)) > 0) {
+		if (r.level < level || !(kinds >> r.kind & 1) ||
+		    r.time < start || (end >= 0 && r.time >= end))
+			continue;
+		if (pools.size() && r.pool &&
+		    std::find(pools.begin(), pools.end(), r.pool) == pools.end())
+			continue;
+		if (count) {
+			++counts[r.level][r.kind];
+			continue;
+		}
+		line.clear();
+		reader.format(r)->render(r, &line);
+		line += '\n';
+		fwrite(line.data(), 1, line.size(), stdout);
+	}
+	if (ret < 0) {
+		fprintf(stderr, "%s is corrupted\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if (count) {
+		printf("LEVEL\tKIND\tRECORDS\n");
+		for (int i = 0; i <= LEVEL_FATAL; ++i)
+			for (int k = 0; k < KIND_NUM; ++k)
+				if (counts[i][k])
+					printf("%s\t%s\t%llu\n", logger::level_str((log_level)i),
+					       logger::kind_str((log_kind)k), counts[i][k]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+// Diff of two decision logs
+// Reports the first scheduling decision where two runs diverge, with
+// the decisions around it.
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <unistd.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-C NUM] LOG1 LOG2\n"
+		"  -C NUM  decisions of context, 5 by default\n"
+		"The exit status is 0 if the logs are identical and 1 if not.\n",
+		prog);
+}
+
+// Print up to n decisions of a log with the prefix
+static void print_next(decision_reader &rd, const char *prefix, int n)
+{
+	decision d;
+	for (int i = 0; i < n && rd.next(&d) > 0; ++i)
+		printf("%s%s\n", prefix, d.to_str().c_str());
+}
+
+int main(int argc, char *argv[])
+{
+	int ctx = 5;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "C:h")) != -1) {
+		switch (opt) {
+		case 'C': ctx = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+			return opt == 'h'? EXIT_SUCCESS: 2;
+		}
+	}
+	if (optind != argc - 2) {
+		usage(argv[0]);
+		return 2;
+	}
+	const char *a = argv[optind];
+	const char *b = argv[optind + 1];
+
+	uint64_t pos;
+	int ret = diff_decisions(a, b, &pos);
+	if (ret < 0)
+		return 2;
+	if (ret == 0) {
+		printf("identical, %llu decisions\n", (unsigned long long)pos);
+		return EXIT_SUCCESS;
+	}
+
+	// rewind to the context before the divergence
+	decision_reader ra, rb;
+	if (ra.open(a) || rb.open(b))
+		return 2;
+	decision d;
+	std::deque<decision> before;
+	for (uint64_t i = 0; i < pos; ++i) {
+		ra.next(&d);
+		rb.next(&d);
+		before.push_back(d);
+		if ((int)before.size() > ctx)
+			before.pop_front();
+	}
+	printf("diverged at decision %llu\n", (unsigned long long)pos);
+	for (size_t i = 0; i < before.size(); ++i)
+		printf("  %s\n", before[i].to_str().c_str());
+	print_next(ra, "- ", ctx + 1);
+	print_next(rb, "+ ", ctx + 1);
+
+	return 1;
+}
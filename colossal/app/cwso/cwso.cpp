@@ -0,0 +1,207 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstdio>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <libconfig.h++>
+#include <colossal/colossal.hpp>
+
+using namespace std;
+using namespace colossal;
+using namespace libconfig;
+
+const char *CONFIG_FILE = "./conf/cwso.conf";
+
+Config        g_conf;
+job_tracker * g_job_tracker = NULL;
+int           g_nmaps;
+int           g_nreduces;
+string        g_input;
+string        g_output;
+
+void create_job_tracker()
+{
+	g_nmaps = g_conf.lookup("cluster.total_maps");
+	g_nreduces = g_conf.lookup("cluster.total_reduces");
+	g_job_tracker = new job_tracker(g_nmaps, g_nreduces);
+}
+
+void create_pools()
+{
+	const Setting &pools = g_conf.lookup("pools");
+	int npools = pools.getLength();
+	for (int i = 0; i < npools; ++i) {
+		const Setting &pool = pools[i];
+		string name;
+		string sched_mode;
+		double min_share_timeout;
+		double fair_share_timeout;
+		double weight;
+		int    map_min_share;
+		int    reduce_min_share;
+		if (!(pool.lookupValue("name", name) &&
+		      pool.lookupValue("sched_mode", sched_mode) &&
+		      pool.lookupValue("min_share_timeout", min_share_timeout) &&
+		      pool.lookupValue("fair_share_timeout", fair_share_timeout) &&
+		      pool.lookupValue("weight", weight) &&
+		      pool.lookupValue("map_min_share", map_min_share) &&
+		      pool.lookupValue("reduce_min_share", reduce_min_share))) {
+			cerr << "Missing pool settings for pool " << i << endl;
+			exit(EXIT_FAILURE);
+		}
+		pool::sched_mode sched;
+		if (pool::sched_from_str(sched_mode.c_str(), &sched)) {
+			ULIB_WARNING("invalid scheduling mode:%s for pool %s",
+				     sched_mode.c_str(), name.c_str());
+			exit(EXIT_FAILURE);
+		}
+		// timeouts are given in milliseconds, same as the trace
+		g_job_tracker->add_pool(name,
+					to_sim_time(min_share_timeout * TICKS_PER_MSEC),
+					to_sim_time(fair_share_timeout * TICKS_PER_MSEC),
+					weight, map_min_share, reduce_min_share, sched);
+	}
+	cerr << "Loaded settings for " << npools << " pools" << endl;
+}
+
+void create_goals(latency_objective *obj)
+{
+	if (!g_conf.exists("optimizer.goals"))
+		return;
+	const Setting &goals = g_conf.lookup("optimizer.goals");
+	for (int i = 0; i < goals.getLength(); ++i) {
+		const Setting &goal = goals[i];
+		string name;
+		double weight;
+		double sla;
+		if (!goal.lookupValue("pool", name)) {
+			cerr << "Missing pool name for goal " << i << endl;
+			exit(EXIT_FAILURE);
+		}
+		if (goal.lookupValue("weight", weight))
+			obj->set_weight(name, weight);
+		if (goal.lookupValue("sla", sla))
+			obj->set_sla(name, to_sim_time(sla * TICKS_PER_MSEC));
+	}
+}
+
+// Save pool settings in the configuration file format
+int export_pools(const char *file, const job_tracker::pool_container_type &pools)
+{
+	FILE *fp = fopen(file, "w");
+	if (fp == NULL) {
+		ULIB_WARNING("cannot open %s for writing", file);
+		return -1;
+	}
+
+	fprintf(fp, "pools:\n       (");
+	for (job_tracker::pool_container_type::const_iterator pit = pools.begin();
+	     pit != pools.end(); ++pit) {
+		fprintf(fp, "%s\n\t\t{ name = \"%s\";\n", pit == pools.begin()? "": ",\n",
+			pit->name.c_str());
+		fprintf(fp, "\t\t  min_share_timeout = %.3f;\n",
+			pit->ms_timeout < 0? -1.0: (double)pit->ms_timeout / TICKS_PER_MSEC);
+		fprintf(fp, "\t\t  fair_share_timeout = %.3f;\n",
+			pit->hf_timeout < 0? -1.0: (double)pit->hf_timeout / TICKS_PER_MSEC);
+		fprintf(fp, "\t\t  weight = %.3f;\n", pit->fs_ctx_map.weight);
+		fprintf(fp, "\t\t  map_min_share = %d;\n", (int)pit->fs_ctx_map.minshare);
+		fprintf(fp, "\t\t  reduce_min_share = %d;\n", (int)pit->fs_ctx_reduce.minshare);
+		fprintf(fp, "\t\t  sched_mode = \"%s\"; }",
+			pool::sched_str(pit->sched));
+	}
+	fprintf(fp, "\n       );\n");
+
+	fclose(fp);
+
+	return 0;
+}
+
+int main()
+{
+	try {
+		g_conf.readFile(CONFIG_FILE);
+	} catch (const FileIOException &e) {
+		cerr << "I/O error while reading " << CONFIG_FILE << endl;
+		exit(EXIT_FAILURE);
+	} catch(const ParseException &pex) {
+		cerr << "Parse error at " << pex.getFile() << ":" << pex.getLine()
+		     << " - " << pex.getError() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	int generations;
+	int population;
+	int threads;
+	int seed;
+	double quantile;
+	try {
+		g_input  = (const char *)g_conf.lookup("optimizer.input");
+		g_output = (const char *)g_conf.lookup("optimizer.output");
+		generations = g_conf.lookup("optimizer.generations");
+		population = g_conf.lookup("optimizer.population");
+		threads = g_conf.lookup("optimizer.threads");
+		seed = g_conf.lookup("optimizer.seed");
+		quantile = g_conf.lookup("optimizer.quantile");
+		create_job_tracker();
+		create_pools();
+	} catch (const SettingNotFoundException &e) {
+		cerr << "Missing a setting in configuration file" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if (import_workload1(g_input.c_str(), &g_job_tracker->getpools())) {
+		cerr << "Unable to load workload" << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	latency_objective obj(quantile);
+	create_goals(&obj);
+
+	pool_optimizer opt(g_nmaps, g_nreduces, g_job_tracker->getpools(), obj, threads);
+	opt.seed(seed);
+	opt.set_popsize(population);
+	double max_timeout;
+	if (g_conf.lookupValue("optimizer.max_timeout", max_timeout)) {
+		opt.set_bounds(pool_optimizer::PARAM_MS_TIMEOUT, 0, max_timeout * TICKS_PER_MSEC);
+		opt.set_bounds(pool_optimizer::PARAM_HF_TIMEOUT, 0, max_timeout * TICKS_PER_MSEC);
+	}
+
+	cerr << "Simulating the current settings ..." << endl;
+	cout << "Initial objective:" << opt.initial_value() << endl;
+	for (int i = 0; i < generations; ++i) {
+		double best = opt.step();
+		cerr << "Generation " << opt.generation() << " best:" << best
+		     << " sigma:" << opt.sigma() << endl;
+	}
+	cout << "Best objective:" << opt.best_value()
+	     << " after " << opt.evaluations() << " simulations" << endl;
+
+	// save the tuned settings without the workload
+	job_tracker::pool_container_type tuned = g_job_tracker->getpools();
+	for (job_tracker::pool_container_type::iterator pit = tuned.begin();
+	     pit != tuned.end(); ++pit)
+		pit->jobs.clear();
+	opt.apply_best(&tuned);
+	if (export_pools(g_output.c_str(), tuned)) {
+		cerr << "Unable to save the tuned settings" << endl;
+		exit(EXIT_FAILURE);
+	}
+	cerr << "Saved tuned settings to " << g_output << endl;
+
+	delete g_job_tracker;
+
+	return 0;
+}
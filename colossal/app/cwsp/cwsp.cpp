@@ -0,0 +1,75 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+// Parser of Hadoop job history files
+// Converts local, possibly concatenated, job history files into a
+// workload trace in one pass, in place of script/parser/parser.awk
+// run on a Hadoop cluster followed by app/cwsc/data/ds2wall.awk.
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-b] [-t NUM] [-u MS] -o TRACE HISTORY...\n"
+		"  -o TRACE  output workload trace\n"
+		"  -b        write the binary trace format\n"
+		"  -t NUM    parser threads, all online CPUs by default\n"
+		"  -u MS     time unit of the text trace in milliseconds, 1 by default\n"
+		"            as read by the simulators\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *output = NULL;
+	bool binary = false;
+	int nthreads = 0;
+	double unit = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "o:bt:u:h")) != -1) {
+		switch (opt) {
+		case 'o': output = optarg; break;
+		case 'b': binary = true; break;
+		case 't': nthreads = atoi(optarg); break;
+		case 'u': unit = atof(optarg); break;
+		default:
+			usage(argv[0]);
+			return opt == 'h'? EXIT_SUCCESS: EXIT_FAILURE;
+		}
+	}
+	if (output == NULL || optind == argc || unit <= 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	history_parser parser(nthreads);
+	parser.set_unit(unit);
+	for (int i = optind; i < argc; ++i) {
+		if (parser.parse(argv[i]))
+			return EXIT_FAILURE;
+	}
+	if (parser.write(output, binary))
+		return EXIT_FAILURE;
+	fprintf(stderr, "%zu records, %zu skipped; %zu jobs, %zu attempts written\n",
+		parser.records(), parser.skipped(), parser.jobs(), parser.attempts());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_ACCURACY_H
+#define _COLOSSAL_ACCURACY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "common.hpp"
+#include "engine.hpp"
+
+namespace colossal
+{
+
+// Error of simulated job completion times against those of a trace,
+// where the completion time of a job is the time from its creation to
+// the finish of its last task
+struct accuracy_stats {
+	size_t jobs;  // number of jobs finished in both
+	double mape;  // mean absolute relative error
+	double bias;  // mean relative error, > 0 if overestimated
+	double p50;   // nearest-rank quantiles of the absolute relative error
+	double p90;
+	double p99;
+	double max;
+
+	accuracy_stats() : jobs(0), mape(0), bias(0), p50(0), p90(0), p99(0), max(0) { }
+};
+
+// A calibration of the simulated cluster
+// The timeouts, in ticks, replace those of every pool unless KEEP.
+struct calibration {
+	static const sim_time KEEP = -2;
+
+	std::string name;
+	int         nmaps;
+	int         nreduces;
+	sim_time    ms_timeout;
+	sim_time    hf_timeout;
+
+	calibration(const std::string &n, int maps, int reduces,
+		    sim_time mto = KEEP, sim_time fto = KEEP)
+		: name(n), nmaps(maps), nreduces(reduces),
+		  ms_timeout(mto), hf_timeout(fto) { }
+};
+
+// Prediction accuracy of calibrations
+// The trace is loaded once with its actual start and finish times,
+// and each calibration simulates a copy of it. Calibrations are
+// simulated in parallel, one copy of the pools per thread.
+class accuracy_evaluator
+{
+public:
+	// pools: configured pools with the trace loaded, not processed
+	// nthreads: number of simulation threads, 0 to use all online CPUs
+	accuracy_evaluator(const engine::pool_container_type &pools, int nthreads = 0);
+
+	void add(const calibration &c) { _cals.push_back(c); }
+
+	// Simulate every calibration added
+	void run();
+
+	size_t size() const { return _cals.size(); }
+
+	const calibration &config(size_t i) const { return _cals[i]; }
+
+	// Accuracy of calibration i over all pools
+	const accuracy_stats &overall(size_t i) const { return _overall[i]; }
+
+	// Accuracy of calibration i for the pool of index p
+	const accuracy_stats &pool_stats(size_t i, size_t p) const { return _pools_stats[i][p]; }
+
+	// Index of the calibration of the least overall MAPE, -1 if none
+	int best() const;
+
+	// Simulate calibration i and evaluate it
+	void evaluate(size_t i);
+
+	// Accuracy of the predicted pools against the actual ones, in the
+	// same order, one entry per pool in stats
+	static accuracy_stats compare(const engine::pool_container_type &actual,
+				      const engine::pool_container_type &predicted,
+				      std::vector<accuracy_stats> *stats = NULL);
+
+private:
+	const engine::pool_container_type &_pools;
+	int _nthreads;
+	std::vector<calibration> _cals;
+	std::vector<accuracy_stats> _overall;
+	std::vector< std::vector<accuracy_stats> > _pools_stats;
+};
+
+}
+
+#endif
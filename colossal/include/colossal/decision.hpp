@@ -0,0 +1,131 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_DECISION_H
+#define _COLOSSAL_DECISION_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "common.hpp"
+#include "task.hpp"
+
+namespace colossal
+{
+
+// A scheduling decision of the engine
+struct decision {
+	enum decision_kind {
+		LAUNCH = 0,
+		FINISH,
+		PREEMPT,
+		BACKUP   // launch of a backup attempt
+	};
+
+	decision_kind   what;
+	task::task_type type;
+	sim_time        time;
+	uint64_t        id;    // task id
+
+	bool operator==(const decision &other) const
+	{
+		return what == other.what && type == other.type &&
+			time == other.time && id == other.id;
+	}
+
+	bool operator!=(const decision &other) const
+	{
+		return !(*this == other);
+	}
+
+	// TIME KIND TYPE TASK
+	std::string to_str() const;
+};
+
+// Writer of compact decision logs
+// Decisions are encoded into blocks that decode on their own. Each
+// decision takes a tag byte holding its kind, type and a small time
+// delta, with larger deltas following as varints. A task id seen
+// recently in the block, as in the finish of a launched task, is
+// written as its slot in a direct-mapped cache instead of in full.
+class decision_writer
+{
+public:
+	static const size_t BLOCK_SIZE;  // bytes
+
+	decision_writer() : _fp(NULL), _err(false), _n(0), _nrecs(0) { }
+	~decision_writer() { close(); }
+
+	// Returns 0 on success, -1 otherwise
+	int open(const char *file);
+
+	// Write the last block and close the file
+	// Returns 0 on success, -1 if anything failed to be written
+	int close();
+
+	void add(decision::decision_kind what, task::task_type type,
+		 sim_time time, uint64_t id);
+
+	// Number of decisions added
+	uint64_t size() const { return _n; }
+
+private:
+	void flush();
+
+	FILE    *_fp;
+	bool     _err;
+	uint64_t _n;
+	uint32_t _nrecs;  // in the current block
+	sim_time _base;   // time of the first decision in the block
+	sim_time _last;
+	std::vector<unsigned char> _buf;
+	uint64_t _cache[256];
+};
+
+// Streaming reader of decision logs
+class decision_reader
+{
+public:
+	decision_reader() : _fp(NULL) { }
+	~decision_reader() { close(); }
+
+	// Returns 0 on success, -1 otherwise
+	int  open(const char *file);
+	void close();
+
+	// Read the next decision
+	// Returns 1 if one was read, 0 at the end, -1 on corruption
+	int next(decision *d);
+
+private:
+	int load_block();
+
+	FILE    *_fp;
+	uint32_t _nrecs;  // left in the current block
+	size_t   _pos;
+	sim_time _last;
+	std::vector<unsigned char> _buf;
+	uint64_t _cache[256];
+};
+
+// Compare two decision logs
+// Returns 0 if they are identical, 1 if they diverge, with the index of
+// the first differing decision in pos, and -1 if either cannot be read.
+// A log that is a prefix of the other diverges at its end.
+int diff_decisions(const char *a, const char *b, uint64_t *pos);
+
+}
+
+#endif
@@ -15,9 +15,10 @@
 #ifndef _COLOSSAL_ENGINE_H
 #define _COLOSSAL_ENGINE_H
 
-#include <list>
+#include <deque>
 #include <vector>
 #include <string>
+#include <ulib/hash_open.h>
 #include "hlist.hpp"
 #include "pointer.hpp"
 #include "hashable.hpp"
@@ -26,64 +27,71 @@
 #include "pool.hpp"
 #include "event.hpp"
 #include "selector.hpp"
+#include "policy.hpp"
+#include "cluster.hpp"
+#include "decision.hpp"
 
 namespace colossal
 {
 
-template<typename T>
-struct map_fs_itr {
+class profiler;
+
+// Fair scheduling iterator over the pools of slot type S
+// T is the pool container type.
+template<typename S, typename T>
+struct slot_fs_itr {
 	typename T::iterator itr;
 
-	map_fs_itr(const typename T::iterator &it) : itr(it) { }
+	slot_fs_itr(const typename T::iterator &it) : itr(it) { }
 
-	map_fs_itr &operator++()
+	slot_fs_itr &operator++()
 	{
 		++itr;
 		return *this;
 	}
 
-	bool operator==(const map_fs_itr &other) const
+	bool operator==(const slot_fs_itr &other) const
 	{
 		return itr == other.itr;
 	}
 
-	bool operator!=(const map_fs_itr &other) const
+	bool operator!=(const slot_fs_itr &other) const
 	{
 		return itr != other.itr;
 	}
 
 	operator fs_context *()
 	{
-		return &itr->fs_ctx_map;
+		return &S::ctx(&*itr);
 	}
 };
 
-template<typename T>
-struct reduce_fs_itr {
-	typename T::iterator itr;
-
-	reduce_fs_itr(const typename T::iterator &it) : itr(it) { }
+// Parameters of speculative execution
+// A running task is a straggler if its progress rate is below
+// slow_ratio times the mean rate of the finished tasks of the same job
+// and type, and it has run for at least min_runtime. Backups go to
+// free slots only, at most cap of the slots each, and are launched
+// for the stragglers with the longest estimated time left first.
+struct spec_params {
+	double   slow_ratio;
+	double   cap;          // fraction of the slots
+	sim_time min_runtime;
+	sim_time interval;     // between two straggler checks
 
-	reduce_fs_itr &operator++()
-	{
-		++itr;
-		return *this;
-	}
-
-	bool operator==(const reduce_fs_itr &other) const
-	{
-		return itr == other.itr;
-	}
+	spec_params()
+		: slow_ratio(0.5), cap(0.1),
+		  min_runtime(60000 * TICKS_PER_MSEC),
+		  interval(10000 * TICKS_PER_MSEC) { }
+};
 
-	bool operator!=(const reduce_fs_itr &other) const
-	{
-		return itr != other.itr;
-	}
+// Outcome of the backup attempts, over both slot types
+struct spec_stats {
+	size_t   launched;
+	size_t   won;        // finished before the original attempt
+	size_t   killed;     // original finished first, or was preempted
+	sim_time slot_time;  // slot time spent on backups
 
-	operator fs_context *()
-	{
-		return &itr->fs_ctx_reduce;
-	}
+	spec_stats() : launched(0), won(0), killed(0), slot_time(0) { }
 };
 
 class engine
@@ -96,20 +104,33 @@ public:
 
         typedef hlist<stime_hash>    taskset_type;
         typedef std::vector<event *> eventheap_type;
-	typedef std::list<pool>      pool_container_type;
+	typedef std::deque<pool>     pool_container_type;
 	typedef vsem<event *>        vsem_type;
 
+	// Victims of preemption, see fair_victim and min_lost_victim
+	enum victim_policy {
+		VICTIM_FAIR,     // pools above their fair shares, the default
+		VICTIM_MIN_LOST  // the youngest tasks of pools above their min shares
+	};
+
         engine(int nmaps,        // number of map slots in the cluster
 	       int nreduces,     // number of reduce slots in the cluster
-	       double now = 0);  // job_tracker boot time
+	       sim_time now = 0);  // job_tracker boot time
 
         ~engine();
 
 	// Set the output metric file and metric sampling window size
-	bool set_metrics(const char * met, int met_win);
+	// With interval > 0, the pool metrics are instead the averages of
+	// the time integrals of the pool status over each interval of
+	// simulated time, see fs_integral.
+	bool set_metrics(const char * met, int met_win, sim_time interval = 0);
+
+	// Record the launches, preemptions and finishes of tasks into a
+	// decision log, written by the end of process()
+	bool set_decisions(const char *file);
 
 	// Add a pool to the engine
-	pool &add_pool(const std::string &ns, double mto, double fto,
+	pool &add_pool(const std::string &ns, sim_time mto, sim_time fto,
 		       double weight, int minmap, int minred,
 		       pool::sched_mode sched);
 
@@ -117,24 +138,120 @@ public:
 	// Required if pool min shares exceed the maximum number of slots
 	void scale_minshares();
 
+	// Profile the hot paths of process(), writing a summary table and
+	// optionally a trace of queue depths in buckets of simulated time
+	// Requires building with -DCOLOSSAL_PROFILE.
+	bool set_profile(const char *summary, const char *trace = NULL,
+			 sim_time bucket = 60000 * TICKS_PER_MSEC);
+
+	// Launch backup attempts of straggling tasks, see spec_params
+	// The first attempt to finish completes the task and the other
+	// one is killed. Backups count towards the pool allocation.
+	bool set_speculation(const spec_params &params);
+	const spec_stats &speculation() const { return _spec_stats; }
+
+	// Change the number of map and reduce slots at time t, -1 to
+	// leave one unchanged
+	// When capacity drops below the running tasks, backups and then
+	// the latest started tasks are killed and requeued.
+	void add_capacity(sim_time t, int nmaps, int nreduces);
+
+	// Model the nodes of the cluster, taking the ownership of c
+	// The engine then has the slots of the cluster. Maps are placed on
+	// their block locations by delay scheduling, and run longer when
+	// not node-local. Not supported with speculation or capacity
+	// changes.
+	void set_cluster(cluster *c);
+	const cluster *getcluster() const { return _cluster; }
+
+	// Number of maps launched at the locality level
+	size_t launches(cluster::locality level) const { return _nlaunch[level]; }
+
+	// Run in the container mode, as YARN does
+	// Tasks then hold containers of memory and vcores out of a vector
+	// capacity shared by maps and reduces, in place of slots. A task
+	// runs in the container of its type given by its pool, or the
+	// default map or reduce one. Pools are shared by dominant resource
+	// fairness: the fair shares come from compute_drf_shares(), the
+	// neediest pool by dominant share is served first and waits until
+	// its container fits, and preemption frees up the resources the
+	// starved pool needs. Not supported with the node model,
+	// speculation or capacity changes.
+	// Returns false if a resource is not positive.
+	bool set_containers(const resource &capacity, const resource &map,
+			    const resource &reduce);
+	bool containers() const { return _drf; }
+	const resource &capacity() const { return _total; }
+	const resource &free_resources() const { return _free; }
+
+	// Model reduce slow-start and the shuffle
+	// The reduces of a job are seen by the scheduler only once the
+	// fraction of its maps have finished, as with Hadoop's
+	// mapred.reduce.slowstart.completed.maps, and a reduce then holds
+	// its slot until the last map of its job has finished, if it would
+	// finish earlier. A fraction < 0 disables it, the default. Not
+	// supported with speculation.
+	void set_slowstart(double fraction) { _slowstart = fraction; }
+
+	// Choose the victims of preemption, and restart each preempted
+	// task overhead later than its ptime alone
+	// The slot time lost to preemption and the restart overheads are
+	// accounted in pool::preempts and job::lost.
+	void set_preemption(victim_policy victims, sim_time overhead = 0)
+	{
+		_victims = victims;
+		_restart_overhead = overhead;
+	}
+
+	// Show processing progress on stderr, enabled by default
+	void set_progress(bool on) { _progress = on; }
+
+	// Keep the start and finish times of each task, disabled by
+	// default, see task_list
+	// Otherwise only the latest finish and the number of finished
+	// tasks of each job are kept, which is all the objectives and the
+	// predictions need.
+	void set_record_times(bool on) { _record_times = on; }
+
 	// Start processing jobs in the pools
-        void process();
+	// With resume, tasks that have started but not finished
+	// (stime >= 0, ftime < 0) hold their slots from the boot time
+	// on, which allows fast-forwarding a snapshot of a live cluster.
+        void process(bool resume = false);
+
+	// Number of events handled by the last process()
+	size_t events() const { return _nevents; }
 
 	const pool_container_type &getpools() const { return _pools; }
 	pool_container_type &getpools() { return _pools; }
 
 	// Event APIs
 	void add_event(event *ev);
-	void run_map(td_ref *t);
-	void run_reduce(td_ref *t);
+	bool run_map(td_ref *t);  // false if deferred for locality
+	bool run_reduce(td_ref *t);
 	void finish_map(td_ref *t);
 	void finish_reduce(td_ref *t);
-        void preempt_maps(int num);
-        void preempt_reduces(int num);
+	// release the ref of an attempt whose finish event has fired,
+	// unless it is still running
+	void retire_map(td_ref *t);
+	void retire_reduce(td_ref *t);
+	// preempt num tasks, or in the container mode the resources of
+	// num tasks of the starved pool p
+        void preempt_maps(int num, pool *p = NULL);
+        void preempt_reduces(int num, pool *p = NULL);
+	// whether the next task may run in the container mode
+	bool admit_map();
+	bool admit_reduce();
 	void update_map_fairshares();
 	void update_reduce_fairshares();
+	void set_slots(int nmaps, int nreduces);
+	void escalate_map(td_ref *t, uint64_t id);
+	template<typename S> void speculate();
+	template<typename S> bool has_backup(uint64_t id, sim_time stime);
+	template<typename S> void finish_backup(td_ref *t);
 
-	double        time_now;
+	sim_time      time_now;
+	unsigned      create_chain[task::TASK_TYPE_NUM];  // live task creation chains
         vsem_type    *sem_map;
         vsem_type    *sem_reduce;
         taskset_type *running_maps;
@@ -142,16 +259,163 @@ public:
 	selector     *select;
 
 private:
+	// map and reduce twins, see map_slot and reduce_slot
+	template<typename S> bool run(td_ref *t);
+	template<typename S> void start(td_ref *t);
+	template<typename S> void finish(td_ref *t);
+	template<typename S> void retire(td_ref *t);
+	template<typename S, typename V> int preempt(int num, pool *p = NULL);
+	template<typename S> bool evict(td_ref *t);
+	template<typename S> void index(td_ref *t);
+	template<typename S> bool admit();
+	template<typename S> void unblock();
+	void unblock();
+	void resolve_containers();
+	template<typename S> void resize(int n);
+	template<typename S> void resume();
+	template<typename S> void update_fairshares();
+	template<typename S> void arm_speculation();
+	template<typename S> bool drop_backup(td_ref *t, bool won);
+	template<typename S> int  drop_backups(int num);
+	template<typename S> bool place(td_ref *t);
+	template<typename S> void assign(td_ref *t, int node, cluster::locality level);
+	template<typename S> int  unplace(td_ref *t, sim_time *base);
+	template<typename S> bool relaunch(int node);
+	void map_done(td_ref *t);
+	bool wait_shuffle(td_ref *t);
+	cluster::locality allowed(job *j);
+	void defer(td_ref *t);
+	void launch_deferred(td_ref *t, int node, cluster::locality level);
+	bool deferred(td_ref *t, uint64_t id) const;
+
+	// a running backup attempt, keyed by task id
+	struct backup {
+		td_ref  *ref;
+		sim_time stime;
+		sim_time ptime;
+	};
+
+	// durations of the finished tasks of a job, keyed by job address
+	struct job_rate {
+		sim_time sum;
+		size_t   n;
+	};
+
+	typedef ulib::open_hash_map<uint64_t, backup>   backup_map_type;
+	typedef ulib::open_hash_map<uint64_t, job_rate> rate_map_type;
+
+	// the node of a running task and its runtime before inflation
+	struct placement {
+		int      node;
+		sim_time base;
+	};
+
+	// delay scheduling state of a job: the locality level of its last
+	// launch and when that was
+	struct job_delay {
+		cluster::locality level;
+		sim_time          since;
+	};
+
+	// a map waiting for a slot close to its blocks
+	struct deferral {
+		td_ref *ref;
+		bool    escalated;
+	};
+
+	// an entry of the wait lists, which may outlive the ref once the
+	// map has launched and finished, hence the id to check it by
+	struct waiting {
+		td_ref  *ref;
+		uint64_t id;
+	};
+
+	// a running task in the start order index
+	// The entry holds a copy of the ref, which keeps the task_desc of
+	// the attempt alive after the selector has released the ref.
+	struct started {
+		td_ref   ref;
+		sim_time stime;
+	};
+
+	static bool by_stime(const started &a, const started &b)
+	{
+		return a.stime < b.stime;
+	}
+
+	template<typename S> td_ref *live(started &s);
+
+	typedef ulib::open_hash_map<uint64_t, sim_time>  restart_map_type;
+	typedef ulib::open_hash_map<uint64_t, placement> placement_map_type;
+	typedef ulib::open_hash_map<uint64_t, job_delay> delay_map_type;
+	typedef ulib::open_hash_map<uint64_t, deferral>  deferral_map_type;
+
+	// slow-start state of a job
+	struct job_deps {
+		int hold;       // maps left to finish before the reduces are released
+		int maps_left;  // unfinished maps
+		std::vector<td_ref *> parked;  // reduces done but for the shuffle
+
+		job_deps() : hold(0), maps_left(0) { }
+	};
+
+	job_deps &deps(td_ref *t) { return _deps[_job_base[t->getpool()->idx] + t->getjob()->idx]; }
+
+	struct capacity_change {
+		sim_time time;
+		int      nslots[task::TASK_TYPE_NUM];
+	};
+
         void   submit_tasks();
+	void   resume_tasks();
+	void   save_profile(uint64_t cycles, double seconds) const;
+	void   settle_integrals();
+	void   print_integrals(metric &met, sim_time until);
 	double map_progress() const;
 	double reduce_progress() const;
 
         pool_container_type _pools;
         eventheap_type _eventheap;
-        int _nmap;
-        int _nreduce;
+	int _nslots[task::TASK_TYPE_NUM];  // indexed by task::task_type
 	int _met_win;
+	sim_time _met_interval;
+	sim_time _met_begin;  // start of the current metric interval
 	FILE * _fp_met;
+	decision_writer *_decisions;
+	bool _progress;
+	bool _record_times;
+	size_t _nevents;
+	profiler *_prof;
+	std::string _prof_summary;
+	std::string _prof_trace;
+	bool _spec;
+	bool _spec_armed[task::TASK_TYPE_NUM];
+	spec_params _spec_params;
+	spec_stats  _spec_stats;
+	backup_map_type _backups[task::TASK_TYPE_NUM];
+	rate_map_type   _rates[task::TASK_TYPE_NUM];
+	std::vector<capacity_change> _capacity;
+	cluster *_cluster;
+	size_t   _nlaunch[cluster::LOCALITY_NUM];
+	placement_map_type _placed[task::TASK_TYPE_NUM];
+	delay_map_type     _delays;     // keyed by job address
+	deferral_map_type  _deferred;   // keyed by task id
+	std::vector< std::vector<waiting> > _node_waits;  // deferred maps by block node
+	std::vector<waiting> _escalated;  // deferred maps past a delay
+	double _slowstart;
+	bool     _drf;  // container mode
+	resource _total;
+	resource _free;
+	resource _containers[task::TASK_TYPE_NUM];  // defaults
+	bool     _blocked[task::TASK_TYPE_NUM];     // task creation waits for resources
+	std::vector<drf_user> _drf_users;           // pool contexts of both types
+	std::vector<size_t>   _job_base;  // dense index of the first job of each pool
+	std::vector<job_deps> _deps;      // by dense job index
+	victim_policy _victims;
+	sim_time      _restart_overhead;
+	restart_map_type     _restarts[task::TASK_TYPE_NUM];  // overhead of the attempt, by task id
+	std::vector<started> _started[task::TASK_TYPE_NUM];   // in start order, with the finished
+	size_t               _started_live[task::TASK_TYPE_NUM];  // running by the last compaction
 };
 
 }
@@ -23,16 +23,16 @@
 namespace colossal {
 
 struct ut_pt {
-	double time;
+	sim_time time;
 
 	ut_pt() { }
 
-	ut_pt(double t) : time(t) { }
+	ut_pt(sim_time t) : time(t) { }
 
 	bool operator> (const ut_pt &other) const
 	{
-		double a = time < 0? -time: time;
-		double b = other.time < 0? -other.time: other.time;
+		sim_time a = time < 0? -time: time;
+		sim_time b = other.time < 0? -other.time: other.time;
 		return a > b;
 	}
 };
@@ -40,6 +40,8 @@ struct ut_pt {
 DEFINE_HEAP(ut, ut_pt, std::greater<ut_pt>());
 
 // Compute cluster utilization
+// The times of the tasks must have been recorded, see
+// engine::set_record_times().
 double compute_utilization(
 	const job_tracker::pool_container_type &pools,
 	task::task_type type, int nslots);
@@ -54,12 +56,26 @@ void print_pool_settings(const job_tracker::pool_container_type &pools);
 
 // Import from workload generated by the parser, where each line is in the format:
 // POOL"\t"JOB:PRIORITY"\t"TASK"\t"<MAP|REDUCE>"\t"CTIME"\t"STIME"\t"FTIME
+// Times are in milliseconds and get converted to ticks.
 int import_workload(const char *file, job_tracker::pool_container_type *pools);
 
 // Import from workload generated by the parser, where each line is in the format:
 // POOL"\t"JOB:PRIORITY"\t"TASK"\t"<MAP|REDUCE>"\t"CTIME"\t"PTIME
+// Times are in milliseconds and get converted to ticks.
 int import_workload1(const char *file, job_tracker::pool_container_type *pools);
 
+// Import a cluster capacity timeline, where each line is in the format:
+// TIME"\t"MAP_SLOTS"\t"REDUCE_SLOTS
+// Times are in milliseconds, and lines starting with '#' are skipped.
+int import_capacity(const char *file, job_tracker *jt);
+
+// Import the input block locations of maps, where each line is in the format:
+// TASK"\t"NODE[,NODE...]
+// with nodes numbered from 0 as in the cluster model.
+int import_blocks(const char *file, cluster *c);
+
+// Write the times of each task, as recorded, see
+// engine::set_record_times()
 int export_schedule(const char *file, const job_tracker::pool_container_type &pools);
 
 }
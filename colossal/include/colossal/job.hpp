@@ -25,15 +25,35 @@ namespace colossal
 
 struct job
 {
-	typedef std::vector<task> task_container_type;
+	typedef task_list task_container_type;
 
         uint64_t   id;
-	double     ctime;
+	size_t     idx;        // dense index in its pool, set by the selector
+	sim_time   ctime;
+	sim_time   deadline;   // completion deadline for EDF, < 0 if none
+	sim_time   work;       // total processing time, set by the selector
+	sim_time   work_left;  // processing time of unfinished tasks
+	sim_time   lost;       // slot time of its preempted attempts
 	fs_context fs_ctx_map;
 	fs_context fs_ctx_reduce;
         task_container_type tasks[task::TASK_TYPE_NUM];
 
+	job() : id(0), idx(0), ctime(0), deadline(-1), work(0), work_left(0), lost(0) { }
+
 	static uint64_t id_from_str(const char *str);
+	static uint64_t id_from_str(const char *str, size_t len);
+
+	// Id of the task at idx among the tasks of a type
+	uint64_t task_id(task::task_type type, size_t idx) const
+	{
+		const task_list &tl = tasks[type];
+		return tl.has_ids()? tl.id(idx): task::make_id(id, type, idx);
+	}
+
+	// Finish of its last task, < 0 unless all have finished
+	sim_time finish() const;
+	// Finish of its latest finished task, < 0 if none
+	sim_time last_finish() const;
 
         std::string to_str(const char *prefix = "") const;
 };
@@ -27,21 +27,62 @@ public:
 
 	job_tracker(int nmaps,        // Number of map slots in the cluster
 		    int nreduces,     // Number of reduce slots in the cluster
-		    double now = 0);  // Boot time of the job tracker
+		    sim_time now = 0);  // Boot time of the job tracker
 
 	virtual ~job_tracker();
 
-	// Set the output metric file and sampling window size
-	bool set_metrics(const char * met, int met_win);
+	// Set the output metric file and sampling window size, or the
+	// interval of time-averaged metrics, see engine::set_metrics()
+	bool set_metrics(const char * met, int met_win, sim_time interval = 0);
+
+	// Record the scheduling decisions, see engine::set_decisions()
+	bool set_decisions(const char *file);
+
+	// Write a hot-path profile of process(), see engine::set_profile()
+	bool set_profile(const char *summary, const char *trace = NULL,
+			 sim_time bucket = 60000 * TICKS_PER_MSEC);
 
 	// Add a pool to the engine
-	pool &add_pool(const std::string &ns, double mto, double fto,
+	pool &add_pool(const std::string &ns, sim_time mto, sim_time fto,
 		       double weight, int minmap, int minred,
 		       pool::sched_mode sched);
 
 	// Start processing all jobs
 	void process();
 
+	// Show processing progress on stderr, enabled by default
+	void set_progress(bool on);
+
+	// Keep the start and finish times of each task, see
+	// engine::set_record_times()
+	void set_record_times(bool on);
+
+	// Number of events handled by the last process()
+	size_t events() const;
+
+	// Change the number of slots at time t, -1 to leave one unchanged
+	void add_capacity(sim_time t, int nmaps, int nreduces);
+
+	// Model the nodes of the cluster, see engine::set_cluster()
+	void set_cluster(cluster *c);
+	size_t launches(cluster::locality level) const;
+
+	// Launch backup attempts of straggling tasks
+	bool set_speculation(const spec_params &params);
+	const spec_stats &speculation() const;
+
+	// Run in the container mode with DRF, see engine::set_containers()
+	bool set_containers(const resource &capacity, const resource &map,
+			    const resource &reduce);
+
+	// Release reduces once a fraction of their job's maps have
+	// finished, see engine::set_slowstart()
+	void set_slowstart(double fraction);
+
+	// Choose the victims of preemption and the restart overhead, see
+	// engine::set_preemption()
+	void set_preemption(engine::victim_policy victims, sim_time overhead = 0);
+
 	// Scale map and reduce min shares
 	// Required if min shares exceed the total number of slots
 	void scale_minshares();
@@ -0,0 +1,133 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_LOADER_H
+#define _COLOSSAL_LOADER_H
+
+#include <cstdio>
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "engine.hpp"
+#include "transform.hpp"
+
+namespace colossal
+{
+
+// Parallel workload loader
+// The trace is mapped into memory and split into line-aligned
+// chunks, each of which is parsed on its own thread. The parsed
+// records are then merged in file order, so the resulting pools are
+// identical to those of a sequential scan.
+// A trace in the binary format, as written by workload_writer, is
+// detected by its magic and loaded whatever the format given, provided
+// it was written by a build of the same tick unit.
+class workload_loader
+{
+public:
+	// Both formats take an optional trailing DEADLINE column, the
+	// completion deadline of the job used by pool::SCHED_EDF.
+	enum trace_format {
+		// POOL JOB:PRIORITY TASK <MAP|REDUCE> CTIME STIME FTIME [DEADLINE]
+		FORMAT_STFT,
+		// POOL JOB:PRIORITY TASK <MAP|REDUCE> CTIME PTIME [DEADLINE]
+		FORMAT_PTIME
+	};
+
+	// nthreads: number of parser threads, 0 to use all online CPUs
+	workload_loader(trace_format fmt, int nthreads = 0);
+	~workload_loader();
+
+	// Load the trace into the configured pools
+	// Returns 0 on success, -1 otherwise
+	int load(const char *file, engine::pool_container_type *pools);
+
+	// Only load tasks created in [begin, end)
+	// The trace must then be sorted by creation time, and only the
+	// part of it covering the window is parsed, as located by its
+	// sidecar trace_index.
+	void set_window(sim_time begin, sim_time end)
+	{
+		_windowed = true;
+		_begin = begin;
+		_end = end;
+	}
+
+	// Append a stage to the transformation pipeline, taking the
+	// ownership of t
+	// The window, if any, applies to the trace before the stages.
+	void add_transform(workload_transform *t) { _stages.push_back(t); }
+
+	// Keep the trace ids of the tasks, hashed from their names
+	// Only needed to look tasks up by name, as the blocks of a cluster
+	// do, the ids being derived from the task index otherwise, see
+	// job::task_id().
+	void set_keep_ids(bool on) { _keep_ids = on; }
+
+	// Number of tasks loaded by the last call to load(), after the
+	// transformation
+	size_t records() const { return _nrec; }
+
+	// Weight of a Hadoop job priority, NORMAL, HIGH or VERY_HIGH
+	// Returns false if the priority is unrecognized.
+	static bool priority_weight(const char *str, size_t len, double *weight);
+
+private:
+	int load_binary(const char *base, size_t size, engine::pool_container_type *pools);
+
+	trace_format _fmt;
+	int          _nthreads;
+	size_t       _nrec;
+	bool         _keep_ids;
+	bool         _windowed;
+	sim_time     _begin;
+	sim_time     _end;
+	std::vector<workload_transform *> _stages;
+};
+
+// Writer of binary workload traces
+// Each task is a fixed-size record holding the hashed pool, job and
+// task ids with the times in ticks, so that loading needs no parsing
+// and the records split evenly among the loader threads. The header
+// records the tick unit, TICKS_PER_MSEC.
+class workload_writer
+{
+public:
+	workload_writer() : _fp(NULL), _err(false), _n(0) { }
+	~workload_writer() { close(); }
+
+	// Returns 0 on success, -1 otherwise
+	int open(const char *file);
+
+	// Returns 0 on success, -1 if anything failed to be written
+	int close();
+
+	// The ids are those of pool::id_from_str(), job::id_from_str() and
+	// task::id_from_str()
+	// A task without a start time (stime < 0) keeps only its ptime.
+	void add(uint64_t pid, uint64_t jid, uint64_t tid, double weight,
+		 task::task_type type, const task &t, sim_time deadline = -1);
+
+	// Number of records added
+	uint64_t size() const { return _n; }
+
+private:
+	FILE    *_fp;
+	bool     _err;
+	uint64_t _n;
+};
+
+}
+
+#endif
@@ -16,21 +16,42 @@
 #define _COLOSSAL_LOG_H
 
 #include <cstdio>
+#include "common.hpp"
+#include "logger.hpp"
+
+// Log a record of an event kind, about a pool if it is nonzero
+// The record goes to the logger if it is running, and is otherwise
+// written synchronously to fp.
+#define COLOSSAL_LOG(level, tag, fp, kind, pool, time, fmt, ...)	\
+	do {								\
+		if (colossal::logger::enabled(level, kind, pool)) {	\
+			static int _log_code = -1;			\
+			if (!colossal::logger::write(&_log_code, level, kind, pool, \
+						     time, fmt, ##__VA_ARGS__)) \
+				fprintf(fp, tag " @%lld\t" fmt "\n",	\
+					(long long)(time), ##__VA_ARGS__); \
+		}							\
+	} while (0)
 
 #ifdef NDEBUG
-#define DEBUG(time, fmt, ...)
+#define DEBUG(kind, time, fmt, ...)
+#define DEBUG_POOL(kind, pool, time, fmt, ...)
 #else
-#define DEBUG(time, fmt, ...)						\
-	fprintf(stdout, "[D] @%f\t" fmt "\n", time, ##__VA_ARGS__)
+#define DEBUG(kind, time, fmt, ...)					\
+	DEBUG_POOL(kind, 0, time, fmt, ##__VA_ARGS__)
+#define DEBUG_POOL(kind, pool, time, fmt, ...)				\
+	COLOSSAL_LOG(colossal::LEVEL_DEBUG, "[D]", stdout, kind, pool, time, fmt, ##__VA_ARGS__)
 #endif
 
-#define NOTICE(time, fmt, ...)						\
-	fprintf(stdout, "[I] @%f\t" fmt "\n", time, ##__VA_ARGS__)
+#define NOTICE(kind, time, fmt, ...)					\
+	NOTICE_POOL(kind, 0, time, fmt, ##__VA_ARGS__)
+#define NOTICE_POOL(kind, pool, time, fmt, ...)				\
+	COLOSSAL_LOG(colossal::LEVEL_NOTICE, "[I]", stdout, kind, pool, time, fmt, ##__VA_ARGS__)
 
-#define WARNING(time, fmt, ...)						\
-	fprintf(stderr, "[W] @%f\t" fmt "\n", time, ##__VA_ARGS__)
+#define WARNING(kind, time, fmt, ...)					\
+	COLOSSAL_LOG(colossal::LEVEL_WARNING, "[W]", stderr, kind, 0, time, fmt, ##__VA_ARGS__)
 
-#define FATAL(time, fmt, ...)						\
-	fprintf(stderr, "[E] @%f\t" fmt "\n", time, ##__VA_ARGS__)
+#define FATAL(kind, time, fmt, ...)					\
+	COLOSSAL_LOG(colossal::LEVEL_FATAL, "[E]", stderr, kind, 0, time, fmt, ##__VA_ARGS__)
 
 #endif
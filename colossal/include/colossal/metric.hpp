@@ -39,6 +39,7 @@ public:
 
 	void set_value(double val);
 	void set_value(int val);
+	void set_value(int64_t val);
 	void set_value(uint64_t val);
 
 	metric operator[](const std::string &key);
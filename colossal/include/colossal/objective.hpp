@@ -0,0 +1,75 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_OBJECTIVE_H
+#define _COLOSSAL_OBJECTIVE_H
+
+#include <stdint.h>
+#include <ulib/hash_open.h>
+#include "common.hpp"
+#include "engine.hpp"
+
+namespace colossal
+{
+
+// Objective of simulated pools, lower is better
+// Implementations are shared by concurrent simulations, and thus must
+// not modify any state when evaluated.
+class objective
+{
+public:
+	virtual ~objective() { }
+
+	virtual double operator()(const engine::pool_container_type &pools) const = 0;
+};
+
+// Weighted quantile of the job latencies in pools, where the latency
+// of a job is the time from its creation to the finish of its last
+// task. Pools may have a latency SLA, and the part of a pool quantile
+// exceeding its SLA is penalized.
+class latency_objective : public objective
+{
+public:
+	static const double DEFAULT_PENALTY;
+
+	latency_objective(double quantile = 0.95, double penalty = DEFAULT_PENALTY)
+		: _quantile(quantile), _penalty(penalty) { }
+
+	// Importance of a pool, 1 by default, 0 to ignore the pool
+	void set_weight(const std::string &pool, double weight);
+
+	// Latency SLA of a pool, < 0 to disable
+	void set_sla(const std::string &pool, sim_time sla);
+
+	// Latency quantile of jobs in a pool, -1 if no job has finished
+	sim_time latency(const pool &p) const;
+
+	virtual double operator()(const engine::pool_container_type &pools) const;
+
+private:
+	struct goal {
+		double   weight;
+		sim_time sla;
+	};
+
+	goal lookup(uint64_t pid) const;
+
+	double _quantile;
+	double _penalty;  // penalty per tick above the SLA
+	ulib::open_hash_map<uint64_t, goal> _goals;
+};
+
+}
+
+#endif
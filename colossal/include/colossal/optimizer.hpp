@@ -0,0 +1,129 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_OPTIMIZER_H
+#define _COLOSSAL_OPTIMIZER_H
+
+#include <stdint.h>
+#include <vector>
+#include <ulib/math_rand_prot.h>
+#include <ulib/math_rng_normal.h>
+#include "common.hpp"
+#include "engine.hpp"
+#include "objective.hpp"
+
+namespace colossal
+{
+
+// Pool configuration optimizer
+// Searches pool weights, min shares and preemption timeouts that
+// minimize an objective of the simulated workload. The search is a
+// separable CMA-ES (diagonal covariance) on parameters normalized to
+// their bounds, starting from the given configuration. Candidates of
+// each generation are simulated in parallel.
+class pool_optimizer
+{
+public:
+	enum param {
+		PARAM_WEIGHT = 0,
+		PARAM_MAP_MINSHARE,
+		PARAM_REDUCE_MINSHARE,
+		PARAM_MS_TIMEOUT,  // only tuned if enabled
+		PARAM_HF_TIMEOUT,  // only tuned if enabled
+		PARAM_NUM
+	};
+
+	// pools: configured pools with the workload loaded, not processed
+	// nthreads: number of simulation threads, 0 to use all online CPUs
+	pool_optimizer(int nmaps, int nreduces,
+		       const engine::pool_container_type &pools,
+		       const objective &obj, int nthreads = 0);
+
+	// Set the search range of a parameter
+	// Defaults are [0.1, 10] for weights, up to the cluster size for
+	// min shares, and up to one hour for timeouts.
+	void set_bounds(param p, double lo, double hi);
+
+	void seed(uint64_t s)
+	{
+		RAND_NR_INIT(_rnorm.u, _rnorm.v, _rnorm.w, s);
+	}
+
+	// Population size, 0 for the default of 4 + 3 ln(n)
+	void set_popsize(int n) { _popsize = n; }
+
+	// Evaluate the candidates by the fluid_model rather than the
+	// engine, trading accuracy for far faster generations
+	void set_fluid(bool on) { _fluid = on; }
+
+	// Run a generation, returning the best objective value so far
+	double step();
+
+	// Run generations, returning the best objective value
+	double run(int generations);
+
+	// Objective value of the given configuration
+	double initial_value();
+
+	double best_value() const { return _best_val; }
+	int    generation() const { return _gen; }
+	int    evaluations() const { return _nevals; }
+	double sigma() const { return _sigma; }
+
+	// Apply the best configuration found to pools in the same order
+	// as those given to the constructor
+	void apply_best(engine::pool_container_type *pools) const;
+
+	// Simulate the pools configured by the normalized parameters x
+	double evaluate(const std::vector<double> &x) const;
+
+private:
+	struct dim {
+		size_t pool;  // index of the pool
+		param  p;
+	};
+
+	void init();
+	void apply(const std::vector<double> &x,
+		   engine::pool_container_type *pools) const;
+	double normal() { return normal_rng_next(&_rnorm); }
+
+	int _nmaps;
+	int _nreduces;
+	int _nthreads;
+	int _popsize;
+	bool _fluid;
+	const engine::pool_container_type &_pools;
+	const objective &_obj;
+	double _lo[PARAM_NUM];
+	double _hi[PARAM_NUM];
+	normal_rng _rnorm;
+
+	// search state
+	std::vector<dim>    _dims;
+	std::vector<double> _mean;
+	std::vector<double> _diag;  // diagonal of the covariance
+	std::vector<double> _ps;    // evolution path of sigma
+	std::vector<double> _pc;    // evolution path of the covariance
+	double _sigma;
+	int    _gen;
+	int    _nevals;
+	std::vector<double> _best;
+	double _best_val;
+	double _init_val;
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_PROFILE_H
+#define _COLOSSAL_PROFILE_H
+
+#include <cstdio>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "common.hpp"
+
+#ifdef COLOSSAL_PROFILE
+#include <ulib/os_rdtsc.h>
+#endif
+
+namespace colossal
+{
+
+// Instrumented hot paths
+enum prof_point {
+	PROF_EV_CREATE_MAP = 0,
+	PROF_EV_CREATE_REDUCE,
+	PROF_EV_FINISH_MAP,
+	PROF_EV_FINISH_REDUCE,
+	PROF_EV_PREEMPT_MAP,
+	PROF_EV_PREEMPT_REDUCE,
+	PROF_POP_MAP,
+	PROF_POP_REDUCE,
+	PROF_FAIRSHARES,
+	PROF_PREEMPT_MAPS,
+	PROF_PREEMPT_REDUCES,
+	PROF_METRICS,
+	PROF_SPECULATE,
+	PROF_NUM
+};
+
+// Engine profiler
+// Counts and times the hot paths in CPU cycles, and samples the event
+// queue depth and the slot wait-list lengths in buckets of simulated
+// time. Timings are inclusive, e.g. ev_create_map includes pop_map.
+// The hot paths are only instrumented when built with
+// -DCOLOSSAL_PROFILE, otherwise the PROF_* macros expand to nothing.
+class profiler
+{
+public:
+	profiler(sim_time bucket) : _bucket(bucket > 0? bucket: 1) { reset(); }
+
+	void reset();
+
+	void record(prof_point pt, uint64_t cycles)
+	{
+		++_count[pt];
+		_cycles[pt] += cycles;
+	}
+
+	void sample(sim_time now, size_t events, size_t map_waits, size_t reduce_waits);
+
+	// Write the summary table
+	// cycles and seconds are the totals of the profiled run.
+	void report(FILE *fp, uint64_t cycles, double seconds) const;
+
+	// Write the time-bucketed samples as TSV
+	void trace(FILE *fp) const;
+
+	// Profiler of the calling thread, NULL if none
+	static profiler *current();
+	static void set_current(profiler *prof);
+
+	static const char *name(prof_point pt);
+
+private:
+	struct bucket {
+		sim_time time;        // bucket start time
+		uint64_t events;      // events processed
+		size_t   max_events;  // max event queue depth
+		size_t   max_map_waits;
+		size_t   max_reduce_waits;
+	};
+
+	sim_time _bucket;
+	uint64_t _count[PROF_NUM];
+	uint64_t _cycles[PROF_NUM];
+	std::vector<bucket> _buckets;
+};
+
+#ifdef COLOSSAL_PROFILE
+
+// Times the enclosing scope
+class prof_scope
+{
+public:
+	prof_scope(prof_point pt) : _pt(pt), _start(rdtsc()) { }
+
+	~prof_scope()
+	{
+		profiler *prof = profiler::current();
+		if (prof)
+			prof->record(_pt, rdtsc() - _start);
+	}
+
+private:
+	prof_point _pt;
+	uint64_t   _start;
+};
+
+#define PROF_SCOPE(pt) colossal::prof_scope __prof_scope(pt)
+
+#define PROF_SAMPLE(now, events, map_waits, reduce_waits) do {		\
+		colossal::profiler *__prof = colossal::profiler::current(); \
+		if (__prof)						\
+			__prof->sample(now, events, map_waits, reduce_waits); \
+	} while (0)
+
+#else
+
+#define PROF_SCOPE(pt)
+#define PROF_SAMPLE(now, events, map_waits, reduce_waits)
+
+#endif
+
+}
+
+#endif
@@ -17,12 +17,10 @@
 
 #include <cstddef>
 #include <stdint.h>
-#include <list>
-#include <queue>
+#include <deque>
 #include <vector>
 #include <ulib/heap_prot.h>
 #include <ulib/hash_open.h>
-#include <ulib/math_rand_prot.h>
 #include "common.hpp"
 #include "hashable.hpp"
 #include "comparable.hpp"
@@ -30,315 +28,231 @@
 #include "job.hpp"
 #include "pool.hpp"
 #include "fsched.hpp"
+#include "policy.hpp"
 
 namespace colossal {
 
+// Task selector
+// The waiting tasks of a job are queued by the job itself in the order
+// of their creation time, only the next unseen one having an entry in
+// the selector, and the ref of a task is only made once it is next to
+// be popped from its job. The cost of the backlog thus goes with the
+// jobs rather than with their tasks.
 class selector
 {
 public:
 	struct pool_view {
-		td_ref *ptr;
+		pool *ptr;
 
-		typedef td_ref * pointer_type;
+		typedef pool * pointer_type;
 
-		pool_view(td_ref * p) : ptr(p) { }
+		pool_view(pool * p) : ptr(p) { }
 
-		operator td_ref *&()
+		operator pool *&()
 		{
 			return ptr;
 		}
 
 		operator size_t() const
 		{
-			return ptr->getpool()->id;
+			return ptr->id;
 		}
 
 		bool operator==(const pool_view &other) const
 		{
-			return ptr->getpool()->id == other.ptr->getpool()->id;
+			return ptr->id == other.ptr->id;
 		}
 	};
 
-	struct job_view {
-		td_ref * ptr;
-
-		typedef td_ref * pointer_type;
-
-		job_view(td_ref * p) : ptr(p) { }
-
-		operator td_ref *&()
-		{
-			return ptr;
-		}
-
-		operator size_t() const
-		{
-			uint64_t h = ptr->getjob()->id;
-			return RAND_INT_MIX64(h) + ptr->getpool()->id;
-		}
-
-		bool operator==(const job_view &other) const
-		{
-			return ptr->getjob()->id == other.ptr->getjob()->id &&
-				ptr->getpool()->id == other.ptr->getpool()->id;
-		}
-	};
-
-	typedef std::list<pool>::iterator pool_itr_type;
+	typedef std::deque<pool>::iterator pool_itr_type;
 	typedef ulib::open_hash_set<pool_view> changes_type;
-	typedef ulib::open_hash_map<job_view, std::queue<td_ref *> *> j2t_type;
-        typedef ulib::open_hash_map<pool_view, j2t_type *> p2j_type;
 
-	DEFINE_HEAP(inclass, td_ref *, std::greater<ctime_comp>());
-
-	struct pool_map_fs_itr {
-		p2j_type::iterator itr;
-
-		pool_map_fs_itr() { }
-		pool_map_fs_itr(const p2j_type::iterator &it) : itr(it) { }
-
-		pool_map_fs_itr &operator++()
-		{
-			++itr;
-			return *this;
-		}
-
-		bool operator==(const pool_map_fs_itr &other) const
-		{
-			return itr == other.itr;
-		}
+	// resume: take started but unfinished tasks (stime >= 0, ftime < 0)
+	// as running, see resumed_maps() and resumed_reduces()
+	// slowstart: hold the reduces of a job back until the fraction of
+	// its maps have finished, see release_reduces(); < 0 to disable
+	selector(const pool_itr_type &pb, const pool_itr_type &pe, bool resume = false,
+		 double slowstart = -1);
+	~selector();
 
-		bool operator!=(const pool_map_fs_itr &other) const
-		{
-			return itr != other.itr;
-		}
+	// Number of maps of a job left to finish before its reduces are
+	// released under slow-start
+	static int slowstart_maps(const job &j, double slowstart, bool resume);
 
-		const fs_context & operator *() const
-		{
-			return ((td_ref *)itr.key())->getpool()->fs_ctx_map;
-		}
+	// Let the scheduler see the held reduces of a job from their
+	// creation time on
+	// Returns the number of reduces released.
+	size_t release_reduces(td_ref *ref);
 
-		operator fs_context *()
-		{
-			return &((td_ref *)itr.key())->getpool()->fs_ctx_map;
-		}
-	};
+	// preempted tasks may need to be added back
+	void add_preempted_map(td_ref *ref);
+	void add_preempted_reduce(td_ref *ref);
 
-	struct job_map_fs_itr {
-		j2t_type::iterator itr;
+	sim_time map_min_ctime() const;
+	sim_time reduce_min_ctime() const;
 
-		job_map_fs_itr() { }
-		job_map_fs_itr(const j2t_type::iterator &it) : itr(it) { }
+	size_t maps_popped() const { return _popped[task::TASK_TYPE_MAP]; }
+	size_t maps_seen() const { return _seen[task::TASK_TYPE_MAP]; }
+	size_t maps_left() const { return _unseen[task::TASK_TYPE_MAP]; }
+	size_t reduces_popped() const { return _popped[task::TASK_TYPE_REDUCE]; }
+	size_t reduces_seen() const { return _seen[task::TASK_TYPE_REDUCE]; }
+	size_t reduces_left() const { return _unseen[task::TASK_TYPE_REDUCE]; }
 
-		job_map_fs_itr &operator++()
-		{
-			++itr;
-			return *this;
-		}
+	// Free the ref of a task attempt that is over
+	// The engine calls it once the ref is neither running nor
+	// referred to by a pending event.
+	void release(td_ref *ref);
 
-		bool operator==(const job_map_fs_itr &other) const
-		{
-			return itr == other.itr;
-		}
+	// number of task refs held, made and not released
+	size_t refs() const { return _owned.size(); }
 
-		bool operator!=(const job_map_fs_itr &other) const
-		{
-			return itr != other.itr;
-		}
+	// Reorder a job of a pool among the jobs with seen tasks after its
+	// key under the policy of the pool, e.g. work_left, has changed
+	void update_job(pool *p, job *j);
 
-		const fs_context & operator *() const
-		{
-			return ((td_ref *)itr.key())->getjob()->fs_ctx_map;
-		}
+	bool has_map() const { return has<map_slot>(); }
+	bool has_reduce() const { return has<reduce_slot>(); }
+	bool has_task() const { return has_map() || has_reduce(); }
 
-		operator fs_context *()
-		{
-			return &((td_ref *)itr.key())->getjob()->fs_ctx_map;
-		}
-	};
+	// tasks found running by the constructor, which are owned by the
+	// selector until released
+	const std::vector<td_ref *> &resumed_maps() const { return _resumed[task::TASK_TYPE_MAP]; }
+	const std::vector<td_ref *> &resumed_reduces() const { return _resumed[task::TASK_TYPE_REDUCE]; }
 
-	struct job_map_fcfs_itr {
-		j2t_type::iterator itr;
+	void dump_seen_task_tree() const;
 
-		job_map_fcfs_itr() { }
-		job_map_fcfs_itr(const j2t_type::iterator &it) : itr(it) { }
+	// update the visibility of maps/reduces to the scheduler
+	void see_maps(sim_time now, changes_type *changes = NULL);
+	void see_reduces(sim_time now, changes_type *changes = NULL);
 
-		job_map_fcfs_itr &operator++()
-		{
-			++itr;
-			return *this;
-		}
+	// Choose pools by DRF in a cluster of the capacity, with the
+	// tasks in the containers of their pools; NULL for slots
+	void set_capacity(const resource *capacity) { _capacity = capacity; }
 
-		bool operator==(const job_map_fcfs_itr &other) const
-		{
-			return itr == other.itr;
-		}
+	// the pool the next task would be popped from, NULL if none
+	pool *next_map_pool();
+	pool *next_reduce_pool();
 
-		bool operator!=(const job_map_fcfs_itr &other) const
-		{
-			return itr != other.itr;
-		}
+	// pop out a map/reduce task
+	// Note: popped tasks should NOT be freed from outside
+	td_ref *pop_map();  // pop only
+	td_ref *pop_map(sim_time now); // see and pop
+	td_ref *pop_reduce();  // pop only
+	td_ref *pop_reduce(sim_time now);  // see and pop
 
-		const job_ctime_hash operator *() const
-		{
-			return (td_ref *)itr.key();
-		}
+private:
+	// The next unseen tasks of a job, or a preempted task to be seen
+	// again
+	struct pending_task {
+		job     *j;
+		pool    *p;
+		td_ref  *ref;    // of a preempted task, NULL for a job
+		sim_time ctime;
+		uint64_t seq;    // breaks ties in ctime
 
-		operator fs_context *()
+		bool operator> (const pending_task &other) const
 		{
-			return &((td_ref *)itr.key())->getjob()->fs_ctx_map;
+			if (ctime != other.ctime)
+				return ctime > other.ctime;
+			return seq > other.seq;
 		}
 	};
 
-	struct pool_reduce_fs_itr {
-		p2j_type::iterator itr;
-
-		pool_reduce_fs_itr() { }
-		pool_reduce_fs_itr(const p2j_type::iterator &it) : itr(it) { }
-
-		pool_reduce_fs_itr &operator++()
-		{
-			++itr;
-			return *this;
-		}
-
-		bool operator==(const pool_reduce_fs_itr &other) const
-		{
-			return itr == other.itr;
-		}
-
-		bool operator!=(const pool_reduce_fs_itr &other) const
-		{
-			return itr != other.itr;
-		}
-
-		const fs_context & operator *() const
-		{
-			return ((td_ref *)itr.key())->getpool()->fs_ctx_reduce;
-		}
+	DEFINE_HEAP(pending, pending_task, std::greater<pending_task>());
 
-		operator fs_context *()
-		{
-			return &((td_ref *)itr.key())->getpool()->fs_ctx_reduce;
-		}
+	// A preempted task seen after the first 'after' queued tasks of
+	// its job
+	struct preempted_task {
+		td_ref  *ref;
+		uint32_t after;
 	};
 
-	struct job_reduce_fs_itr {
-		j2t_type::iterator itr;
+	// Waiting tasks of a job
+	// The tasks not running are queued by creation time, by index in
+	// j->tasks unless they are in order there already: [0, head) have
+	// been popped, [head, next) seen and [next, end) not seen yet.
+	// Preempted tasks seen again are queued apart.
+	struct job_queue {
+		std::vector<uint32_t> order;  // empty if in index order
+		std::vector<preempted_task> preempted;
+		td_ref  *front;  // ref of the next task, made on demand
+		uint32_t head;
+		uint32_t next;
+		uint32_t end;
+		uint32_t phead;  // first preempted task not popped
+		int      pos;    // in the active jobs of the pool, -1 if none
+		bool     held;   // reduces not yet released, see slowstart
 
-		job_reduce_fs_itr() { }
-		job_reduce_fs_itr(const j2t_type::iterator &it) : itr(it) { }
-
-		job_reduce_fs_itr &operator++()
-		{
-			++itr;
-			return *this;
-		}
+		job_queue() : front(NULL), head(0), next(0), end(0), phead(0), pos(-1), held(false) { }
 
-		bool operator==(const job_reduce_fs_itr &other) const
-		{
-			return itr == other.itr;
-		}
+		// index of the k-th queued task
+		uint32_t task(uint32_t k) const { return order.empty()? k: order[k]; }
 
-		bool operator!=(const job_reduce_fs_itr &other) const
+		// whether a preempted task is next to be popped
+		bool preempted_first() const
 		{
-			return itr != other.itr;
+			return phead < preempted.size() && preempted[phead].after <= head;
 		}
 
-		const fs_context & operator *() const
-		{
-			return ((td_ref *)itr.key())->getjob()->fs_ctx_reduce;
-		}
-
-		operator fs_context *()
-		{
-			return &((td_ref *)itr.key())->getjob()->fs_ctx_reduce;
-		}
+		bool empty() const { return head == next && phead == preempted.size(); }
 	};
 
-	struct job_reduce_fcfs_itr {
-		j2t_type::iterator itr;
-
-		job_reduce_fcfs_itr() { }
-		job_reduce_fcfs_itr(const j2t_type::iterator &it) : itr(it) { }
-
-		job_reduce_fcfs_itr &operator++()
-		{
-			++itr;
-			return *this;
-		}
-
-		bool operator==(const job_reduce_fcfs_itr &other) const
-		{
-			return itr == other.itr;
-		}
-
-		bool operator!=(const job_reduce_fcfs_itr &other) const
-		{
-			return itr != other.itr;
-		}
-
-		const job_ctime_hash operator *() const
-		{
-			return (td_ref *)itr.key();
-		}
-
-		operator fs_context *()
-		{
-			return &((td_ref *)itr.key())->getjob()->fs_ctx_reduce;
-		}
+	// Jobs of a pool, indexed by job::idx, and those with seen tasks,
+	// the latter being a heap in the order of the pool if the policy
+	// is indexed, see policy.hpp
+	struct job_queues {
+		std::vector<job_queue> jobs;
+		std::vector<size_t>    active;
 	};
 
-	selector(const pool_itr_type &pb, const pool_itr_type &pe);
-	~selector();
-
-	// preempted tasks may need to be added back
-	void add_preempted_map(td_ref *ref);
-	void add_preempted_reduce(td_ref *ref);
-
-	double map_min_ctime() const;
-	double reduce_min_ctime() const;
-
-	size_t maps_popped() const { return _maps_popped; }
-	size_t maps_seen() const { return _seen_maps.size(); }
-	size_t maps_left() const { return _map_refs.size(); }
-	size_t reduces_popped() const { return _reduces_popped; }
-	size_t reduces_seen() const { return _seen_reduces.size(); }
-	size_t reduces_left() const { return _reduce_refs.size(); }
+	struct pool_queue {
+		pool      *p;
+		int        pos;  // in the active pools, -1 if none
+		uint64_t   seq;  // of the first job of the pool
+		job_queues q;
+	};
 
-	bool has_map() const { return _map_refs.size() || _maps_popped < _seen_maps.size(); }
-	bool has_reduce() const { return _reduce_refs.size() || _reduces_popped < _seen_reduces.size(); }
-	bool has_task() const { return has_map() || has_reduce(); }
+	template<typename S>
+	bool has() const
+	{
+		return _unseen[S::type] || _popped[S::type] < _seen[S::type];
+	}
 
-	void dump_seen_task_tree() const;
+	void    add_pending(pool_queue &pq, job *j, task::task_type type);
+	td_ref *make_ref(td_ref *ref);
+	td_ref *front(pool_queue &pq, size_t jidx, task::task_type type);
 
-	// update the visibility of maps/reduces to the scheduler
-	void see_maps(double now, changes_type *changes = NULL);
-	void see_reduces(double now, changes_type *changes = NULL);
+	template<typename S> void     add_preempted(td_ref *ref);
+	template<typename S> sim_time min_ctime() const;
+	template<typename S> void     see(sim_time now, changes_type *changes);
+	template<typename S> pool_queue *neediest();
+	template<typename S> td_ref  *pop();
+	template<typename S, typename O>
+	td_ref *job_select(pool_queue &pq);
 
-	// pop out a map/reduce task
-	// Note: popped tasks should NOT be freed from outside
-	td_ref *pop_map();  // pop only
-	td_ref *pop_map(double now); // see and pop
-	td_ref *pop_reduce();  // pop only
-	td_ref *pop_reduce(double now);  // see and pop
+	// keep the active jobs of a pool in order
+	void activate_job(pool_queue &pq, size_t jidx);
+	void deactivate_job(pool_queue &pq, job_queue &jq);
+	void reorder(pool_queue &pq, size_t pos);
+	template<typename O> void sift(pool_queue &pq, size_t pos);
 
-private:
-	static td_ref * job_select_map_fs(pool_map_fs_itr pchosen);
-	static td_ref * job_select_map_fcfs(pool_map_fs_itr pchosen);
-	static td_ref * job_select_reduce_fs(pool_reduce_fs_itr pchosen);
-	static td_ref * job_select_reduce_fcfs(pool_reduce_fs_itr pchosen);
+	template<typename S> void     dump_seen(const char *label) const;
 
 	pool_itr_type _pb;
 	pool_itr_type _pe;
-	p2j_type _map_tasks;
-	p2j_type _reduce_tasks;
-	size_t _maps_popped;     // maps popped out by now
-	size_t _reduces_popped;  // reduces popped out by now
-	std::vector<td_ref *> _map_refs;
-	std::vector<td_ref *> _seen_maps;
-	std::vector<td_ref *> _reduce_refs;
-	std::vector<td_ref *> _seen_reduces;
+	// per task type, indexed by task::task_type
+	std::vector<pool_queue> _tasks[task::TASK_TYPE_NUM];   // by pool::idx
+	std::vector<size_t>     _active[task::TASK_TYPE_NUM];  // pools with seen tasks
+	size_t   _popped[task::TASK_TYPE_NUM];  // tasks popped out by now
+	size_t   _seen[task::TASK_TYPE_NUM];    // tasks seen by now
+	size_t   _unseen[task::TASK_TYPE_NUM];  // tasks not seen by now
+	std::vector<pending_task> _pending[task::TASK_TYPE_NUM];  // heap of unseen tasks
+	std::vector<td_ref *> _resumed[task::TASK_TYPE_NUM];
+	// the refs made and not released, keyed by address, the rest
+	// being freed with the selector
+	ulib::open_hash_set<uint64_t> _owned;
+	uint64_t _seq;
+	const resource *_capacity;
 };
 
 }
@@ -0,0 +1,93 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_SHADOW_H
+#define _COLOSSAL_SHADOW_H
+
+#include <stdint.h>
+#include <ulib/hash_open.h>
+#include "common.hpp"
+#include "task.hpp"
+#include "pool.hpp"
+#include "job_tracker.hpp"
+
+namespace colossal
+{
+
+// Shadow job tracker that follows a live cluster
+// The tracked state only holds unfinished tasks, and is updated
+// incrementally as tasks are submitted, started and finished. Finish
+// times are predicted by fast-forwarding a copy of the state, which is
+// cached until the next update.
+class shadow_tracker : public job_tracker
+{
+public:
+	shadow_tracker(int nmaps, int nreduces);
+
+	// Add a pool to follow
+	// Pools added by job_tracker::add_pool() are not followed.
+	pool &follow_pool(const std::string &ns, sim_time mto, sim_time fto,
+			  double weight, int minmap, int minred,
+			  pool::sched_mode sched);
+
+	// Incremental updates, returning 0 on success, -1 otherwise
+	// The ptime of a submitted task is its estimated processing time.
+	int submit(uint64_t pid, uint64_t jid, uint64_t tid, double weight,
+		   task::task_type type, const task &t);
+	int start(uint64_t tid, sim_time now);
+	int finish(uint64_t tid, sim_time now);
+
+	// Predicted finish time of a job or of all jobs in a pool
+	// Returns -1 if the job is unknown or the pool is idle.
+	sim_time predict_job(uint64_t jid);
+	sim_time predict_pool(uint64_t pid);
+
+	// Time of the latest update
+	sim_time now() const { return _now; }
+
+	size_t jobs() const { return _jobs.size(); }
+	size_t tasks() const { return _tasks.size(); }
+
+private:
+	struct job_loc {
+		pool  *p;
+		size_t idx;
+	};
+
+	struct task_loc {
+		pool  *p;
+		size_t job;
+		int    type;
+		size_t idx;
+	};
+
+	void forecast();
+	void remove_job(pool *p, size_t idx);
+
+	int      _nmaps;
+	int      _nreduces;
+	sim_time _now;
+	uint64_t _version;   // bumped on each update
+	uint64_t _forecast;  // version of the cached forecast
+
+	ulib::open_hash_map<uint64_t, pool *>   _pools;
+	ulib::open_hash_map<uint64_t, job_loc>  _jobs;
+	ulib::open_hash_map<uint64_t, task_loc> _tasks;
+	ulib::open_hash_map<uint64_t, sim_time> _job_pred;
+	ulib::open_hash_map<uint64_t, sim_time> _pool_pred;
+};
+
+}
+
+#endif
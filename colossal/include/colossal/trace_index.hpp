@@ -0,0 +1,76 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_TRACE_INDEX_H
+#define _COLOSSAL_TRACE_INDEX_H
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "common.hpp"
+
+namespace colossal
+{
+
+// Sparse time index of a workload trace sorted by task creation time
+// The index maps each non-empty time bucket to the file offset of its
+// first line. It is kept in a sidecar file next to the trace, and is
+// rebuilt when the trace changes.
+class trace_index
+{
+public:
+	static const sim_time DEFAULT_BUCKET;  // one hour
+	static const int      MAX_LINE_LEN;
+
+	trace_index() : _bucket(DEFAULT_BUCKET), _size(0), _mtime(0) { }
+
+	// Build the index of the trace using binary line search
+	// Returns 0 on success, -1 otherwise
+	int build(const char *trace, sim_time bucket = DEFAULT_BUCKET);
+
+	// Save/load the index to/from a file
+	int save(const char *file) const;
+	int load(const char *file);
+
+	// Load the sidecar index of the trace, building and saving it
+	// if it is missing or stale
+	int open(const char *trace, sim_time bucket = DEFAULT_BUCKET);
+
+	// Offset of the first line whose bucket is not before that of t
+	// Lines at or after the returned offset cover all tasks created
+	// at or after t; the trace size is returned if there is none.
+	off_t seek(sim_time t) const;
+
+	sim_time bucket() const { return _bucket; }
+	size_t   size() const { return _entries.size(); }
+
+	// Path of the sidecar index of a trace
+	static std::string sidecar(const char *trace);
+
+private:
+	struct entry {
+		int64_t bucket;
+		int64_t offset;
+	};
+
+	sim_time _bucket;
+	off_t    _size;   // trace size when indexed
+	time_t   _mtime;  // trace modification time when indexed
+	std::vector<entry> _entries;
+};
+
+}
+
+#endif
@@ -45,10 +45,17 @@ public:
 		return false;
         }
 
+	// Take a unit regardless of the value, e.g. for tasks already
+	// running at boot. The value may go negative on over-commit.
+	void take()
+	{
+		--_val;
+	}
+
         void post(engine *eng)
         {
 		++_val;
-                if (_wlist.size()) {
+                if (_val > 0 && _wlist.size()) {  // not over-committed
 			T obj = _wlist.front();
                         _wlist.pop();
 			(*obj)(eng);
@@ -56,11 +63,23 @@ public:
                 }
         }
 
+	// Set the value, e.g. to lift the limit
+	void reset(int val)
+	{
+		_val = val;
+	}
+
 	size_t size() const
 	{
 		return _wlist.size();
 	}
 
+	// Number of free units, negative if over-committed
+	int value() const
+	{
+		return _val;
+	}
+
 private:
         std::queue<T> _wlist;
         int _val;
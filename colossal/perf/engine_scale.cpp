@@ -0,0 +1,236 @@
+//
+// Engine scaling benchmark
+//
+// Runs synthetic workloads from job_generator through job_tracker over
+// a matrix of pool, job and slot counts, with preemption off and on.
+// Each configuration runs in its own process, so the peak RSS is its
+// own, and one TSV line is written per configuration:
+//
+//   pools jobs slots preempt tasks events secs events/s tasks/s
+//   pops ns/pop peak_rss_kb
+//
+// secs covers job_tracker::process() only, and the peak RSS is taken
+// right after it. ns/pop is measured on a separate selector drained
+// with all tasks seen, i.e. the worst case of a fully backlogged
+// cluster, for at most -n pops per task type. With -N the slots are
+// spread over a node model, 40 nodes per rack, with delay scheduling.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <vector>
+#include <deque>
+#include <ulib/util_timer.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+struct config {
+	int  pools;
+	int  jobs;
+	int  slots;
+	bool preempt;
+};
+
+static double   load_factor = 1.2;  // offered load relative to the map slots
+static size_t   max_pops    = 10000;
+static int      nnodes      = 0;    // no node model
+static uint64_t rng_seed    = 1;
+
+// lognormal workload parameters, durations in milliseconds
+static const double MMPJ = 2.5, SMPJ = 1.0;  // ~20 maps per job
+static const double MRPJ = 0.5, SRPJ = 0.5;  // ~2 reduces per job
+static const double MMTD = 9.5, SMTD = 1.0;  // ~22s per map
+static const double MRTD = 10,  SRTD = 1.0;  // ~36s per reduce
+
+static void parse_list(const char *arg, std::vector<int> *vals)
+{
+	vals->clear();
+	for (const char *p = arg; *p; ) {
+		char *end;
+		long v = strtol(p, &end, 10);
+		if (end == p || v < 0) {
+			fprintf(stderr, "invalid list: %s\n", arg);
+			exit(EXIT_FAILURE);
+		}
+		vals->push_back(v);
+		p = *end == ',' ? end + 1: end;
+	}
+}
+
+// Add the pools of the configuration to the container
+static void add_pools(const config &c, std::deque<pool> *pools)
+{
+	sim_time to = c.preempt? 30000 * TICKS_PER_MSEC: -1;
+	int minmap = c.preempt? std::max(c.slots / c.pools, 1): 0;
+	int minred = c.preempt? std::max(c.slots / 2 / c.pools, 1): 0;
+	for (int i = 0; i < c.pools; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "pool_%d", i);
+		pools->push_back(pool(name, to, to, 1, minmap, minred, pool::SCHED_FAIR));
+	}
+}
+
+// Generate the jobs round robin over the pools
+// The workload only depends on the configuration and the seed.
+static size_t gen_jobs(const config &c, std::deque<pool> *pools)
+{
+	// arrival rate keeping the map slots at the offered load
+	double maps = exp(MMPJ + SMPJ * SMPJ / 2);
+	double mdur = exp(MMTD + SMTD * SMTD / 2) * TICKS_PER_MSEC;
+	double jar  = load_factor * c.slots / (maps * mdur);
+	double lt   = log((double)TICKS_PER_MSEC);
+	job_generator gen(jar, MMPJ, MRPJ, SMPJ, SRPJ, MMTD + lt, MRTD + lt, SMTD, SRTD);
+	gen.seed(rng_seed);
+
+	std::vector<pool *> pv;
+	for (std::deque<pool>::iterator it = pools->begin(); it != pools->end(); ++it)
+		pv.push_back(&*it);
+	size_t ntasks = 0;
+	for (int i = 0; i < c.jobs; ++i) {
+		job j = gen();
+		ntasks += j.tasks[task::TASK_TYPE_MAP].size() +
+			j.tasks[task::TASK_TYPE_REDUCE].size();
+		pv[i % c.pools]->add_job(j);
+	}
+	return ntasks;
+}
+
+// Average time per pop of a fully backlogged selector in nanoseconds
+static double time_pops(std::deque<pool> &pools, size_t *npops)
+{
+	selector sel(pools.begin(), pools.end());
+	sim_time end = (sim_time)1 << 62;
+	ulib_timer_t timer;
+	size_t n = 0;
+
+	timer_start(&timer);
+	sel.see_maps(end);
+	for (size_t i = 0; i < max_pops && sel.has_map(); ++i, ++n)
+		sel.pop_map();
+	sel.see_reduces(end);
+	for (size_t i = 0; i < max_pops && sel.has_reduce(); ++i, ++n)
+		sel.pop_reduce();
+	double secs = timer_stop(&timer);
+
+	*npops = n;
+	return n? secs * 1e9 / n: 0;
+}
+
+static void run(const config &c)
+{
+	size_t ntasks, nevents;
+	double secs;
+	struct rusage ru;
+	{
+		job_tracker jt(c.slots, std::max(c.slots / 2, 1));
+		jt.set_progress(false);
+		if (nnodes > 0)
+			jt.set_cluster(new cluster(nnodes, 40, std::max(c.slots / nnodes, 1),
+						   std::max(c.slots / 2 / nnodes, 1)));
+		add_pools(c, &jt.getpools());
+		ntasks = gen_jobs(c, &jt.getpools());
+		jt.scale_minshares();
+
+		ulib_timer_t timer;
+		timer_start(&timer);
+		jt.process();
+		secs = timer_stop(&timer);
+		nevents = jt.events();
+		getrusage(RUSAGE_SELF, &ru);
+	}
+
+	// selecting updates the fair share contexts, so pops are timed
+	// on a fresh copy of the same workload
+	std::deque<pool> pools;
+	add_pools(c, &pools);
+	gen_jobs(c, &pools);
+	size_t npops;
+	double nspp = time_pops(pools, &npops);
+
+	printf("%d\t%d\t%d\t%d\t%lu\t%lu\t%.3f\t%.0f\t%.0f\t%lu\t%.1f\t%ld\n",
+	       c.pools, c.jobs, c.slots, c.preempt, (unsigned long)ntasks,
+	       (unsigned long)nevents, secs,
+	       secs > 0? nevents / secs: 0, secs > 0? ntasks / secs: 0,
+	       (unsigned long)npops, nspp, (long)ru.ru_maxrss);
+	fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -p LIST  pool counts, e.g. 10,100,1000\n"
+		"  -j LIST  job counts\n"
+		"  -s LIST  map slot counts, with half as many reduce slots\n"
+		"  -P LIST  preemption settings, 0 for off and 1 for on\n"
+		"  -f       full matrix: 10-5000 pools, 1k-100k jobs and slots\n"
+		"  -l LOAD  offered load relative to the map slots, default 1.2\n"
+		"  -n NUM   max selector pops timed per task type, default 10000\n"
+		"  -r SEED  workload seed, default 1\n"
+		"  -N NUM   spread the slots over NUM nodes with delay scheduling\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<int> pools, jobs, slots, preempt;
+	parse_list("10,100,1000", &pools);
+	parse_list("1000", &jobs);
+	parse_list("1000,10000", &slots);
+	parse_list("0,1", &preempt);
+
+	int opt;
+	while ((opt = getopt(argc, argv, "p:j:s:P:fl:n:r:N:h")) != -1) {
+		switch (opt) {
+		case 'p': parse_list(optarg, &pools); break;
+		case 'j': parse_list(optarg, &jobs); break;
+		case 's': parse_list(optarg, &slots); break;
+		case 'P': parse_list(optarg, &preempt); break;
+		case 'f':
+			parse_list("10,100,1000,5000", &pools);
+			parse_list("1000,10000,100000", &jobs);
+			parse_list("1000,10000,100000", &slots);
+			break;
+		case 'l': load_factor = atof(optarg); break;
+		case 'n': max_pops = strtoul(optarg, NULL, 10); break;
+		case 'r': rng_seed = strtoull(optarg, NULL, 10); break;
+		case 'N': nnodes = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+			return opt == 'h'? EXIT_SUCCESS: EXIT_FAILURE;
+		}
+	}
+
+	printf("pools\tjobs\tslots\tpreempt\ttasks\tevents\tsecs\tevents/s\ttasks/s"
+	       "\tpops\tns/pop\tpeak_rss_kb\n");
+	fflush(stdout);
+
+	int failed = 0;
+	for (size_t a = 0; a < pools.size(); ++a)
+	for (size_t b = 0; b < jobs.size(); ++b)
+	for (size_t s = 0; s < slots.size(); ++s)
+	for (size_t e = 0; e < preempt.size(); ++e) {
+		config c = { pools[a], jobs[b], slots[s], preempt[e] != 0 };
+		if (c.pools <= 0 || c.jobs <= 0 || c.slots <= 0)
+			continue;
+		pid_t pid = fork();
+		if (pid == 0) {
+			run(c);
+			_exit(EXIT_SUCCESS);
+		}
+		int status;
+		if (pid < 0 || waitpid(pid, &status, 0) != pid ||
+		    !WIFEXITED(status) || WEXITSTATUS(status)) {
+			fprintf(stderr, "configuration %d/%d/%d/%d failed\n",
+				c.pools, c.jobs, c.slots, c.preempt);
+			++failed;
+		}
+	}
+
+	return failed? EXIT_FAILURE: EXIT_SUCCESS;
+}
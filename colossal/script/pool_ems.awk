@@ -7,5 +7,5 @@
 
 END {
 	for (i in sum)
-		printf("%s\t%.3f\n", i, sum[i]/cnt[i])
+		printf("%s\t%.3f\n", i, sum[i]/cnt[i]/1000)
 }
@@ -8,5 +8,5 @@
 
 END {
 	for (i in sum)
-		printf("%s\t%.3f\t%.15g\n", i, sum[i]/cnt[i], sum1[i]/cnt[i])
+		printf("%s\t%.3f\t%.15g\n", i, sum[i]/cnt[i]/1000, sum1[i]/cnt[i]/1000)
 }
@@ -0,0 +1,163 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+#include <ulib/os_thread.h>
+#include "pool.hpp"
+#include "accuracy.hpp"
+
+namespace colossal
+{
+
+const sim_time calibration::KEEP;
+
+namespace
+{
+
+// Evaluates every nth calibration
+class accuracy_worker : public ulib::thread
+{
+public:
+	accuracy_worker(accuracy_evaluator *eval, size_t first, size_t stride)
+		: _eval(eval), _first(first), _stride(stride) { }
+
+	~accuracy_worker()
+	{
+		join();
+	}
+
+	int run()
+	{
+		for (size_t i = _first; i < _eval->size(); i += _stride)
+			_eval->evaluate(i);
+		return 0;
+	}
+
+private:
+	accuracy_evaluator *_eval;
+	size_t _first;
+	size_t _stride;
+};
+
+// Summarize the relative errors, which get sorted
+accuracy_stats summarize(std::vector<double> &errs)
+{
+	accuracy_stats st;
+	if (errs.empty())
+		return st;
+	st.jobs = errs.size();
+	for (size_t i = 0; i < errs.size(); ++i) {
+		st.bias += errs[i];
+		errs[i] = fabs(errs[i]);
+		st.mape += errs[i];
+	}
+	st.mape /= st.jobs;
+	st.bias /= st.jobs;
+	std::sort(errs.begin(), errs.end());
+	// the nearest-rank quantiles
+	const double qs[] = { 0.5, 0.9, 0.99 };
+	double *vals[] = { &st.p50, &st.p90, &st.p99 };
+	for (int i = 0; i < 3; ++i) {
+		size_t k = (size_t)ceil(qs[i] * errs.size());
+		*vals[i] = errs[std::min(k > 0? k - 1: 0, errs.size() - 1)];
+	}
+	st.max = errs.back();
+	return st;
+}
+
+}
+
+accuracy_evaluator::accuracy_evaluator(const engine::pool_container_type &pools, int nthreads)
+	: _pools(pools), _nthreads(nthreads)
+{
+	if (_nthreads <= 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		_nthreads = n > 0? n: 1;
+	}
+}
+
+void accuracy_evaluator::run()
+{
+	_overall.assign(_cals.size(), accuracy_stats());
+	_pools_stats.assign(_cals.size(), std::vector<accuracy_stats>());
+
+	int nthreads = std::min(_nthreads, (int)_cals.size());
+	std::vector<accuracy_worker *> workers;
+	for (int t = 0; t < nthreads; ++t) {
+		workers.push_back(new accuracy_worker(this, t, nthreads));
+		if (workers.back()->start())
+			workers.back()->run();  // fall back to the calling thread
+	}
+	for (size_t t = 0; t < workers.size(); ++t)
+		delete workers[t];  // joins the thread
+}
+
+int accuracy_evaluator::best() const
+{
+	int b = -1;
+	for (size_t i = 0; i < _overall.size(); ++i)
+		if (_overall[i].jobs && (b < 0 || _overall[i].mape < _overall[b].mape))
+			b = (int)i;
+	return b;
+}
+
+void accuracy_evaluator::evaluate(size_t i)
+{
+	const calibration &c = _cals[i];
+	engine eng(c.nmaps, c.nreduces);
+	eng.set_progress(false);
+	eng.getpools() = _pools;
+	for (engine::pool_container_type::iterator it = eng.getpools().begin();
+	     it != eng.getpools().end(); ++it) {
+		if (c.ms_timeout != calibration::KEEP)
+			it->ms_timeout = c.ms_timeout;
+		if (c.hf_timeout != calibration::KEEP)
+			it->hf_timeout = c.hf_timeout;
+	}
+	eng.scale_minshares();
+	eng.process();
+	_overall[i] = compare(_pools, eng.getpools(), &_pools_stats[i]);
+}
+
+accuracy_stats accuracy_evaluator::compare(const engine::pool_container_type &actual,
+					   const engine::pool_container_type &predicted,
+					   std::vector<accuracy_stats> *stats)
+{
+	std::vector<double> all;
+	std::vector<double> errs;
+	if (stats)
+		stats->clear();
+	engine::pool_container_type::const_iterator pa = actual.begin();
+	engine::pool_container_type::const_iterator pp = predicted.begin();
+	for (; pa != actual.end() && pp != predicted.end(); ++pa, ++pp) {
+		errs.clear();
+		size_t njobs = std::min(pa->jobs.size(), pp->jobs.size());
+		for (size_t i = 0; i < njobs; ++i) {
+			sim_time fa = pa->jobs[i].finish();
+			sim_time fp = pp->jobs[i].finish();
+			sim_time la = fa - pa->jobs[i].ctime;
+			if (fa < 0 || fp < 0 || la <= 0)
+				continue;
+			errs.push_back((double)(fp - pp->jobs[i].ctime - la) / la);
+		}
+		all.insert(all.end(), errs.begin(), errs.end());
+		if (stats)
+			stats->push_back(summarize(errs));
+	}
+	return summarize(all);
+}
+
+}
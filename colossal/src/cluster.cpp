@@ -0,0 +1,185 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <algorithm>
+#include <ulib/math_rand_prot.h>
+#include "cluster.hpp"
+
+namespace colossal
+{
+
+cluster::cluster(int nnodes, int nodes_per_rack, int map_slots, int reduce_slots)
+	: _nnodes(std::max(nnodes, 1)), _npr(std::max(nodes_per_rack, 1)),
+	  _replicas(3), _delay(5000 * TICKS_PER_MSEC)
+{
+	_nracks = (_nnodes + _npr - 1) / _npr;
+	_slots[task::TASK_TYPE_MAP] = map_slots;
+	_slots[task::TASK_TYPE_REDUCE] = reduce_slots;
+	_factor[LOCALITY_NODE] = 1.0;
+	_factor[LOCALITY_RACK] = 1.2;
+	_factor[LOCALITY_OFF_RACK] = 1.5;
+
+	size_t nwords = (_nnodes + 63) / 64;
+	for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt) {
+		_free[tt].assign(_nnodes, _slots[tt]);
+		_rack_free[tt].assign(_nracks, 0);
+		_bits[tt].assign(nwords, 0);
+		_summary[tt].assign((nwords + 63) / 64, 0);
+		if (_slots[tt] <= 0)
+			continue;
+		for (int i = 0; i < _nnodes; ++i) {
+			_rack_free[tt][rack_of(i)] += _slots[tt];
+			set_bit(tt, i);
+		}
+	}
+}
+
+void cluster::set_replicas(int n)
+{
+	_replicas = std::max(1, std::min(n, (int)MAX_REPLICAS));
+}
+
+int cluster::add_block(uint64_t task, int node)
+{
+	if (node < 0 || node >= _nnodes)
+		return -1;
+	block_list &bl = _blocks[task];  // zeroed on insertion
+	if (bl.n == MAX_REPLICAS)
+		return -1;
+	bl.nodes[bl.n++] = node;
+	return 0;
+}
+
+int cluster::blocks(uint64_t task, int *nodes) const
+{
+	ulib::open_hash_map<uint64_t, block_list>::const_iterator it = _blocks.find(task);
+	if (it != _blocks.end()) {
+		for (int i = 0; i < it.value().n; ++i)
+			nodes[i] = it.value().nodes[i];
+		return it.value().n;
+	}
+
+	uint64_t h = task;
+	RAND_INT_MIX64(h);
+	int n = 0;
+	nodes[n++] = h % _nnodes;
+	if (_replicas > 1 && _nracks > 1) {
+		// the second and the third replicas share another rack
+		RAND_INT_MIX64(h);
+		int rack = (rack_of(nodes[0]) + 1 + h % (_nracks - 1)) % _nracks;
+		int base = rack * _npr;
+		int size = std::min(_npr, _nnodes - base);
+		int off = (h >> 20) % size;
+		nodes[n++] = base + off;
+		if (_replicas > 2 && size > 1)
+			nodes[n++] = base + (off + 1 + (h >> 40) % (size - 1)) % size;
+	}
+	while (n < _replicas && n < _nnodes) {
+		RAND_INT_MIX64(h);
+		nodes[n++] = h % _nnodes;
+	}
+	return n;
+}
+
+void cluster::set_bit(int type, int node)
+{
+	size_t w = node >> 6;
+	_bits[type][w] |= 1ull << (node & 63);
+	_summary[type][w >> 6] |= 1ull << (w & 63);
+}
+
+void cluster::clear_bit(int type, int node)
+{
+	size_t w = node >> 6;
+	_bits[type][w] &= ~(1ull << (node & 63));
+	if (_bits[type][w] == 0)
+		_summary[type][w >> 6] &= ~(1ull << (w & 63));
+}
+
+// first node in [begin, end) with a free slot, or -1
+int cluster::first_free(int type, int begin, int end) const
+{
+	if (begin >= end)
+		return -1;
+	const std::vector<uint64_t> &bits = _bits[type];
+	const std::vector<uint64_t> &summary = _summary[type];
+	size_t w = begin >> 6;
+	size_t last = (end - 1) >> 6;
+	uint64_t word = bits[w] & (~0ull << (begin & 63));
+	while (word == 0) {
+		if (++w > last)
+			return -1;
+		// skip empty words using the summary
+		size_t s = w >> 6;
+		uint64_t sword = summary[s] & (~0ull << (w & 63));
+		while (sword == 0) {
+			if (++s > (last >> 6))
+				return -1;
+			sword = summary[s];
+		}
+		w = (s << 6) + __builtin_ctzll(sword);
+		if (w > last)
+			return -1;
+		word = bits[w];
+	}
+	int node = (w << 6) + __builtin_ctzll(word);
+	return node < end? node: -1;
+}
+
+int cluster::find(task::task_type type, const int *nodes, int n,
+		  locality max, locality *level) const
+{
+	for (int i = 0; i < n; ++i) {
+		if (_free[type][nodes[i]] > 0) {
+			*level = LOCALITY_NODE;
+			return nodes[i];
+		}
+	}
+	if (max >= LOCALITY_RACK) {
+		for (int i = 0; i < n; ++i) {
+			int rack = rack_of(nodes[i]);
+			if (_rack_free[type][rack] <= 0)
+				continue;
+			*level = LOCALITY_RACK;
+			return first_free(type, rack * _npr, std::min((rack + 1) * _npr, _nnodes));
+		}
+	}
+	if (max >= LOCALITY_OFF_RACK || n == 0) {
+		*level = n? LOCALITY_OFF_RACK: LOCALITY_NODE;
+		return first_free(type, 0, _nnodes);
+	}
+	return -1;
+}
+
+void cluster::take(task::task_type type, int node)
+{
+	if (--_free[type][node] == 0)
+		clear_bit(type, node);
+	--_rack_free[type][rack_of(node)];
+}
+
+void cluster::release(task::task_type type, int node)
+{
+	if (++_free[type][node] == 1)
+		set_bit(type, node);
+	++_rack_free[type][rack_of(node)];
+}
+
+const char *cluster::locality_str(locality level)
+{
+	static const char *names[LOCALITY_NUM] = { "node", "rack", "off-rack" };
+	return names[level];
+}
+
+}
@@ -0,0 +1,116 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_CLUSTER_H
+#define _COLOSSAL_CLUSTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <ulib/hash_open.h>
+#include "common.hpp"
+#include "task.hpp"
+
+namespace colossal
+{
+
+// Node-level cluster model
+// Nodes are numbered rack by rack, and each has the same number of map
+// and reduce slots. The nodes with a free slot of each type are kept in
+// a two-level bitmap, so a free slot in a rack or anywhere is found by
+// scanning a few words even with thousands of nodes.
+class cluster
+{
+public:
+	enum locality {
+		LOCALITY_NODE = 0,
+		LOCALITY_RACK,
+		LOCALITY_OFF_RACK,
+		LOCALITY_NUM
+	};
+
+	static const int MAX_REPLICAS = 4;
+
+	cluster(int nnodes, int nodes_per_rack, int map_slots, int reduce_slots);
+
+	// Delay scheduling wait before a job may launch a map one locality
+	// level further away, 0 to disable the delay
+	void set_delay(sim_time wait) { _delay = wait; }
+
+	// Map runtime factors when running rack-local and off-rack
+	void set_inflation(double rack, double off_rack)
+	{
+		_factor[LOCALITY_RACK] = rack;
+		_factor[LOCALITY_OFF_RACK] = off_rack;
+	}
+
+	// Number of block replicas synthesized for a map without locations
+	void set_replicas(int n);
+
+	// Add a node holding the input block of a map
+	// Returns 0 on success, -1 if the node or the replica count is out
+	// of range.
+	int add_block(uint64_t task, int node);
+
+	// Nodes holding the input block of a map, as added or synthesized
+	// with the default HDFS placement: one node, then two on another rack
+	int blocks(uint64_t task, int *nodes) const;
+
+	// Find a node with a free slot of the type, at most max away from
+	// the block nodes, and preferring the closest
+	// Returns the node and sets the locality level found, or returns
+	// -1 if there is none.
+	int find(task::task_type type, const int *nodes, int n,
+		 locality max, locality *level) const;
+
+	void take(task::task_type type, int node);
+	void release(task::task_type type, int node);
+
+	int      nodes() const { return _nnodes; }
+	int      racks() const { return _nracks; }
+	int      rack_of(int node) const { return node / _npr; }
+	int      slots(task::task_type type) const { return _nnodes * _slots[type]; }
+	int      free_slots(task::task_type type, int node) const { return _free[type][node]; }
+	sim_time delay() const { return _delay; }
+	double   factor(locality level) const { return _factor[level]; }
+
+	static const char *locality_str(locality level);
+
+private:
+	struct block_list {
+		int n;
+		int nodes[MAX_REPLICAS];
+	};
+
+	void set_bit(int type, int node);
+	void clear_bit(int type, int node);
+	int  first_free(int type, int begin, int end) const;
+
+	int      _nnodes;
+	int      _npr;     // nodes per rack
+	int      _nracks;
+	int      _replicas;
+	int      _slots[task::TASK_TYPE_NUM];  // per node
+	sim_time _delay;
+	double   _factor[LOCALITY_NUM];
+	// per task type, indexed by task::task_type
+	std::vector<int>      _free[task::TASK_TYPE_NUM];
+	std::vector<int>      _rack_free[task::TASK_TYPE_NUM];
+	std::vector<uint64_t> _bits[task::TASK_TYPE_NUM];     // node has a free slot
+	std::vector<uint64_t> _summary[task::TASK_TYPE_NUM];  // bits word is non-zero
+	ulib::open_hash_map<uint64_t, block_list> _blocks;
+};
+
+}
+
+#endif
@@ -20,6 +20,20 @@
 #include "pool.hpp"
 #include "job_tracker.hpp"
 #include "helper.hpp"
+#include "transform.hpp"
+#include "loader.hpp"
+#include "trace_index.hpp"
+#include "shadow.hpp"
+#include "objective.hpp"
+#include "optimizer.hpp"
+#include "fluid.hpp"
+#include "accuracy.hpp"
+#include "profile.hpp"
+#include "policy.hpp"
+#include "cluster.hpp"
+#include "logger.hpp"
+#include "decision.hpp"
+#include "history.hpp"
 #include "job_gen.hpp"
 
 namespace colossal
@@ -16,12 +16,24 @@
 #define _COLOSSAL_COMMON_H
 
 #include <cstddef>
+#include <stdint.h>
 #include <exception>
 
 namespace colossal
 {
 
-// Timestamp precision
+// Simulated time in integer ticks
+// Traces carry milliseconds since epoch, one tick per millisecond by
+// default. Build with -DCOLOSSAL_TIME_USEC for microsecond ticks.
+typedef int64_t sim_time;
+
+#ifdef COLOSSAL_TIME_USEC
+static const sim_time TICKS_PER_MSEC = 1000;
+#else
+static const sim_time TICKS_PER_MSEC = 1;
+#endif
+
+// Floating-point comparison precision
 static const double PRECISION = 0.000001;
 
 // Exception throwed by the library
@@ -38,6 +50,13 @@ double_equal(double a, double b,
 	return d < epsilon && d > -epsilon;
 }
 
+// Round a floating-point time value to the nearest tick
+static inline sim_time
+to_sim_time(double t)
+{
+	return (sim_time)(t < 0? t - 0.5: t + 0.5);
+}
+
 }
 
 #endif
@@ -34,12 +34,12 @@ struct ctime_comp {
 
 	bool operator> (const ctime_comp &other) const
 	{
-		return ptr->gettask()->ctime > other.ptr->gettask()->ctime;
+		return ptr->ctime() > other.ptr->ctime();
 	}
 
 	bool operator< (const ctime_comp &other) const
 	{
-		return ptr->gettask()->ctime < other.ptr->gettask()->ctime;
+		return ptr->ctime() < other.ptr->ctime();
 	}
 };
 
@@ -0,0 +1,253 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ulib/util_log.h>
+#include "decision.hpp"
+
+namespace colossal
+{
+
+namespace
+{
+
+const char DECISION_MAGIC[8] = { 'C', 'L', 'S', 'D', 'E', 'C', '1', 0 };
+
+const char *g_kind_names[] = { "LAUNCH", "FINISH", "PREEMPT", "BACKUP" };
+
+// the tag byte: kind:2 type:1 cached:1 delta:4
+const int TAG_CACHED = 8;
+const int TAG_DELTA  = 15;  // the delta follows as a varint
+
+inline unsigned cache_slot(uint64_t id)
+{
+	return (id * 0x9e3779b97f4a7c15ull) >> 56;
+}
+
+inline void put_varint(std::vector<unsigned char> *buf, uint64_t v)
+{
+	while (v >= 0x80) {
+		buf->push_back(v | 0x80);
+		v >>= 7;
+	}
+	buf->push_back(v);
+}
+
+inline bool get_varint(const std::vector<unsigned char> &buf, size_t *pos, uint64_t *v)
+{
+	*v = 0;
+	for (int shift = 0; shift < 64 && *pos < buf.size(); shift += 7) {
+		unsigned char c = buf[(*pos)++];
+		*v |= (uint64_t)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+}
+
+std::string decision::to_str() const
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "%lld\t%s\t%s\t%016llx", (long long)time,
+		 g_kind_names[what], type == task::TASK_TYPE_MAP? "MAP": "REDUCE",
+		 (unsigned long long)id);
+	return buf;
+}
+
+const size_t decision_writer::BLOCK_SIZE = 65536;
+
+int decision_writer::open(const char *file)
+{
+	close();
+	_fp = fopen(file, "wb");
+	if (_fp == NULL) {
+		ULIB_WARNING("cannot open decision log %s for writing", file);
+		return -1;
+	}
+	_err = fwrite(DECISION_MAGIC, sizeof(DECISION_MAGIC), 1, _fp) != 1;
+	_n = 0;
+	_nrecs = 0;
+	_buf.reserve(BLOCK_SIZE + 32);
+	return 0;
+}
+
+int decision_writer::close()
+{
+	if (_fp == NULL)
+		return 0;
+	flush();
+	bool err = _err;
+	if (fclose(_fp))
+		err = true;
+	_fp = NULL;
+	if (err) {
+		ULIB_WARNING("failed to write the decision log");
+		return -1;
+	}
+	return 0;
+}
+
+void decision_writer::add(decision::decision_kind what, task::task_type type,
+			  sim_time time, uint64_t id)
+{
+	if (_nrecs == 0) {
+		_base = time;
+		_last = time;
+		memset(_cache, 0, sizeof(_cache));
+	}
+	unsigned char tag = what | type << 2;
+	unsigned slot = cache_slot(id);
+	bool cached = _cache[slot] == id && id != 0;
+	if (cached)
+		tag |= TAG_CACHED;
+	// zigzag so that a backward step stays small
+	int64_t delta = time - _last;
+	uint64_t zz = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+	_last = time;
+	if (zz < TAG_DELTA) {
+		_buf.push_back(tag | zz << 4);
+	} else {
+		_buf.push_back(tag | TAG_DELTA << 4);
+		put_varint(&_buf, zz - TAG_DELTA);
+	}
+	if (cached)
+		_buf.push_back(slot);
+	else {
+		for (int i = 0; i < 8; ++i)
+			_buf.push_back(id >> (i * 8));
+		_cache[slot] = id;
+	}
+	++_n;
+	++_nrecs;
+	if (_buf.size() >= BLOCK_SIZE)
+		flush();
+}
+
+// block: NRECS NBYTES BASE, followed by the encoded decisions
+void decision_writer::flush()
+{
+	if (_nrecs == 0)
+		return;
+	uint32_t hdr[2] = { _nrecs, (uint32_t)_buf.size() };
+	int64_t base = _base;
+	if (fwrite(hdr, sizeof(hdr), 1, _fp) != 1 ||
+	    fwrite(&base, sizeof(base), 1, _fp) != 1 ||
+	    fwrite(&_buf[0], 1, _buf.size(), _fp) != _buf.size())
+		_err = true;
+	_buf.clear();
+	_nrecs = 0;
+}
+
+int decision_reader::open(const char *file)
+{
+	close();
+	_fp = fopen(file, "rb");
+	if (_fp == NULL) {
+		ULIB_WARNING("cannot open decision log %s for reading", file);
+		return -1;
+	}
+	char magic[sizeof(DECISION_MAGIC)];
+	if (fread(magic, sizeof(magic), 1, _fp) != 1 ||
+	    memcmp(magic, DECISION_MAGIC, sizeof(magic))) {
+		ULIB_WARNING("%s is not a decision log", file);
+		close();
+		return -1;
+	}
+	_nrecs = 0;
+	return 0;
+}
+
+void decision_reader::close()
+{
+	if (_fp)
+		fclose(_fp);
+	_fp = NULL;
+}
+
+int decision_reader::load_block()
+{
+	uint32_t hdr[2];
+	int64_t base;
+	if (fread(hdr, sizeof(hdr), 1, _fp) != 1)
+		return feof(_fp)? 0: -1;
+	if (fread(&base, sizeof(base), 1, _fp) != 1 || hdr[0] == 0)
+		return -1;
+	_buf.resize(hdr[1]);
+	if (hdr[1] && fread(&_buf[0], 1, hdr[1], _fp) != hdr[1])
+		return -1;
+	_nrecs = hdr[0];
+	_pos = 0;
+	_last = base;
+	memset(_cache, 0, sizeof(_cache));
+	return 1;
+}
+
+int decision_reader::next(decision *d)
+{
+	if (_nrecs == 0) {
+		int ret = load_block();
+		if (ret <= 0)
+			return ret;
+	}
+	if (_pos >= _buf.size())
+		return -1;
+	unsigned char tag = _buf[_pos++];
+	uint64_t zz = tag >> 4;
+	if (zz == (uint64_t)TAG_DELTA) {
+		if (!get_varint(_buf, &_pos, &zz))
+			return -1;
+		zz += TAG_DELTA;
+	}
+	_last += (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+	d->what = (decision::decision_kind)(tag & 3);
+	d->type = (task::task_type)(tag >> 2 & 1);
+	d->time = _last;
+	if (tag & TAG_CACHED) {
+		if (_pos >= _buf.size())
+			return -1;
+		d->id = _cache[_buf[_pos++]];
+	} else {
+		if (_pos + 8 > _buf.size())
+			return -1;
+		d->id = 0;
+		for (int i = 0; i < 8; ++i)
+			d->id |= (uint64_t)_buf[_pos++] << (i * 8);
+		_cache[cache_slot(d->id)] = d->id;
+	}
+	--_nrecs;
+	return 1;
+}
+
+int diff_decisions(const char *a, const char *b, uint64_t *pos)
+{
+	decision_reader ra, rb;
+	if (ra.open(a) || rb.open(b))
+		return -1;
+	decision da, db;
+	for (*pos = 0;; ++*pos) {
+		int ea = ra.next(&da);
+		int eb = rb.next(&db);
+		if (ea < 0 || eb < 0)
+			return -1;
+		if (ea == 0 && eb == 0)
+			return 0;
+		if (ea != eb || da != db)
+			return 1;
+	}
+}
+
+}
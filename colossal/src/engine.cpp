@@ -14,6 +14,10 @@
 
 #include <cstddef>
 #include <cstdio>
+#include <climits>
+#include <stdint.h>
+#include <vector>
+#include <utility>
 #include <algorithm>
 #include <ulib/util_log.h>
 #include "log.hpp"
@@ -22,6 +26,10 @@
 #include "helper.hpp"
 #include "metric.hpp"
 #include "engine.hpp"
+#include "profile.hpp"
+#ifdef COLOSSAL_PROFILE
+#include <ulib/util_timer.h>
+#endif
 
 namespace colossal
 {
@@ -29,10 +37,24 @@ namespace colossal
 const double engine::LOAD_FACTOR = 0.7;
 const int    engine::PROGRESS_WINSIZE = 50000;
 
-engine::engine(int nmaps, int nreduces, double now)
-        : time_now(now), _nmap(nmaps), _nreduce(nreduces),
-	  _met_win(0), _fp_met(NULL)
+engine::engine(int nmaps, int nreduces, sim_time now)
+        : time_now(now),
+	  _met_win(0), _met_interval(0), _met_begin(0), _fp_met(NULL), _decisions(NULL), _progress(true), _record_times(false), _nevents(0), _prof(NULL),
+	  _spec(false), _cluster(NULL), _slowstart(-1), _drf(false),
+	  _victims(VICTIM_FAIR), _restart_overhead(0)
 {
+	create_chain[task::TASK_TYPE_MAP] = 0;
+	create_chain[task::TASK_TYPE_REDUCE] = 0;
+	_blocked[task::TASK_TYPE_MAP] = false;
+	_blocked[task::TASK_TYPE_REDUCE] = false;
+	_started_live[task::TASK_TYPE_MAP] = 0;
+	_started_live[task::TASK_TYPE_REDUCE] = 0;
+	for (int i = 0; i < cluster::LOCALITY_NUM; ++i)
+		_nlaunch[i] = 0;
+	_spec_armed[task::TASK_TYPE_MAP] = false;
+	_spec_armed[task::TASK_TYPE_REDUCE] = false;
+	_nslots[task::TASK_TYPE_MAP] = nmaps;
+	_nslots[task::TASK_TYPE_REDUCE] = nreduces;
 	select = NULL; // allocate only when jobs are loaded
         sem_map = new vsem_type(nmaps);
         sem_reduce = new vsem_type(nreduces);
@@ -50,13 +72,17 @@ engine::~engine()
 
 	if (_fp_met)
 		fclose(_fp_met);
+	delete _decisions;
+	delete _prof;
+	delete _cluster;
 }
 
-bool engine::set_metrics(const char * met, int met_win)
+bool engine::set_metrics(const char * met, int met_win, sim_time interval)
 {
 	if (met == NULL)
 		return false;
 	_met_win = met_win;
+	_met_interval = interval;
 	_fp_met = fopen(met, "w");
 	if (_fp_met == NULL) {
 		ULIB_WARNING("cannot open metric file %s", met);
@@ -66,65 +92,201 @@ bool engine::set_metrics(const char * met, int met_win)
 	return true;
 }
 
-pool &engine::add_pool(const std::string &ns, double mto, double fto,
+bool engine::set_decisions(const char *file)
+{
+	if (file == NULL)
+		return false;
+	delete _decisions;
+	_decisions = new decision_writer;
+	if (_decisions->open(file)) {
+		delete _decisions;
+		_decisions = NULL;
+		return false;
+	}
+	return true;
+}
+
+pool &engine::add_pool(const std::string &ns, sim_time mto, sim_time fto,
 		       double weight, int minmap, int minred, pool::sched_mode sched)
 {
         _pools.push_back(pool(ns, mto, fto, weight, minmap, minred, sched));
         return _pools.back();
 }
 
-void engine::run_map(td_ref *t)
+template<typename S>
+bool engine::run(td_ref *t)
+{
+	if (_cluster && !place<S>(t)) {
+		defer(t);
+		return false;
+	}
+	start<S>(t);
+	return true;
+}
+
+template<typename S>
+void engine::start(td_ref *t)
 {
 	// set stime
-	t->gettask()->stime = time_now;
+	t->set_stime(time_now);
+	if (_decisions)
+		_decisions->add(decision::LAUNCH, S::type, time_now, t->id());
 
 	// add to running set
-	running_maps->insert(t);
+	S::running(this)->insert(t);
+	if (_victims == VICTIM_MIN_LOST)
+		index<S>(t);
+	if (_drf)
+		_free -= S::container(t->getpool());
+
+	// the selector has raised the allocation of the pool
+	if (_met_interval > 0)
+		S::integ(t->getpool()).settle(S::ctx(t->getpool()), time_now);
 
 	// add finish event
-	add_event(new ev_finish_map(t));
+	add_event(new typename S::finish_event(t));
+
+	if (_spec)
+		arm_speculation<S>();
 }
 
-void engine::run_reduce(td_ref *t)
+bool engine::run_map(td_ref *t)
 {
-	// set stime
-	t->gettask()->stime = time_now;
+	return run<map_slot>(t);
+}
 
-	// add to running set
-	running_reduces->insert(t);
+bool engine::run_reduce(td_ref *t)
+{
+	return run<reduce_slot>(t);
+}
 
-	// add finish event
-	add_event(new ev_finish_reduce(t));
+template<typename S>
+void engine::finish(td_ref *t)
+{
+	bool killed = false;
+	if (_spec) {
+		job_rate &r = _rates[S::type][(uint64_t)(uintptr_t)t->getjob()];
+		r.sum += time_now - t->stime();
+		++r.n;
+		killed = drop_backup<S>(t, false);
+	}
+	// the restart overhead is not part of the task
+	sim_time overhead = 0;
+	if (_restart_overhead > 0) {
+		restart_map_type::iterator it = _restarts[S::type].find(t->id());
+		if (it != _restarts[S::type].end()) {
+			overhead = it.value();
+			_restarts[S::type].erase(it);
+		}
+	}
+	preempt_stats &ps = t->getpool()->preempts[S::type];
+	ps.useful += time_now - t->stime() - overhead;
+	ps.overhead += overhead;
+	sim_time work = t->ptime();
+	int node = _cluster? unplace<S>(t, &work): -1;
+	t->set_ptime(t->ptime() - overhead);
+	t->set_ftime(time_now);
+	t->getjob()->work_left -= work - overhead;
+	select->update_job(t->getpool(), t->getjob());
+	if (_decisions)
+		_decisions->add(decision::FINISH, S::type, time_now, t->id());
+	S::running(this)->erase(t);
+	if (_drf)
+		_free += S::container(t->getpool());
+	--S::ctx(t->getjob()).alloc;
+	--S::ctx(t->getjob()).demand;
+	--S::ctx(t->getpool()).alloc;
+	--S::ctx(t->getpool()).demand;
+	update_fairshares<S>(); // since demand has changed, update fair shares
+	S::transit_n2s(t->getpool(), this);
+	// needed for half fair share starvation
+	S::transit_s2n(t->getpool());
+	// a map waiting for this node takes over the slot
+	if (node < 0 || !relaunch<S>(node))
+		S::sem(this)->post(this);
+	if (killed)
+		S::sem(this)->post(this);  // slot of the backup
+	if (_drf)
+		unblock();
+	if (S::type == task::TASK_TYPE_MAP && _slowstart >= 0)
+		map_done(t);
 }
 
 void engine::finish_map(td_ref *t)
 {
-	t->gettask()->ftime = time_now;
-	running_maps->erase(t);
-	--t->getjob()->fs_ctx_map.alloc;
-	--t->getjob()->fs_ctx_map.demand;
-	--t->getpool()->fs_ctx_map.alloc;
-	--t->getpool()->fs_ctx_map.demand;
-	update_map_fairshares(); // since demand has changed, update fair shares
-	t->getpool()->map_transit_n2s(this);
-	// needed for half fair share starvation
-	t->getpool()->map_transit_s2n();
-	sem_map->post(this);
+	finish<map_slot>(t);
+}
+
+// Release the ref of an attempt that is over
+// The finish event of an attempt is the last to refer to its ref,
+// but for a reduce held for the shuffle, which map_done() retires.
+template<typename S>
+void engine::retire(td_ref *t)
+{
+	taskset_type::iterator it = S::running(this)->find(t);
+	if (it == S::running(this)->end() || (td_ref *)it.key() != t)
+		select->release(t);
+}
+
+void engine::retire_map(td_ref *t)
+{
+	retire<map_slot>(t);
+}
+
+void engine::retire_reduce(td_ref *t)
+{
+	retire<reduce_slot>(t);
 }
 
 void engine::finish_reduce(td_ref *t)
 {
-	t->gettask()->ftime = time_now;
-	running_reduces->erase(t);
-	--t->getjob()->fs_ctx_reduce.alloc;
-	--t->getjob()->fs_ctx_reduce.demand;
-	--t->getpool()->fs_ctx_reduce.alloc;
-	--t->getpool()->fs_ctx_reduce.demand;
-	update_reduce_fairshares(); // since demand has changed, update fair shares
-	t->getpool()->reduce_transit_n2s(this);
-	// needed for half fair share starvation
-	t->getpool()->reduce_transit_s2n();
-	sem_reduce->post(this);
+	if (_slowstart >= 0 && wait_shuffle(t))
+		return;
+	finish<reduce_slot>(t);
+}
+
+// Count a finished map towards the slow-start of its job, releasing
+// the reduces and then those waiting for the shuffle
+void engine::map_done(td_ref *t)
+{
+	job_deps &d = deps(t);
+	--d.maps_left;
+	if (d.hold > 0 && --d.hold == 0 && select->release_reduces(t)) {
+		// replace the creation chain unless it waits for a slot
+		if (sem_reduce->size() == 0)
+			add_event(new ev_create_reduce(select, ++create_chain[task::TASK_TYPE_REDUCE]));
+		DEBUG(KIND_CREATE, time_now, "released the reduces of job %016llx",
+		      (unsigned long long)t->getjob()->id);
+	}
+	if (d.maps_left > 0 || d.parked.empty())
+		return;
+	std::vector<td_ref *> parked;
+	parked.swap(d.parked);
+	for (size_t i = 0; i < parked.size(); ++i) {
+		td_ref *r = parked[i];
+		// skip the attempts preempted since, which may have relaunched
+		taskset_type::iterator it = running_reduces->find(r);
+		if (it == running_reduces->end() || it.key() != r || r->ftime() >= 0) {
+			retire<reduce_slot>(r);
+			continue;
+		}
+		finish<reduce_slot>(r);
+		r->set_ptime(time_now - r->stime());
+		select->release(r);
+	}
+}
+
+// Hold a finished reduce in its slot while maps of its job are running
+// Returns true if the reduce is held.
+bool engine::wait_shuffle(td_ref *t)
+{
+	job_deps &d = deps(t);
+	if (d.maps_left <= 0)
+		return false;
+	d.parked.push_back(t);
+	DEBUG(KIND_FINISH, time_now, "reduce %016llx waits for the shuffle",
+	      (unsigned long long)t->id());
+	return true;
 }
 
 void engine::add_event(event *ev)
@@ -134,74 +296,202 @@ void engine::add_event(event *ev)
 			  0, *_eventheap.rbegin());
 }
 
-void engine::preempt_maps(int num)
+template<typename S, typename V>
+int engine::preempt(int num, pool *p)
 {
+	taskset_type *running = S::running(this);
         int n = 0;
         int m = num;
-	running_maps->snap();  // take a snapshop of current running tasks
-        running_maps->sort();  // sort the running tasks by start time
-        for (taskset_type::iterator it = running_maps->begin();
-             it != running_maps->end() && m;) {
-                if (((td_ref *)it.key())->getpool()->fs_ctx_map.alloc >
-		    ((td_ref *)it.key())->getpool()->fs_ctx_map.fairshare) {
-                        ++n;
-                        --m;
-			((td_ref *)it.key())->set_flag(task::TASK_FLAG_PREEMPTED);
-			--((td_ref *)it.key())->getjob()->fs_ctx_map.alloc;
-			--((td_ref *)it.key())->getjob()->fs_ctx_map.demand;
-			--((td_ref *)it.key())->getpool()->fs_ctx_map.alloc;
-			--((td_ref *)it.key())->getpool()->fs_ctx_map.demand;
-			// must be added back into the scheduler
-			select->add_preempted_map(it.key());
-                        running_maps->erase((it++).key());
-		} else
-			++it;
-        }
+	int nbackups = 0;
+	// in the container mode, free up the containers of num tasks of p
+	bool sized = _drf && p;
+	resource need;
+	if (sized) {
+		need = S::container(p) * num;
+		need -= _free;
+	}
+	if (V::indexed) {
+		// the index has the running tasks in start order, among
+		// finished and preempted ones
+		std::vector<started> &idx = _started[S::type];
+		for (size_t i = idx.size(); i-- > 0 && (sized? !need.empty(): m);) {
+			td_ref *t = live<S>(idx[i]);
+			if (t == NULL)
+				continue;
+			if (V::eligible(t, p)) {
+				++n;
+				--m;
+				if (_drf) {
+					_free += S::container(t->getpool());
+					need -= S::container(t->getpool());
+				}
+				if (evict<S>(t))
+					++nbackups;
+				running->erase(t);
+			}
+		}
+	} else {
+		running->snap();  // take a snapshop of current running tasks
+		running->sort();  // sort the running tasks by start time
+		for (taskset_type::iterator it = running->begin();
+		     it != running->end() && (sized? !need.empty(): m);) {
+			td_ref *t = it.key();
+			if (V::eligible(t, p)) {
+				++n;
+				--m;
+				if (_drf) {
+					_free += S::container(t->getpool());
+					need -= S::container(t->getpool());
+				}
+				if (evict<S>(t))
+					++nbackups;
+				running->erase((it++).key());
+			} else
+				++it;
+		}
+	}
 
 	// update fair shares due to demand changes
-	update_map_fairshares();
+	update_fairshares<S>();
 
-	for (int i = 0; i < n; ++i) {
-		// wake up pending map creations
-		sem_map->post(this);
+	for (int i = 0; i < n + nbackups; ++i) {
+		// wake up pending task creations
+		S::sem(this)->post(this);
 	}
+	if (_drf)
+		unblock();
+
+	if (sized)
+		NOTICE(KIND_PREEMPT, time_now, "%d %ss have been preempted to fit %d containers", n, S::name(), num);
+	else
+		NOTICE(KIND_PREEMPT, time_now, "%d of %d %ss have been preempted", n, num, S::name());
 
-	NOTICE(time_now, "%d of %d maps have been preempted", n, num);
+	return n;
 }
 
-void engine::preempt_reduces(int num)
+// Kill a running task and add it back to the selector, accounting the
+// slot time lost
+// Returns true if its backup was dropped as well.
+template<typename S>
+bool engine::evict(td_ref *t)
 {
-        int n = 0;
-        int m = num;
-	running_reduces->snap();  // take a snapshop of current running tasks
-        running_reduces->sort();  // sort the running tasks by start time
-        for (taskset_type::iterator it = running_reduces->begin();
-             it != running_reduces->end() && m;) {
-                if (((td_ref *)it.key())->getpool()->fs_ctx_reduce.alloc >
-		    ((td_ref *)it.key())->getpool()->fs_ctx_reduce.fairshare) {
-                        ++n;
-                        --m;
-			((td_ref *)it.key())->set_flag(task::TASK_FLAG_PREEMPTED);
-			--((td_ref *)it.key())->getjob()->fs_ctx_reduce.alloc;
-			--((td_ref *)it.key())->getjob()->fs_ctx_reduce.demand;
-			--((td_ref *)it.key())->getpool()->fs_ctx_reduce.alloc;
-			--((td_ref *)it.key())->getpool()->fs_ctx_reduce.demand;
-			// must be added back into the scheduler
-			select->add_preempted_reduce(it.key());
-                        running_reduces->erase((it++).key());
-		} else
-			++it;
-        }
-
-	// update fair shares due to demand changes
-	update_reduce_fairshares();
+	// the backup goes along with the victim
+	bool backup = _spec && drop_backup<S>(t, false);
+	if (_cluster) {
+		sim_time base;
+		unplace<S>(t, &base);
+		t->set_ptime(base);
+	}
+	sim_time lost = time_now - t->stime();
+	preempt_stats &ps = t->getpool()->preempts[S::type];
+	++ps.preempted;
+	ps.lost += lost;
+	t->getjob()->lost += lost;
+	if (_restart_overhead > 0) {
+		// in place of the overhead of the attempt, if a restart
+		sim_time &overhead = _restarts[S::type][t->id()];
+		t->set_ptime(t->ptime() + _restart_overhead - overhead);
+		overhead = _restart_overhead;
+	}
+	t->set_flag(task::TASK_FLAG_PREEMPTED);
+	if (_decisions)
+		_decisions->add(decision::PREEMPT, S::type, time_now, t->id());
+	--S::ctx(t->getjob()).alloc;
+	--S::ctx(t->getjob()).demand;
+	--S::ctx(t->getpool()).alloc;
+	--S::ctx(t->getpool()).demand;
+	// must be added back into the scheduler
+	S::add_preempted(select, t);
+	return backup;
+}
 
-	for (int i = 0; i < n; ++i) {
-		// wake up pending reduce creations
-		sem_reduce->post(this);
+// Append a started task to the start order index, dropping the tasks
+// no longer running once they outnumber those running
+template<typename S>
+void engine::index(td_ref *t)
+{
+	std::vector<started> &idx = _started[S::type];
+	if (idx.size() > 2 * _started_live[S::type] + 64) {
+		size_t k = 0;
+		for (size_t i = 0; i < idx.size(); ++i)
+			if (live<S>(idx[i]))
+				idx[k++] = idx[i];
+		idx.erase(idx.begin() + k, idx.end());
+		_started_live[S::type] = k;
 	}
+	started s = { *t, t->stime() };
+	idx.push_back(s);
+}
 
-	NOTICE(time_now, "%d of %d reduces have been preempted", n, num);
+// The running ref of the attempt of an index entry, NULL if it is no
+// longer running
+// The running set finds the task by its ids, and a later attempt of
+// it has started since.
+template<typename S>
+td_ref *engine::live(started &s)
+{
+	taskset_type::iterator it = S::running(this)->find(&s.ref);
+	if (it == S::running(this)->end())
+		return NULL;
+	td_ref *t = it.key();
+	return t->stime() == s.stime? t: NULL;
+}
+
+void engine::preempt_maps(int num, pool *p)
+{
+	PROF_SCOPE(PROF_PREEMPT_MAPS);
+	if (_victims == VICTIM_MIN_LOST)
+		preempt<map_slot, min_lost_victim<map_slot> >(num, p);
+	else
+		preempt<map_slot, fair_victim<map_slot> >(num, p);
+}
+
+void engine::preempt_reduces(int num, pool *p)
+{
+	PROF_SCOPE(PROF_PREEMPT_REDUCES);
+	if (_victims == VICTIM_MIN_LOST)
+		preempt<reduce_slot, min_lost_victim<reduce_slot> >(num, p);
+	else
+		preempt<reduce_slot, fair_victim<reduce_slot> >(num, p);
+}
+
+template<typename S>
+bool engine::admit()
+{
+	if (!_drf)
+		return true;
+	pool *p = S::next_pool(select);
+	if (p == NULL || S::container(p).fits(_free))
+		return true;
+	_blocked[S::type] = true;
+	return false;
+}
+
+bool engine::admit_map()
+{
+	return admit<map_slot>();
+}
+
+bool engine::admit_reduce()
+{
+	return admit<reduce_slot>();
+}
+
+// Restart the task creations blocked for lack of resources
+template<typename S>
+void engine::unblock()
+{
+	if (!_blocked[S::type])
+		return;
+	_blocked[S::type] = false;
+	if (S::has(select))
+		add_event(new typename S::create_event(select, ++create_chain[S::type]));
+}
+
+void engine::unblock()
+{
+	unblock<map_slot>();
+	unblock<reduce_slot>();
 }
 
 void engine::submit_tasks()
@@ -212,6 +502,56 @@ void engine::submit_tasks()
 		add_event(new ev_create_reduce(select));
 }
 
+template<typename S>
+void engine::resume()
+{
+	const std::vector<td_ref *> &tasks = S::resumed(select);
+	for (std::vector<td_ref *>::const_iterator it = tasks.begin();
+	     it != tasks.end(); ++it) {
+		td_ref *t = *it;
+		// overdue tasks are assumed to finish right away
+		if (t->stime() + t->ptime() < time_now)
+			t->set_ptime(time_now - t->stime());
+		S::sem(this)->take();
+		if (_drf)
+			_free -= S::container(t->getpool());
+		++S::ctx(t->getjob()).alloc;
+		++S::ctx(t->getjob()).demand;
+		++S::ctx(t->getpool()).alloc;
+		++S::ctx(t->getpool()).demand;
+		if (_cluster) {
+			// anywhere, without runtime inflation
+			cluster::locality level;
+			int node = _cluster->find(S::type, NULL, 0, cluster::LOCALITY_OFF_RACK, &level);
+			if (node >= 0) {
+				_cluster->take(S::type, node);
+				placement &pl = _placed[S::type][t->id()];
+				pl.node = node;
+				pl.base = t->ptime();
+			}
+		}
+		S::running(this)->insert(t);
+		if (_victims == VICTIM_MIN_LOST)
+			index<S>(t);
+		add_event(new typename S::finish_event(t));
+		if (_decisions)
+			_decisions->add(decision::LAUNCH, S::type, t->stime(), t->id());
+	}
+	// started at different times before the boot
+	std::stable_sort(_started[S::type].begin(), _started[S::type].end(), by_stime);
+	if (tasks.size()) {
+		update_fairshares<S>();
+		if (_spec)
+			arm_speculation<S>();
+	}
+}
+
+void engine::resume_tasks()
+{
+	resume<map_slot>();
+	resume<reduce_slot>();
+}
+
 double engine::map_progress() const
 {
 	if (select == NULL)
@@ -232,35 +572,151 @@ double engine::reduce_progress() const
 	return select->reduces_popped() / total;
 }
 
-void engine::process()
+void engine::process(bool resume)
 {
 	// Initially fair shares are zero due to zero demand, and
 	// nobody is starved due to zero demands
 
+	// the times of a previous run are dropped, those of the started
+	// tasks kept to resume
+	for (pool_container_type::iterator pit = _pools.begin();
+	     pit != _pools.end(); ++pit)
+		for (pool::job_container_type::iterator jit = pit->jobs.begin();
+		     jit != pit->jobs.end(); ++jit)
+			for (int type = 0; type < task::TASK_TYPE_NUM; ++type) {
+				if (!resume)
+					jit->tasks[type].clear_times(_record_times);
+				else if (_record_times)
+					jit->tasks[type].record_times();
+			}
+
 	// create a task selector on pools
-	select = new selector(_pools.begin(), _pools.end());
+	select = new selector(_pools.begin(), _pools.end(), resume, _slowstart);
+
+	if (_drf) {
+		if (_cluster || _spec || _capacity.size()) {
+			ULIB_WARNING("the node model, speculation and capacity changes are ignored in the container mode");
+			delete _cluster;
+			_cluster = NULL;
+			_spec = false;
+			_capacity.clear();
+		}
+		resolve_containers();
+		select->set_capacity(&_total);
+		_free = _total;
+		// slots no longer limit the tasks, containers do
+		sem_map->reset(INT_MAX / 2);
+		sem_reduce->reset(INT_MAX / 2);
+		_drf_users.clear();
+		for (pool_container_type::iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			drf_user u;
+			u.ctx  = &it->fs_ctx_map;
+			u.size = it->containers[task::TASK_TYPE_MAP];
+			_drf_users.push_back(u);
+			u.ctx  = &it->fs_ctx_reduce;
+			u.size = it->containers[task::TASK_TYPE_REDUCE];
+			_drf_users.push_back(u);
+		}
+	}
+
+	if (_slowstart >= 0) {
+		if (_spec) {
+			ULIB_WARNING("speculation is ignored with reduce slow-start");
+			_spec = false;
+		}
+		// per-job completion counters, indexed densely
+		_job_base.clear();
+		size_t njobs = 0;
+		for (pool_container_type::const_iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			_job_base.push_back(njobs);
+			njobs += it->jobs.size();
+		}
+		_deps.assign(njobs, job_deps());
+		for (pool_container_type::const_iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			for (size_t i = 0; i < it->jobs.size(); ++i) {
+				const job &j = it->jobs[i];
+				job_deps &d = _deps[_job_base[it->idx] + i];
+				d.hold = selector::slowstart_maps(j, _slowstart, resume);
+				const job::task_container_type &maps = j.tasks[task::TASK_TYPE_MAP];
+				for (size_t k = 0; k < maps.size(); ++k)
+					if (!resume || maps.ftime(k) < 0)
+						++d.maps_left;
+			}
+		}
+	}
+
+	if (_cluster && (_spec || _capacity.size())) {
+		ULIB_WARNING("speculation and capacity changes are ignored with a node model");
+		_spec = false;
+		_capacity.clear();
+	}
+
+	for (pool_container_type::iterator it = _pools.begin(); it != _pools.end(); ++it) {
+		for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt)
+			it->preempts[tt] = preempt_stats();
+		for (pool::job_container_type::iterator jit = it->jobs.begin();
+		     jit != it->jobs.end(); ++jit)
+			jit->lost = 0;
+	}
+
+	// occupy slots with the tasks already running
+	if (resume)
+		resume_tasks();
 
 	// add task creation events
         submit_tasks();
 
+	for (std::vector<capacity_change>::const_iterator it = _capacity.begin();
+	     it != _capacity.end(); ++it)
+		add_event(new ev_capacity(it->time, it->nslots[task::TASK_TYPE_MAP],
+					  it->nslots[task::TASK_TYPE_REDUCE]));
+
+#ifdef COLOSSAL_PROFILE
+	ulib_timer_t timer;
+	uint64_t cycles = 0;
+	if (_prof) {
+		_prof->reset();
+		profiler::set_current(_prof);
+		timer_start(&timer);
+		cycles = rdtsc();
+	}
+#endif
+
 	metric met("", _fp_met);
+	if (_fp_met && _met_interval > 0) {
+		_met_begin = time_now;
+		for (pool_container_type::iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			it->fs_int_map.reset(it->fs_ctx_map, time_now);
+			it->fs_int_reduce.reset(it->fs_ctx_reduce, time_now);
+		}
+	}
 	size_t nev = 0;
         // process events
 	while (_eventheap.size()) {
 		event *ev = *_eventheap.begin();
 		heap_pop_to_rear_inclass(&*_eventheap.begin(), &*_eventheap.end());
 		_eventheap.pop_back();
+		// intervals that end before the event
+		if (_fp_met && _met_interval > 0)
+			print_integrals(met, ev->gettime());
 		if ((*ev)(this))  // delete the event if it is done
 			delete ev;
+		PROF_SAMPLE(time_now, _eventheap.size(), sem_map->size(), sem_reduce->size());
 		// sample processing progress
-		if (nev % PROGRESS_WINSIZE == 0 || _eventheap.size() == 0)
+		if (_progress && (nev % PROGRESS_WINSIZE == 0 || _eventheap.size() == 0))
 			show_progress(map_progress(), reduce_progress());
 		// sample metrics
-		if (_fp_met && (nev % _met_win == 0 || _eventheap.size() == 0)) {
+		if (_fp_met && _met_interval <= 0 &&
+		    (nev % _met_win == 0 || _eventheap.size() == 0)) {
+			PROF_SCOPE(PROF_METRICS);
 			for (pool_container_type::const_iterator it = _pools.begin();
 			     it != _pools.end(); ++it) {
 				char key[64];
-				snprintf(key, sizeof(key), "%lf", time_now);
+				snprintf(key, sizeof(key), "%lld", (long long)time_now);
 				metric root = met[key];
 				it->print_metrics(root[it->name]);
 			}
@@ -268,32 +724,639 @@ void engine::process()
 		++nev;
 	}
 
-	if (nev)
+	if (nev && _progress)
 		fprintf(stderr, "\n");
+	_nevents = nev;
+
+	// the last, possibly partial, interval
+	if (_fp_met && _met_interval > 0 && time_now > _met_begin) {
+		settle_integrals();
+		char key[64];
+		snprintf(key, sizeof(key), "%lld", (long long)time_now);
+		metric root = met[key];
+		for (pool_container_type::const_iterator it = _pools.begin();
+		     it != _pools.end(); ++it)
+			it->print_integrals(root[it->name], time_now - _met_begin);
+	}
+	if (_fp_met)
+		fflush(_fp_met);
+
+	if (_decisions) {
+		_decisions->close();
+		delete _decisions;
+		_decisions = NULL;
+	}
+
+#ifdef COLOSSAL_PROFILE
+	if (_prof) {
+		cycles = rdtsc() - cycles;
+		double secs = timer_stop(&timer);
+		profiler::set_current(NULL);
+		save_profile(cycles, secs);
+	}
+#endif
+}
+
+bool engine::set_profile(const char *summary, const char *trace, sim_time bucket)
+{
+#ifdef COLOSSAL_PROFILE
+	if (summary == NULL)
+		return false;
+	delete _prof;
+	_prof = new profiler(bucket);
+	_prof_summary = summary;
+	_prof_trace = trace? trace: "";
+	return true;
+#else
+	(void)summary;
+	(void)trace;
+	(void)bucket;
+	ULIB_WARNING("profiling is not built in, rebuild with -DCOLOSSAL_PROFILE");
+	return false;
+#endif
+}
+
+void engine::save_profile(uint64_t cycles, double seconds) const
+{
+	FILE *fp = fopen(_prof_summary.c_str(), "w");
+	if (fp == NULL) {
+		ULIB_WARNING("cannot open profile summary %s", _prof_summary.c_str());
+		return;
+	}
+	_prof->report(fp, cycles, seconds);
+	fclose(fp);
+
+	if (_prof_trace.empty())
+		return;
+	fp = fopen(_prof_trace.c_str(), "w");
+	if (fp == NULL) {
+		ULIB_WARNING("cannot open profile trace %s", _prof_trace.c_str());
+		return;
+	}
+	_prof->trace(fp);
+	fclose(fp);
 }
 
 void engine::scale_minshares()
 {
-	map_fs_itr<pool_container_type> map_begin(_pools.begin());
-	map_fs_itr<pool_container_type> map_end(_pools.end());
-	reduce_fs_itr<pool_container_type> red_begin(_pools.begin());
-	reduce_fs_itr<pool_container_type> red_end(_pools.end());
-	colossal::scale_minshares(map_begin, map_end, _nmap);
-	colossal::scale_minshares(red_begin, red_end, _nreduce);
+	if (_drf) {
+		// the min share containers of all pools within the capacity
+		resolve_containers();
+		resource sum;
+		for (pool_container_type::const_iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			sum += it->containers[task::TASK_TYPE_MAP] * it->fs_ctx_map.minshare;
+			sum += it->containers[task::TASK_TYPE_REDUCE] * it->fs_ctx_reduce.minshare;
+		}
+		double r = 1;
+		for (int k = 0; k < resource::RESOURCE_NUM; ++k)
+			if (sum[k] > _total[k])
+				r = std::min(r, _total[k] / sum[k]);
+		for (pool_container_type::iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			it->fs_ctx_map.minshare *= r;
+			it->fs_ctx_reduce.minshare *= r;
+		}
+		return;
+	}
+
+	slot_fs_itr<map_slot, pool_container_type> map_begin(_pools.begin());
+	slot_fs_itr<map_slot, pool_container_type> map_end(_pools.end());
+	slot_fs_itr<reduce_slot, pool_container_type> red_begin(_pools.begin());
+	slot_fs_itr<reduce_slot, pool_container_type> red_end(_pools.end());
+	colossal::scale_minshares(map_begin, map_end, _nslots[task::TASK_TYPE_MAP]);
+	colossal::scale_minshares(red_begin, red_end, _nslots[task::TASK_TYPE_REDUCE]);
+}
+
+template<typename S>
+void engine::update_fairshares()
+{
+	PROF_SCOPE(PROF_FAIRSHARES);
+	// maps and reduces share the containers
+	if (_drf) {
+		compute_drf_shares(_drf_users, _total);
+		if (_met_interval > 0)
+			settle_integrals();
+		return;
+	}
+	slot_fs_itr<S, pool_container_type> begin(_pools.begin());
+	slot_fs_itr<S, pool_container_type> end(_pools.end());
+	compute_fairshares(begin, end, _nslots[S::type]);
+	// every change of a pool status ends up here
+	if (_met_interval > 0) {
+		for (pool_container_type::iterator it = _pools.begin();
+		     it != _pools.end(); ++it)
+			S::integ(&*it).settle(S::ctx(&*it), time_now);
+	}
+}
+
+// Bring the time integrals of all pools up to date
+void engine::settle_integrals()
+{
+	for (pool_container_type::iterator it = _pools.begin();
+	     it != _pools.end(); ++it) {
+		it->fs_int_map.settle(it->fs_ctx_map, time_now);
+		it->fs_int_reduce.settle(it->fs_ctx_reduce, time_now);
+	}
+}
+
+// Print the averages of all intervals that end by the time until
+// Nothing changes between the last event and until, so the integrals
+// are settled at each interval end as they are.
+void engine::print_integrals(metric &met, sim_time until)
+{
+	while (_met_begin + _met_interval <= until) {
+		sim_time end = _met_begin + _met_interval;
+		char key[64];
+		snprintf(key, sizeof(key), "%lld", (long long)end);
+		metric root = met[key];
+		for (pool_container_type::iterator it = _pools.begin();
+		     it != _pools.end(); ++it) {
+			it->fs_int_map.settle(it->fs_ctx_map, end);
+			it->fs_int_reduce.settle(it->fs_ctx_reduce, end);
+			it->print_integrals(root[it->name], _met_interval);
+			it->fs_int_map.restart(end);
+			it->fs_int_reduce.restart(end);
+		}
+		_met_begin = end;
+	}
 }
 
 void engine::update_map_fairshares()
 {
-	map_fs_itr<pool_container_type> begin(_pools.begin());
-	map_fs_itr<pool_container_type> end(_pools.end());
-	compute_fairshares(begin, end, _nmap);
+	update_fairshares<map_slot>();
 }
 
 void engine::update_reduce_fairshares()
 {
-	reduce_fs_itr<pool_container_type> begin(_pools.begin());
-	reduce_fs_itr<pool_container_type> end(_pools.end());
-	compute_fairshares(begin, end, _nreduce);
+	update_fairshares<reduce_slot>();
+}
+
+void engine::add_capacity(sim_time t, int nmaps, int nreduces)
+{
+	capacity_change c;
+	c.time = t;
+	c.nslots[task::TASK_TYPE_MAP] = nmaps;
+	c.nslots[task::TASK_TYPE_REDUCE] = nreduces;
+	_capacity.push_back(c);
+}
+
+template<typename S>
+void engine::resize(int n)
+{
+	vsem_type *sem = S::sem(this);
+	int delta = n - _nslots[S::type];
+	if (delta == 0)
+		return;
+	_nslots[S::type] = n;
+
+	if (delta < 0) {
+		for (int i = 0; i < -delta; ++i)
+			sem->take();
+		// evict what is running beyond the new capacity
+		int over = -sem->value();
+		if (over > 0 && _spec) {
+			int nb = drop_backups<S>(over);
+			over -= nb;
+			for (int i = 0; i < nb; ++i)
+				sem->post(this);
+		}
+		if (over > 0) {
+			// restart task creation if it has run out of tasks
+			bool idle = !S::has(select);
+			preempt<S, any_victim<S> >(over);
+			if (idle && S::has(select))
+				add_event(new typename S::create_event(select, create_chain[S::type]));
+		}
+	}
+	update_fairshares<S>();
+
+	// wake up pending task creations
+	for (int i = 0; i < delta; ++i)
+		sem->post(this);
+
+	NOTICE(KIND_CAPACITY, time_now, "%s slots changed by %d to %d", S::name(), delta, n);
+}
+
+void engine::set_slots(int nmaps, int nreduces)
+{
+	if (nmaps >= 0)
+		resize<map_slot>(nmaps);
+	if (nreduces >= 0)
+		resize<reduce_slot>(nreduces);
+}
+
+bool engine::set_speculation(const spec_params &params)
+{
+	if (params.slow_ratio <= 0 || params.slow_ratio > 1 ||
+	    params.cap < 0 || params.cap > 1 || params.interval <= 0) {
+		ULIB_WARNING("invalid speculation parameters");
+		return false;
+	}
+	_spec = true;
+	_spec_params = params;
+	return true;
+}
+
+template<typename S>
+void engine::arm_speculation()
+{
+	if (_spec_armed[S::type])
+		return;
+	_spec_armed[S::type] = true;
+	add_event(new ev_speculate<S>(time_now + _spec_params.interval));
+}
+
+namespace
+{
+
+// Straggler candidate, ordered by the estimated time left
+struct straggler {
+	sim_time left;
+	sim_time est;  // estimated duration of a backup
+	td_ref  *ref;
+
+	bool operator<(const straggler &other) const
+	{
+		if (left != other.left)
+			return left > other.left;
+		return ref->id() < other.ref->id();
+	}
+};
+
+}
+
+template<typename S>
+void engine::speculate()
+{
+	PROF_SCOPE(PROF_SPECULATE);
+
+	taskset_type *running = S::running(this);
+	backup_map_type &backups = _backups[S::type];
+	rate_map_type &rates = _rates[S::type];
+
+	int n = std::min(S::sem(this)->value(),
+			 (int)(_spec_params.cap * _nslots[S::type]) - (int)backups.size());
+	std::vector<straggler> cands;
+	for (taskset_type::iterator it = running->begin();
+	     n > 0 && it != running->end(); ++it) {
+		td_ref *t = it.key();
+		if (time_now - t->stime() < _spec_params.min_runtime ||
+		    backups.find(t->id()) != backups.end())
+			continue;
+		rate_map_type::iterator r = rates.find((uint64_t)(uintptr_t)t->getjob());
+		if (r == rates.end())
+			continue;  // no finished task to compare against
+		// Progress is reported exactly, so the rate of the task is
+		// 1/ptime and its estimated time left is the actual one.
+		straggler s;
+		s.est = r.value().sum / r.value().n;
+		s.left = t->stime() + t->ptime() - time_now;
+		s.ref = t;
+		if (t->ptime() * _spec_params.slow_ratio > s.est && s.left > s.est)
+			cands.push_back(s);
+	}
+
+	n = std::min(n, (int)cands.size());
+	std::partial_sort(cands.begin(), cands.begin() + n, cands.end());
+	for (int i = 0; i < n; ++i) {
+		td_ref *t = cands[i].ref;
+		S::sem(this)->take();
+		++S::ctx(t->getjob()).alloc;
+		++S::ctx(t->getjob()).demand;
+		++S::ctx(t->getpool()).alloc;
+		++S::ctx(t->getpool()).demand;
+		backup &b = backups[t->id()];
+		b.ref = t;
+		b.stime = time_now;
+		b.ptime = cands[i].est;
+		add_event(new ev_finish_backup<S>(t, b.stime, b.ptime));
+		if (_decisions)
+			_decisions->add(decision::BACKUP, S::type, time_now, t->id());
+		++_spec_stats.launched;
+	}
+	if (n) {
+		update_fairshares<S>();
+		NOTICE(KIND_SPECULATE, time_now, "launched %d backup %ss", n, S::name());
+	}
+
+	// keep checking as long as there are running tasks
+	if (running->size())
+		add_event(new ev_speculate<S>(time_now + _spec_params.interval));
+	else
+		_spec_armed[S::type] = false;
+}
+
+// The original attempt may have been released, so the backup is
+// looked up by the task id
+template<typename S>
+bool engine::has_backup(uint64_t id, sim_time stime)
+{
+	backup_map_type::iterator it = _backups[S::type].find(id);
+	return it != _backups[S::type].end() && it.value().stime == stime;
+}
+
+// Remove the backup of a task, releasing its share of the allocation
+// The caller updates the fair shares and posts the slot.
+template<typename S>
+bool engine::drop_backup(td_ref *t, bool won)
+{
+	backup_map_type::iterator it = _backups[S::type].find(t->id());
+	if (it == _backups[S::type].end())
+		return false;
+	_spec_stats.slot_time += time_now - it.value().stime;
+	if (won)
+		++_spec_stats.won;
+	else
+		++_spec_stats.killed;
+	_backups[S::type].erase(it);
+	--S::ctx(t->getjob()).alloc;
+	--S::ctx(t->getjob()).demand;
+	--S::ctx(t->getpool()).alloc;
+	--S::ctx(t->getpool()).demand;
+	return true;
+}
+
+// Drop up to num backups, returning the number dropped
+template<typename S>
+int engine::drop_backups(int num)
+{
+	std::vector<td_ref *> refs;
+	for (backup_map_type::iterator it = _backups[S::type].begin();
+	     it != _backups[S::type].end() && (int)refs.size() < num; ++it)
+		refs.push_back(it.value().ref);
+	for (size_t i = 0; i < refs.size(); ++i)
+		drop_backup<S>(refs[i], false);
+	return refs.size();
+}
+
+template<typename S>
+void engine::finish_backup(td_ref *t)
+{
+	drop_backup<S>(t, true);
+	finish<S>(t);
+	// the pending finish event of the original attempt no longer
+	// matches, and the task ends up with its effective run time
+	t->set_ptime(time_now - t->stime());
+	S::sem(this)->post(this);
+}
+
+template void engine::speculate<map_slot>();
+template void engine::speculate<reduce_slot>();
+template bool engine::has_backup<map_slot>(uint64_t, sim_time);
+template bool engine::has_backup<reduce_slot>(uint64_t, sim_time);
+template void engine::finish_backup<map_slot>(td_ref *);
+template void engine::finish_backup<reduce_slot>(td_ref *);
+
+bool engine::set_containers(const resource &capacity, const resource &map, const resource &reduce)
+{
+	for (int k = 0; k < resource::RESOURCE_NUM; ++k) {
+		if (capacity[k] <= 0 || map[k] <= 0 || reduce[k] <= 0) {
+			ULIB_WARNING("container resources must be positive");
+			return false;
+		}
+	}
+	_drf = true;
+	_total = capacity;
+	_containers[task::TASK_TYPE_MAP] = map;
+	_containers[task::TASK_TYPE_REDUCE] = reduce;
+	return true;
+}
+
+// Give the pools without a container size the default one, and cap
+// the sizes at the capacity
+void engine::resolve_containers()
+{
+	for (pool_container_type::iterator it = _pools.begin();
+	     it != _pools.end(); ++it) {
+		for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt) {
+			resource &c = it->containers[tt];
+			if (c.empty())
+				c = _containers[tt];
+			if (!c.fits(_total)) {
+				ULIB_WARNING("containers of pool %s exceed the capacity", it->name.c_str());
+				for (int k = 0; k < resource::RESOURCE_NUM; ++k)
+					c[k] = std::min(c[k], _total[k]);
+			}
+		}
+	}
+}
+
+void engine::set_cluster(cluster *c)
+{
+	delete _cluster;
+	_cluster = c;
+	_node_waits.assign(c->nodes(), std::vector<waiting>());
+	for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt)
+		_nslots[tt] = c->slots((task::task_type)tt);
+	delete sem_map;
+	delete sem_reduce;
+	sem_map = new vsem_type(_nslots[task::TASK_TYPE_MAP]);
+	sem_reduce = new vsem_type(_nslots[task::TASK_TYPE_REDUCE]);
+}
+
+// Locality level a job may launch a map at
+// The job waits for the cluster delay at each level, counting from
+// its last launch.
+cluster::locality engine::allowed(job *j)
+{
+	uint64_t key = (uint64_t)(uintptr_t)j;
+	delay_map_type::iterator it = _delays.find(key);
+	if (it == _delays.end()) {
+		job_delay d = { cluster::LOCALITY_NODE, time_now };
+		it = _delays.insert(key, d);
+	}
+	if (_cluster->delay() <= 0)
+		return cluster::LOCALITY_OFF_RACK;
+	sim_time steps = (time_now - it.value().since) / _cluster->delay();
+	return (cluster::locality)std::min((sim_time)cluster::LOCALITY_OFF_RACK,
+					   it.value().level + steps);
+}
+
+// Find a slot for the task, false if a map is to wait for locality
+template<typename S>
+bool engine::place(td_ref *t)
+{
+	int blocks[cluster::MAX_REPLICAS] = { 0 };
+	int n = 0;
+	cluster::locality max = cluster::LOCALITY_OFF_RACK;
+	if (S::type == task::TASK_TYPE_MAP) {
+		n = _cluster->blocks(t->id(), blocks);
+		max = allowed(t->getjob());
+	}
+	cluster::locality level;
+	int node = _cluster->find(S::type, blocks, n, max, &level);
+	if (node >= 0)
+		assign<S>(t, node, level);
+	// over-committed reduces run without a node
+	return node >= 0 || S::type != task::TASK_TYPE_MAP;
+}
+
+template<typename S>
+void engine::assign(td_ref *t, int node, cluster::locality level)
+{
+	_cluster->take(S::type, node);
+	placement &pl = _placed[S::type][t->id()];
+	pl.node = node;
+	pl.base = t->ptime();
+	if (S::type != task::TASK_TYPE_MAP)
+		return;
+	t->set_ptime(to_sim_time(t->ptime() * _cluster->factor(level)));
+	++_nlaunch[level];
+	job_delay &d = _delays[(uint64_t)(uintptr_t)t->getjob()];
+	d.level = level;
+	d.since = time_now;
+}
+
+// Free the slot of the task, returning its node or -1 if it has none
+template<typename S>
+int engine::unplace(td_ref *t, sim_time *base)
+{
+	*base = t->ptime();
+	placement_map_type::iterator it = _placed[S::type].find(t->id());
+	if (it == _placed[S::type].end())
+		return -1;
+	int node = it.value().node;
+	*base = it.value().base;
+	_placed[S::type].erase(it);
+	_cluster->release(S::type, node);
+	return node;
+}
+
+// Only the id is looked at, as t may be gone already
+bool engine::deferred(td_ref *t, uint64_t id) const
+{
+	deferral_map_type::const_iterator it = _deferred.find(id);
+	return it != _deferred.end() && it.value().ref == t;
+}
+
+// Put a popped map aside until a slot close to its blocks frees up,
+// or until its job has waited long enough to go further
+void engine::defer(td_ref *t)
+{
+	--map_slot::ctx(t->getjob()).alloc;
+	--map_slot::ctx(t->getjob()).demand;
+	--map_slot::ctx(t->getpool()).alloc;
+	--map_slot::ctx(t->getpool()).demand;
+	update_fairshares<map_slot>();
+
+	int blocks[cluster::MAX_REPLICAS];
+	int n = _cluster->blocks(t->id(), blocks);
+	waiting w = { t, t->id() };
+	for (int i = 0; i < n; ++i)
+		_node_waits[blocks[i]].push_back(w);
+	deferral &d = _deferred[w.id];
+	d.ref = t;
+	d.escalated = false;
+
+	cluster::locality max = allowed(t->getjob());
+	if (max == cluster::LOCALITY_OFF_RACK) {
+		d.escalated = true;
+		_escalated.push_back(w);
+	} else {
+		const job_delay &jd = _delays[(uint64_t)(uintptr_t)t->getjob()];
+		add_event(new ev_locality(jd.since + (max - jd.level + 1) * _cluster->delay(), t));
+	}
+	DEBUG(KIND_LOCALITY, time_now, "deferred map %016llx", (unsigned long long)t->id());
+}
+
+void engine::launch_deferred(td_ref *t, int node, cluster::locality level)
+{
+	_deferred.erase(t->id());
+	++map_slot::ctx(t->getjob()).alloc;
+	++map_slot::ctx(t->getjob()).demand;
+	++map_slot::ctx(t->getpool()).alloc;
+	++map_slot::ctx(t->getpool()).demand;
+	update_fairshares<map_slot>();
+	t->clear_flag();
+	assign<map_slot>(t, node, level);
+	start<map_slot>(t);
+}
+
+// Hand the slot freed on the node to a deferred map, node-local ones
+// first, and then those whose job has waited long enough
+template<typename S>
+bool engine::relaunch(int node)
+{
+	if (S::type != task::TASK_TYPE_MAP || _cluster->free_slots(S::type, node) <= 0)
+		return false;
+
+	std::vector<waiting> &waits = _node_waits[node];
+	td_ref *local = NULL;
+	size_t k = 0;
+	for (size_t i = 0; i < waits.size(); ++i) {
+		if (!deferred(waits[i].ref, waits[i].id))
+			continue;  // stale
+		if (local == NULL)
+			local = waits[i].ref;
+		else
+			waits[k++] = waits[i];
+	}
+	waits.resize(k);
+	if (local) {
+		launch_deferred(local, node, cluster::LOCALITY_NODE);
+		return true;
+	}
+
+	td_ref *chosen = NULL;
+	cluster::locality level = cluster::LOCALITY_OFF_RACK;
+	k = 0;
+	for (size_t i = 0; i < _escalated.size(); ++i) {
+		td_ref *t = _escalated[i].ref;
+		if (!deferred(t, _escalated[i].id))
+			continue;
+		if (chosen == NULL) {
+			int blocks[cluster::MAX_REPLICAS];
+			int n = _cluster->blocks(t->id(), blocks);
+			cluster::locality l = cluster::LOCALITY_OFF_RACK;
+			for (int b = 0; b < n; ++b)
+				if (_cluster->rack_of(blocks[b]) == _cluster->rack_of(node))
+					l = cluster::LOCALITY_RACK;
+			if (l <= allowed(t->getjob())) {
+				chosen = t;
+				level = l;
+				continue;
+			}
+		}
+		_escalated[k++] = _escalated[i];
+	}
+	_escalated.resize(k);
+	if (chosen) {
+		launch_deferred(chosen, node, level);
+		return true;
+	}
+	return false;
+}
+
+// The job of a deferred map has waited for another delay
+void engine::escalate_map(td_ref *t, uint64_t id)
+{
+	if (!deferred(t, id))
+		return;
+
+	cluster::locality max = allowed(t->getjob());
+	if (sem_map->value() > 0) {
+		int blocks[cluster::MAX_REPLICAS];
+		int n = _cluster->blocks(t->id(), blocks);
+		cluster::locality level;
+		int node = _cluster->find(task::TASK_TYPE_MAP, blocks, n, max, &level);
+		if (node >= 0) {
+			sem_map->take();
+			launch_deferred(t, node, level);
+			return;
+		}
+	}
+
+	deferral &d = _deferred[id];
+	if (!d.escalated) {
+		d.escalated = true;
+		waiting w = { t, id };
+		_escalated.push_back(w);
+	}
+	if (max < cluster::LOCALITY_OFF_RACK) {
+		const job_delay &jd = _delays[(uint64_t)(uintptr_t)t->getjob()];
+		add_event(new ev_locality(jd.since + (max - jd.level + 1) * _cluster->delay(), t));
+	}
 }
 
 }
@@ -13,6 +13,7 @@
  */
 
 #include "log.hpp"
+#include "profile.hpp"
 #include "common.hpp"
 #include "event.hpp"
 #include "engine.hpp"
@@ -20,8 +21,8 @@
 namespace colossal
 {
 
-ev_create_map::ev_create_map(selector *sel)
-	: _sel(sel)
+ev_create_map::ev_create_map(selector *sel, unsigned chain)
+	: _sel(sel), _chain(chain)
 {
 	// we are guaranteed that sel has map tasks
         _time = sel->map_min_ctime();
@@ -29,11 +30,16 @@ ev_create_map::ev_create_map(selector *sel)
 
 bool ev_create_map::operator()(engine *eng)
 {
+	PROF_SCOPE(PROF_EV_CREATE_MAP);
+
+	if (_chain != eng->create_chain[task::TASK_TYPE_MAP])
+		return true;  // replaced
+
 	if (_time > eng->time_now)  // possibly woke from sleep
 		eng->time_now = _time;
 
 	// creation event is asynchronous, thus time is job tracker time
-        DEBUG(eng->time_now, "ev_create_map executed");
+        DEBUG(KIND_CREATE, eng->time_now, "ev_create_map executed");
 
 	// update demands
 	selector::changes_type changes;
@@ -45,42 +51,60 @@ bool ev_create_map::operator()(engine *eng)
 	// we may need to add preemption check points accordingly
 	for (selector::changes_type::iterator it = changes.begin();
 	     it != changes.end(); ++it)
-		((td_ref *)(it.key()))->getpool()->map_transit_n2s(eng);
+		((pool *)(it.key()))->map_transit_n2s(eng);
 
 	// acquire resources
 	if (!eng->sem_map->wait(this)) {
-		DEBUG(eng->time_now, "map creation suspended due to lack of slot");
+		DEBUG(KIND_CREATE, eng->time_now, "map creation suspended due to lack of slot");
 		return false;
 	} else {
-		DEBUG(eng->time_now, "map creation acquired a slot");
+		DEBUG(KIND_CREATE, eng->time_now, "map creation acquired a slot");
 	}
 
-	// run the map
-	td_ref *t = _sel->pop_map();
-	if (t == NULL) {
-		FATAL(eng->time_now, "popped out a NULL task");
+	// in the container mode, wait for resources to free up
+	if (!eng->admit_map()) {
+		DEBUG(KIND_CREATE, eng->time_now, "map creation blocked for lack of resources");
+		eng->sem_map->post(eng);
 		return true;
 	}
 
-	// popping out may change the pool state
-	t->getpool()->map_transit_s2n();
-
-	// make the task clean before launching
-	t->clear_flag();
-	eng->run_map(t);
+	// run the map, or the next one if it waits for locality
+	bool deferred = false;
+	td_ref *t = NULL;
+	while (!deferred || _sel->maps_popped() < _sel->maps_seen()) {
+		if ((t = _sel->pop_map()) == NULL)
+			break;
+
+		// popping out may change the pool state
+		t->getpool()->map_transit_s2n();
+
+		// make the task clean before launching
+		t->clear_flag();
+		if (eng->run_map(t))
+			break;
+		t = NULL;
+		deferred = true;
+	}
+	if (t == NULL) {
+		if (!deferred) {
+			FATAL(KIND_CREATE, eng->time_now, "popped out a NULL task");
+			return true;
+		}
+		eng->sem_map->post(eng);  // nothing to run for now
+	}
 
 	// add repeated event
 	if (_sel->has_map())
-		eng->add_event(new ev_create_map(_sel));
+		eng->add_event(new ev_create_map(_sel, _chain));
 	else {
-		DEBUG(eng->time_now, "no more map creation");
+		DEBUG(KIND_CREATE, eng->time_now, "no more map creation");
 	}
 
 	return true;
 }
 
-ev_create_reduce::ev_create_reduce(selector *sel)
-	: _sel(sel)
+ev_create_reduce::ev_create_reduce(selector *sel, unsigned chain)
+	: _sel(sel), _chain(chain)
 {
 	// we are guaranteed that sel has reduce tasks
         _time = sel->reduce_min_ctime();
@@ -88,11 +112,16 @@ ev_create_reduce::ev_create_reduce(selector *sel)
 
 bool ev_create_reduce::operator()(engine *eng)
 {
+	PROF_SCOPE(PROF_EV_CREATE_REDUCE);
+
+	if (_chain != eng->create_chain[task::TASK_TYPE_REDUCE])
+		return true;  // replaced
+
 	if (_time > eng->time_now)  // possibly woke from sleep
 		eng->time_now = _time;
 
 	// creation event is asynchronous, thus time is job tracker time
-        DEBUG(eng->time_now, "ev_create_reduce executed");
+        DEBUG(KIND_CREATE, eng->time_now, "ev_create_reduce executed");
 
 	// update demands
 	selector::changes_type changes;
@@ -104,20 +133,27 @@ bool ev_create_reduce::operator()(engine *eng)
 	// we may need to add preemption check points accordingly
 	for (selector::changes_type::iterator it = changes.begin();
 	     it != changes.end(); ++it)
-		((td_ref *)(it.key()))->getpool()->reduce_transit_n2s(eng);
+		((pool *)(it.key()))->reduce_transit_n2s(eng);
 
 	// acquire resources
 	if (!eng->sem_reduce->wait(this)) {
-		DEBUG(eng->time_now, "reduce creation suspended due to lack of slot");
+		DEBUG(KIND_CREATE, eng->time_now, "reduce creation suspended due to lack of slot");
 		return false;
 	} else {
-		DEBUG(eng->time_now, "reduce creation acquired a slot");
+		DEBUG(KIND_CREATE, eng->time_now, "reduce creation acquired a slot");
+	}
+
+	// in the container mode, wait for resources to free up
+	if (!eng->admit_reduce()) {
+		DEBUG(KIND_CREATE, eng->time_now, "reduce creation blocked for lack of resources");
+		eng->sem_reduce->post(eng);
+		return true;
 	}
 
 	// run the reduce
 	td_ref *t = _sel->pop_reduce();
 	if (t == NULL) {
-		FATAL(eng->time_now, "popped out a NULL task");
+		FATAL(KIND_CREATE, eng->time_now, "popped out a NULL task");
 		return true;
 	}
 
@@ -130,9 +166,9 @@ bool ev_create_reduce::operator()(engine *eng)
 
 	// add repeated event
 	if (_sel->has_reduce())
-		eng->add_event(new ev_create_reduce(_sel));
+		eng->add_event(new ev_create_reduce(_sel, _chain));
 	else {
-		DEBUG(eng->time_now, "no more reduce creation");
+		DEBUG(KIND_CREATE, eng->time_now, "no more reduce creation");
 	}
 
 	return true;
@@ -141,18 +177,21 @@ bool ev_create_reduce::operator()(engine *eng)
 ev_finish_map::ev_finish_map(td_ref *t)
 	: _ref(t)
 {
-	_time = t->gettask()->stime + t->gettask()->ptime;
+	_time = t->stime() + t->ptime();
 }
 
 bool ev_finish_map::operator()(engine *eng)
 {
+	PROF_SCOPE(PROF_EV_FINISH_MAP);
+
 	// Only effective if the task has not been preempted
-	if (double_equal(_ref->gettask()->stime + _ref->gettask()->ptime, _time) &&
+	if (_ref->stime() + _ref->ptime() == _time &&
 	    !_ref->test_flag(task::TASK_FLAG_PREEMPTED)) {
 		eng->time_now = _time;
 		eng->finish_map(_ref);
 	}
-	DEBUG(eng->time_now, "ev_finish_map executed");
+	eng->retire_map(_ref);
+	DEBUG(KIND_FINISH, eng->time_now, "ev_finish_map executed");
 
 	return true;
 }
@@ -160,23 +199,26 @@ bool ev_finish_map::operator()(engine *eng)
 ev_finish_reduce::ev_finish_reduce(td_ref *t)
 	: _ref(t)
 {
-	_time = t->gettask()->stime + t->gettask()->ptime;
+	_time = t->stime() + t->ptime();
 }
 
 bool ev_finish_reduce::operator()(engine *eng)
 {
+	PROF_SCOPE(PROF_EV_FINISH_REDUCE);
+
 	// Only effective if the task has not been preempted and not already finished
-	if (double_equal(_ref->gettask()->stime + _ref->gettask()->ptime, _time) &&
+	if (_ref->stime() + _ref->ptime() == _time &&
 	    !_ref->test_flag(task::TASK_FLAG_PREEMPTED)) {
 		eng->time_now = _time;
 		eng->finish_reduce(_ref);
 	}
-	DEBUG(eng->time_now, "ev_finish_reduce executed");
+	eng->retire_reduce(_ref);
+	DEBUG(KIND_FINISH, eng->time_now, "ev_finish_reduce executed");
 
 	return true;
 }
 
-ev_preempt_map::ev_preempt_map(pool *p, double deadline)
+ev_preempt_map::ev_preempt_map(pool *p, sim_time deadline)
 	: _pool(p)
 {
 	_time = deadline;
@@ -184,25 +226,27 @@ ev_preempt_map::ev_preempt_map(pool *p, double deadline)
 
 bool ev_preempt_map::operator()(engine *eng)
 {
+	PROF_SCOPE(PROF_EV_PREEMPT_MAP);
+
 	eng->time_now = _time;
 
-	DEBUG(eng->time_now, "ev_preempt_map executed");
+	DEBUG(KIND_PREEMPT, eng->time_now, "ev_preempt_map executed");
 
 	int ms = _pool->starved_for_map_minshare(_time);
 	int hf = _pool->starved_for_map_halffairshare(_time);
 
 	if (ms > hf) {
-		NOTICE(eng->time_now, "need to preempt %d maps due to min share", ms);
-		eng->preempt_maps(ms);
+		NOTICE_POOL(KIND_PREEMPT, _pool->id, eng->time_now, "need to preempt %d maps due to min share", ms);
+		eng->preempt_maps(ms, _pool);
 	} else if (hf > 0) {
-		NOTICE(eng->time_now, "need to preempt %d maps due to half fair share", hf);
-		eng->preempt_maps(hf);
+		NOTICE_POOL(KIND_PREEMPT, _pool->id, eng->time_now, "need to preempt %d maps due to half fair share", hf);
+		eng->preempt_maps(hf, _pool);
 	}
 
 	return true;
 }
 
-ev_preempt_reduce::ev_preempt_reduce(pool *p, double deadline)
+ev_preempt_reduce::ev_preempt_reduce(pool *p, sim_time deadline)
 	: _pool(p)
 {
 	_time = deadline;
@@ -210,22 +254,96 @@ ev_preempt_reduce::ev_preempt_reduce(pool *p, double deadline)
 
 bool ev_preempt_reduce::operator()(engine *eng)
 {
+	PROF_SCOPE(PROF_EV_PREEMPT_REDUCE);
+
 	eng->time_now = _time;
 
-	DEBUG(eng->time_now, "ev_preempt_reduce executed");
+	DEBUG(KIND_PREEMPT, eng->time_now, "ev_preempt_reduce executed");
 
 	int ms = _pool->starved_for_reduce_minshare(_time);
 	int hf = _pool->starved_for_reduce_halffairshare(_time);
 
 	if (ms > hf) {
-		NOTICE(eng->time_now, "need to preempt %d reduces due to min share", ms);
-		eng->preempt_reduces(ms);
+		NOTICE_POOL(KIND_PREEMPT, _pool->id, eng->time_now, "need to preempt %d reduces due to min share", ms);
+		eng->preempt_reduces(ms, _pool);
 	} else if (hf > 0) {
-		NOTICE(eng->time_now, "need to preempt %d reduces due to half fair share", hf);
-		eng->preempt_reduces(hf);
+		NOTICE_POOL(KIND_PREEMPT, _pool->id, eng->time_now, "need to preempt %d reduces due to half fair share", hf);
+		eng->preempt_reduces(hf, _pool);
 	}
 
 	return true;
 }
 
+ev_capacity::ev_capacity(sim_time t, int nmaps, int nreduces)
+	: _nmaps(nmaps), _nreduces(nreduces)
+{
+	_time = t;
+}
+
+bool ev_capacity::operator()(engine *eng)
+{
+	if (_time > eng->time_now)  // boot time may be later
+		eng->time_now = _time;
+	DEBUG(KIND_CAPACITY, eng->time_now, "ev_capacity executed");
+	eng->set_slots(_nmaps, _nreduces);
+
+	return true;
+}
+
+ev_locality::ev_locality(sim_time t, td_ref *ref)
+	: _ref(ref), _id(ref->id())
+{
+	_time = t;
+}
+
+bool ev_locality::operator()(engine *eng)
+{
+	eng->time_now = _time;
+	DEBUG(KIND_LOCALITY, eng->time_now, "ev_locality executed");
+	eng->escalate_map(_ref, _id);
+
+	return true;
+}
+
+template<typename S>
+ev_speculate<S>::ev_speculate(sim_time t)
+{
+	_time = t;
+}
+
+template<typename S>
+bool ev_speculate<S>::operator()(engine *eng)
+{
+	eng->time_now = _time;
+	DEBUG(KIND_SPECULATE, eng->time_now, "ev_speculate executed");
+	eng->speculate<S>();
+
+	return true;
+}
+
+template<typename S>
+ev_finish_backup<S>::ev_finish_backup(td_ref *t, sim_time stime, sim_time ptime)
+	: _ref(t), _id(t->id()), _stime(stime)
+{
+	_time = stime + ptime;
+}
+
+template<typename S>
+bool ev_finish_backup<S>::operator()(engine *eng)
+{
+	// Only effective if the backup has not been killed
+	if (eng->has_backup<S>(_id, _stime)) {
+		eng->time_now = _time;
+		eng->finish_backup<S>(_ref);
+	}
+	DEBUG(KIND_SPECULATE, eng->time_now, "ev_finish_backup executed");
+
+	return true;
+}
+
+template class ev_speculate<map_slot>;
+template class ev_speculate<reduce_slot>;
+template class ev_finish_backup<map_slot>;
+template class ev_finish_backup<reduce_slot>;
+
 }
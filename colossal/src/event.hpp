@@ -30,7 +30,7 @@ class event
 public:
         virtual ~event() { }
 
-        double gettime() const
+        sim_time gettime() const
         {
                 return _time;
         }
@@ -57,27 +57,34 @@ public:
 	}
 
 protected:
-        double _time;
+        sim_time _time;
 };
 
+// Task creation events
+// Each task type has a single chain of creation events, each adding
+// the next one. The engine may start a new chain, e.g. when tasks are
+// released earlier than the pending event, and an event of a replaced
+// chain then does nothing. See engine::create_chain.
 class ev_create_map : public event
 {
 public:
-        ev_create_map(selector *sel);
+        ev_create_map(selector *sel, unsigned chain = 0);
         bool operator()(engine *eng);
 
 private:
 	selector *_sel;
+	unsigned  _chain;
 };
 
 class ev_create_reduce : public event
 {
 public:
-	ev_create_reduce(selector *sel);
+	ev_create_reduce(selector *sel, unsigned chain = 0);
 	bool operator()(engine *eng);
 
 private:
 	selector *_sel;
+	unsigned  _chain;
 };
 
 class ev_finish_map : public event
@@ -103,7 +110,7 @@ private:
 class ev_preempt_map : public event
 {
 public:
-	ev_preempt_map(pool *p, double deadline);
+	ev_preempt_map(pool *p, sim_time deadline);
 	bool operator()(engine *eng);
 
 private:
@@ -113,13 +120,60 @@ private:
 class ev_preempt_reduce : public event
 {
 public:
-	ev_preempt_reduce(pool *p, double deadline);
+	ev_preempt_reduce(pool *p, sim_time deadline);
 	bool operator()(engine *eng);
 
 private:
 	pool *_pool;
 };
 
+class ev_capacity : public event
+{
+public:
+	// nmaps, nreduces: new numbers of slots, -1 if unchanged
+	ev_capacity(sim_time t, int nmaps, int nreduces);
+	bool operator()(engine *eng);
+
+private:
+	int _nmaps;
+	int _nreduces;
+};
+
+// A deferred map may go one locality level further
+class ev_locality : public event
+{
+public:
+	ev_locality(sim_time t, td_ref *ref);
+	bool operator()(engine *eng);
+
+private:
+	td_ref  *_ref;  // only valid while the map is deferred
+	uint64_t _id;
+};
+
+// Periodic straggler check of slot type S
+template<typename S>
+class ev_speculate : public event
+{
+public:
+	ev_speculate(sim_time t);
+	bool operator()(engine *eng);
+};
+
+// Completion of a backup attempt of slot type S
+template<typename S>
+class ev_finish_backup : public event
+{
+public:
+	ev_finish_backup(td_ref *ref, sim_time stime, sim_time ptime);
+	bool operator()(engine *eng);
+
+private:
+	td_ref  *_ref;  // only valid while the backup runs
+	uint64_t _id;
+	sim_time _stime;
+};
+
 }
 
 #endif
@@ -0,0 +1,197 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "fluid.hpp"
+
+namespace colossal
+{
+
+void fluid_model::process(engine::pool_container_type *pools)
+{
+	_breakpoints = 0;
+	process(task::TASK_TYPE_MAP, _nmaps, pools);
+	process(task::TASK_TYPE_REDUCE, _nreduces, pools);
+}
+
+void fluid_model::process(int type, int nslots, engine::pool_container_type *pools)
+{
+	// pool contexts with the min shares scaled as in the engine
+	std::vector<fs_context> pctx;
+	std::vector<pool *> pv;
+	std::vector<fluid_job> jobs;
+	for (engine::pool_container_type::iterator pit = pools->begin();
+	     pit != pools->end(); ++pit) {
+		const fs_context &ctx = type == task::TASK_TYPE_MAP? pit->fs_ctx_map: pit->fs_ctx_reduce;
+		pctx.push_back(fs_context(ctx.weight, ctx.minshare, 0, pv.size()));
+		for (pool::job_container_type::iterator jit = pit->jobs.begin();
+		     jit != pit->jobs.end(); ++jit) {
+			job::task_container_type &tasks = jit->tasks[type];
+			if (tasks.empty())
+				continue;
+			fluid_job fj;
+			fj.j = &*jit;
+			fj.pool = pv.size();
+			fj.ctime = jit->ctime;
+			fj.work = 0;
+			fj.longest = 0;
+			for (size_t k = 0; k < tasks.size(); ++k) {
+				fj.ctime = std::min(fj.ctime, (double)tasks.ctime(k));
+				fj.work += tasks.ptime(k);
+				fj.longest = std::max(fj.longest, tasks.ptime(k));
+			}
+			tasks.clear_times(true);
+			fj.left = fj.work;
+			fj.weight = (type == task::TASK_TYPE_MAP? jit->fs_ctx_map: jit->fs_ctx_reduce).weight;
+			fj.ntasks = tasks.size();
+			fj.rate = 0;
+			fj.key = 0;
+			jobs.push_back(fj);
+		}
+		pv.push_back(&*pit);
+	}
+	if (pv.empty())
+		return;
+	scale_minshares(&pctx[0], &pctx[0] + pctx.size(), nslots);
+	std::stable_sort(jobs.begin(), jobs.end(), by_ctime);
+
+	std::vector< std::vector<fluid_job *> > active(pv.size());
+	size_t nactive = 0;
+	size_t next = 0;
+	double now = 0;
+	while (next < jobs.size() || nactive) {
+		if (nactive == 0)
+			now = std::max(now, jobs[next].ctime);
+		for (; next < jobs.size() && jobs[next].ctime <= now; ++next) {
+			active[jobs[next].pool].push_back(&jobs[next]);
+			pctx[jobs[next].pool].demand += jobs[next].ntasks;
+			++nactive;
+		}
+
+		// allocations until the next breakpoint
+		++_breakpoints;
+		compute_fairshares(&pctx[0], &pctx[0] + pctx.size(), nslots);
+		for (size_t i = 0; i < pv.size(); ++i)
+			if (active[i].size())
+				share(pv[i]->sched, active[i], pctx[i].fairshare);
+
+		double t = next < jobs.size()? jobs[next].ctime: HUGE_VAL;
+		for (size_t i = 0; i < pv.size(); ++i)
+			for (size_t k = 0; k < active[i].size(); ++k)
+				if (active[i][k]->rate > 0)
+					t = std::min(t, now + active[i][k]->left / active[i][k]->rate);
+		if (t == HUGE_VAL) {
+			ULIB_WARNING("%d jobs left without slots", (int)nactive);
+			break;
+		}
+
+		// drain the work, and retire the jobs done by t
+		for (size_t i = 0; i < pv.size(); ++i) {
+			std::vector<fluid_job *> &q = active[i];
+			for (size_t k = 0; k < q.size();) {
+				fluid_job *fj = q[k];
+				if (fj->rate > 0 && now + fj->left / fj->rate <= t) {
+					double fin = std::max(t, fj->ctime + fj->longest);
+					job::task_container_type &tasks = fj->j->tasks[type];
+					for (size_t m = 0; m < tasks.size(); ++m)
+						tasks.set_ftime(m, to_sim_time(fin));
+					pctx[i].demand -= fj->ntasks;
+					--nactive;
+					q.erase(q.begin() + k);
+				} else {
+					fj->left = std::max(fj->left - fj->rate * (t - now), 0.0);
+					++k;
+				}
+			}
+		}
+		now = t;
+	}
+}
+
+void fluid_model::share(pool::sched_mode sched, std::vector<fluid_job *> &active, double slots)
+{
+	if (sched == pool::SCHED_FAIR) {
+		// weighted max-min fairness, where a job capped by its tasks
+		// leaves the rest to the others
+		std::vector<fluid_job *> order(active);
+		std::sort(order.begin(), order.end(), by_cap);
+		double wsum = 0;
+		for (size_t k = 0; k < order.size(); ++k)
+			wsum += order[k]->weight;
+		for (size_t k = 0; k < order.size(); ++k) {
+			double x = wsum > 0? order[k]->weight * slots / wsum: 0;
+			order[k]->rate = std::min((double)order[k]->ntasks, x);
+			slots -= order[k]->rate;
+			wsum -= order[k]->weight;
+		}
+		return;
+	}
+
+	for (size_t k = 0; k < active.size(); ++k) {
+		fluid_job *fj = active[k];
+		switch (sched) {
+		case pool::SCHED_SRPT:
+			fj->key = fj->left;
+			break;
+		case pool::SCHED_SJF:
+			fj->key = fj->work;
+			break;
+		case pool::SCHED_EDF:
+			fj->key = fj->j->deadline < 0? HUGE_VAL: fj->j->deadline;
+			break;
+		default:
+			fj->key = fj->ctime;
+			break;
+		}
+	}
+	// stable, so that ties go by arrival
+	std::vector<fluid_job *> order(active);
+	std::stable_sort(order.begin(), order.end(), by_key);
+	for (size_t k = 0; k < order.size(); ++k) {
+		order[k]->rate = std::min((double)order[k]->ntasks, slots);
+		slots -= order[k]->rate;
+	}
+}
+
+fluid_error fluid_model::error(const engine::pool_container_type &approx,
+			       const engine::pool_container_type &exact)
+{
+	fluid_error err;
+	engine::pool_container_type::const_iterator pa = approx.begin();
+	engine::pool_container_type::const_iterator pe = exact.begin();
+	for (; pa != approx.end() && pe != exact.end(); ++pa, ++pe) {
+		size_t njobs = std::min(pa->jobs.size(), pe->jobs.size());
+		for (size_t i = 0; i < njobs; ++i) {
+			sim_time fa = pa->jobs[i].last_finish();
+			sim_time fe = pe->jobs[i].last_finish();
+			sim_time la = fa - pa->jobs[i].ctime;
+			sim_time le = fe - pe->jobs[i].ctime;
+			if (fa < 0 || fe < 0 || le <= 0)
+				continue;
+			double rel = (double)(la - le) / le;
+			err.mape += fabs(rel);
+			err.bias += rel;
+			err.max = std::max(err.max, fabs(rel));
+			++err.jobs;
+		}
+	}
+	if (err.jobs) {
+		err.mape /= err.jobs;
+		err.bias /= err.jobs;
+	}
+	return err;
+}
+
+}
@@ -0,0 +1,112 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_FLUID_H
+#define _COLOSSAL_FLUID_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "common.hpp"
+#include "pool.hpp"
+#include "engine.hpp"
+
+namespace colossal
+{
+
+// Error of estimated job latencies against exact ones, where the
+// latency of a job is the time from its creation to the finish of its
+// last task
+struct fluid_error {
+	size_t jobs;  // number of jobs finished in both
+	double mape;  // mean absolute relative error
+	double bias;  // mean relative error, > 0 if overestimated
+	double max;   // largest absolute relative error
+
+	fluid_error() : jobs(0), mape(0), bias(0), max(0) { }
+};
+
+// Fluid approximation of the engine
+// Each job is a volume of work in slot ticks rather than a set of
+// tasks. The pools share the slots by compute_fairshares(), and the
+// share of a pool is split among its jobs by its scheduling mode, a
+// job taking at most as many slots as it has tasks. The allocations
+// are constant between breakpoints, which are the arrivals and the
+// finishes of jobs, so the cost is that of the jobs rather than of
+// the tasks. Maps and reduces are approximated independently.
+// Preemption is taken to be immediate, and the capacity timeline, the
+// cluster, the container mode, slow-start and speculation are not
+// modeled.
+class fluid_model
+{
+public:
+	fluid_model(int nmaps, int nreduces)
+		: _nmaps(nmaps), _nreduces(nreduces), _breakpoints(0) { }
+
+	// Estimate the finish times of the jobs in pools
+	// The ftime of each task is recorded as the estimated finish of
+	// the maps or the reduces of its job, and its stime is cleared. A
+	// job never finishes before its longest task, and is left
+	// unfinished (ftime < 0) if there are no slots for it.
+	void process(engine::pool_container_type *pools);
+
+	// Number of breakpoints of the last process()
+	size_t breakpoints() const { return _breakpoints; }
+
+	// Error of the estimated pools against the same pools processed
+	// by the engine
+	static fluid_error error(const engine::pool_container_type &approx,
+				 const engine::pool_container_type &exact);
+
+private:
+	struct fluid_job {
+		job     *j;
+		size_t   pool;
+		double   ctime;
+		double   work;     // processing time of the tasks
+		double   left;     // work left
+		double   weight;
+		int      ntasks;
+		sim_time longest;  // processing time of the longest task
+		double   rate;     // slots allocated
+		double   key;      // order in the pool, lower first
+	};
+
+	static bool by_ctime(const fluid_job &a, const fluid_job &b)
+	{
+		return a.ctime < b.ctime;
+	}
+
+	// the jobs capped by their tasks first
+	static bool by_cap(const fluid_job *a, const fluid_job *b)
+	{
+		return a->ntasks * b->weight < b->ntasks * a->weight;
+	}
+
+	static bool by_key(const fluid_job *a, const fluid_job *b)
+	{
+		return a->key < b->key;
+	}
+
+	void process(int type, int nslots, engine::pool_container_type *pools);
+	void share(pool::sched_mode sched, std::vector<fluid_job *> &active, double slots);
+
+	int    _nmaps;
+	int    _nreduces;
+	size_t _breakpoints;
+};
+
+}
+
+#endif
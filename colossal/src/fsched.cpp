@@ -12,6 +12,7 @@
  * binding.
  */
 
+#include <cmath>
 #include <algorithm>
 #include <ulib/util_algo.h>
 #include "fsched.hpp"
@@ -20,6 +21,11 @@ namespace colossal
 {
 
 int fs_context::operator()(const fs_context &a, const fs_context &b) const
+{
+        return compare(a, 1.0, b, 1.0);
+}
+
+int fs_context::compare(const fs_context &a, double da, const fs_context &b, double db)
 {
         int ret;
         int m1 = std::min((int)a.minshare, a.demand);
@@ -28,8 +34,8 @@ int fs_context::operator()(const fs_context &a, const fs_context &b) const
         bool needy2 = b.alloc < m2;
         double sr1 = a.alloc / std::max(a.minshare, 1.0);
         double sr2 = b.alloc / std::max(b.minshare, 1.0);
-        double wr1 = a.alloc / a.weight;
-        double wr2 = b.alloc / b.weight;
+        double wr1 = a.alloc * da / a.weight;
+        double wr2 = b.alloc * db / b.weight;
         if (needy1 && !needy2)
                 ret = -1;
         else if (!needy1 && needy2)
@@ -43,4 +49,73 @@ int fs_context::operator()(const fs_context &a, const fs_context &b) const
         return ret;
 }
 
+// A change of the DRF usage slope at a ratio
+struct drf_breakpoint {
+        double r;
+        double slope;  // tasks per unit of ratio
+        size_t user;
+
+        bool operator<(const drf_breakpoint &other) const
+        {
+                return r < other.r;
+        }
+};
+
+double compute_drf_shares(std::vector<drf_user> &users, const resource &capacity)
+{
+        std::vector<drf_breakpoint> bps;
+        std::vector<double> doms(users.size());
+        resource use, slope;
+
+        // usage at r = 0, and where each user starts and stops growing
+        for (size_t i = 0; i < users.size(); ++i) {
+                const fs_context *c = users[i].ctx;
+                double m = std::min(c->minshare, (double)c->demand);
+                doms[i] = users[i].size.dominant(capacity);
+                use += users[i].size * m;
+                if (doms[i] <= 0 || m >= c->demand)
+                        continue;
+                drf_breakpoint bp;
+                bp.user  = i;
+                bp.slope = c->weight / doms[i];
+                bp.r = m / bp.slope;
+                bps.push_back(bp);
+                bp.r = c->demand / bp.slope;
+                bp.slope = -bp.slope;
+                bps.push_back(bp);
+        }
+        std::sort(bps.begin(), bps.end());
+
+        double r = 0;
+        for (size_t j = 0; j <= bps.size(); ++j) {
+                double next = j < bps.size()? bps[j].r: HUGE_VAL;
+                // where the segment reaches the capacity of a resource
+                double stop = next;
+                for (int k = 0; k < resource::RESOURCE_NUM; ++k)
+                        if (slope[k] > PRECISION)
+                                stop = std::min(stop, r + (capacity[k] - use[k]) / slope[k]);
+                if (stop < next) {
+                        r = std::max(stop, r);
+                        break;
+                }
+                if (j == bps.size())
+                        break;
+                for (int k = 0; k < resource::RESOURCE_NUM; ++k)
+                        use[k] += slope[k] * (next - r);
+                r = next;
+                slope += users[bps[j].user].size * bps[j].slope;
+        }
+
+        for (size_t i = 0; i < users.size(); ++i) {
+                fs_context *c = users[i].ctx;
+                if (doms[i] <= 0)
+                        c->fairshare = c->demand;
+                else
+                        c->fairshare = std::min((double)c->demand,
+                                                std::max(c->weight * r / doms[i], c->minshare));
+        }
+
+        return r;
+}
+
 }
@@ -24,11 +24,14 @@
 #include <ulib/util_log.h>
 #include "common.hpp"
 #include "pointer.hpp"
+#include "resource.hpp"
 
 namespace colossal
 {
 
 // Basic settings of a user (pool/job)
+// Not polymorphic, so that the two contexts of every job carry no
+// vtable pointer.
 struct fs_conf {
         double weight;
         double minshare;
@@ -36,20 +39,18 @@ struct fs_conf {
 
         fs_conf() : weight(1.0), minshare(0), demand(0) { }
         fs_conf(double w, double m, int d) : weight(w), minshare(m), demand(d) { }
-
-        virtual
-        ~fs_conf() { }
 };
 
 // User settings and status
+// alloc comes first to fill the tail padding of fs_conf.
 struct fs_context : public fs_conf {
-        double   fairshare;
         int      alloc;
+        double   fairshare;
         uint64_t uid; // unique user id used for stable sorting
 
-        fs_context() : fairshare(0), alloc(0), uid(0) { }
+        fs_context() : alloc(0), fairshare(0), uid(0) { }
         fs_context(double w, double m, int d, uint64_t u = 0)
-                : fs_conf(w, m, d), fairshare(0), alloc(0), uid(u) { }
+                : fs_conf(w, m, d), alloc(0), fairshare(0), uid(u) { }
 
         operator size_t() const
         {
@@ -59,6 +60,10 @@ struct fs_context : public fs_conf {
 	// Fair share comparator
         int  operator()(const fs_context &a, const fs_context &b) const;
 
+	// Fair share comparator of DRF, where the allocations above the
+	// min shares count da and db each, the dominant shares of a task
+	static int compare(const fs_context &a, double da, const fs_context &b, double db);
+
         bool operator< (const fs_context &other) const
         {
                 return this->operator()(*this, other) < 0;
@@ -70,6 +75,85 @@ struct fs_context : public fs_conf {
         }
 };
 
+// Time integrals of a user status
+// The status is piecewise constant in simulated time, so settle() is
+// called once the status has changed at time now: the time since the
+// last call is charged at the status seen then, and the current status
+// is kept for the next one. Several changes at the same time thus cost
+// a single O(1) update, and the integrals are exact.
+struct fs_integral {
+        sim_time last;      // time of the last settle()
+        double   alloc;     // integral of the allocation
+        double   demand;    // integral of the demand
+        double   deficit;   // integral of max(fairshare - alloc, 0)
+        sim_time below_ms;  // time spent below min(minshare, demand)
+
+        fs_integral() : last(0), alloc(0), demand(0), deficit(0), below_ms(0),
+                        _alloc(0), _demand(0), _deficit(0), _below(false) { }
+
+        // Clear the integrals and restart them from the status at now
+        void reset(const fs_context &ctx, sim_time now)
+        {
+                restart(now);
+                keep(ctx);
+        }
+
+        void settle(const fs_context &ctx, sim_time now)
+        {
+                if (now > last) {
+                        sim_time dt = now - last;
+                        alloc   += (double)_alloc * dt;
+                        demand  += (double)_demand * dt;
+                        deficit += _deficit * dt;
+                        if (_below)
+                                below_ms += dt;
+                        last = now;
+                }
+                keep(ctx);
+        }
+
+        // Clear the integrals, keeping the status
+        void restart(sim_time now)
+        {
+                alloc = demand = deficit = 0;
+                below_ms = 0;
+                last = now;
+        }
+
+private:
+        void keep(const fs_context &ctx)
+        {
+                _alloc   = ctx.alloc;
+                _demand  = ctx.demand;
+                _deficit = std::max(ctx.fairshare - ctx.alloc, 0.0);
+                _below   = ctx.alloc < std::min(ctx.demand, (int)ctx.minshare);
+        }
+
+        int    _alloc;
+        int    _demand;
+        double _deficit;
+        bool   _below;
+};
+
+// A user of dominant resource fairness (DRF): its context and the
+// resources of each of its tasks
+struct drf_user {
+	fs_context *ctx;
+	resource    size;
+};
+
+// Compute the DRF fair shares of the users in a cluster of vector
+// capacity
+// A user gets min(demand, max(weight * r / dom, minshare)) tasks, dom
+// being the dominant share of one of its tasks, so that the weighted
+// dominant shares are even above the min shares. The ratio r is the
+// largest that keeps every resource within the capacity. The usage is
+// piecewise linear in r, and is swept across the sorted breakpoints in
+// O(n log n) instead of bisected.
+// Returns the fair share ratio
+// Note: must first scale the min shares
+double compute_drf_shares(std::vector<drf_user> &users, const resource &capacity);
+
 // Fair share computation using the given ratio
 // Returns the computed fair share
 static inline double compute_fairshare(const fs_conf &conf, double r)
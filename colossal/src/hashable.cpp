@@ -30,7 +30,7 @@ job_ctime_hash::operator size_t() const
 
 bool job_ctime_hash::operator> (const job_ctime_hash &other) const
 {
-	if (double_equal(ptr->getjob()->ctime, other.ptr->getjob()->ctime)) {
+	if (ptr->getjob()->ctime == other.ptr->getjob()->ctime) {
 		// maps and reduces of a job have the same priority(weight)
 		if (double_equal(ptr->getjob()->fs_ctx_map.weight,
 				 other.ptr->getjob()->fs_ctx_map.weight))
@@ -42,7 +42,7 @@ bool job_ctime_hash::operator> (const job_ctime_hash &other) const
 
 bool job_ctime_hash::operator< (const job_ctime_hash &other) const
 {
-	if (double_equal(ptr->getjob()->ctime, other.ptr->getjob()->ctime)) {
+	if (ptr->getjob()->ctime == other.ptr->getjob()->ctime) {
 		// maps and reduces of a job have the same priority(weight)
 		if (double_equal(ptr->getjob()->fs_ctx_map.weight,
 				 other.ptr->getjob()->fs_ctx_map.weight))
@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include "task.hpp"
+#include "job.hpp"
 
 namespace colossal
 {
@@ -41,13 +42,13 @@ struct stime_hash {
 	// sort in the order of reversed task start time
 	bool operator> (const stime_hash &other) const
 	{
-		return ptr->gettask()->stime < other.ptr->gettask()->stime;
+		return ptr->stime() < other.ptr->stime();
 	}
 
 	// sort in the order of reversed task start time
 	bool operator< (const stime_hash &other) const
 	{
-		return ptr->gettask()->stime > other.ptr->gettask()->stime;
+		return ptr->stime() > other.ptr->stime();
 	}
 
         bool operator==(const stime_hash &other) const
@@ -77,6 +78,78 @@ struct job_ctime_hash {
         bool operator==(const job_ctime_hash &other) const;
 };
 
+// Job ordered by a key in ascending order, with ties broken by job
+// creation time and then by job id
+// K::value(const job *) gives the key.
+template<typename K>
+struct job_key_hash {
+	td_ref * ptr;
+
+	typedef td_ref * pointer_type;
+
+	job_key_hash(td_ref * p) : ptr(p) { }
+
+	operator td_ref *&()
+	{
+		return ptr;
+	}
+
+	operator size_t() const
+	{
+		return job_ctime_hash(ptr);
+	}
+
+	bool operator> (const job_key_hash &other) const
+	{
+		return compare(other) > 0;
+	}
+
+	bool operator< (const job_key_hash &other) const
+	{
+		return compare(other) < 0;
+	}
+
+        bool operator==(const job_key_hash &other) const
+	{
+		return job_ctime_hash(ptr) == job_ctime_hash(other.ptr);
+	}
+
+	// < 0, 0 or > 0 as job a goes before, with or after job b
+	static int order(const job *a, const job *b)
+	{
+		sim_time ka = K::value(a);
+		sim_time kb = K::value(b);
+		if (ka != kb)
+			return ka < kb? -1: 1;
+		if (a->ctime != b->ctime)
+			return a->ctime < b->ctime? -1: 1;
+		return a->id < b->id? -1: (a->id > b->id? 1: 0);
+	}
+
+private:
+	int compare(const job_key_hash &other) const
+	{
+		return order(ptr->getjob(), other.ptr->getjob());
+	}
+};
+
+// Keys of job_key_hash
+struct job_work_left_key {
+	static sim_time value(const job *j) { return j->work_left; }
+};
+
+struct job_work_key {
+	static sim_time value(const job *j) { return j->work; }
+};
+
+// jobs without a deadline go last
+struct job_deadline_key {
+	static sim_time value(const job *j)
+	{
+		return j->deadline < 0? (sim_time)((~0ull) >> 1): j->deadline;
+	}
+};
+
 }
 
 #endif
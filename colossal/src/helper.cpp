@@ -15,14 +15,14 @@
 #include <cstdio>
 #include <stdint.h>
 #include <cstring>
+#include <cstdlib>
 #include <vector>
 #include <functional>
 #include <ulib/heap_prot.h>
-#include <ulib/hash_func.h>
-#include <ulib/hash_open.h>
 #include <ulib/util_log.h>
 #include "job.hpp"
 #include "pool.hpp"
+#include "loader.hpp"
 #include "helper.hpp"
 
 namespace colossal {
@@ -33,15 +33,15 @@ void print_pool_settings(const job_tracker::pool_container_type &pools)
 	     it != pools.end(); ++it) {
 		printf("Pool name = %s\tid = %016llx\tnjobs = %zu\tsched = %s\n",
 		       it->name.c_str(), it->id, it->jobs.size(),
-		       it->sched == pool::SCHED_FAIR? "FAIR": "FCFS");
-		printf("\tw = %lf\tm = %lf\td = %d\tmt = %lf\tft = %lf\n",
+		       pool::sched_str(it->sched));
+		printf("\tw = %lf\tm = %lf\td = %d\tmt = %lld\tft = %lld\n",
 		       it->fs_ctx_map.weight, it->fs_ctx_map.minshare, it->fs_ctx_map.demand,
-		       it->ms_timeout, it->hf_timeout);
+		       (long long)it->ms_timeout, (long long)it->hf_timeout);
 		printf("\tr = %lf\ta = %d\n",
 		       it->fs_ctx_map.fairshare, it->fs_ctx_map.alloc);
-		printf("\tw = %lf\tm = %lf\td = %d\tmt = %lf\tft = %lf\n",
+		printf("\tw = %lf\tm = %lf\td = %d\tmt = %lld\tft = %lld\n",
 		       it->fs_ctx_reduce.weight, it->fs_ctx_reduce.minshare, it->fs_ctx_reduce.demand,
-		       it->ms_timeout, it->hf_timeout);
+		       (long long)it->ms_timeout, (long long)it->hf_timeout);
 		printf("\tr = %lf\ta = %d\n",
 		       it->fs_ctx_reduce.fairshare, it->fs_ctx_reduce.alloc);
 	}
@@ -77,10 +77,10 @@ double compute_utilization(
 	     pit != pools.end(); ++pit) {
 		for (pool::job_container_type::const_iterator jit = pit->jobs.begin();
 		     jit != pit->jobs.end(); ++jit) {
-			for (job::task_container_type::const_iterator tit = jit->tasks[type].begin();
-			     tit != jit->tasks[type].end(); ++tit) {
-				points.push_back(tit->stime);
-				points.push_back(-tit->ftime);
+			const job::task_container_type &tasks = jit->tasks[type];
+			for (size_t k = 0; k < tasks.size(); ++k) {
+				points.push_back(tasks.stime(k));
+				points.push_back(-tasks.ftime(k));
 			}
 		}
 	}
@@ -94,18 +94,19 @@ double compute_utilization(
 	}
 	heap_init_ut(&*points.begin(), &*points.end());
 
-	double first = points.begin()->time;
-	double last  = first < 0? -first: first;
-	double util  = 0;
-	int    in    = first < 0? -1: 1;
+	sim_time first = points.begin()->time;
+	sim_time last  = first < 0? -first: first;
+	double   util  = 0;
+	int      in    = first < 0? -1: 1;
 	heap_pop_to_rear_ut(&*points.begin(), &*points.end());
 	points.pop_back();
 	do {
-		double t = points.begin()->time;
-		double s = t < 0? -t: t;
-		if ((in < 0 || in > nslots) && !double_equal(s, last))
-			ULIB_FATAL("used slots(%d) is illegal between %f and %f", in, last, s);
-		util += in * (s - last);
+		sim_time t = points.begin()->time;
+		sim_time s = t < 0? -t: t;
+		if ((in < 0 || in > nslots) && s != last)
+			ULIB_FATAL("used slots(%d) is illegal between %lld and %lld",
+				   in, (long long)last, (long long)s);
+		util += in * (double)(s - last);
 		if (t < 0)
 			--in;
 		else
@@ -120,7 +121,7 @@ double compute_utilization(
 		return -1;
 	}
 
-	return util / (last - first) / nslots;
+	return util / (double)(last - first) / nslots;
 }
 
 double compute_utilization(const pool &p, task::task_type type, int nslots)
@@ -129,10 +130,10 @@ double compute_utilization(const pool &p, task::task_type type, int nslots)
 
 	for (pool::job_container_type::const_iterator jit = p.jobs.begin();
 	     jit != p.jobs.end(); ++jit) {
-		for (job::task_container_type::const_iterator tit = jit->tasks[type].begin();
-		     tit != jit->tasks[type].end(); ++tit) {
-			points.push_back(tit->stime);
-			points.push_back(-tit->ftime);
+		const job::task_container_type &tasks = jit->tasks[type];
+		for (size_t k = 0; k < tasks.size(); ++k) {
+			points.push_back(tasks.stime(k));
+			points.push_back(-tasks.ftime(k));
 		}
 	}
 	if (points.size() == 0) {
@@ -145,18 +146,19 @@ double compute_utilization(const pool &p, task::task_type type, int nslots)
 	}
 	heap_init_ut(&*points.begin(), &*points.end());
 
-	double first = points.begin()->time;
-	double last  = first < 0? -first: first;
-	double util  = 0;
-	int    in    = first < 0? -1: 1;
+	sim_time first = points.begin()->time;
+	sim_time last  = first < 0? -first: first;
+	double   util  = 0;
+	int      in    = first < 0? -1: 1;
 	heap_pop_to_rear_ut(&*points.begin(), &*points.end());
 	points.pop_back();
 	do {
-		double t = points.begin()->time;
-		double s = t < 0? -t: t;
-		if ((in < 0 || in > nslots) && !double_equal(s, last))
-			ULIB_FATAL("used slots(%d) is illegal between %f and %f", in, last, s);
-		util += in * (s - last);
+		sim_time t = points.begin()->time;
+		sim_time s = t < 0? -t: t;
+		if ((in < 0 || in > nslots) && s != last)
+			ULIB_FATAL("used slots(%d) is illegal between %lld and %lld",
+				   in, (long long)last, (long long)s);
+		util += in * (double)(s - last);
 		if (t < 0)
 			--in;
 		else
@@ -171,7 +173,7 @@ double compute_utilization(const pool &p, task::task_type type, int nslots)
 		return -1;
 	}
 
-	return util / (last - first) / nslots;
+	return util / (double)(last - first) / nslots;
 }
 
 int import_workload(const char *file, job_tracker::pool_container_type *pools)
@@ -179,156 +181,78 @@ int import_workload(const char *file, job_tracker::pool_container_type *pools)
 	// Sample line:
 	// modeling job_201405200258_257255:HIGH task_201405200258_257255_m_021770 \
 	// MAP 1403620325026 1403620325033 1403620344772
+	workload_loader loader(workload_loader::FORMAT_STFT);
+	return loader.load(file, pools);
+}
+
+// Support ptime instead of stime and ftime
+int import_workload1(const char *file, job_tracker::pool_container_type *pools)
+{
+	// Sample line:
+	// modeling job_201405200258_257255:HIGH task_201405200258_257255_m_021770 \
+	// MAP 1403620325026 1024
+	workload_loader loader(workload_loader::FORMAT_PTIME);
+	return loader.load(file, pools);
+}
 
+int import_capacity(const char *file, job_tracker *jt)
+{
 	FILE *fp = fopen(file, "r");
 	if (fp == NULL) {
 		ULIB_WARNING("cannot open %s for reading", file);
 		return -1;
 	}
 
-	ulib::open_hash_map<uint64_t, pool *> pmap;
-	ulib::open_hash_map<uint64_t, job  *> jmap;
-
-	for (job_tracker::pool_container_type::iterator pit = pools->begin();
-	     pit != pools->end(); ++pit)
-		pmap[pit->id] = &*pit;
-
-	int ret = -1;
-	while (!ferror(fp) && !feof(fp)) {
-		char pstr[1024];
-		char jstr[1024];
-		char prio[16];
-		char tstr[1024];
-		char type[16];
-		double ctime, stime, ftime;
-		if (fscanf(fp, "%[^\t]\t%[^:]:%[^\t]\t%[^\t]\t%[^\t]\t%lf\t%lf\t%lf\n",
-			   pstr, jstr, prio, tstr, type, &ctime, &stime, &ftime) != 8) {
-			ULIB_WARNING("Error encounterred while parsing a line");
-			goto done;
-		}
-		uint64_t pid = pool::id_from_str(pstr);
-		pool *p = pmap[pid];
-		if (p == NULL) {
-			ULIB_FATAL("pool %s has not been configured", pstr);
-			goto done;
+	char line[256];
+	int ret = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		double ms;
+		int nmaps, nreduces;
+		if (sscanf(line, "%lf\t%d\t%d", &ms, &nmaps, &nreduces) != 3 ||
+		    nmaps < 0 || nreduces < 0) {
+			ULIB_WARNING("Error encounterred while parsing a line:%s", line);
+			ret = -1;
+			break;
 		}
-		uint64_t jid = job::id_from_str(jstr);
-		job *j = jmap[jid];
-		if (j == NULL) {
-			job nj;
-			nj.id = jid;
-			nj.ctime = ctime;
-			nj.fs_ctx_map.uid = jid;
-			nj.fs_ctx_reduce.uid = jid;
-			j = &p->add_job(nj);
-			jmap[jid] = j;
-		} else if (j->ctime > ctime)
-			j->ctime = ctime;
-		double jw;
-		if (strcmp("NORMAL", prio) == 0)
-			jw = 1.0;
-		else if (strcmp("HIGH", prio) == 0)
-			jw = 2.0;
-		else if (strcmp("VERY_HIGH", prio) == 0)
-			jw = 4.0;
-		else {
-			ULIB_WARNING("job priority unrecognized:%s", prio);
-			goto done;
-		}
-		j->fs_ctx_map.weight = jw;
-		j->fs_ctx_reduce.weight = jw;
-		task t;
-		t.id = task::id_from_str(tstr);
-		t.ctime = ctime;
-		t.stime = stime;
-		t.ftime = ftime;
-		t.ptime = ftime - stime;
-		t.type = strcmp("MAP", type) == 0? task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE;
-		j->tasks[t.type].push_back(t);
+		jt->add_capacity(to_sim_time(ms * TICKS_PER_MSEC), nmaps, nreduces);
 	}
 
-	ret = 0;
-done:
 	fclose(fp);
 	return ret;
 }
 
-// Support ptime instead of stime and ftime
-int import_workload1(const char *file, job_tracker::pool_container_type *pools)
+int import_blocks(const char *file, cluster *c)
 {
-	// Sample line:
-	// modeling job_201405200258_257255:HIGH task_201405200258_257255_m_021770 \
-	// MAP 1403620325026 1024
-
 	FILE *fp = fopen(file, "r");
 	if (fp == NULL) {
 		ULIB_WARNING("cannot open %s for reading", file);
 		return -1;
 	}
 
-	ulib::open_hash_map<uint64_t, pool *> pmap;
-	ulib::open_hash_map<uint64_t, job  *> jmap;
-
-	for (job_tracker::pool_container_type::iterator pit = pools->begin();
-	     pit != pools->end(); ++pit)
-		pmap[pit->id] = &*pit;
-
-	int ret = -1;
-	while (!ferror(fp) && !feof(fp)) {
-		char pstr[1024];
-		char jstr[1024];
-		char prio[16];
-		char tstr[1024];
-		char type[16];
-		double ctime, ptime;
-		if (fscanf(fp, "%[^\t]\t%[^:]:%[^\t]\t%[^\t]\t%[^\t]\t%lf\t%lf\n",
-			   pstr, jstr, prio, tstr, type, &ctime, &ptime) != 7) {
-			ULIB_WARNING("Error encounterred while parsing a line");
-			goto done;
-		}
-		uint64_t pid = pool::id_from_str(pstr);
-		pool *p = pmap[pid];
+	char line[1024];
+	int ret = 0;
+	while (ret == 0 && fgets(line, sizeof(line), fp)) {
+		char *p = strchr(line, '\t');
 		if (p == NULL) {
-			ULIB_FATAL("pool %s has not been configured", pstr);
-			goto done;
+			ULIB_WARNING("Error encounterred while parsing a line:%s", line);
+			ret = -1;
+			break;
 		}
-		uint64_t jid = job::id_from_str(jstr);
-		job *j = jmap[jid];
-		if (j == NULL) {
-			job nj;
-			nj.id = jid;
-			nj.ctime = ctime;
-			nj.fs_ctx_map.uid = jid;
-			nj.fs_ctx_reduce.uid = jid;
-			j = &p->add_job(nj);
-			jmap[jid] = j;
-		} else if (j->ctime > ctime)
-			j->ctime = ctime;
-		double jw;
-		if (strcmp("NORMAL", prio) == 0)
-			jw = 1.0;
-		else if (strcmp("HIGH", prio) == 0)
-			jw = 2.0;
-		else if (strcmp("VERY_HIGH", prio) == 0)
-			jw = 4.0;
-		else {
-			ULIB_WARNING("job priority unrecognized:%s", prio);
-			goto done;
-		}
-		j->fs_ctx_map.weight = jw;
-		j->fs_ctx_reduce.weight = jw;
-		task t;
-		t.id = task::id_from_str(tstr);
-		t.ctime = ctime;
-		t.stime = -1;
-		t.ftime = -1;
-		t.ptime = ptime;
-		t.type = strcmp("MAP", type) == 0? task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE;
-		j->tasks[t.type].push_back(t);
+		uint64_t id = task::id_from_str(line, p - line);
+		do {
+			char *end;
+			long node = strtol(p + 1, &end, 10);
+			if (end == p + 1 || c->add_block(id, node)) {
+				ULIB_WARNING("invalid block location in line:%s", line);
+				ret = -1;
+				break;
+			}
+			p = end;
+		} while (*p == ',');
 	}
 
-	ret = 0;
-done:
 	fclose(fp);
 	return ret;
 }
@@ -345,19 +269,19 @@ int export_schedule(const char *file, const job_tracker::pool_container_type &po
 	     pit != pools.end(); ++pit) {
 		for (pool::job_container_type::const_iterator jit = pit->jobs.begin();
 		     jit != pit->jobs.end(); ++jit) {
-			for (job::task_container_type::const_iterator tit = jit->tasks[task::TASK_TYPE_MAP].begin();
-			     tit != jit->tasks[task::TASK_TYPE_MAP].end(); ++tit) {
-				// pool job task type ctime ptime stime ftime
-				fprintf(fp, "%s\t%016llx:%lf\t%016llx\t%d\t%f\t%f\t%f\t%f\n",
-					pit->name.c_str(), jit->id, jit->fs_ctx_map.weight, tit->id,
-					task::TASK_TYPE_MAP, tit->ctime, tit->ptime, tit->stime, tit->ftime);
-			}
-			for (job::task_container_type::const_iterator tit = jit->tasks[task::TASK_TYPE_REDUCE].begin();
-			     tit != jit->tasks[task::TASK_TYPE_REDUCE].end(); ++tit) {
-				// pool job task type ctime ptime stime ftime
-				fprintf(fp, "%s\t%016llx:%lf\t%016llx\t%d\t%f\t%f\t%f\t%f\n",
-					pit->name.c_str(), jit->id, jit->fs_ctx_reduce.weight, tit->id,
-					task::TASK_TYPE_REDUCE, tit->ctime, tit->ptime, tit->stime, tit->ftime);
+			static const task::task_type types[] = { task::TASK_TYPE_MAP, task::TASK_TYPE_REDUCE };
+			for (size_t i = 0; i < sizeof(types)/sizeof(types[0]); ++i) {
+				task::task_type type = types[i];
+				const job::task_container_type &tasks = jit->tasks[type];
+				const fs_context &ctx = type == task::TASK_TYPE_MAP? jit->fs_ctx_map: jit->fs_ctx_reduce;
+				for (size_t k = 0; k < tasks.size(); ++k) {
+					// pool job task type ctime ptime stime ftime
+					fprintf(fp, "%s\t%016llx:%lf\t%016llx\t%d\t%lld\t%lld\t%lld\t%lld\n",
+						pit->name.c_str(), jit->id, ctx.weight,
+						(unsigned long long)jit->task_id(type, k), type,
+						(long long)tasks.ctime(k), (long long)tasks.ptime(k),
+						(long long)tasks.stime(k), (long long)tasks.ftime(k));
+				}
 			}
 		}
 	}
@@ -0,0 +1,670 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ulib/util_log.h>
+#include <ulib/os_thread.h>
+#include <ulib/hash_multi_r.h>
+#include <ulib/mc_typedef.h>
+#include <ulib/mc_splitter.h>
+#include "task.hpp"
+#include "job.hpp"
+#include "pool.hpp"
+#include "loader.hpp"
+#include "history.hpp"
+
+namespace colossal
+{
+
+namespace
+{
+
+// An attempt record
+// Strings point into the mapped history files.
+struct history_attempt {
+	const char *id;
+	size_t      len;
+	int         type;    // task::task_type, or -1 if not simulated
+	int64_t     start;   // ms, < 0 if unknown
+	int64_t     finish;  // ms, < 0 if unknown
+};
+
+// What is known of a job, combined from its records
+// The hash map moves its values as raw memory, so the attempts are
+// kept out of line. An emitted value carries at most one attempt.
+struct history_job {
+	const char *id;  // job_...
+	size_t      len;
+	const char *queue;
+	size_t      qlen;
+	const char *prio;
+	size_t      plen;
+	uint64_t    prio_pos;  // position of the priority record
+	int64_t     submit;
+	int64_t     launch;
+	bool        finished;
+	const history_attempt        *attempt;   // emitted
+	std::vector<history_attempt> *attempts;  // combined
+
+	history_job()
+		: id(NULL), len(0), queue(NULL), qlen(0), prio(NULL), plen(0),
+		  prio_pos(0), submit(-1), launch(-1), finished(false),
+		  attempt(NULL), attempts(NULL) { }
+};
+
+// Combine the records of a job
+// The priority may change while the job runs, and the last one in
+// the history is kept as parser.awk does.
+struct history_combiner : public ulib::mapcombine::combiner<history_job> {
+	void operator()(history_job &sum, const history_job &val) const
+	{
+		if (val.id) {
+			sum.id  = val.id;
+			sum.len = val.len;
+		}
+		if (val.queue) {
+			sum.queue = val.queue;
+			sum.qlen  = val.qlen;
+		}
+		if (val.prio && (sum.prio == NULL || val.prio_pos > sum.prio_pos)) {
+			sum.prio     = val.prio;
+			sum.plen     = val.plen;
+			sum.prio_pos = val.prio_pos;
+		}
+		if (val.submit >= 0)
+			sum.submit = val.submit;
+		if (val.launch >= 0)
+			sum.launch = val.launch;
+		if (val.finished)
+			sum.finished = true;
+		if (val.attempt) {
+			if (sum.attempts == NULL)
+				sum.attempts = new std::vector<history_attempt>;
+			sum.attempts->push_back(*val.attempt);
+		}
+	}
+};
+
+// End of the history record starting at p
+// Records end with " ." and a newline, and may span several lines.
+// The start of the next record is returned in next.
+static const char *
+record_end(const char *p, const char *end, const char **next)
+{
+	const char *s = p;
+	for (;;) {
+		const char *q = (const char *)memchr(p, '\n', end - p);
+		if (q == NULL) {
+			*next = end;
+			return end - s >= 2 && end[-1] == '.' && end[-2] == ' '? end - 2: end;
+		}
+		if (q - s >= 2 && q[-1] == '.' && q[-2] == ' ') {
+			*next = q + 1;
+			return q - 2;
+		}
+		p = q + 1;
+	}
+}
+
+// A chunk of whole history records
+class record_chunk {
+public:
+	struct record {
+		const char *str;
+		size_t      len;
+	};
+
+	typedef record value_type;
+
+	record_chunk(const char *from, const char *end)
+		: _from(from), _end(end) { }
+
+	struct iterator {
+		iterator(const char *pos, const char *end)
+			: _pos(pos), _end(end), _next(NULL) { }
+
+		record operator*() const
+		{
+			record rec;
+			rec.str = _pos;
+			rec.len = record_end(_pos, _end, &_next) - _pos;
+			return rec;
+		}
+
+		iterator &operator++()
+		{
+			if (_next == NULL)
+				record_end(_pos, _end, &_next);
+			_pos = _next;
+			_next = NULL;
+			return *this;
+		}
+
+		bool operator!=(const iterator &other) const
+		{ return _pos != other._pos; }
+
+		const char *_pos;
+		const char *_end;
+		mutable const char *_next;
+	};
+
+	iterator begin() const { return iterator(_from, _end); }
+	iterator end() const { return iterator(_end, _end); }
+
+private:
+	const char *_from;
+	const char *_end;
+};
+
+// Splitter of history files on record boundaries
+class record_splitter : public ulib::mapcombine::splitter<record_chunk> {
+public:
+	record_splitter(const char *from, const char *end)
+		: _from(from), _end(end) { }
+
+	int split(size_t nchunk)
+	{
+		_segments.clear();
+		if (nchunk == 0)
+			return 0;
+		size_t step = std::max((size_t)(_end - _from + nchunk) / nchunk, (size_t)1);
+		const char *p = _from;
+		while (p < _end) {
+			const char *q = p + step;
+			if (q >= _end) {
+				_segments.push_back(std::make_pair(p, _end));
+				break;
+			}
+			record_end(q, _end, &q);
+			_segments.push_back(std::make_pair(p, q));
+			p = q;
+		}
+		return 0;
+	}
+
+	size_t size() const { return _segments.size(); }
+
+	record_chunk chunk(size_t n) const
+	{ return record_chunk(_segments[n].first, _segments[n].second); }
+
+private:
+	const char *_from;
+	const char *_end;
+	std::vector< std::pair<const char *, const char *> > _segments;
+};
+
+}
+
+// Storage of the jobs keyed by id
+// The regions are guarded by mutexes rather than spinlocks, as the
+// parser threads may outnumber the CPUs.
+class history_storage :
+		public ulib::multi_hash_map<uint64_t, history_job, ulib::ulib_except, history_combiner,
+					    ulib::region_mutex<pthread_mutex_t> > {
+public:
+	history_storage(size_t nslot)
+		: ulib::multi_hash_map<uint64_t, history_job, ulib::ulib_except, history_combiner,
+				       ulib::region_mutex<pthread_mutex_t> >(nslot) { }
+};
+
+namespace
+{
+
+// Scan the next KEY="VALUE" field of a record, advancing p past it
+// Escaped characters are kept in the value, as none of the values
+// used has any.
+// Returns 1 if a field was scanned, 0 at the end, and -1 if malformed.
+static int
+scan_field(const char *&p, const char *end, const char **key, size_t *klen,
+	   const char **val, size_t *vlen)
+{
+	while (p < end && (*p == ' ' || *p == '\n' || *p == '\r'))
+		++p;
+	if (p == end)
+		return 0;
+	const char *eq = (const char *)memchr(p, '=', end - p);
+	if (eq == NULL || eq + 1 == end || eq[1] != '"')
+		return -1;
+	const char *q = eq + 2;
+	while (q < end && *q != '"')
+		q += *q == '\\'? 2: 1;
+	if (q >= end)
+		return -1;
+	*key  = p;
+	*klen = eq - p;
+	*val  = eq + 2;
+	*vlen = q - *val;
+	p = q + 1;
+	return 1;
+}
+
+static inline bool
+field_is(const char *key, size_t klen, const char *name)
+{
+	return strlen(name) == klen && memcmp(key, name, klen) == 0;
+}
+
+static inline bool
+scan_ms(const char *str, size_t len, int64_t *ms)
+{
+	if (len == 0)
+		return false;
+	int64_t v = 0;
+	for (const char *e = str + len; str < e; ++str) {
+		if (*str < '0' || *str > '9')
+			return false;
+		v = v * 10 + (*str - '0');
+	}
+	*ms = v;
+	return true;
+}
+
+// Key of the job of an attempt_<JT>_<N>_<m|r>_<TASK>_<ATTEMPT>, which
+// is the id of job_<JT>_<N>
+static bool
+attempt_job_key(const char *str, size_t len, uint64_t *key)
+{
+	char buf[128] = "job_";
+	if (len < 8 || memcmp(str, "attempt_", 8))
+		return false;
+	const char *p = str + 8, *end = str + len;
+	const char *q = (const char *)memchr(p, '_', end - p);
+	if (q == NULL || (q = (const char *)memchr(q + 1, '_', end - q - 1)) == NULL ||
+	    q - p > (ptrdiff_t)sizeof(buf) - 5)
+		return false;
+	memcpy(buf + 4, p, q - p);
+	*key = job::id_from_str(buf, q - p + 4);
+	return true;
+}
+
+static inline int
+attempt_type(const char *str, size_t len)
+{
+	if ((len == 3 && memcmp(str, "MAP", 3) == 0) ||
+	    (len == 5 && memcmp(str, "SETUP", 5) == 0))
+		return task::TASK_TYPE_MAP;
+	if ((len == 6 && memcmp(str, "REDUCE", 6) == 0) ||
+	    (len == 7 && memcmp(str, "CLEANUP", 7) == 0))
+		return task::TASK_TYPE_REDUCE;
+	return -1;
+}
+
+// Mapper of history records to the jobs they belong to
+class history_mapper :
+		public ulib::mapcombine::mc_mapper<history_storage, record_chunk::record,
+						   uint64_t, history_job> {
+public:
+	history_mapper(history_storage &stor, const char *base, uint64_t file)
+		: ulib::mapcombine::mc_mapper<history_storage, record_chunk::record,
+					      uint64_t, history_job>(stor),
+		  _base(base), _file(file), _nrecs(0), _nskipped(0) { }
+
+	void operator()(const record_chunk::record &rec)
+	{
+		const char *p = rec.str, *end = rec.str + rec.len;
+		while (p < end && (*p == ' ' || *p == '\n' || *p == '\r'))
+			++p;
+		if (p == end)
+			return;  // blank
+		++_nrecs;
+		const char *type = p;
+		while (p < end && *p != ' ')
+			++p;
+		size_t tlen = p - type;
+		if (tlen == 3 && memcmp(type, "Job", 3) == 0)
+			map_job(p, end);
+		else if (tlen > 7 && memcmp(type + tlen - 7, "Attempt", 7) == 0)
+			map_attempt(p, end);
+	}
+
+	size_t records() const { return _nrecs; }
+	size_t skipped() const { return _nskipped; }
+
+private:
+	void map_job(const char *p, const char *end)
+	{
+		history_job j;
+		const char *key, *val;
+		size_t klen, vlen;
+		int ret;
+		while ((ret = scan_field(p, end, &key, &klen, &val, &vlen)) == 1) {
+			if (field_is(key, klen, "JOBID")) {
+				j.id  = val;
+				j.len = vlen;
+			} else if (field_is(key, klen, "JOB_QUEUE")) {
+				j.queue = val;
+				j.qlen  = vlen;
+			} else if (field_is(key, klen, "JOB_PRIORITY")) {
+				j.prio     = val;
+				j.plen     = vlen;
+				j.prio_pos = (_file << 48) + (val - _base);
+			} else if (field_is(key, klen, "SUBMIT_TIME")) {
+				if (!scan_ms(val, vlen, &j.submit))
+					ret = -1;
+			} else if (field_is(key, klen, "LAUNCH_TIME")) {
+				if (!scan_ms(val, vlen, &j.launch))
+					ret = -1;
+			} else if (field_is(key, klen, "FINISHED_MAPS"))
+				j.finished = true;
+			if (ret < 0)
+				break;
+		}
+		if (ret < 0 || j.id == NULL || j.len < 5 || memcmp(j.id, "job_", 4)) {
+			++_nskipped;
+			return;
+		}
+		emit(job::id_from_str(j.id, j.len), j);
+	}
+
+	void map_attempt(const char *p, const char *end)
+	{
+		history_attempt a;
+		a.id     = NULL;
+		a.len    = 0;
+		a.type   = -1;
+		a.start  = -1;
+		a.finish = -1;
+		const char *key, *val;
+		size_t klen, vlen;
+		int ret;
+		while ((ret = scan_field(p, end, &key, &klen, &val, &vlen)) == 1) {
+			if (field_is(key, klen, "TASK_ATTEMPT_ID")) {
+				a.id  = val;
+				a.len = vlen;
+			} else if (field_is(key, klen, "TASK_TYPE"))
+				a.type = attempt_type(val, vlen);
+			else if (field_is(key, klen, "START_TIME")) {
+				if (!scan_ms(val, vlen, &a.start))
+					ret = -1;
+			} else if (field_is(key, klen, "FINISH_TIME")) {
+				if (!scan_ms(val, vlen, &a.finish))
+					ret = -1;
+			}
+			if (ret < 0)
+				break;
+		}
+		uint64_t jid;
+		if (ret < 0 || a.id == NULL || !attempt_job_key(a.id, a.len, &jid)) {
+			++_nskipped;
+			return;
+		}
+		if (a.start < 0 && a.finish < 0)
+			return;  // progress or counters only
+		history_job j;
+		j.attempt = &a;
+		emit(jid, j);
+	}
+
+	const char *_base;
+	uint64_t    _file;
+	size_t      _nrecs;
+	size_t      _nskipped;
+};
+
+// Map task of a chunk
+class history_task : public history_mapper, public ulib::thread
+{
+public:
+	history_task(const record_chunk &chunk, history_storage &stor,
+		     const char *base, uint64_t file)
+		: history_mapper(stor, base, file), _chunk(chunk) { }
+
+	~history_task()
+	{
+		join();
+	}
+
+	int run()
+	{
+		for (record_chunk::iterator it = _chunk.begin(); it != _chunk.end(); ++it)
+			(*this)(*it);
+		return 0;
+	}
+
+private:
+	record_chunk _chunk;
+};
+
+static bool
+str_less(const char *a, size_t alen, const char *b, size_t blen)
+{
+	int c = memcmp(a, b, std::min(alen, blen));
+	return c < 0 || (c == 0 && alen < blen);
+}
+
+static inline int64_t
+job_ctime(const history_job *j)
+{
+	return j->launch >= 0? j->launch: j->submit;
+}
+
+struct job_order {
+	bool operator()(const history_job *a, const history_job *b) const
+	{
+		if (job_ctime(a) != job_ctime(b))
+			return job_ctime(a) < job_ctime(b);
+		return str_less(a->id, a->len, b->id, b->len);
+	}
+};
+
+struct attempt_id_order {
+	bool operator()(const history_attempt &a, const history_attempt &b) const
+	{
+		return str_less(a.id, a.len, b.id, b.len);
+	}
+};
+
+struct attempt_order {
+	bool operator()(const history_attempt &a, const history_attempt &b) const
+	{
+		if (a.start != b.start)
+			return a.start < b.start;
+		return str_less(a.id, a.len, b.id, b.len);
+	}
+};
+
+// Merge the start and finish records of each attempt, keeping the
+// complete attempts of simulated types in the order of start time
+static void
+merge_attempts(const std::vector<history_attempt> &recs,
+	       std::vector<history_attempt> *attempts)
+{
+	std::vector<history_attempt> sorted(recs);
+	std::sort(sorted.begin(), sorted.end(), attempt_id_order());
+	attempts->clear();
+	for (size_t i = 0; i < sorted.size();) {
+		history_attempt a = sorted[i];
+		int start_type = a.start >= 0? a.type: -1;
+		for (++i; i < sorted.size() && sorted[i].len == a.len &&
+			     memcmp(sorted[i].id, a.id, a.len) == 0; ++i) {
+			if (sorted[i].start >= 0) {
+				a.start = sorted[i].start;
+				start_type = sorted[i].type;
+			}
+			if (sorted[i].finish >= 0)
+				a.finish = sorted[i].finish;
+			if (a.type < 0)
+				a.type = sorted[i].type;
+		}
+		// the type of the start record takes precedence
+		if (start_type >= 0)
+			a.type = start_type;
+		if (a.type >= 0 && a.start > 0 && a.finish > 0)
+			attempts->push_back(a);
+	}
+	std::sort(attempts->begin(), attempts->end(), attempt_order());
+}
+
+}
+
+history_parser::history_parser(int nthreads)
+	: _nthreads(nthreads), _unit(1), _njobs(0), _nattempts(0),
+	  _nrecs(0), _nskipped(0)
+{
+	if (_nthreads <= 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		_nthreads = n > 0? n: 1;
+	}
+	_storage = new history_storage(std::max(_nthreads * _nthreads, 16));
+}
+
+history_parser::~history_parser()
+{
+	for (history_storage::iterator it = _storage->begin();
+	     it != _storage->end(); ++it)
+		delete it.value().attempts;
+	delete _storage;
+	for (size_t i = 0; i < _maps.size(); ++i)
+		munmap((void *)_maps[i].base, _maps[i].size);
+}
+
+int history_parser::parse(const char *file)
+{
+	int fd = open(file, O_RDONLY);
+	if (fd == -1) {
+		ULIB_WARNING("cannot open %s for reading", file);
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st)) {
+		ULIB_WARNING("cannot stat %s", file);
+		close(fd);
+		return -1;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	const char *base = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		ULIB_WARNING("cannot map %s into memory", file);
+		return -1;
+	}
+	madvise((void *)base, st.st_size, MADV_SEQUENTIAL);
+	mapping m = { base, (size_t)st.st_size };
+	_maps.push_back(m);
+
+	// map record-aligned chunks in parallel into the storage
+	record_splitter splitter(base, base + st.st_size);
+	splitter.split(_nthreads);
+	std::vector<history_task *> tasks;
+	for (size_t i = 0; i < splitter.size(); ++i) {
+		tasks.push_back(new history_task(splitter.chunk(i), *_storage,
+						 base, _maps.size()));
+		if (tasks.back()->start())
+			tasks.back()->run();  // fall back to the calling thread
+	}
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		tasks[i]->join();
+		_nrecs += tasks[i]->records();
+		_nskipped += tasks[i]->skipped();
+		delete tasks[i];
+	}
+	return 0;
+}
+
+int history_parser::write(const char *file, bool binary)
+{
+	_njobs = 0;
+	_nattempts = 0;
+
+	std::vector<const history_job *> jobs;
+	size_t nunknown = 0;
+	for (history_storage::const_iterator it = _storage->begin();
+	     it != _storage->end(); ++it) {
+		const history_job &j = it.value();
+		if (j.id == NULL || !j.finished)
+			continue;  // unfinished jobs are left out as by parser.awk
+		if (j.queue == NULL || job_ctime(&j) < 0) {
+			++nunknown;
+			continue;
+		}
+		jobs.push_back(&j);
+	}
+	if (nunknown)
+		ULIB_WARNING("%zu finished job(s) without a queue or launch time skipped", nunknown);
+	std::sort(jobs.begin(), jobs.end(), job_order());
+
+	FILE *fp = NULL;
+	workload_writer bw;
+	if (binary) {
+		if (bw.open(file))
+			return -1;
+	} else {
+		fp = fopen(file, "w");
+		if (fp == NULL) {
+			ULIB_WARNING("cannot open %s for writing", file);
+			return -1;
+		}
+	}
+
+	std::vector<history_attempt> attempts;
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		const history_job *j = jobs[i];
+		const char *prio = j->prio;
+		size_t plen = j->plen;
+		double weight;
+		if (prio == NULL || !workload_loader::priority_weight(prio, plen, &weight)) {
+			ULIB_WARNING("priority of %.*s unrecognized, NORMAL assumed",
+				     (int)j->len, j->id);
+			prio = "NORMAL";
+			plen = 6;
+			weight = 1.0;
+		}
+		if (j->attempts)
+			merge_attempts(*j->attempts, &attempts);
+		else
+			attempts.clear();
+		double ctime = job_ctime(j);
+		for (std::vector<history_attempt>::const_iterator it = attempts.begin();
+		     it != attempts.end(); ++it) {
+			if (binary) {
+				task t;
+				t.ctime = to_sim_time(ctime * TICKS_PER_MSEC);
+				t.stime = to_sim_time(it->start * TICKS_PER_MSEC);
+				t.ftime = to_sim_time(it->finish * TICKS_PER_MSEC);
+				t.ptime = t.ftime - t.stime;
+				bw.add(pool::id_from_str(j->queue, j->qlen),
+				       job::id_from_str(j->id, j->len),
+				       task::id_from_str(it->id, it->len), weight,
+				       (task::task_type)it->type, t);
+			} else
+				fprintf(fp, "%.*s\t%.*s:%.*s\t%.*s\t%s\t%.15g\t%.15g\t%.15g\n",
+					(int)j->qlen, j->queue, (int)j->len, j->id,
+					(int)plen, prio, (int)it->len, it->id,
+					it->type == task::TASK_TYPE_MAP? "MAP": "REDUCE",
+					ctime / _unit, it->start / _unit, it->finish / _unit);
+			++_nattempts;
+		}
+		++_njobs;
+	}
+
+	if (binary)
+		return bw.close();
+	if (ferror(fp) | fclose(fp)) {
+		ULIB_WARNING("failed to write %s", file);
+		return -1;
+	}
+	return 0;
+}
+
+}
@@ -0,0 +1,87 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_HISTORY_H
+#define _COLOSSAL_HISTORY_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+namespace colossal
+{
+
+class history_storage;
+
+// Parser of Hadoop job history files
+// It replaces script/parser/parser.awk and app/cwsc/data/ds2wall.awk
+// without a Hadoop cluster. Each history file is mapped into memory
+// and split into chunks aligned on history records, and the chunks
+// are mapped in parallel into a MapCombine storage keyed by job id, so
+// that the records of a job may come from any chunk or file. The
+// attempts of finished jobs are then written out as a workload trace.
+class history_parser
+{
+public:
+	// nthreads: number of parser threads, 0 to use all online CPUs
+	history_parser(int nthreads = 0);
+	~history_parser();
+
+	// Parse a (possibly concatenated) job history file
+	// The file stays mapped until the parser is destroyed, and
+	// several files may be parsed before writing.
+	// Returns 0 on success, -1 otherwise
+	int parse(const char *file);
+
+	// Time unit of the written text trace in milliseconds
+	// The default of 1 writes milliseconds, as the loaders read them
+	// and ds2wall.awk writes them. The binary trace is always in ticks.
+	void set_unit(double ms) { _unit = ms; }
+
+	// Write the trace in the FORMAT_STFT format of workload_loader,
+	// or in the binary format if binary is set, sorted by the launch
+	// times of the jobs. The tasks take the launch time of their job
+	// as the creation time, and SETUP and CLEANUP attempts count as
+	// maps and reduces, respectively. Only attempts with both start
+	// and finish times of finished jobs are written.
+	// Returns 0 on success, -1 otherwise
+	int write(const char *file, bool binary = false);
+
+	// Number of finished jobs and of attempts written by write()
+	size_t jobs() const { return _njobs; }
+	size_t attempts() const { return _nattempts; }
+
+	// Number of history records parsed and of malformed ones skipped
+	size_t records() const { return _nrecs; }
+	size_t skipped() const { return _nskipped; }
+
+private:
+	struct mapping {
+		const char *base;
+		size_t      size;
+	};
+
+	int                  _nthreads;
+	double               _unit;
+	history_storage     *_storage;
+	std::vector<mapping> _maps;
+	size_t               _njobs;
+	size_t               _nattempts;
+	size_t               _nrecs;
+	size_t               _nskipped;
+};
+
+}
+
+#endif
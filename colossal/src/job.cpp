@@ -14,6 +14,7 @@
 
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 #include <ulib/hash_func.h>
 #include "job.hpp"
 
@@ -24,21 +25,42 @@ std::string job::to_str(const char *prefix) const
 {
         char buf[1024];
 
-        snprintf(buf, sizeof(buf), "%016llx,%lf", id, ctime);
+        snprintf(buf, sizeof(buf), "%016llx,%lld", id, (long long)ctime);
         std::string s = buf;
-        for (std::vector<task>::const_iterator it = tasks[task::TASK_TYPE_MAP].begin();
-             it != tasks[task::TASK_TYPE_MAP].end(); ++it)
-                s += "\n" + std::string(prefix) + "\t" + it->to_str();
-        for (std::vector<task>::const_iterator it = tasks[task::TASK_TYPE_REDUCE].begin();
-             it != tasks[task::TASK_TYPE_REDUCE].end(); ++it)
-                s += "\n" + std::string(prefix) + "\t" + it->to_str();
+	static const task::task_type order[] = { task::TASK_TYPE_MAP, task::TASK_TYPE_REDUCE };
+	for (int i = 0; i < 2; ++i)
+		for (size_t k = 0; k < tasks[order[i]].size(); ++k)
+			s += "\n" + std::string(prefix) + "\t" +
+				tasks[order[i]][k].to_str(task_id(order[i], k), order[i]);
 
         return s;
 }
 
+sim_time job::finish() const
+{
+	sim_time fin = -1;
+	for (int type = 0; type < task::TASK_TYPE_NUM; ++type) {
+		if (tasks[type].finished() < tasks[type].size())
+			return -1;
+		fin = std::max(fin, tasks[type].last_finish());
+	}
+	return fin;
+}
+
+sim_time job::last_finish() const
+{
+	return std::max(tasks[task::TASK_TYPE_MAP].last_finish(),
+			tasks[task::TASK_TYPE_REDUCE].last_finish());
+}
+
 uint64_t job::id_from_str(const char *str)
 {
-	return hash_fast64(str, strlen(str), 0xfeedbeefdeedbeefull);
+	return id_from_str(str, strlen(str));
+}
+
+uint64_t job::id_from_str(const char *str, size_t len)
+{
+	return hash_fast64(str, len, 0xfeedbeefdeedbeefull);
 }
 
 }
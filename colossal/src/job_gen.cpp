@@ -40,25 +40,23 @@ job job_generator::operator()()
 	j.fs_ctx_reduce.weight = 1.0;
 	j.fs_ctx_reduce.minshare = 0;
         _now += rexpo();
-	j.ctime = _now;
+	j.ctime = to_sim_time(_now * TICKS_PER_MSEC);
         for (int i = 0; i < nmap; ++i) {
                 task t;
-                t.id    = drand();
+                drand();  // the unused id draw keeps the sequence of a seed
                 t.ctime = j.ctime;
-                t.ptime = rmapdur();
+                t.ptime = to_sim_time(rmapdur() * TICKS_PER_MSEC);
                 t.stime = -1;
                 t.ftime = -1;
-                t.type  = task::TASK_TYPE_MAP;
                 j.tasks[task::TASK_TYPE_MAP].push_back(t);
         }
         for (int i = 0; i < nreduce; ++i) {
                 task t;
-                t.id    = drand();
+                drand();
                 t.ctime = j.ctime;
-                t.ptime = rreducedur();
+                t.ptime = to_sim_time(rreducedur() * TICKS_PER_MSEC);
                 t.stime = -1;
                 t.ftime = -1;
-                t.type  = task::TASK_TYPE_REDUCE;
                 j.tasks[task::TASK_TYPE_REDUCE].push_back(t);
         }
         return j;
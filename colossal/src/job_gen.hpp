@@ -29,6 +29,8 @@ namespace colossal
 //   1. Number of maps and reduces in a job follow lognormal distributions;
 //   2. Number of submitted jobs in an interval follows a Possion process;
 //   3. Map and reduce durations follow lognormal distributions;
+// The model is in milliseconds: the arrival rate is per millisecond and
+// the durations are in milliseconds, rounded to ticks.
 class job_generator
 {
 public:
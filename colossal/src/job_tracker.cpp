@@ -17,7 +17,7 @@
 namespace colossal
 {
 
-job_tracker::job_tracker(int nmaps, int nreduces, double now)
+job_tracker::job_tracker(int nmaps, int nreduces, sim_time now)
 {
 	_eng = new engine(nmaps, nreduces, now);
 }
@@ -27,12 +27,78 @@ job_tracker::~job_tracker()
 	delete _eng;
 }
 
-bool job_tracker::set_metrics(const char * met, int met_win)
+bool job_tracker::set_metrics(const char * met, int met_win, sim_time interval)
 {
-	return _eng->set_metrics(met, met_win);
+	return _eng->set_metrics(met, met_win, interval);
 }
 
-pool & job_tracker::add_pool(const std::string &ns, double mto, double fto,
+void job_tracker::set_progress(bool on)
+{
+	_eng->set_progress(on);
+}
+
+void job_tracker::set_record_times(bool on)
+{
+	_eng->set_record_times(on);
+}
+
+size_t job_tracker::events() const
+{
+	return _eng->events();
+}
+
+void job_tracker::add_capacity(sim_time t, int nmaps, int nreduces)
+{
+	_eng->add_capacity(t, nmaps, nreduces);
+}
+
+void job_tracker::set_cluster(cluster *c)
+{
+	_eng->set_cluster(c);
+}
+
+size_t job_tracker::launches(cluster::locality level) const
+{
+	return _eng->launches(level);
+}
+
+bool job_tracker::set_decisions(const char *file)
+{
+	return _eng->set_decisions(file);
+}
+
+bool job_tracker::set_speculation(const spec_params &params)
+{
+	return _eng->set_speculation(params);
+}
+
+bool job_tracker::set_containers(const resource &capacity, const resource &map,
+				 const resource &reduce)
+{
+	return _eng->set_containers(capacity, map, reduce);
+}
+
+void job_tracker::set_slowstart(double fraction)
+{
+	_eng->set_slowstart(fraction);
+}
+
+void job_tracker::set_preemption(engine::victim_policy victims, sim_time overhead)
+{
+	_eng->set_preemption(victims, overhead);
+}
+
+const spec_stats &job_tracker::speculation() const
+{
+	return _eng->speculation();
+}
+
+bool job_tracker::set_profile(const char *summary, const char *trace, sim_time bucket)
+{
+	return _eng->set_profile(summary, trace, bucket);
+}
+
+pool & job_tracker::add_pool(const std::string &ns, sim_time mto, sim_time fto,
 			     double weight, int minmap, int minred,
 			     pool::sched_mode sched)
 {
@@ -0,0 +1,660 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ulib/hash_open.h>
+#include <ulib/util_log.h>
+#include <ulib/os_thread.h>
+#include <ulib/mc_splitter.h>
+#include "task.hpp"
+#include "job.hpp"
+#include "pool.hpp"
+#include "loader.hpp"
+#include "trace_index.hpp"
+
+namespace colossal
+{
+
+namespace
+{
+
+static const char WORKLOAD_MAGIC[8] = { 'C', 'L', 'S', 'W', 'K', 'L', '2', 0 };
+
+// Header of a binary trace
+struct binary_header {
+	char     magic[8];
+	uint64_t ticks_per_msec;  // of the build that wrote the times
+};
+
+// The trace is cut into this many chunks per parser thread, and only
+// the chunks being parsed hold their records, so that the records of
+// at most about a CHUNKS_PER_THREAD-th of the trace are held at once.
+static const int CHUNKS_PER_THREAD = 8;
+
+// A task of a binary trace
+struct binary_record {
+	uint64_t pid;
+	uint64_t jid;
+	uint64_t tid;
+	int64_t  ctime;
+	int64_t  stime;  // < 0 if only the ptime is known
+	int64_t  ptime;
+	int64_t  deadline;
+	float    weight;
+	uint8_t  type;
+	uint8_t  pad[3];
+};
+
+// A parsed trace line
+struct trace_record {
+	uint64_t    pid;
+	uint64_t    jid;
+	uint64_t    tid;
+	double      weight;
+	const char *pstr;  // pool name in the mapped trace, NULL if binary
+	size_t      plen;
+	sim_time    deadline;  // < 0 if none
+	task::task_type type;
+	task        t;
+};
+
+// Location of a loaded job
+// The job vector may be reallocated as it grows, so jobs are referred
+// to by index rather than by pointer.
+struct job_loc {
+	pool  *p;
+	size_t idx;
+};
+
+// Scan a field terminated by @delim, advancing @p past the delimiter
+static inline bool
+scan_field(const char *&p, const char *end, char delim,
+	   const char **str, size_t *len)
+{
+	const char *q = (const char *)memchr(p, delim, end - p);
+	if (q == NULL)
+		return false;
+	*str = p;
+	*len = q - p;
+	p = q + 1;
+	return true;
+}
+
+// Scan a millisecond time value and convert it to ticks
+// Fractional milliseconds are accepted.
+static inline bool
+scan_time(const char *&p, const char *end, sim_time *val)
+{
+	bool neg = false;
+	if (p < end && *p == '-') {
+		neg = true;
+		++p;
+	}
+	const char *s = p;
+	sim_time ms = 0;
+	while (p < end && *p >= '0' && *p <= '9')
+		ms = ms * 10 + (*p++ - '0');
+	if (p == s)
+		return false;
+	sim_time t = ms * TICKS_PER_MSEC;
+	if (p < end && *p == '.') {
+		double frac = 0;
+		double unit = 0.1;
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p, unit *= 0.1)
+			frac += (*p - '0') * unit;
+		t += to_sim_time(frac * TICKS_PER_MSEC);
+	}
+	*val = neg? -t: t;
+	return true;
+}
+
+// Skip the field separator, or make sure the line ends here
+static inline bool
+scan_sep(const char *&p, const char *end, bool last)
+{
+	if (last) {
+		while (p < end && (*p == ' ' || *p == '\r'))
+			++p;
+		return p == end;
+	}
+	if (p < end && *p == '\t') {
+		++p;
+		return true;
+	}
+	return false;
+}
+
+// Scan the optional job deadline column and the end of the line
+static inline bool
+scan_deadline(const char *&p, const char *end, sim_time *deadline)
+{
+	*deadline = -1;
+	if (p < end && *p == '\t') {
+		++p;
+		if (!scan_time(p, end, deadline))
+			return false;
+	}
+	return scan_sep(p, end, true);
+}
+
+// Parser of a part of the trace
+class trace_parser : public ulib::thread
+{
+public:
+	trace_parser(const sim_time *window)
+		: _window(window), _err(NULL), _errlen(0) { }
+
+	virtual ~trace_parser() { }
+
+	const std::vector<trace_record> &records() const { return _recs; }
+
+	// free the records once merged
+	virtual void release() { std::vector<trace_record>().swap(_recs); }
+
+	// the first malformed line, or NULL
+	const char *error(size_t *len) const
+	{
+		*len = _errlen;
+		return _err;
+	}
+
+protected:
+	bool in_window(sim_time ctime) const
+	{
+		return _window == NULL || (ctime >= _window[0] && ctime < _window[1]);
+	}
+
+	const sim_time           *_window;  // [begin, end), or NULL
+	std::vector<trace_record> _recs;
+	const char *_err;
+	size_t      _errlen;
+};
+
+// Parser of a line-aligned chunk of a text trace
+class chunk_parser : public trace_parser
+{
+public:
+	chunk_parser(const ulib::mapcombine::text_chunk &chunk,
+		     workload_loader::trace_format fmt,
+		     const sim_time *window)
+		: trace_parser(window), _chunk(chunk), _fmt(fmt) { }
+
+	~chunk_parser()
+	{
+		join();
+	}
+
+	int run()
+	{
+		for (ulib::mapcombine::text_chunk::iterator it = _chunk.begin();
+		     it != _chunk.end(); ++it) {
+			ulib::mapcombine::text_chunk::record line = *it;
+			if (line.len == 0)
+				continue;  // skip blank lines
+			if (!parse(line.str, line.str + line.len)) {
+				_err = line.str;
+				_errlen = line.len;
+				return -1;
+			}
+		}
+		return 0;
+	}
+
+	// The pages of the chunk go as well, and are read back from the
+	// file should they be touched again.
+	void release()
+	{
+		trace_parser::release();
+		uintptr_t page = sysconf(_SC_PAGESIZE);
+		uintptr_t lo = ((uintptr_t)_chunk.begin()._pos + page - 1) & ~(page - 1);
+		uintptr_t hi = (uintptr_t)_chunk.end()._pos & ~(page - 1);
+		if (lo < hi)
+			madvise((void *)lo, hi - lo, MADV_DONTNEED);
+	}
+
+private:
+	bool parse(const char *p, const char *end)
+	{
+		trace_record r;
+		const char *str;
+		size_t len;
+
+		if (!scan_field(p, end, '\t', &r.pstr, &r.plen))
+			return false;
+		if (!scan_field(p, end, ':', &str, &len))
+			return false;
+		r.jid = job::id_from_str(str, len);
+		if (!scan_field(p, end, '\t', &str, &len) ||
+		    !workload_loader::priority_weight(str, len, &r.weight)) {
+			ULIB_WARNING("job priority unrecognized:%.*s", (int)len, str);
+			return false;
+		}
+		if (!scan_field(p, end, '\t', &str, &len))
+			return false;
+		r.tid = task::id_from_str(str, len);
+		if (!scan_field(p, end, '\t', &str, &len))
+			return false;
+		r.type = len == 3 && memcmp(str, "MAP", 3) == 0?
+			task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE;
+		if (!scan_time(p, end, &r.t.ctime) || !scan_sep(p, end, false))
+			return false;
+		if (_fmt == workload_loader::FORMAT_STFT) {
+			if (!scan_time(p, end, &r.t.stime) || !scan_sep(p, end, false) ||
+			    !scan_time(p, end, &r.t.ftime) || !scan_deadline(p, end, &r.deadline))
+				return false;
+			r.t.ptime = r.t.ftime - r.t.stime;
+		} else {
+			if (!scan_time(p, end, &r.t.ptime) || !scan_deadline(p, end, &r.deadline))
+				return false;
+			r.t.stime = -1;
+			r.t.ftime = -1;
+		}
+		if (!in_window(r.t.ctime))
+			return true;
+		r.pid = pool::id_from_str(r.pstr, r.plen);
+		_recs.push_back(r);
+		return true;
+	}
+
+	ulib::mapcombine::text_chunk  _chunk;
+	workload_loader::trace_format _fmt;
+};
+
+// Parser of a range of binary records
+class binary_parser : public trace_parser
+{
+public:
+	binary_parser(const binary_record *begin, const binary_record *end,
+		      const sim_time *window)
+		: trace_parser(window), _begin(begin), _end(end) { }
+
+	~binary_parser()
+	{
+		join();
+	}
+
+	int run()
+	{
+		_recs.reserve(_end - _begin);
+		for (const binary_record *b = _begin; b < _end; ++b) {
+			if (b->type >= task::TASK_TYPE_NUM) {
+				_err = (const char *)b;
+				_errlen = 0;
+				return -1;
+			}
+			if (!in_window(b->ctime))
+				continue;
+			trace_record r;
+			r.pid      = b->pid;
+			r.jid      = b->jid;
+			r.weight   = b->weight;
+			r.pstr     = NULL;
+			r.plen     = 0;
+			r.deadline = b->deadline;
+			r.tid      = b->tid;
+			r.type     = (task::task_type)b->type;
+			r.t.ctime  = b->ctime;
+			r.t.ptime  = b->ptime;
+			r.t.stime  = b->stime;
+			r.t.ftime  = b->stime < 0? -1: b->stime + b->ptime;
+			_recs.push_back(r);
+		}
+		return 0;
+	}
+
+private:
+	const binary_record *_begin;
+	const binary_record *_end;
+};
+
+typedef ulib::open_hash_map<uint64_t, pool *> pool_map;
+typedef ulib::open_hash_map<uint64_t, job_loc> job_map;
+
+// Add a task to its job, creating the job if it is the first task
+// Returns false if the pool has not been configured.
+static bool
+add_task(const trace_task &tt, const char *pstr, size_t plen, bool keep_ids,
+	 pool_map &pmap, job_map &jmap)
+{
+	pool_map::iterator pit = pmap.find(tt.pid);
+	if (pit == pmap.end()) {
+		if (pstr)
+			ULIB_FATAL("pool %.*s has not been configured", (int)plen, pstr);
+		else
+			ULIB_FATAL("pool %016llx has not been configured",
+				   (unsigned long long)tt.pid);
+		return false;
+	}
+	pool *p = pit.value();
+	job_map::iterator jit = jmap.find(tt.jid);
+	job *j;
+	if (jit == jmap.end()) {
+		job nj;
+		nj.id = tt.jid;
+		nj.ctime = tt.t.ctime;
+		nj.fs_ctx_map.uid = tt.jid;
+		nj.fs_ctx_reduce.uid = tt.jid;
+		j = &p->add_job(nj);
+		job_loc loc = { p, p->jobs.size() - 1 };
+		jmap[tt.jid] = loc;
+	} else {
+		j = &jit.value().p->jobs[jit.value().idx];
+		if (j->ctime > tt.t.ctime)
+			j->ctime = tt.t.ctime;
+	}
+	if (tt.deadline >= 0)
+		j->deadline = tt.deadline;
+	j->fs_ctx_map.weight = tt.weight;
+	j->fs_ctx_reduce.weight = tt.weight;
+	if (keep_ids)
+		j->tasks[tt.type].push_back(tt.t, tt.tid);
+	else
+		j->tasks[tt.type].push_back(tt.t);
+	return true;
+}
+
+// Release the spare capacity of the task containers, which grow by
+// doubling as the records are merged
+void trim_tasks(engine::pool_container_type *pools)
+{
+	for (engine::pool_container_type::iterator pit = pools->begin();
+	     pit != pools->end(); ++pit)
+		for (pool::job_container_type::iterator jit = pit->jobs.begin();
+		     jit != pit->jobs.end(); ++jit)
+			for (int type = 0; type < task::TASK_TYPE_NUM; ++type)
+				jit->tasks[type].shrink();
+}
+
+void start_parser(trace_parser *p)
+{
+	if (p->start())
+		p->run();  // fall back to the calling thread
+}
+
+// Run the parsers, at most nthreads at a time, and merge their records
+// into the pools in order, passing them through the transformation
+// stages if any
+// A parser is started only once the chunk nthreads before it has been
+// merged and freed.
+// Returns 0 on success, -1 otherwise
+int merge_records(const std::vector<trace_parser *> &parsers, int nthreads,
+		  const std::vector<workload_transform *> &stages, bool keep_ids,
+		  engine::pool_container_type *pools, size_t *nrec)
+{
+	size_t ahead = std::min(parsers.size(), (size_t)std::max(nthreads, 1));
+	for (size_t i = 0; i < ahead; ++i)
+		start_parser(parsers[i]);
+
+	pool_map pmap;
+	job_map  jmap;
+
+	for (engine::pool_container_type::iterator pit = pools->begin();
+	     pit != pools->end(); ++pit)
+		pmap[pit->id] = &*pit;
+
+	int ret = 0;
+	std::vector<trace_task> cur, next;
+	for (size_t i = 0; i < parsers.size() && ret == 0; ++i) {
+		parsers[i]->join();
+		size_t errlen;
+		const char *err = parsers[i]->error(&errlen);
+		const std::vector<trace_record> &recs = parsers[i]->records();
+		for (std::vector<trace_record>::const_iterator it = recs.begin();
+		     it != recs.end() && ret == 0; ++it) {
+			trace_task tt;
+			tt.pid      = it->pid;
+			tt.jid      = it->jid;
+			tt.tid      = it->tid;
+			tt.weight   = it->weight;
+			tt.deadline = it->deadline;
+			tt.type     = it->type;
+			tt.t        = it->t;
+			if (stages.empty()) {
+				if (!add_task(tt, it->pstr, it->plen, keep_ids, pmap, jmap))
+					ret = -1;
+				else
+					++*nrec;
+				continue;
+			}
+			cur.assign(1, tt);
+			for (size_t k = 0; k < stages.size() && cur.size(); ++k) {
+				next.clear();
+				for (size_t m = 0; m < cur.size(); ++m)
+					stages[k]->apply(cur[m], &next);
+				cur.swap(next);
+			}
+			for (size_t m = 0; m < cur.size() && ret == 0; ++m) {
+				bool same = cur[m].pid == it->pid;
+				if (!add_task(cur[m], same? it->pstr: NULL, same? it->plen: 0,
+					      keep_ids, pmap, jmap))
+					ret = -1;
+				else
+					++*nrec;
+			}
+		}
+		if (err && ret == 0) {
+			if (errlen)
+				ULIB_WARNING("Error encounterred while parsing a line:%.*s",
+					     (int)errlen, err);
+			else
+				ULIB_WARNING("Error encounterred while parsing a record");
+			ret = -1;
+		}
+		parsers[i]->release();
+		if (i + ahead < parsers.size())
+			start_parser(parsers[i + ahead]);
+	}
+	if (ret == 0)
+		trim_tasks(pools);
+	return ret;
+}
+
+}
+
+bool workload_loader::priority_weight(const char *str, size_t len, double *weight)
+{
+	if (len == 6 && memcmp(str, "NORMAL", 6) == 0)
+		*weight = 1.0;
+	else if (len == 4 && memcmp(str, "HIGH", 4) == 0)
+		*weight = 2.0;
+	else if (len == 9 && memcmp(str, "VERY_HIGH", 9) == 0)
+		*weight = 4.0;
+	else
+		return false;
+	return true;
+}
+
+workload_loader::workload_loader(trace_format fmt, int nthreads)
+	: _fmt(fmt), _nthreads(nthreads), _nrec(0), _keep_ids(false),
+	  _windowed(false), _begin(0), _end(0)
+{
+	if (_nthreads <= 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		_nthreads = n > 0? n: 1;
+	}
+}
+
+workload_loader::~workload_loader()
+{
+	for (size_t i = 0; i < _stages.size(); ++i)
+		delete _stages[i];
+}
+
+int workload_loader::load(const char *file, engine::pool_container_type *pools)
+{
+	_nrec = 0;
+
+	int fd = open(file, O_RDONLY);
+	if (fd == -1) {
+		ULIB_WARNING("cannot open %s for reading", file);
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st)) {
+		ULIB_WARNING("cannot stat %s", file);
+		close(fd);
+		return -1;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	const char *base = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		ULIB_WARNING("cannot map %s into memory", file);
+		return -1;
+	}
+	if (st.st_size >= (off_t)sizeof(WORKLOAD_MAGIC) &&
+	    memcmp(base, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC)) == 0) {
+		int ret = load_binary(base, st.st_size, pools);
+		munmap((void *)base, st.st_size);
+		return ret;
+	}
+
+	// narrow the range to the window using the sidecar index
+	off_t lo = 0, hi = st.st_size;
+	sim_time window[2] = { _begin, _end };
+	if (_windowed) {
+		trace_index idx;
+		if (idx.open(file)) {
+			munmap((void *)base, st.st_size);
+			return -1;
+		}
+		lo = idx.seek(_begin);
+		// the bucket containing end - 1 may hold tasks in the window
+		hi = std::max(lo, idx.seek(_end + idx.bucket()));
+	}
+	if (lo == hi) {
+		munmap((void *)base, st.st_size);
+		return 0;
+	}
+	off_t page = lo & ~(off_t)(sysconf(_SC_PAGESIZE) - 1);
+	madvise((void *)(base + page), hi - page, MADV_SEQUENTIAL);
+
+	// parse line-aligned chunks in parallel
+	ulib::mapcombine::text_splitter splitter(base + lo, base + hi);
+	splitter.split(_nthreads * CHUNKS_PER_THREAD);
+	std::vector<trace_parser *> parsers;
+	for (size_t i = 0; i < splitter.size(); ++i)
+		parsers.push_back(new chunk_parser(splitter.chunk(i), _fmt,
+						   _windowed? window: NULL));
+	int ret = merge_records(parsers, _nthreads, _stages, _keep_ids, pools, &_nrec);
+
+	for (size_t i = 0; i < parsers.size(); ++i)
+		delete parsers[i];
+	munmap((void *)base, st.st_size);
+
+	return ret;
+}
+
+int workload_loader::load_binary(const char *base, size_t size,
+				 engine::pool_container_type *pools)
+{
+	const binary_header *h = (const binary_header *)base;
+	if (size < sizeof(binary_header)) {
+		ULIB_WARNING("binary trace truncated");
+		return -1;
+	}
+	// the times are read as they are, in ticks
+	if (h->ticks_per_msec != (uint64_t)TICKS_PER_MSEC) {
+		ULIB_WARNING("binary trace written with %llu ticks per millisecond, not %llu",
+			     (unsigned long long)h->ticks_per_msec,
+			     (unsigned long long)TICKS_PER_MSEC);
+		return -1;
+	}
+	size_t n = (size - sizeof(binary_header)) / sizeof(binary_record);
+	if (sizeof(binary_header) + n * sizeof(binary_record) != size) {
+		ULIB_WARNING("binary trace truncated");
+		return -1;
+	}
+	if (n == 0)
+		return 0;
+	madvise((void *)base, size, MADV_SEQUENTIAL);
+
+	// the records split evenly, without any scanning
+	const binary_record *recs = (const binary_record *)(base + sizeof(binary_header));
+	sim_time window[2] = { _begin, _end };
+	size_t nchunks = (size_t)_nthreads * CHUNKS_PER_THREAD;
+	size_t step = (n + nchunks - 1) / nchunks;
+	std::vector<trace_parser *> parsers;
+	for (size_t i = 0; i < n; i += step)
+		parsers.push_back(new binary_parser(recs + i, recs + std::min(n, i + step),
+						    _windowed? window: NULL));
+	int ret = merge_records(parsers, _nthreads, _stages, _keep_ids, pools, &_nrec);
+
+	for (size_t i = 0; i < parsers.size(); ++i)
+		delete parsers[i];
+
+	return ret;
+}
+
+int workload_writer::open(const char *file)
+{
+	close();
+	_fp = fopen(file, "wb");
+	if (_fp == NULL) {
+		ULIB_WARNING("cannot open %s for writing", file);
+		return -1;
+	}
+	_n = 0;
+	binary_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC));
+	h.ticks_per_msec = TICKS_PER_MSEC;
+	_err = fwrite(&h, sizeof(h), 1, _fp) != 1;
+	return 0;
+}
+
+int workload_writer::close()
+{
+	if (_fp == NULL)
+		return 0;
+	bool err = fclose(_fp) || _err;
+	_fp = NULL;
+	if (err) {
+		ULIB_WARNING("failed to write the binary trace");
+		return -1;
+	}
+	return 0;
+}
+
+void workload_writer::add(uint64_t pid, uint64_t jid, uint64_t tid, double weight,
+			  task::task_type type, const task &t, sim_time deadline)
+{
+	binary_record b;
+	memset(&b, 0, sizeof(b));
+	b.pid      = pid;
+	b.jid      = jid;
+	b.tid      = tid;
+	b.ctime    = t.ctime;
+	b.stime    = t.stime;
+	b.ptime    = t.stime < 0? t.ptime: t.ftime - t.stime;
+	b.deadline = deadline;
+	b.weight   = weight;
+	b.type     = type;
+	if (fwrite(&b, sizeof(b), 1, _fp) != 1)
+		_err = true;
+	++_n;
+}
+
+}
@@ -0,0 +1,600 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <cstdarg>
+#include <sched.h>
+#include <unistd.h>
+#include <ulib/util_log.h>
+#include <ulib/os_thread.h>
+#include "logger.hpp"
+
+namespace colossal
+{
+
+namespace
+{
+
+const char LOG_MAGIC[8] = { 'C', 'L', 'S', 'L', 'O', 'G', '1', 0 };
+
+const int MAX_FORMATS = 4096;
+
+const char *g_level_names[] = { "debug", "notice", "warning", "fatal" };
+const char *g_kind_names[]  = { "engine", "create", "finish", "preempt",
+				"capacity", "locality", "speculate" };
+
+// Bounded multi-producer single-consumer ring of records
+// Each cell carries a sequence number telling whether it is free for
+// the producer claiming its position or ready for the consumer.
+class log_ring
+{
+public:
+	log_ring(size_t capacity)
+	{
+		size_t n = 1;
+		while (n < capacity)
+			n <<= 1;
+		_mask = n - 1;
+		_cells = new cell[n];
+		for (size_t i = 0; i < n; ++i)
+			_cells[i].seq = i;
+		_head = 0;
+		_tail = 0;
+	}
+
+	~log_ring() { delete [] _cells; }
+
+	// Returns false if the ring is full
+	bool push(const log_record &r)
+	{
+		uint64_t pos = _head;
+		for (;;) {
+			cell *c = &_cells[pos & _mask];
+			int64_t diff = (int64_t)(c->seq - pos);
+			if (diff == 0) {
+				if (__sync_bool_compare_and_swap(&_head, pos, pos + 1)) {
+					c->rec = r;
+					__sync_synchronize();
+					c->seq = pos + 1;
+					return true;
+				}
+			} else if (diff < 0)
+				return false;
+			pos = _head;
+		}
+	}
+
+	// Single consumer, returns false if the ring is empty
+	bool pop(log_record *r)
+	{
+		cell *c = &_cells[_tail & _mask];
+		if ((int64_t)(c->seq - (_tail + 1)) < 0)
+			return false;
+		__sync_synchronize();
+		*r = c->rec;
+		__sync_synchronize();
+		c->seq = _tail + _mask + 1;
+		++_tail;
+		return true;
+	}
+
+private:
+	struct cell {
+		volatile uint64_t seq;
+		log_record rec;
+	};
+
+	cell    *_cells;
+	uint64_t _mask;
+	char     _pad0[64];
+	volatile uint64_t _head;  // next position to claim
+	char     _pad1[64];
+	uint64_t _tail;           // next position to consume
+};
+
+// Background writer draining the ring
+class log_writer : public ulib::thread
+{
+public:
+	log_writer(log_ring *ring, FILE *fp, bool binary)
+		: _ring(ring), _fp(fp), _binary(binary), _stop(false) { }
+
+	void finish()
+	{
+		_stop = true;
+		join();
+	}
+
+	int run()
+	{
+		log_record r;
+		for (;;) {
+			bool stop = _stop;
+			__sync_synchronize();
+			size_t n = 0;
+			while (_ring->pop(&r)) {
+				emit(r);
+				++n;
+			}
+			if (stop)
+				break;
+			if (n == 0)
+				usleep(1000);
+		}
+		fflush(_fp);
+		return 0;
+	}
+
+private:
+	void emit(const log_record &r)
+	{
+		const log_format *f = logger::format(r.code);
+		if (!_binary) {
+			_line.clear();
+			f->render(r, &_line);
+			_line += '\n';
+			fwrite(_line.data(), 1, _line.size(), _fp);
+			return;
+		}
+		// define the format before its first record
+		if (r.code >= _defined.size())
+			_defined.resize(r.code + 1, false);
+		if (!_defined[r.code]) {
+			uint16_t code = r.code;
+			uint8_t  lk[2] = { (uint8_t)f->level, (uint8_t)f->kind };
+			uint32_t len = f->fmt.size();
+			fputc('F', _fp);
+			fwrite(&code, sizeof(code), 1, _fp);
+			fwrite(lk, sizeof(lk), 1, _fp);
+			fwrite(&len, sizeof(len), 1, _fp);
+			fwrite(f->fmt.data(), 1, len, _fp);
+			_defined[r.code] = true;
+		}
+		fputc('R', _fp);
+		fwrite(&r, sizeof(r), 1, _fp);
+	}
+
+	log_ring *_ring;
+	FILE     *_fp;
+	bool      _binary;
+	volatile bool     _stop;
+	std::string       _line;
+	std::vector<bool> _defined;
+};
+
+log_ring   *g_ring   = NULL;
+log_writer *g_writer = NULL;
+FILE       *g_fp     = NULL;
+
+// Call site formats, never freed since the codes are kept by the sites
+log_format  *g_formats[MAX_FORMATS];
+volatile int g_nformats = 0;
+
+int define(log_level lv, log_kind k, const char *fmt)
+{
+	log_format *f = new log_format;
+	if (f->parse(lv, k, fmt)) {
+		delete f;
+		return -1;
+	}
+	int code = __sync_fetch_and_add(&g_nformats, 1);
+	if (code >= MAX_FORMATS) {
+		delete f;
+		return -1;
+	}
+	g_formats[code] = f;
+	__sync_synchronize();
+	return code;
+}
+
+inline bool put(log_record *r, const void *v)
+{
+	if ((size_t)r->size + 8 > sizeof(r->payload))
+		return false;
+	memcpy(r->payload + r->size, v, 8);
+	r->size += 8;
+	return true;
+}
+
+inline bool put_str(log_record *r, const char *s)
+{
+	if ((size_t)r->size + 1 > sizeof(r->payload))
+		return false;
+	size_t len = s? strlen(s): 0;
+	size_t avail = sizeof(r->payload) - r->size - 1;
+	if (len > avail)
+		len = avail;
+	r->payload[r->size] = len;
+	memcpy(r->payload + r->size + 1, s, len);
+	r->size += len + 1;
+	return true;
+}
+
+}
+
+int log_format::parse(log_level lv, log_kind k, const char *f)
+{
+	level = lv;
+	kind  = k;
+	fmt   = f;
+	args.clear();
+	specs.clear();
+	texts.clear();
+
+	std::string text;
+	for (const char *p = f; *p;) {
+		if (*p != '%') {
+			text += *p++;
+			continue;
+		}
+		if (p[1] == '%') {
+			text += '%';
+			p += 2;
+			continue;
+		}
+		const char *s = p++;
+		while (*p && strchr("-+ #0", *p))
+			++p;
+		while (isdigit(*p) || *p == '.')
+			++p;
+		std::string base(s, p - s);
+		arg_type t = ARG_INT;
+		if (p[0] == 'l' && p[1] == 'l') {
+			t = ARG_LLONG;
+			p += 2;
+		} else if (*p == 'l') {
+			t = ARG_LONG;
+			++p;
+		} else if (*p == 'j') {
+			t = ARG_LLONG;
+			++p;
+		} else if (*p == 'z') {
+			t = ARG_SIZE;
+			++p;
+		}
+		char c = *p++;
+		switch (c) {
+		case 'd':
+		case 'i':
+			specs.push_back(base + "ll" + c);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			if (t == ARG_INT)
+				t = ARG_UINT;
+			specs.push_back(base + "ll" + c);
+			break;
+		case 'c':
+			if (t != ARG_INT)
+				return -1;
+			specs.push_back(base + c);
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+			if (t != ARG_INT && t != ARG_LONG)
+				return -1;
+			t = ARG_DOUBLE;
+			specs.push_back(base + c);
+			break;
+		case 's':
+			if (t != ARG_INT)
+				return -1;
+			t = ARG_STR;
+			specs.push_back(base + c);
+			break;
+		default:
+			// e.g. '*' widths, %p and %n
+			return -1;
+		}
+		args.push_back(t);
+		texts.push_back(text);
+		text.clear();
+	}
+	texts.push_back(text);
+	return 0;
+}
+
+void log_format::render(const log_record &r, std::string *out) const
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "[%c] @%lld\t", "DIWE"[r.level & 3], (long long)r.time);
+	*out += buf;
+	size_t off = 0;
+	for (size_t i = 0; i < args.size(); ++i) {
+		*out += texts[i];
+		if (args[i] == ARG_STR) {
+			if (off >= r.size) {
+				*out += '?';
+				continue;
+			}
+			size_t len = (uint8_t)r.payload[off];
+			std::string s(r.payload + off + 1, len);
+			off += len + 1;
+			snprintf(buf, sizeof(buf), specs[i].c_str(), s.c_str());
+		} else {
+			if (off + 8 > r.size) {
+				*out += '?';
+				continue;
+			}
+			if (args[i] == ARG_DOUBLE) {
+				double v;
+				memcpy(&v, r.payload + off, 8);
+				snprintf(buf, sizeof(buf), specs[i].c_str(), v);
+			} else {
+				long long v;
+				memcpy(&v, r.payload + off, 8);
+				if (specs[i][specs[i].size() - 1] == 'c')
+					snprintf(buf, sizeof(buf), specs[i].c_str(), (int)v);
+				else
+					snprintf(buf, sizeof(buf), specs[i].c_str(), v);
+			}
+			off += 8;
+		}
+		*out += buf;
+	}
+	*out += texts.back();
+}
+
+const size_t logger::DEFAULT_CAPACITY = 65536;
+
+volatile bool         logger::_running = false;
+log_level             logger::_level   = LEVEL_DEBUG;
+uint32_t              logger::_kinds   = ~0u;
+std::vector<uint64_t> logger::_pools;
+volatile uint64_t     logger::_stalls  = 0;
+
+int logger::start(const char *file, bool binary, size_t capacity)
+{
+	if (_running) {
+		ULIB_WARNING("logger is already running");
+		return -1;
+	}
+	if (file == NULL && binary) {
+		ULIB_WARNING("binary logs require a file");
+		return -1;
+	}
+	FILE *fp = stdout;
+	if (file) {
+		fp = fopen(file, binary? "wb": "w");
+		if (fp == NULL) {
+			ULIB_WARNING("cannot open %s for writing", file);
+			return -1;
+		}
+	}
+	if (binary && fwrite(LOG_MAGIC, sizeof(LOG_MAGIC), 1, fp) != 1) {
+		ULIB_WARNING("failed to write log %s", file);
+		fclose(fp);
+		return -1;
+	}
+	g_ring = new log_ring(capacity > 0? capacity: DEFAULT_CAPACITY);
+	g_writer = new log_writer(g_ring, fp, binary);
+	if (g_writer->start()) {
+		ULIB_WARNING("cannot start the log writer");
+		delete g_writer;
+		delete g_ring;
+		g_writer = NULL;
+		g_ring = NULL;
+		if (fp != stdout)
+			fclose(fp);
+		return -1;
+	}
+	g_fp = fp;
+	_stalls = 0;
+	__sync_synchronize();
+	_running = true;
+	return 0;
+}
+
+void logger::stop()
+{
+	if (!_running)
+		return;
+	_running = false;
+	__sync_synchronize();
+	g_writer->finish();
+	delete g_writer;
+	delete g_ring;
+	g_writer = NULL;
+	g_ring = NULL;
+	if (g_fp != stdout)
+		fclose(g_fp);
+	g_fp = NULL;
+}
+
+bool logger::write(int *code, log_level lv, log_kind k, uint64_t pool,
+		   sim_time time, const char *fmt, ...)
+{
+	if (!_running)
+		return false;
+	int c = *code;
+	if (c == -2)
+		return false;  // not loggable as a record
+	if (c < 0) {
+		c = define(lv, k, fmt);
+		*code = c < 0? -2: c;
+		if (c < 0)
+			return false;
+	}
+
+	const log_format *f = g_formats[c];
+	log_record r;
+	r.code  = c;
+	r.level = lv;
+	r.kind  = k;
+	r.size  = 0;
+	r.pad   = 0;
+	r.time  = time;
+	r.pool  = pool;
+
+	va_list ap;
+	va_start(ap, fmt);
+	bool room = true;
+	for (size_t i = 0; i < f->args.size(); ++i) {
+		long long v = 0;
+		double d = 0;
+		const char *s = NULL;
+		switch (f->args[i]) {
+		case log_format::ARG_INT:
+			v = va_arg(ap, int);
+			break;
+		case log_format::ARG_UINT:
+			v = va_arg(ap, unsigned int);
+			break;
+		case log_format::ARG_LONG:
+			v = va_arg(ap, long);
+			break;
+		case log_format::ARG_LLONG:
+			v = va_arg(ap, long long);
+			break;
+		case log_format::ARG_SIZE:
+			v = va_arg(ap, size_t);
+			break;
+		case log_format::ARG_DOUBLE:
+			d = va_arg(ap, double);
+			break;
+		case log_format::ARG_STR:
+			s = va_arg(ap, const char *);
+			break;
+		}
+		if (!room)
+			continue;
+		if (f->args[i] == log_format::ARG_STR)
+			room = put_str(&r, s);
+		else if (f->args[i] == log_format::ARG_DOUBLE)
+			room = put(&r, &d);
+		else
+			room = put(&r, &v);
+	}
+	va_end(ap);
+
+	if (!g_ring->push(r)) {
+		__sync_fetch_and_add(&_stalls, 1);
+		do
+			sched_yield();
+		while (!g_ring->push(r));
+	}
+	return true;
+}
+
+bool logger::pool_enabled(uint64_t pool)
+{
+	for (size_t i = 0; i < _pools.size(); ++i)
+		if (_pools[i] == pool)
+			return true;
+	return false;
+}
+
+const char *logger::level_str(log_level lv)
+{
+	return g_level_names[lv];
+}
+
+const char *logger::kind_str(log_kind k)
+{
+	return g_kind_names[k];
+}
+
+int logger::level_from_str(const char *str)
+{
+	for (int i = 0; i <= LEVEL_FATAL; ++i)
+		if (strcmp(str, g_level_names[i]) == 0)
+			return i;
+	return -1;
+}
+
+int logger::kind_from_str(const char *str)
+{
+	for (int i = 0; i < KIND_NUM; ++i)
+		if (strcmp(str, g_kind_names[i]) == 0)
+			return i;
+	return -1;
+}
+
+const log_format *logger::format(int code)
+{
+	return code >= 0 && code < g_nformats && code < MAX_FORMATS?
+		g_formats[code]: NULL;
+}
+
+int log_reader::open(const char *file)
+{
+	close();
+	_fp = fopen(file, "rb");
+	if (_fp == NULL) {
+		ULIB_WARNING("cannot open %s for reading", file);
+		return -1;
+	}
+	char magic[sizeof(LOG_MAGIC)];
+	if (fread(magic, sizeof(magic), 1, _fp) != 1 ||
+	    memcmp(magic, LOG_MAGIC, sizeof(magic))) {
+		ULIB_WARNING("%s is not a binary log", file);
+		close();
+		return -1;
+	}
+	return 0;
+}
+
+void log_reader::close()
+{
+	if (_fp)
+		fclose(_fp);
+	_fp = NULL;
+	_formats.clear();
+}
+
+int log_reader::next(log_record *r)
+{
+	for (;;) {
+		int tag = fgetc(_fp);
+		if (tag == EOF)
+			return 0;
+		if (tag == 'R') {
+			if (fread(r, sizeof(*r), 1, _fp) != 1 || format(*r) == NULL ||
+			    r->size > sizeof(r->payload))
+				return -1;
+			return 1;
+		}
+		if (tag != 'F')
+			return -1;
+		uint16_t code;
+		uint8_t  lk[2];
+		uint32_t len;
+		if (fread(&code, sizeof(code), 1, _fp) != 1 ||
+		    fread(lk, sizeof(lk), 1, _fp) != 1 ||
+		    fread(&len, sizeof(len), 1, _fp) != 1 ||
+		    lk[0] > LEVEL_FATAL || lk[1] >= KIND_NUM)
+			return -1;
+		std::string fmt(len, '\0');
+		if (len && fread(&fmt[0], 1, len, _fp) != len)
+			return -1;
+		if (code >= _formats.size()) {
+			entry e;
+			e.defined = false;
+			_formats.resize(code + 1, e);
+		}
+		if (_formats[code].f.parse((log_level)lk[0], (log_kind)lk[1], fmt.c_str()))
+			return -1;
+		_formats[code].defined = true;
+	}
+}
+
+}
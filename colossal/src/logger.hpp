@@ -0,0 +1,189 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_LOGGER_H
+#define _COLOSSAL_LOGGER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "common.hpp"
+
+namespace colossal
+{
+
+enum log_level {
+	LEVEL_DEBUG = 0,
+	LEVEL_NOTICE,
+	LEVEL_WARNING,
+	LEVEL_FATAL
+};
+
+// Event kinds, the bit positions of the kind filter
+enum log_kind {
+	KIND_ENGINE = 0,
+	KIND_CREATE,
+	KIND_FINISH,
+	KIND_PREEMPT,
+	KIND_CAPACITY,
+	KIND_LOCALITY,
+	KIND_SPECULATE,
+	KIND_NUM
+};
+
+// A binary log record, one cache line
+struct log_record {
+	uint16_t code;   // call site format
+	uint8_t  level;
+	uint8_t  kind;
+	uint16_t size;   // payload bytes in use
+	uint16_t pad;
+	sim_time time;
+	uint64_t pool;   // 0 if not about a pool
+	char     payload[40];
+};
+
+// Format of a log call site
+// The arguments are described by the printf conversions and packed
+// into the record payload in order. Integers and doubles take eight
+// bytes each, strings a length byte followed by the characters, which
+// are truncated to fit. Arguments beyond the payload are dropped.
+struct log_format {
+	enum arg_type {
+		ARG_INT,
+		ARG_UINT,
+		ARG_LONG,
+		ARG_LLONG,
+		ARG_SIZE,
+		ARG_DOUBLE,
+		ARG_STR
+	};
+
+	log_level level;
+	log_kind  kind;
+	std::string fmt;
+	std::vector<arg_type>    args;
+	std::vector<std::string> specs;  // conversion of each argument
+	std::vector<std::string> texts;  // text before each argument, then the tail
+
+	// Parse the printf format
+	// Returns 0 on success, -1 for conversions that cannot be logged
+	int parse(log_level lv, log_kind k, const char *f);
+
+	// Render a record of this format as a log line, without the newline
+	void render(const log_record &r, std::string *out) const;
+};
+
+// Asynchronous logger of the simulator
+// The log macros pack their arguments into fixed-size records, which
+// are pushed into a lock-free ring buffer and written by a background
+// thread either as text or as a binary log to be decoded by
+// log_reader. Producers wait for the writer when the ring is full, so
+// no record is lost. When the logger is not running, the macros write
+// text synchronously. Records can be filtered at runtime by level,
+// event kind and pool in both cases.
+class logger
+{
+public:
+	static const size_t DEFAULT_CAPACITY;  // records
+
+	// Start the writer
+	// file: log file, or NULL for the standard output in text mode
+	// binary: write binary records rather than text
+	// Returns 0 on success, -1 otherwise
+	static int start(const char *file, bool binary, size_t capacity = DEFAULT_CAPACITY);
+
+	// Write the buffered records and stop the writer
+	// Log calls must have returned before stopping.
+	static void stop();
+
+	static bool running() { return _running; }
+
+	// Runtime filters
+	static void set_level(log_level lv) { _level = lv; }
+	static void set_kinds(uint32_t mask) { _kinds = mask; }
+	static void add_pool(uint64_t pool) { _pools.push_back(pool); }
+	static void clear_pools() { _pools.clear(); }
+
+	static bool enabled(log_level lv, log_kind k, uint64_t pool)
+	{
+		return lv >= _level && (_kinds >> k & 1) &&
+			(pool == 0 || _pools.empty() || pool_enabled(pool));
+	}
+
+	// Log a record through the ring
+	// code: call site format code, defined on the first call
+	// Returns false if the record must be written synchronously
+	static bool write(int *code, log_level lv, log_kind k, uint64_t pool,
+			  sim_time time, const char *fmt, ...)
+		__attribute__((format(printf, 6, 7)));
+
+	// Number of times a producer found the ring full
+	static uint64_t stalls() { return _stalls; }
+
+	// Level/kind names, and the reverse lookups returning -1 if unknown
+	static const char *level_str(log_level lv);
+	static const char *kind_str(log_kind k);
+	static int level_from_str(const char *str);
+	static int kind_from_str(const char *str);
+
+	// Format of a defined code, or NULL
+	static const log_format *format(int code);
+
+private:
+	static bool pool_enabled(uint64_t pool);
+
+	static volatile bool  _running;
+	static log_level      _level;
+	static uint32_t       _kinds;
+	static std::vector<uint64_t> _pools;
+	static volatile uint64_t _stalls;
+};
+
+// Reader of binary logs
+class log_reader
+{
+public:
+	log_reader() : _fp(NULL) { }
+	~log_reader() { close(); }
+
+	// Returns 0 on success, -1 otherwise
+	int  open(const char *file);
+	void close();
+
+	// Read the next record
+	// Returns 1 if a record was read, 0 at the end, -1 on corruption
+	int next(log_record *r);
+
+	// Format of a record read so far, or NULL
+	const log_format *format(const log_record &r) const
+	{
+		return r.code < _formats.size() && _formats[r.code].defined?
+			&_formats[r.code].f: NULL;
+	}
+
+private:
+	struct entry {
+		bool       defined;
+		log_format f;
+	};
+
+	FILE *_fp;
+	std::vector<entry> _formats;
+};
+
+}
+
+#endif
@@ -42,6 +42,13 @@ void metric::set_value(int val)
 	set_value(buf);
 }
 
+void metric::set_value(int64_t val)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%lld", (long long)val);
+	set_value(buf);
+}
+
 void metric::set_value(uint64_t val)
 {
 	char buf[64];
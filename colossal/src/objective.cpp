@@ -0,0 +1,94 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "job.hpp"
+#include "pool.hpp"
+#include "objective.hpp"
+
+namespace colossal
+{
+
+const double latency_objective::DEFAULT_PENALTY = 10.0;
+
+void latency_objective::set_weight(const std::string &pool, double weight)
+{
+	uint64_t pid = pool::id_from_str(pool.c_str());
+	goal g = lookup(pid);
+	g.weight = weight;
+	_goals[pid] = g;
+}
+
+void latency_objective::set_sla(const std::string &pool, sim_time sla)
+{
+	uint64_t pid = pool::id_from_str(pool.c_str());
+	goal g = lookup(pid);
+	g.sla = sla;
+	_goals[pid] = g;
+}
+
+latency_objective::goal latency_objective::lookup(uint64_t pid) const
+{
+	ulib::open_hash_map<uint64_t, goal>::const_iterator it = _goals.find(pid);
+	if (it != _goals.end())
+		return it.value();
+	goal g = { 1.0, -1 };
+	return g;
+}
+
+sim_time latency_objective::latency(const pool &p) const
+{
+	std::vector<sim_time> lat;
+	for (pool::job_container_type::const_iterator jit = p.jobs.begin();
+	     jit != p.jobs.end(); ++jit) {
+		sim_time fin = jit->last_finish();
+		if (fin >= 0)
+			lat.push_back(fin - jit->ctime);
+	}
+	if (lat.empty())
+		return -1;
+
+	// the nearest-rank quantile
+	size_t k = (size_t)ceil(_quantile * lat.size());
+	k = std::min(k > 0? k - 1: 0, lat.size() - 1);
+	std::nth_element(lat.begin(), lat.begin() + k, lat.end());
+	return lat[k];
+}
+
+double latency_objective::operator()(const engine::pool_container_type &pools) const
+{
+	double sum = 0;
+	double wsum = 0;
+	double penalty = 0;
+
+	for (engine::pool_container_type::const_iterator it = pools.begin();
+	     it != pools.end(); ++it) {
+		goal g = lookup(it->id);
+		if (g.weight <= 0)
+			continue;
+		sim_time q = latency(*it);
+		if (q < 0)
+			continue;
+		sum += g.weight * q;
+		wsum += g.weight;
+		if (g.sla >= 0 && q > g.sla)
+			penalty += _penalty * (q - g.sla);
+	}
+
+	return (wsum > 0? sum / wsum: 0) + penalty;
+}
+
+}
@@ -0,0 +1,312 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+#include <ulib/os_thread.h>
+#include <ulib/util_log.h>
+#include "pool.hpp"
+#include "fluid.hpp"
+#include "optimizer.hpp"
+
+namespace colossal
+{
+
+namespace
+{
+
+const double INITIAL_SIGMA = 0.3;
+
+// Simulates every nth candidate of a generation
+class eval_worker : public ulib::thread
+{
+public:
+	eval_worker(const pool_optimizer *opt,
+		    const std::vector< std::vector<double> > *cands,
+		    std::vector<double> *vals, size_t first, size_t stride)
+		: _opt(opt), _cands(cands), _vals(vals),
+		  _first(first), _stride(stride) { }
+
+	~eval_worker()
+	{
+		join();
+	}
+
+	int run()
+	{
+		for (size_t i = _first; i < _cands->size(); i += _stride)
+			(*_vals)[i] = _opt->evaluate((*_cands)[i]);
+		return 0;
+	}
+
+private:
+	const pool_optimizer *_opt;
+	const std::vector< std::vector<double> > *_cands;
+	std::vector<double> *_vals;
+	size_t _first;
+	size_t _stride;
+};
+
+struct ranked {
+	double val;
+	size_t idx;
+
+	bool operator<(const ranked &other) const
+	{
+		return val < other.val;
+	}
+};
+
+}
+
+pool_optimizer::pool_optimizer(int nmaps, int nreduces,
+			       const engine::pool_container_type &pools,
+			       const objective &obj, int nthreads)
+	: _nmaps(nmaps), _nreduces(nreduces), _nthreads(nthreads), _popsize(0), _fluid(false),
+	  _pools(pools), _obj(obj), _sigma(INITIAL_SIGMA), _gen(0), _nevals(0),
+	  _best_val(0), _init_val(0)
+{
+	if (_nthreads <= 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		_nthreads = n > 0? n: 1;
+	}
+	_lo[PARAM_WEIGHT] = 0.1;
+	_hi[PARAM_WEIGHT] = 10;
+	_lo[PARAM_MAP_MINSHARE] = 0;
+	_hi[PARAM_MAP_MINSHARE] = nmaps;
+	_lo[PARAM_REDUCE_MINSHARE] = 0;
+	_hi[PARAM_REDUCE_MINSHARE] = nreduces;
+	_lo[PARAM_MS_TIMEOUT] = 0;
+	_hi[PARAM_MS_TIMEOUT] = 3600000 * TICKS_PER_MSEC;
+	_lo[PARAM_HF_TIMEOUT] = 0;
+	_hi[PARAM_HF_TIMEOUT] = 3600000 * TICKS_PER_MSEC;
+	seed(0);
+}
+
+void pool_optimizer::set_bounds(param p, double lo, double hi)
+{
+	if (p < 0 || p >= PARAM_NUM || lo > hi) {
+		ULIB_WARNING("invalid bounds [%f, %f] of parameter %d", lo, hi, p);
+		return;
+	}
+	_lo[p] = lo;
+	_hi[p] = hi;
+}
+
+void pool_optimizer::init()
+{
+	size_t idx = 0;
+	for (engine::pool_container_type::const_iterator it = _pools.begin();
+	     it != _pools.end(); ++it, ++idx) {
+		double val[PARAM_NUM] = {
+			it->fs_ctx_map.weight,
+			it->fs_ctx_map.minshare,
+			it->fs_ctx_reduce.minshare,
+			(double)it->ms_timeout,
+			(double)it->hf_timeout
+		};
+		for (int p = 0; p < PARAM_NUM; ++p) {
+			// disabled preemption stays disabled
+			if ((p == PARAM_MS_TIMEOUT || p == PARAM_HF_TIMEOUT) && val[p] < 0)
+				continue;
+			if (_hi[p] <= _lo[p])
+				continue;  // fixed parameter
+			dim d = { idx, (param)p };
+			_dims.push_back(d);
+			double x = (val[p] - _lo[p]) / (_hi[p] - _lo[p]);
+			_mean.push_back(std::min(1.0, std::max(0.0, x)));
+		}
+	}
+	_diag.assign(_dims.size(), 1.0);
+	_ps.assign(_dims.size(), 0.0);
+	_pc.assign(_dims.size(), 0.0);
+	_best = _mean;
+	_best_val = _init_val = evaluate(_best);
+	++_nevals;
+}
+
+void pool_optimizer::apply(const std::vector<double> &x,
+			   engine::pool_container_type *pools) const
+{
+	std::vector<pool *> pv;
+	for (engine::pool_container_type::iterator it = pools->begin();
+	     it != pools->end(); ++it)
+		pv.push_back(&*it);
+
+	for (size_t i = 0; i < _dims.size(); ++i) {
+		pool *p = pv[_dims[i].pool];
+		double v = _lo[_dims[i].p] + x[i] * (_hi[_dims[i].p] - _lo[_dims[i].p]);
+		switch (_dims[i].p) {
+		case PARAM_WEIGHT:
+			p->fs_ctx_map.weight = v;
+			p->fs_ctx_reduce.weight = v;
+			break;
+		case PARAM_MAP_MINSHARE:
+			p->fs_ctx_map.minshare = (int)(v + 0.5);
+			break;
+		case PARAM_REDUCE_MINSHARE:
+			p->fs_ctx_reduce.minshare = (int)(v + 0.5);
+			break;
+		case PARAM_MS_TIMEOUT:
+			p->ms_timeout = to_sim_time(v);
+			break;
+		case PARAM_HF_TIMEOUT:
+			p->hf_timeout = to_sim_time(v);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+double pool_optimizer::evaluate(const std::vector<double> &x) const
+{
+	if (_fluid) {
+		engine::pool_container_type pools = _pools;
+		apply(x, &pools);
+		fluid_model(_nmaps, _nreduces).process(&pools);
+		return _obj(pools);
+	}
+	engine eng(_nmaps, _nreduces);
+	eng.set_progress(false);
+	eng.getpools() = _pools;
+	apply(x, &eng.getpools());
+	eng.scale_minshares();
+	eng.process();
+	return _obj(eng.getpools());
+}
+
+double pool_optimizer::initial_value()
+{
+	if (_nevals == 0)
+		init();
+	return _init_val;
+}
+
+double pool_optimizer::step()
+{
+	if (_nevals == 0)
+		init();
+	size_t n = _dims.size();
+	if (n == 0)
+		return _best_val;
+
+	// strategy parameters of sep-CMA-ES
+	int lambda = _popsize > 0? _popsize: 4 + (int)(3 * log((double)n));
+	int mu = lambda / 2;
+	std::vector<double> w(mu);
+	double wsum = 0;
+	for (int i = 0; i < mu; ++i) {
+		w[i] = log(mu + 0.5) - log(i + 1.0);
+		wsum += w[i];
+	}
+	double wsq = 0;
+	for (int i = 0; i < mu; ++i) {
+		w[i] /= wsum;
+		wsq += w[i] * w[i];
+	}
+	double mueff = 1.0 / wsq;
+	double cs = (mueff + 2) / (n + mueff + 5);
+	double ds = 1 + 2 * std::max(0.0, sqrt((mueff - 1) / (n + 1)) - 1) + cs;
+	double cc = 4.0 / (n + 4);
+	double c1 = 2 / ((n + 1.3) * (n + 1.3) + mueff) * (n + 2) / 3;
+	double cmu = std::min(1 - c1, 2 * (mueff - 2 + 1 / mueff) /
+			      ((n + 2) * (n + 2) + mueff) * (n + 2) / 3);
+	double chin = sqrt((double)n) * (1 - 1.0 / (4 * n) + 1.0 / (21.0 * n * n));
+
+	// sample candidates within the bounds
+	std::vector< std::vector<double> > ys(lambda, std::vector<double>(n));
+	std::vector< std::vector<double> > xs(lambda, std::vector<double>(n));
+	for (int k = 0; k < lambda; ++k) {
+		for (size_t i = 0; i < n; ++i) {
+			ys[k][i] = sqrt(_diag[i]) * normal();
+			double x = _mean[i] + _sigma * ys[k][i];
+			xs[k][i] = std::min(1.0, std::max(0.0, x));
+			// the repaired step is used for the update
+			ys[k][i] = (xs[k][i] - _mean[i]) / _sigma;
+		}
+	}
+
+	// simulate the candidates in parallel
+	std::vector<double> vals(lambda);
+	std::vector<eval_worker *> workers;
+	for (int t = 0; t < std::min(_nthreads, lambda); ++t) {
+		workers.push_back(new eval_worker(this, &xs, &vals, t,
+						  std::min(_nthreads, lambda)));
+		if (workers.back()->start())
+			workers.back()->run();  // fall back to the calling thread
+	}
+	for (size_t t = 0; t < workers.size(); ++t)
+		delete workers[t];  // joins the thread
+	_nevals += lambda;
+
+	std::vector<ranked> rank(lambda);
+	for (int k = 0; k < lambda; ++k) {
+		rank[k].val = vals[k];
+		rank[k].idx = k;
+	}
+	std::sort(rank.begin(), rank.end());
+	if (rank[0].val < _best_val) {
+		_best_val = rank[0].val;
+		_best = xs[rank[0].idx];
+	}
+
+	// recombination
+	std::vector<double> yw(n, 0.0);
+	for (int i = 0; i < mu; ++i)
+		for (size_t j = 0; j < n; ++j)
+			yw[j] += w[i] * ys[rank[i].idx][j];
+	for (size_t j = 0; j < n; ++j)
+		_mean[j] = std::min(1.0, std::max(0.0, _mean[j] + _sigma * yw[j]));
+
+	// step-size control
+	double psnorm = 0;
+	for (size_t j = 0; j < n; ++j) {
+		_ps[j] = (1 - cs) * _ps[j] + sqrt(cs * (2 - cs) * mueff) * yw[j] / sqrt(_diag[j]);
+		psnorm += _ps[j] * _ps[j];
+	}
+	psnorm = sqrt(psnorm);
+	++_gen;
+	bool hs = psnorm / sqrt(1 - pow(1 - cs, 2.0 * _gen)) < (1.4 + 2.0 / (n + 1)) * chin;
+	_sigma *= exp(cs / ds * (psnorm / chin - 1));
+	_sigma = std::min(_sigma, 1.0);
+
+	// covariance adaptation
+	for (size_t j = 0; j < n; ++j) {
+		_pc[j] = (1 - cc) * _pc[j] + (hs? sqrt(cc * (2 - cc) * mueff) * yw[j]: 0);
+		double rank_mu = 0;
+		for (int i = 0; i < mu; ++i)
+			rank_mu += w[i] * ys[rank[i].idx][j] * ys[rank[i].idx][j];
+		_diag[j] = (1 - c1 - cmu) * _diag[j] +
+			c1 * (_pc[j] * _pc[j] + (hs? 0: cc * (2 - cc) * _diag[j])) +
+			cmu * rank_mu;
+	}
+
+	return _best_val;
+}
+
+double pool_optimizer::run(int generations)
+{
+	for (int i = 0; i < generations; ++i)
+		step();
+	return _best_val;
+}
+
+void pool_optimizer::apply_best(engine::pool_container_type *pools) const
+{
+	apply(_best, pools);
+}
+
+}
@@ -0,0 +1,211 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_POLICY_H
+#define _COLOSSAL_POLICY_H
+
+#include <vector>
+#include "task.hpp"
+#include "job.hpp"
+#include "pool.hpp"
+#include "fsched.hpp"
+#include "hashable.hpp"
+
+namespace colossal
+{
+
+class ev_create_map;
+class ev_create_reduce;
+class ev_finish_map;
+class ev_finish_reduce;
+
+// Slot types
+// The scheduler is written once for both task types, as templates on
+// a slot type that resolves the fair scheduling contexts and the
+// engine resources of its task type at compile time. The engine and
+// the selector are template parameters of the accessors to avoid
+// circular includes.
+struct map_slot {
+	static const task::task_type type = task::TASK_TYPE_MAP;
+
+	typedef ev_create_map create_event;
+	typedef ev_finish_map finish_event;
+
+	static fs_context &ctx(pool *p) { return p->fs_ctx_map; }
+	static fs_context &ctx(job *j) { return j->fs_ctx_map; }
+	static fs_integral &integ(pool *p) { return p->fs_int_map; }
+	static resource &container(pool *p) { return p->containers[task::TASK_TYPE_MAP]; }
+
+	template<typename E>
+	static typename E::vsem_type *sem(E *eng) { return eng->sem_map; }
+
+	template<typename E>
+	static typename E::taskset_type *running(E *eng) { return eng->running_maps; }
+
+	template<typename E>
+	static void transit_n2s(pool *p, E *eng) { p->map_transit_n2s(eng); }
+	static void transit_s2n(pool *p) { p->map_transit_s2n(); }
+
+	template<typename Sel>
+	static bool has(Sel *sel) { return sel->has_map(); }
+
+	template<typename Sel>
+	static pool *next_pool(Sel *sel) { return sel->next_map_pool(); }
+
+	template<typename Sel>
+	static void add_preempted(Sel *sel, td_ref *t) { sel->add_preempted_map(t); }
+
+	template<typename Sel>
+	static const std::vector<td_ref *> &resumed(Sel *sel) { return sel->resumed_maps(); }
+
+	static const char *name() { return "map"; }
+};
+
+struct reduce_slot {
+	static const task::task_type type = task::TASK_TYPE_REDUCE;
+
+	typedef ev_create_reduce create_event;
+	typedef ev_finish_reduce finish_event;
+
+	static fs_context &ctx(pool *p) { return p->fs_ctx_reduce; }
+	static fs_context &ctx(job *j) { return j->fs_ctx_reduce; }
+	static fs_integral &integ(pool *p) { return p->fs_int_reduce; }
+	static resource &container(pool *p) { return p->containers[task::TASK_TYPE_REDUCE]; }
+
+	template<typename E>
+	static typename E::vsem_type *sem(E *eng) { return eng->sem_reduce; }
+
+	template<typename E>
+	static typename E::taskset_type *running(E *eng) { return eng->running_reduces; }
+
+	template<typename E>
+	static void transit_n2s(pool *p, E *eng) { p->reduce_transit_n2s(eng); }
+	static void transit_s2n(pool *p) { p->reduce_transit_s2n(); }
+
+	template<typename Sel>
+	static bool has(Sel *sel) { return sel->has_reduce(); }
+
+	template<typename Sel>
+	static pool *next_pool(Sel *sel) { return sel->next_reduce_pool(); }
+
+	template<typename Sel>
+	static void add_preempted(Sel *sel, td_ref *t) { sel->add_preempted_reduce(t); }
+
+	template<typename Sel>
+	static const std::vector<td_ref *> &resumed(Sel *sel) { return sel->resumed_reduces(); }
+
+	static const char *name() { return "reduce"; }
+};
+
+// Job ordering policies within a pool
+// Jobs with unmet demand are selected in the order of key(), which
+// must be hashable and comparable, see fs_select. The jobs of an
+// indexed policy keep a heap in the selector by before(), their order
+// changing only through selector::update_job(); the others are
+// scanned on each pop.
+template<typename S>
+struct fair_order {
+	typedef const fs_context &key_type;
+	static const bool indexed = false;
+
+	static key_type key(td_ref *t) { return S::ctx(t->getjob()); }
+};
+
+template<typename S>
+struct fcfs_order {
+	typedef job_ctime_hash key_type;
+	static const bool indexed = false;
+
+	static key_type key(td_ref *t) { return job_ctime_hash(t); }
+};
+
+// Shortest remaining processing time first
+// The remaining work of a job drops as its tasks finish.
+template<typename S>
+struct srpt_order {
+	typedef job_key_hash<job_work_left_key> key_type;
+	static const bool indexed = true;
+
+	static key_type key(td_ref *t) { return key_type(t); }
+	static bool before(const job *a, const job *b) { return key_type::order(a, b) < 0; }
+};
+
+// Shortest job first, by the total work of a job
+template<typename S>
+struct sjf_order {
+	typedef job_key_hash<job_work_key> key_type;
+	static const bool indexed = true;
+
+	static key_type key(td_ref *t) { return key_type(t); }
+	static bool before(const job *a, const job *b) { return key_type::order(a, b) < 0; }
+};
+
+// Earliest deadline first
+template<typename S>
+struct edf_order {
+	typedef job_key_hash<job_deadline_key> key_type;
+	static const bool indexed = true;
+
+	static key_type key(td_ref *t) { return key_type(t); }
+	static bool before(const job *a, const job *b) { return key_type::order(a, b) < 0; }
+};
+
+// Preemption victim policy
+// Running tasks are visited latest started first, and a task may be
+// preempted if its pool runs above its fair share. The pool starved,
+// if any, is given.
+template<typename S>
+struct fair_victim {
+	static const bool indexed = false;
+
+	static bool eligible(td_ref *t, const pool *starved)
+	{
+		(void)starved;
+		const fs_context &ctx = S::ctx(t->getpool());
+		return ctx.alloc > ctx.fairshare;
+	}
+};
+
+// Any running task, used when slots are taken away from the cluster
+template<typename S>
+struct any_victim {
+	static const bool indexed = false;
+
+	static bool eligible(td_ref *t, const pool *starved)
+	{
+		(void)t;
+		(void)starved;
+		return true;
+	}
+};
+
+// Any task of the other pools that run above their min shares
+// The youngest tasks of the cluster are thus preempted, which loses
+// the least work at the expense of pools between their min and fair
+// shares. The running tasks are visited through the start order
+// index of the engine instead of being sorted.
+template<typename S>
+struct min_lost_victim {
+	static const bool indexed = true;
+
+	static bool eligible(td_ref *t, const pool *starved)
+	{
+		const fs_context &ctx = S::ctx(t->getpool());
+		return t->getpool() != starved && ctx.alloc > ctx.minshare;
+	}
+};
+
+}
+
+#endif
@@ -22,10 +22,11 @@
 namespace colossal
 {
 
-pool::pool(const std::string &ns, double mto, double fto,
+pool::pool(const std::string &ns, sim_time mto, sim_time fto,
 	   double weight, int minmap, int minred, sched_mode sc)
 {
 	id = id_from_str(ns.c_str());
+	idx = 0;
 	name = ns;
 	sched = sc;
 	ms_timeout = mto;
@@ -42,6 +43,30 @@ pool::pool(const std::string &ns, double mto, double fto,
 	fs_ctx_reduce.minshare = minred;
 }
 
+static const char *sched_names[] = { "fair", "fcfs", "srpt", "sjf", "edf" };
+
+const char *pool::sched_str(sched_mode sched)
+{
+	if (sched < 0 || sched >= (int)(sizeof(sched_names)/sizeof(sched_names[0])))
+		return "unknown";
+	return sched_names[sched];
+}
+
+int pool::sched_from_str(const char *str, sched_mode *sched)
+{
+	if (strcmp(str, "fifo") == 0) {
+		*sched = SCHED_FCFS;
+		return 0;
+	}
+	for (size_t i = 0; i < sizeof(sched_names)/sizeof(sched_names[0]); ++i) {
+		if (strcmp(str, sched_names[i]) == 0) {
+			*sched = (sched_mode)i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
 job &pool::add_job(const job &j)
 {
 	// demand is set by task creation events
@@ -51,11 +76,16 @@ job &pool::add_job(const job &j)
 
 uint64_t pool::id_from_str(const char *str)
 {
-	return hash_fast64(str, strlen(str), 0xdeedbeeffeedbeefull);
+	return id_from_str(str, strlen(str));
+}
+
+uint64_t pool::id_from_str(const char *str, size_t len)
+{
+	return hash_fast64(str, len, 0xdeedbeeffeedbeefull);
 }
 
 // returns the number of needed slots if starved for minimum share, 0 otherwise
-int pool::starved_for_map_minshare(double now) const
+int pool::starved_for_map_minshare(sim_time now) const
 {
 	if (map_last_at_ms < 0 || now - map_last_at_ms < ms_timeout)
 		return 0;
@@ -69,7 +99,7 @@ int pool::starved_for_map_minshare(double now) const
 	return need;
 }
 
-int pool::starved_for_reduce_minshare(double now) const
+int pool::starved_for_reduce_minshare(sim_time now) const
 {
 	if (reduce_last_at_ms < 0 || now - reduce_last_at_ms < ms_timeout)
 		return 0;
@@ -84,7 +114,7 @@ int pool::starved_for_reduce_minshare(double now) const
 }
 
 // returns the number of needed slots if starved for half fair share, 0 otherwise
-int pool::starved_for_map_halffairshare(double now) const
+int pool::starved_for_map_halffairshare(sim_time now) const
 {
 	if (map_last_at_hf < 0 || now - map_last_at_hf < hf_timeout)
 		return 0;
@@ -97,7 +127,7 @@ int pool::starved_for_map_halffairshare(double now) const
 	return fs_ctx_map.fairshare - fs_ctx_map.alloc;
 }
 
-int pool::starved_for_reduce_halffairshare(double now) const
+int pool::starved_for_reduce_halffairshare(sim_time now) const
 {
 	if (reduce_last_at_hf < 0 || now - reduce_last_at_hf < hf_timeout)
 		return 0;
@@ -200,4 +230,19 @@ void pool::print_metrics(metric met) const
 	met_red["weight"].set_value(fs_ctx_reduce.weight);
 }
 
+void pool::print_integrals(metric met, sim_time len) const
+{
+	metric met_map = met["map"];
+	metric met_red = met["reduce"];
+
+	met_map["avgDemand"].set_value(fs_int_map.demand / len);
+	met_red["avgDemand"].set_value(fs_int_reduce.demand / len);
+	met_map["avgFairShareDeficit"].set_value(fs_int_map.deficit / len);
+	met_red["avgFairShareDeficit"].set_value(fs_int_reduce.deficit / len);
+	met_map["avgRunningTasks"].set_value(fs_int_map.alloc / len);
+	met_red["avgRunningTasks"].set_value(fs_int_reduce.alloc / len);
+	met_map["belowMinShare"].set_value((double)fs_int_map.below_ms / len);
+	met_red["belowMinShare"].set_value((double)fs_int_reduce.below_ms / len);
+}
+
 }
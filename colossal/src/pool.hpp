@@ -27,42 +27,78 @@ namespace colossal
 
 class engine;
 
+// Slot time of the attempts of a pool's tasks of one type
+// An attempt is either preempted, and its slot time is lost, or
+// finishes, and its slot time is useful but for the overhead of its
+// restart, if it was preempted before.
+struct preempt_stats {
+	size_t   preempted;  // attempts preempted
+	sim_time lost;       // slot time of the preempted attempts
+	sim_time overhead;   // restart overhead of the finished attempts
+	sim_time useful;     // slot time of the finished attempts, less overhead
+
+	preempt_stats() : preempted(0), lost(0), overhead(0), useful(0) { }
+
+	// Fraction of the slot time that was useful
+	double efficiency() const
+	{
+		sim_time total = useful + lost + overhead;
+		return total > 0? (double)useful / total: 1.0;
+	}
+};
+
 struct pool
 {
 	typedef std::vector<job> job_container_type;
 
 	enum sched_mode {
 		SCHED_FAIR,
-		SCHED_FCFS
+		SCHED_FCFS,
+		SCHED_SRPT,  // shortest remaining processing time first
+		SCHED_SJF,   // shortest job first
+		SCHED_EDF    // earliest deadline first
 	};
 
         uint64_t id;        // integer unique id, typically a one-to-one mapping to name
+	size_t   idx;       // dense index among the pools, set by the selector
         std::string  name;  // human readable string name
 	sched_mode  sched;  // scheduling mode for jobs in the pool
-        double ms_timeout;  // min share timeout, < 0 to disable
-        double hf_timeout;  // half fair share timeout, < 0 to disable
-        double map_last_at_ms;  // last time seen below min share
-        double map_last_at_hf;  // last time seen below half fair share
-        double reduce_last_at_ms;  // last time seen below min share
-        double reduce_last_at_hf;  // last time seen below half fair share
+        sim_time ms_timeout;  // min share timeout, < 0 to disable
+        sim_time hf_timeout;  // half fair share timeout, < 0 to disable
+        sim_time map_last_at_ms;  // last time seen below min share
+        sim_time map_last_at_hf;  // last time seen below half fair share
+        sim_time reduce_last_at_ms;  // last time seen below min share
+        sim_time reduce_last_at_hf;  // last time seen below half fair share
         fs_context fs_ctx_map;    // fair scheduling context
         fs_context fs_ctx_reduce; // fair schedulign context
+	fs_integral fs_int_map;     // time integrals of fs_ctx_map
+	fs_integral fs_int_reduce;  // time integrals of fs_ctx_reduce
+	resource containers[task::TASK_TYPE_NUM];  // of a task in the container mode,
+	                                           // empty for the default
+	preempt_stats preempts[task::TASK_TYPE_NUM];  // by task::task_type
         job_container_type jobs;    // all jobs records in the pool
 
         // timeout < 0 disables preemption
-        pool(const std::string &ns, double mto, double fto,
+        pool(const std::string &ns, sim_time mto, sim_time fto,
              double weight, int minmap, int minred, sched_mode sched);
 
 	static uint64_t id_from_str(const char *str);
+	static uint64_t id_from_str(const char *str, size_t len);
+
+	// Name of a scheduling mode, and the mode of a name
+	// Names are fair, fcfs (or fifo), srpt, sjf and edf.
+	// sched_from_str() returns 0 on success, -1 otherwise.
+	static const char *sched_str(sched_mode sched);
+	static int sched_from_str(const char *str, sched_mode *sched);
 
 	job &add_job(const job &j);
 
 	// returns the number of needed slots if starved for minimum share, 0 otherwise
-	int starved_for_map_minshare(double now) const;
-	int starved_for_reduce_minshare(double now) const;
+	int starved_for_map_minshare(sim_time now) const;
+	int starved_for_reduce_minshare(sim_time now) const;
 	// returns the number of needed slots if starved for half fair share, 0 otherwise
-	int starved_for_map_halffairshare(double now) const;
-	int starved_for_reduce_halffairshare(double now) const;
+	int starved_for_map_halffairshare(sim_time now) const;
+	int starved_for_reduce_halffairshare(sim_time now) const;
 
 	// transitions from normal to starved
         void map_transit_n2s(engine *eng);
@@ -74,6 +110,9 @@ struct pool
 
 	std::string to_str() const;
 	void print_metrics(metric met) const;
+	// Print the averages of the settled integrals over a period of
+	// length len
+	void print_integrals(metric met, sim_time len) const;
 };
 
 }
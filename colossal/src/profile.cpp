@@ -0,0 +1,108 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstring>
+#include "profile.hpp"
+
+namespace colossal
+{
+
+// each thread, e.g. of the optimizer, profiles its own engine
+static __thread profiler *tls_profiler = NULL;
+
+static const char *prof_names[PROF_NUM] = {
+	"ev_create_map",
+	"ev_create_reduce",
+	"ev_finish_map",
+	"ev_finish_reduce",
+	"ev_preempt_map",
+	"ev_preempt_reduce",
+	"selector::pop_map",
+	"selector::pop_reduce",
+	"compute_fairshares",
+	"preempt_maps",
+	"preempt_reduces",
+	"metrics",
+	"speculate"
+};
+
+void profiler::reset()
+{
+	memset(_count, 0, sizeof(_count));
+	memset(_cycles, 0, sizeof(_cycles));
+	_buckets.clear();
+}
+
+void profiler::sample(sim_time now, size_t events, size_t map_waits, size_t reduce_waits)
+{
+	sim_time t = now - now % _bucket;
+	if (_buckets.empty() || _buckets.back().time != t) {
+		bucket b = { t, 0, 0, 0, 0 };
+		_buckets.push_back(b);
+	}
+	bucket &b = _buckets.back();
+	++b.events;
+	if (events > b.max_events)
+		b.max_events = events;
+	if (map_waits > b.max_map_waits)
+		b.max_map_waits = map_waits;
+	if (reduce_waits > b.max_reduce_waits)
+		b.max_reduce_waits = reduce_waits;
+}
+
+void profiler::report(FILE *fp, uint64_t cycles, double seconds) const
+{
+	double nspc = cycles? seconds * 1e9 / cycles: 0;  // ns per cycle
+
+	fprintf(fp, "%-22s %12s %16s %12s %10s %7s\n",
+		"point", "count", "cycles", "cycles/call", "ms", "%");
+	for (int i = 0; i < PROF_NUM; ++i) {
+		fprintf(fp, "%-22s %12llu %16llu %12.1f %10.3f %6.2f%%\n",
+			prof_names[i], (unsigned long long)_count[i],
+			(unsigned long long)_cycles[i],
+			_count[i]? (double)_cycles[i] / _count[i]: 0.0,
+			_cycles[i] * nspc / 1e6,
+			cycles? 100.0 * _cycles[i] / cycles: 0.0);
+	}
+	fprintf(fp, "%-22s %12s %16llu %12s %10.3f %6.2f%%\n",
+		"total", "", (unsigned long long)cycles, "", seconds * 1e3, 100.0);
+}
+
+void profiler::trace(FILE *fp) const
+{
+	fprintf(fp, "time\tevents\tmax_events\tmax_map_waits\tmax_reduce_waits\n");
+	for (std::vector<bucket>::const_iterator it = _buckets.begin();
+	     it != _buckets.end(); ++it)
+		fprintf(fp, "%lld\t%llu\t%lu\t%lu\t%lu\n", (long long)it->time,
+			(unsigned long long)it->events, (unsigned long)it->max_events,
+			(unsigned long)it->max_map_waits,
+			(unsigned long)it->max_reduce_waits);
+}
+
+profiler *profiler::current()
+{
+	return tls_profiler;
+}
+
+void profiler::set_current(profiler *prof)
+{
+	tls_profiler = prof;
+}
+
+const char *profiler::name(prof_point pt)
+{
+	return prof_names[pt];
+}
+
+}
@@ -0,0 +1,102 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_RESOURCE_H
+#define _COLOSSAL_RESOURCE_H
+
+#include <algorithm>
+
+namespace colossal
+{
+
+// Vector of cluster resources, used by the container mode
+// A task of the container mode holds a container of some memory and
+// vcores instead of a slot, and the cluster has a capacity of each.
+struct resource {
+	enum resource_type {
+		RESOURCE_MEMORY = 0,  // in MB
+		RESOURCE_VCORES,
+		RESOURCE_NUM
+	};
+
+	double v[RESOURCE_NUM];
+
+	resource()
+	{
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			v[i] = 0;
+	}
+
+	resource(double mem, double vcores)
+	{
+		v[RESOURCE_MEMORY] = mem;
+		v[RESOURCE_VCORES] = vcores;
+	}
+
+	double &operator[](int i) { return v[i]; }
+	double  operator[](int i) const { return v[i]; }
+
+	resource &operator+=(const resource &other)
+	{
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			v[i] += other.v[i];
+		return *this;
+	}
+
+	resource &operator-=(const resource &other)
+	{
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			v[i] -= other.v[i];
+		return *this;
+	}
+
+	resource operator*(double n) const
+	{
+		resource r;
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			r.v[i] = v[i] * n;
+		return r;
+	}
+
+	// Whether each amount is at most that of other
+	bool fits(const resource &other) const
+	{
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			if (v[i] > other.v[i])
+				return false;
+		return true;
+	}
+
+	bool empty() const
+	{
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			if (v[i] > 0)
+				return false;
+		return true;
+	}
+
+	// The largest share of the capacity, that of the dominant resource
+	double dominant(const resource &capacity) const
+	{
+		double d = 0;
+		for (int i = 0; i < RESOURCE_NUM; ++i)
+			if (capacity.v[i] > 0)
+				d = std::max(d, v[i] / capacity.v[i]);
+		return d;
+	}
+};
+
+}
+
+#endif
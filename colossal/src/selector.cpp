@@ -12,421 +12,614 @@
  * binding.
  */
 
+
 #include <cstdio>
+#include <cmath>
+#include <algorithm>
 #include <ulib/util_log.h>
 #include "fsched.hpp"
+#include "profile.hpp"
 #include "selector.hpp"
 
 namespace colossal {
 
-selector::selector(const pool_itr_type &pb, const pool_itr_type &pe)
-	: _pb(pb), _pe(pe), _maps_popped(0), _reduces_popped(0)
+// Running tasks are seen and popped already
+static inline bool running(const job::task_container_type &tasks, size_t k, bool resume)
+{
+	return resume && tasks.stime(k) >= 0 && tasks.ftime(k) < 0;
+}
+
+// Task indices of a job in the order of creation time
+struct ctime_order {
+	const job::task_container_type *tasks;
+
+	ctime_order(const job::task_container_type *t) : tasks(t) { }
+
+	bool operator()(uint32_t a, uint32_t b) const
+	{
+		return tasks->ctime(a) < tasks->ctime(b);
+	}
+};
+
+selector::selector(const pool_itr_type &pb, const pool_itr_type &pe, bool resume,
+		   double slowstart)
+	: _pb(pb), _pe(pe), _seq(0), _capacity(NULL)
 {
+	static const task::task_type types[] = { task::TASK_TYPE_MAP, task::TASK_TYPE_REDUCE };
+
+	for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt) {
+		_popped[tt] = 0;
+		_seen[tt] = 0;
+		_unseen[tt] = 0;
+	}
+	// dense indices of the pools and of the jobs in each pool, jobs
+	// taking their sequence numbers in the same order
+	size_t npools = 0;
 	for (pool_itr_type pit = pb; pit != pe; ++pit) {
+		pit->idx = npools++;
+		for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt) {
+			pool_queue pq;
+			pq.p = &*pit;
+			pq.pos = -1;
+			pq.seq = _seq;
+			_tasks[tt].push_back(pq);
+			_tasks[tt].back().q.jobs.resize(pit->jobs.size());
+		}
 		for (pool::job_container_type::iterator jit = pit->jobs.begin();
 		     jit != pit->jobs.end(); ++jit) {
-			for (job::task_container_type::iterator tit = jit->tasks[task::TASK_TYPE_MAP].begin();
-			     tit != jit->tasks[task::TASK_TYPE_MAP].end(); ++tit) {
-				task_desc *td = new task_desc(&*tit, &*jit, &*pit);
-				td_ref *p = new td_ref(td);
-				_map_refs.push_back(p);
-			}
-			for (job::task_container_type::iterator tit = jit->tasks[task::TASK_TYPE_REDUCE].begin();
-			     tit != jit->tasks[task::TASK_TYPE_REDUCE].end(); ++tit) {
-				task_desc *td = new task_desc(&*tit, &*jit, &*pit);
-				td_ref *p  = new td_ref(td);
-				_reduce_refs.push_back(p);
+			jit->idx = jit - pit->jobs.begin();
+			bool hold = slowstart >= 0 && slowstart_maps(*jit, slowstart, resume) > 0;
+			// the work of size-based policies
+			jit->work = 0;
+			for (size_t i = 0; i < sizeof(types)/sizeof(types[0]); ++i) {
+				task::task_type tt = types[i];
+				pool_queue &pq = _tasks[tt][pit->idx];
+				job_queue &jq = pq.q.jobs[jit->idx];
+				job::task_container_type &tasks = jit->tasks[tt];
+				bool ordered = true;
+				for (size_t k = 0; k < tasks.size(); ++k) {
+					jit->work += tasks.ptime(k);
+					if (running(tasks, k, resume)) {
+						td_ref *p = make_ref(new td_ref(new task_desc(&*jit, &*pit, tt, k)));
+						p->set_flag(task::TASK_FLAG_POPPED);
+						_resumed[tt].push_back(p);
+						++_seen[tt];
+						++_popped[tt];
+						ordered = false;
+					} else {
+						if (jq.end && tasks.ctime(k) < tasks.ctime(k - 1))
+							ordered = false;
+						++jq.end;
+					}
+				}
+				if (!ordered) {
+					jq.order.reserve(jq.end);
+					for (size_t k = 0; k < tasks.size(); ++k)
+						if (!running(tasks, k, resume))
+							jq.order.push_back(k);
+					std::stable_sort(jq.order.begin(), jq.order.end(), ctime_order(&tasks));
+				}
+				if (hold && tt == task::TASK_TYPE_REDUCE)
+					jq.held = true;
+				else {
+					add_pending(pq, &*jit, tt);
+					_unseen[tt] += jq.end;
+				}
 			}
+			jit->work_left = jit->work;
 		}
+		_seq += pit->jobs.size();
 	}
-	heap_init_inclass(&*_map_refs.begin(), &*_map_refs.end());
-	heap_init_inclass(&*_reduce_refs.begin(), &*_reduce_refs.end());
+	for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt)
+		heap_init_pending(&*_pending[tt].begin(), &*_pending[tt].end());
 }
 
-void selector::add_preempted_map(td_ref *ref)
+// Add the entry of the next unseen task of a job, if any, to the back
+// of the unseen tasks; the caller keeps the heap
+void selector::add_pending(pool_queue &pq, job *j, task::task_type type)
 {
-	// deep copy to avoid double-free
-	td_ref *p = new td_ref(*ref);
-
-	_map_refs.push_back(p);
-	heap_push_inclass(&*_map_refs.begin(), _map_refs.size() - 1, 0, p);
+	job_queue &jq = pq.q.jobs[j->idx];
+	if (jq.next == jq.end)
+		return;
+	pending_task e = {
+		j, pq.p, NULL, j->tasks[type].ctime(jq.task(jq.next)), pq.seq + j->idx
+	};
+	_pending[type].push_back(e);
 }
 
-void selector::add_preempted_reduce(td_ref *ref)
+td_ref *selector::make_ref(td_ref *ref)
 {
-	// deep copy to avoid double-free
-	td_ref *p = new td_ref(*ref);
+	_owned.insert((uint64_t)(uintptr_t)ref);
+	return ref;
+}
 
-	_reduce_refs.push_back(p);
-	heap_push_inclass(&*_reduce_refs.begin(), _reduce_refs.size() - 1, 0, p);
+void selector::release(td_ref *ref)
+{
+	ulib::open_hash_set<uint64_t>::iterator it = _owned.find((uint64_t)(uintptr_t)ref);
+	if (it == _owned.end()) {
+		ULIB_WARNING("releasing a task ref not held");
+		return;
+	}
+	_owned.erase(it);
+	delete ref;
 }
 
-selector::~selector()
+// the ref of the next task of a job
+td_ref *selector::front(pool_queue &pq, size_t jidx, task::task_type type)
 {
-	// free remaining refs
-	for (p2j_type::iterator pit = _map_tasks.begin();
-	     pit != _map_tasks.end(); ++pit) {
-		// visit each job in the job hash map
-		for (j2t_type::iterator jit = pit.value()->begin();
-		     jit != pit.value()->end(); ++jit) {
-			// free the task list, task refs will be freed later
-			delete jit.value();
+	job_queue &jq = pq.q.jobs[jidx];
+	if (jq.front == NULL) {
+		if (jq.preempted_first())
+			jq.front = jq.preempted[jq.phead].ref;
+		else {
+			job *j = &pq.p->jobs[jidx];
+			jq.front = make_ref(new td_ref(new task_desc(j, pq.p, type, jq.task(jq.head))));
 		}
-		// free job hash map
-		delete pit.value();
 	}
-	for (p2j_type::iterator pit = _reduce_tasks.begin();
-	     pit != _reduce_tasks.end(); ++pit) {
-		for (j2t_type::iterator jit = pit.value()->begin();
-		     jit != pit.value()->end(); ++jit)
-			delete jit.value();
-		delete pit.value();
+	return jq.front;
+}
+
+int selector::slowstart_maps(const job &j, double slowstart, bool resume)
+{
+	const job::task_container_type &maps = j.tasks[task::TASK_TYPE_MAP];
+	int need = (int)ceil(std::min(slowstart, 1.0) * maps.size());
+	if (resume) {
+		for (size_t k = 0; k < maps.size() && need > 0; ++k)
+			if (maps.ftime(k) >= 0)
+				--need;
 	}
-	// free task refs
-	for (std::vector<td_ref *>::iterator it = _map_refs.begin();
-	     it != _map_refs.end(); ++it)
-		delete *it;
-	for (std::vector<td_ref *>::iterator it = _reduce_refs.begin();
-	     it != _reduce_refs.end(); ++it)
-		delete *it;
-	for (std::vector<td_ref *>::iterator it = _seen_maps.begin();
-	     it != _seen_maps.end(); ++it)
-		delete *it;
-	for (std::vector<td_ref *>::iterator it = _seen_reduces.begin();
-	     it != _seen_reduces.end(); ++it)
-		delete *it;
+	return need;
 }
 
-void selector::dump_seen_task_tree() const
+size_t selector::release_reduces(td_ref *ref)
 {
-	printf("[Begin dumping seen task tree]\n");
-	printf("[MAP] %llu pools\n", _map_tasks.size());
-	for (p2j_type::const_iterator pit = _map_tasks.begin();
-	     pit != _map_tasks.end(); ++pit) {
-		printf("    [POOL] %s has seen %llu jobs, A/D=%d/%d\n",
-		       pit.key().ptr->getpool()->name.c_str(), pit.value()->size(),
-		       pit.key().ptr->getpool()->fs_ctx_map.alloc,
-		       pit.key().ptr->getpool()->fs_ctx_map.demand);
-		// visit each job in the job hash map
-		for (j2t_type::const_iterator jit = pit.value()->begin();
-		     jit != pit.value()->end(); ++jit) {
-			printf("        [JOB] %016llx has %lu tasks, A/D=%d/%d\n",
-			       jit.key().ptr->getjob()->id, jit.value()->size(),
-			       jit.key().ptr->getjob()->fs_ctx_map.alloc,
-			       jit.key().ptr->getjob()->fs_ctx_map.demand);
-		}
+	pool_queue &pq = _tasks[task::TASK_TYPE_REDUCE][ref->getpool()->idx];
+	job_queue &jq = pq.q.jobs[ref->getjob()->idx];
+	if (!jq.held)
+		return 0;
+	jq.held = false;
+	std::vector<pending_task> &pending = _pending[task::TASK_TYPE_REDUCE];
+	size_t n = jq.end - jq.next;
+	if (n) {
+		add_pending(pq, ref->getjob(), task::TASK_TYPE_REDUCE);
+		heap_push_pending(&*pending.begin(), pending.size() - 1, 0, pending.back());
 	}
-	printf("[REDUCE] %llu pools\n", _reduce_tasks.size());
-	for (p2j_type::const_iterator pit = _reduce_tasks.begin();
-	     pit != _reduce_tasks.end(); ++pit) {
+	_unseen[task::TASK_TYPE_REDUCE] += n;
+	return n;
+}
+
+template<typename S>
+void selector::add_preempted(td_ref *ref)
+{
+	// deep copy to avoid double-free
+	pending_task e = {
+		ref->getjob(), ref->getpool(), make_ref(new td_ref(*ref)), ref->ctime(), _seq++
+	};
+
+	std::vector<pending_task> &pending = _pending[S::type];
+	pending.push_back(e);
+	heap_push_pending(&*pending.begin(), pending.size() - 1, 0, e);
+	++_unseen[S::type];
+}
+
+void selector::add_preempted_map(td_ref *ref)
+{
+	add_preempted<map_slot>(ref);
+}
+
+void selector::add_preempted_reduce(td_ref *ref)
+{
+	add_preempted<reduce_slot>(ref);
+}
+
+selector::~selector()
+{
+	// the refs of preempted tasks are among those made
+	for (ulib::open_hash_set<uint64_t>::iterator it = _owned.begin(); it != _owned.end(); ++it)
+		delete (td_ref *)(uintptr_t)it.key();
+}
+
+template<typename S>
+void selector::dump_seen(const char *label) const
+{
+	const std::vector<pool_queue> &tasks = _tasks[S::type];
+	const std::vector<size_t> &active = _active[S::type];
+
+	printf("[%s] %llu pools\n", label, (unsigned long long)active.size());
+	for (size_t i = 0; i < active.size(); ++i) {
+		const pool_queue &pq = tasks[active[i]];
 		printf("    [POOL] %s has seen %llu jobs, A/D=%d/%d\n",
-		       pit.key().ptr->getpool()->name.c_str(), pit.value()->size(),
-		       pit.key().ptr->getpool()->fs_ctx_reduce.alloc,
-		       pit.key().ptr->getpool()->fs_ctx_reduce.demand);
-		for (j2t_type::const_iterator jit = pit.value()->begin();
-		     jit != pit.value()->end(); ++jit) {
+		       pq.p->name.c_str(), (unsigned long long)pq.q.active.size(),
+		       S::ctx(pq.p).alloc, S::ctx(pq.p).demand);
+		for (size_t k = 0; k < pq.q.active.size(); ++k) {
+			job &j = pq.p->jobs[pq.q.active[k]];
+			const job_queue &jq = pq.q.jobs[pq.q.active[k]];
+			unsigned long n = (jq.next - jq.head) + (jq.preempted.size() - jq.phead);
 			printf("        [JOB] %016llx has %lu tasks, A/D=%d/%d\n",
-			       jit.key().ptr->getjob()->id, jit.value()->size(),
-			       jit.key().ptr->getjob()->fs_ctx_reduce.alloc,
-			       jit.key().ptr->getjob()->fs_ctx_reduce.demand);
+			       (unsigned long long)j.id, n, S::ctx(&j).alloc, S::ctx(&j).demand);
 		}
 	}
+}
+
+void selector::dump_seen_task_tree() const
+{
+	printf("[Begin dumping seen task tree]\n");
+	dump_seen<map_slot>("MAP");
+	dump_seen<reduce_slot>("REDUCE");
 	printf("[End dumping seen task tree]\n");
 }
 
-double selector::map_min_ctime() const
+template<typename S>
+sim_time selector::min_ctime() const
 {
-	if (_maps_popped == _seen_maps.size()) {
-		if (!_map_refs.size())
-			return -1; // no more maps
-		return (*_map_refs.begin())->gettask()->ctime;
+	if (_popped[S::type] == _seen[S::type]) {
+		if (!_unseen[S::type])
+			return -1; // no more tasks
+		return _pending[S::type].begin()->ctime;
 	}
-	// search for buffered tasks with the minimum ctime
-	for (std::vector<td_ref *>::const_iterator it = _seen_maps.begin();
-	     it != _seen_maps.end(); ++it) {
-		if (!(*it)->test_flag(task::TASK_FLAG_POPPED))
-			return (*it)->gettask()->ctime;
+	// search the seen tasks for the minimum ctime, the first queued
+	// one of a job being the earliest
+	const std::vector<pool_queue> &tasks = _tasks[S::type];
+	const std::vector<size_t> &active = _active[S::type];
+	sim_time ret = -1;
+	for (size_t i = 0; i < active.size(); ++i) {
+		const pool_queue &pq = tasks[active[i]];
+		for (size_t k = 0; k < pq.q.active.size(); ++k) {
+			const job_queue &jq = pq.q.jobs[pq.q.active[k]];
+			if (jq.head < jq.next) {
+				const job &j = pq.p->jobs[pq.q.active[k]];
+				sim_time ctime = j.tasks[S::type].ctime(jq.task(jq.head));
+				if (ret < 0 || ctime < ret)
+					ret = ctime;
+			}
+			for (size_t m = jq.phead; m < jq.preempted.size(); ++m) {
+				sim_time ctime = jq.preempted[m].ref->ctime();
+				if (ret < 0 || ctime < ret)
+					ret = ctime;
+			}
+		}
 	}
-	ULIB_FATAL("unexpected all popped tasks");
-	return -1;
+	if (ret < 0)
+		ULIB_FATAL("unexpected all popped tasks");
+	return ret;
 }
 
-double selector::reduce_min_ctime() const
+sim_time selector::map_min_ctime() const
 {
-	if (_reduces_popped == _seen_reduces.size()) {
-		if (!_reduce_refs.size())
-			return -1; // no more reduces
-		return (*_reduce_refs.begin())->gettask()->ctime;
-	}
-	// search for buffered tasks with the minimum ctime
-	for (std::vector<td_ref *>::const_iterator it = _seen_reduces.begin();
-	     it != _seen_reduces.end(); ++it) {
-		if (!(*it)->test_flag(task::TASK_FLAG_POPPED))
-			return (*it)->gettask()->ctime;
-	}
-	ULIB_FATAL("unexpected all popped tasks");
-	return -1;
+	return min_ctime<map_slot>();
 }
 
-void selector::see_maps(double now, changes_type *changes)
+sim_time selector::reduce_min_ctime() const
 {
+	return min_ctime<reduce_slot>();
+}
+
+template<typename S>
+void selector::see(sim_time now, changes_type *changes)
+{
+	std::vector<pending_task> &pending = _pending[S::type];
+
 	// move emerged (ctime <= now) tasks to task tree
-	while (_map_refs.size() &&
-	       (*_map_refs.begin())->gettask()->ctime <= now) {  // just seen top
-		td_ref *top = *_map_refs.begin();
-		heap_pop_to_rear_inclass(&*_map_refs.begin(), &*_map_refs.end());
-		_map_refs.pop_back();
-		_seen_maps.push_back(top);
-		// find or create the pool-to-job mapping
-		p2j_type::iterator pit = _map_tasks.find(top);
-		if (pit == _map_tasks.end()) {
-			j2t_type *jm = new j2t_type;
-			pit = _map_tasks.insert(top, jm);
+	while (pending.size() && pending.begin()->ctime <= now) {  // just seen top
+		pending_task top = *pending.begin();
+		heap_pop_to_rear_pending(&*pending.begin(), &*pending.end());
+		pending.pop_back();
+		pool_queue &pq = _tasks[S::type][top.p->idx];
+		size_t jidx = top.j->idx;
+		job_queue &jq = pq.q.jobs[jidx];
+		uint32_t n = 1;
+		if (top.ref) {
+			preempted_task pt = { top.ref, jq.next };
+			jq.preempted.push_back(pt);
+		} else {
+			// the tasks of the job created at the time, the entry
+			// moving on to the next one
+			const job::task_container_type &jt = top.j->tasks[S::type];
+			uint32_t k = jq.next + 1;
+			while (k < jq.end && jt.ctime(jq.task(k)) == top.ctime)
+				++k;
+			n = k - jq.next;
+			jq.next = k;
+			if (k < jq.end) {
+				top.ctime = jt.ctime(jq.task(k));
+				pending.push_back(top);
+				heap_push_pending(&*pending.begin(), pending.size() - 1, 0, top);
+			}
 		}
-		// find or create the job-to-task mapping
-		j2t_type::iterator jit = pit.value()->find(top);
-		if (jit == pit.value()->end()) {
-			std::queue<td_ref *> *pl = new std::queue<td_ref *>;
-			jit = pit.value()->insert(top, pl);
+		_unseen[S::type] -= n;
+		_seen[S::type] += n;
+		// activate the job and pool
+		if (jq.pos < 0)
+			activate_job(pq, jidx);
+		if (pq.pos < 0) {
+			pq.pos = _active[S::type].size();
+			_active[S::type].push_back(top.p->idx);
 		}
-		jit.value()->push(top);
 		if (changes)
-			changes->insert(top);
-		++top->getpool()->fs_ctx_map.demand;
-		++top->getjob()->fs_ctx_map.demand;
+			changes->insert(top.p);
+		S::ctx(top.p).demand += n;
+		S::ctx(top.j).demand += n;
 	}
 }
 
-td_ref * selector::job_select_map_fs(pool_map_fs_itr pchosen)
+void selector::see_maps(sim_time now, changes_type *changes)
 {
-	job_map_fs_itr jbegin(pchosen.itr.value()->begin());
-	job_map_fs_itr jend(pchosen.itr.value()->end());
-	fs_select<job_map_fs_itr> jfs(jbegin, jend);
-	job_map_fs_itr jchosen = jfs();
-	if (jchosen == jend) {
-		ULIB_FATAL("should have chosen from a non-empty job");
-		return NULL;
-	}
-
-	td_ref *ret = jchosen.itr.value()->front();
-	jchosen.itr.value()->pop();
-
-	// remove inactive job
-	job *j = jchosen.itr.key().ptr->getjob();
-	if (j->fs_ctx_map.alloc == j->fs_ctx_map.demand) {
-		if (jchosen.itr.value()->size())
-			ULIB_FATAL("task set is non-empty while removing the job");
-		delete jchosen.itr.value();
-		// the job set will be freed if its belonging pool is inactive
-		pchosen.itr.value()->erase(jchosen.itr);
-	}
-
-	return ret;
+	see<map_slot>(now, changes);
 }
 
-td_ref * selector::job_select_map_fcfs(pool_map_fs_itr pchosen)
+void selector::see_reduces(sim_time now, changes_type *changes)
 {
-	job_map_fcfs_itr jbegin(pchosen.itr.value()->begin());
-	job_map_fcfs_itr jend(pchosen.itr.value()->end());
-	fs_select<job_map_fcfs_itr> jfs(jbegin, jend);
-	job_map_fcfs_itr jchosen = jfs();
-	if (jchosen == jend) {
-		ULIB_FATAL("should have chosen from a non-empty job");
-		return NULL;
-	}
-
-	td_ref *ret = jchosen.itr.value()->front();
-	jchosen.itr.value()->pop();
-
-	// remove inactive job
-	job *j = jchosen.itr.key().ptr->getjob();
-	if (j->fs_ctx_map.alloc == j->fs_ctx_map.demand) {
-		if (jchosen.itr.value()->size())
-			ULIB_FATAL("task set is non-empty while removing the job");
-		delete jchosen.itr.value();
-		// the job set will be freed if its belonging pool is inactive
-		pchosen.itr.value()->erase(jchosen.itr);
-	}
-
-	return ret;
+	see<reduce_slot>(now, changes);
 }
 
-// pop out a map/reduce task
-td_ref *selector::pop_map()
+// Remove the entry at pos of a list of active indices, moving the last
+// one into its place
+template<typename Q>
+static inline void deactivate(std::vector<size_t> &active, std::vector<Q> &entries, int pos)
 {
-	if (_maps_popped == _seen_maps.size()) {
-		ULIB_DEBUG("haven't seen a new task");
-		return NULL;
-	}
+	size_t last = active.back();
+	active[pos] = last;
+	entries[last].pos = pos;
+	active.pop_back();
+}
 
-	pool_map_fs_itr pbegin(_map_tasks.begin());
-	pool_map_fs_itr pend(_map_tasks.end());
-	fs_select<pool_map_fs_itr> pfs(pbegin, pend);
-	pool_map_fs_itr pchosen = pfs();
-	if (pchosen == pend) {
-		ULIB_FATAL("should have chosen a task");
-		return NULL;
+// Move the active job at pos of a pool to its place in the heap of
+// the order O
+template<typename O>
+void selector::sift(pool_queue &pq, size_t pos)
+{
+	std::vector<size_t> &active = pq.q.active;
+	pool::job_container_type &jobs = pq.p->jobs;
+	size_t jidx = active[pos];
+	const job *j = &jobs[jidx];
+	// up
+	while (pos > 0) {
+		size_t up = (pos - 1) / 2;
+		if (!O::before(j, &jobs[active[up]]))
+			break;
+		active[pos] = active[up];
+		pq.q.jobs[active[pos]].pos = pos;
+		pos = up;
 	}
-
-	pool *p = pchosen.itr.key().ptr->getpool();
-	td_ref *ret;
-	if (p->sched == pool::SCHED_FAIR)
-		ret = job_select_map_fs(pchosen);
-	else if (p->sched == pool::SCHED_FCFS)
-		ret = job_select_map_fcfs(pchosen);
-	else {
-		ULIB_FATAL("unrecognized sched mode:%d for pool %s", p->sched, p->name.c_str());
-		return NULL;
+	// down
+	for (;;) {
+		size_t down = pos * 2 + 1;
+		if (down >= active.size())
+			break;
+		if (down + 1 < active.size() &&
+		    O::before(&jobs[active[down + 1]], &jobs[active[down]]))
+			++down;
+		if (!O::before(&jobs[active[down]], j))
+			break;
+		active[pos] = active[down];
+		pq.q.jobs[active[pos]].pos = pos;
+		pos = down;
 	}
+	active[pos] = jidx;
+	pq.q.jobs[jidx].pos = pos;
+}
 
-	// mark the task as 'popped'
-	ret->set_flag(task::TASK_FLAG_POPPED);
-	++_maps_popped;
-
-	// remove inactive pool
-	if (p->fs_ctx_map.alloc == p->fs_ctx_map.demand) {
-		if (pchosen.itr.value()->size())
-			ULIB_FATAL("job set is non-empty while removing the pool");
-		delete pchosen.itr.value();
-		_map_tasks.erase(pchosen.itr);
+// Restore the order of the active jobs of a pool about pos, if kept
+void selector::reorder(pool_queue &pq, size_t pos)
+{
+	// the slot type does not matter to the order of jobs
+	switch (pq.p->sched) {
+	case pool::SCHED_SRPT:
+		sift< srpt_order<map_slot> >(pq, pos);
+		break;
+	case pool::SCHED_SJF:
+		sift< sjf_order<map_slot> >(pq, pos);
+		break;
+	case pool::SCHED_EDF:
+		sift< edf_order<map_slot> >(pq, pos);
+		break;
+	default:
+		break;
 	}
+}
 
-	return ret;
+void selector::activate_job(pool_queue &pq, size_t jidx)
+{
+	job_queue &jq = pq.q.jobs[jidx];
+	jq.pos = pq.q.active.size();
+	pq.q.active.push_back(jidx);
+	reorder(pq, jq.pos);
 }
 
-td_ref *selector::pop_map(double now)
+void selector::deactivate_job(pool_queue &pq, job_queue &jq)
 {
-	see_maps(now);
-	return pop_map();
+	size_t pos = jq.pos;
+	deactivate(pq.q.active, pq.q.jobs, pos);
+	jq.pos = -1;
+	if (pos < pq.q.active.size())
+		reorder(pq, pos);
 }
 
-void selector::see_reduces(double now, changes_type *changes)
+void selector::update_job(pool *p, job *j)
 {
-	// move emerged (ctime <= now) tasks to task tree
-	while (_reduce_refs.size() &&
-	       (*_reduce_refs.begin())->gettask()->ctime <= now) {  // just seen top
-		td_ref *top = *_reduce_refs.begin();
-		heap_pop_to_rear_inclass(&*_reduce_refs.begin(), &*_reduce_refs.end());
-		_reduce_refs.pop_back();
-		_seen_reduces.push_back(top);
-		// find or create the pool-to-job mapping
-		p2j_type::iterator pit = _reduce_tasks.find(top);
-		if (pit == _reduce_tasks.end()) {
-			j2t_type *jm = new j2t_type;
-			pit = _reduce_tasks.insert(top, jm);
-		}
-		// find or create the job-to-task mapping
-		j2t_type::iterator jit = pit.value()->find(top);
-		if (jit == pit.value()->end()) {
-			std::queue<td_ref *> *pl = new std::queue<td_ref *>;
-			jit = pit.value()->insert(top, pl);
-		}
-		jit.value()->push(top);
-		if (changes)
-			changes->insert(top);
-		++top->getpool()->fs_ctx_reduce.demand;
-		++top->getjob()->fs_ctx_reduce.demand;
+	for (int tt = 0; tt < task::TASK_TYPE_NUM; ++tt) {
+		pool_queue &pq = _tasks[tt][p->idx];
+		int pos = pq.q.jobs[j->idx].pos;
+		if (pos >= 0)
+			reorder(pq, pos);
 	}
 }
 
-td_ref * selector::job_select_reduce_fs(pool_reduce_fs_itr pchosen)
+// select a job of the chosen pool in the order of the policy O, and
+// pop out its next task
+// The job is the first in the order among those whose demand is not
+// met, as fs_select would choose, and its allocation is incremented.
+// The jobs of an indexed policy are at the top of their heap, the
+// others are scanned.
+template<typename S, typename O>
+td_ref *selector::job_select(pool_queue &pq)
 {
-	job_reduce_fs_itr jbegin(pchosen.itr.value()->begin());
-	job_reduce_fs_itr jend(pchosen.itr.value()->end());
-	fs_select<job_reduce_fs_itr> jfs(jbegin, jend);
-	job_reduce_fs_itr jchosen = jfs();
-	if (jchosen == jend) {
+	job_queues &jobs = pq.q;
+	int best = -1;
+	if (O::indexed) {
+		if (jobs.active.size())
+			best = jobs.active[0];
+	} else {
+		td_ref *bref = NULL;
+		for (size_t i = 0; i < jobs.active.size(); ++i) {
+			td_ref *ref = front(pq, jobs.active[i], S::type);
+			const fs_context &ctx = S::ctx(ref->getjob());
+			if (ctx.demand == ctx.alloc)
+				continue;
+			if (best < 0 || O::key(bref) > O::key(ref)) {
+				best = jobs.active[i];
+				bref = ref;
+			}
+		}
+	}
+	if (best < 0) {
 		ULIB_FATAL("should have chosen from a non-empty job");
 		return NULL;
 	}
 
-	td_ref *ret = jchosen.itr.value()->front();
-	jchosen.itr.value()->pop();
+	job_queue &jq = jobs.jobs[best];
+	fs_context &jctx = S::ctx(&pq.p->jobs[best]);
+	if (jctx.demand == jctx.alloc)
+		ULIB_FATAL("active job has no unmet demand");
+	++jctx.alloc;
+	td_ref *ret = front(pq, best, S::type);
+	jq.front = NULL;
+	if (jq.preempted_first()) {
+		if (++jq.phead == jq.preempted.size()) {
+			jq.preempted.clear();
+			jq.phead = 0;
+		}
+	} else
+		++jq.head;
 
 	// remove inactive job
-	job *j = jchosen.itr.key().ptr->getjob();
-	if (j->fs_ctx_reduce.alloc == j->fs_ctx_reduce.demand) {
-		if (jchosen.itr.value()->size())
+	if (jctx.alloc == jctx.demand) {
+		if (!jq.empty())
 			ULIB_FATAL("task set is non-empty while removing the job");
-		delete jchosen.itr.value();
-		// the job set will be freed if its belonging pool is inactive
-		pchosen.itr.value()->erase(jchosen.itr);
+		deactivate_job(pq, jq);
 	}
 
 	return ret;
 }
 
-td_ref * selector::job_select_reduce_fcfs(pool_reduce_fs_itr pchosen)
+// the neediest pool with seen tasks, as fs_select would choose, or
+// by DRF in the container mode
+template<typename S>
+selector::pool_queue *selector::neediest()
 {
-	job_reduce_fcfs_itr jbegin(pchosen.itr.value()->begin());
-	job_reduce_fcfs_itr jend(pchosen.itr.value()->end());
-	fs_select<job_reduce_fcfs_itr> jfs(jbegin, jend);
-	job_reduce_fcfs_itr jchosen = jfs();
-	if (jchosen == jend) {
-		ULIB_FATAL("should have chosen from a non-empty job");
-		return NULL;
+	std::vector<pool_queue> &tasks = _tasks[S::type];
+	std::vector<size_t> &active = _active[S::type];
+	pool_queue *pq = NULL;
+	double pd = 0;
+	for (size_t i = 0; i < active.size(); ++i) {
+		pool_queue *q = &tasks[active[i]];
+		const fs_context &ctx = S::ctx(q->p);
+		if (ctx.demand == ctx.alloc)
+			continue;
+		if (_capacity) {
+			double d = S::container(q->p).dominant(*_capacity);
+			if (pq == NULL || fs_context::compare(S::ctx(pq->p), pd, ctx, d) > 0) {
+				pq = q;
+				pd = d;
+			}
+		} else if (pq == NULL || S::ctx(pq->p) > ctx)
+			pq = q;
 	}
+	return pq;
+}
 
-	td_ref *ret = jchosen.itr.value()->front();
-	jchosen.itr.value()->pop();
-
-	// remove inactive job
-	job *j = jchosen.itr.key().ptr->getjob();
-	if (j->fs_ctx_reduce.alloc == j->fs_ctx_reduce.demand) {
-		if (jchosen.itr.value()->size())
-			ULIB_FATAL("task set is non-empty while removing the job");
-		delete jchosen.itr.value();
-		// the job set will be freed if its belonging pool is inactive
-		pchosen.itr.value()->erase(jchosen.itr);
-	}
+pool *selector::next_map_pool()
+{
+	if (_popped[task::TASK_TYPE_MAP] == _seen[task::TASK_TYPE_MAP])
+		return NULL;
+	pool_queue *pq = neediest<map_slot>();
+	return pq? pq->p: NULL;
+}
 
-	return ret;
+pool *selector::next_reduce_pool()
+{
+	if (_popped[task::TASK_TYPE_REDUCE] == _seen[task::TASK_TYPE_REDUCE])
+		return NULL;
+	pool_queue *pq = neediest<reduce_slot>();
+	return pq? pq->p: NULL;
 }
 
-// pop out a reduce/reduce task
-td_ref *selector::pop_reduce()
+// pop out a task of slot type S
+template<typename S>
+td_ref *selector::pop()
 {
-	if (_reduces_popped == _seen_reduces.size()) {
+	if (_popped[S::type] == _seen[S::type]) {
 		ULIB_DEBUG("haven't seen a new task");
 		return NULL;
 	}
 
-	pool_reduce_fs_itr pbegin(_reduce_tasks.begin());
-	pool_reduce_fs_itr pend(_reduce_tasks.end());
-	fs_select<pool_reduce_fs_itr> pfs(pbegin, pend);
-	pool_reduce_fs_itr pchosen = pfs();
-	if (pchosen == pend) {
+	std::vector<pool_queue> &tasks = _tasks[S::type];
+	std::vector<size_t> &active = _active[S::type];
+	pool_queue *pq = neediest<S>();
+	if (pq == NULL) {
 		ULIB_FATAL("should have chosen a task");
 		return NULL;
 	}
 
-	pool *p = pchosen.itr.key().ptr->getpool();
+	pool *p = pq->p;
+	++S::ctx(p).alloc;
 	td_ref *ret;
-	if (p->sched == pool::SCHED_FAIR)
-		ret = job_select_reduce_fs(pchosen);
-	else if (p->sched == pool::SCHED_FCFS)
-		ret = job_select_reduce_fcfs(pchosen);
-	else {
+	switch (p->sched) {
+	case pool::SCHED_FAIR:
+		ret = job_select< S, fair_order<S> >(*pq);
+		break;
+	case pool::SCHED_FCFS:
+		ret = job_select< S, fcfs_order<S> >(*pq);
+		break;
+	case pool::SCHED_SRPT:
+		ret = job_select< S, srpt_order<S> >(*pq);
+		break;
+	case pool::SCHED_SJF:
+		ret = job_select< S, sjf_order<S> >(*pq);
+		break;
+	case pool::SCHED_EDF:
+		ret = job_select< S, edf_order<S> >(*pq);
+		break;
+	default:
 		ULIB_FATAL("unrecognized sched mode:%d for pool %s", p->sched, p->name.c_str());
 		return NULL;
 	}
 
 	// mark the task as 'popped'
 	ret->set_flag(task::TASK_FLAG_POPPED);
-	++_reduces_popped;
+	++_popped[S::type];
 
 	// remove inactive pool
-	if (p->fs_ctx_reduce.alloc == p->fs_ctx_reduce.demand) {
-		if (pchosen.itr.value()->size())
+	const fs_context &pctx = S::ctx(p);
+	if (pctx.alloc == pctx.demand) {
+		if (pq->q.active.size())
 			ULIB_FATAL("job set is non-empty while removing the pool");
-		delete pchosen.itr.value();
-		_reduce_tasks.erase(pchosen.itr);
+		deactivate(active, tasks, pq->pos);
+		pq->pos = -1;
 	}
 
 	return ret;
 }
 
-td_ref *selector::pop_reduce(double now)
+td_ref *selector::pop_map()
+{
+	PROF_SCOPE(PROF_POP_MAP);
+	return pop<map_slot>();
+}
+
+td_ref *selector::pop_map(sim_time now)
+{
+	see_maps(now);
+	return pop_map();
+}
+
+td_ref *selector::pop_reduce()
+{
+	PROF_SCOPE(PROF_POP_REDUCE);
+	return pop<reduce_slot>();
+}
+
+td_ref *selector::pop_reduce(sim_time now)
 {
 	see_reduces(now);
 	return pop_reduce();
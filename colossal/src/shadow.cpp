@@ -0,0 +1,186 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <algorithm>
+#include <ulib/util_log.h>
+#include "engine.hpp"
+#include "shadow.hpp"
+
+namespace colossal
+{
+
+shadow_tracker::shadow_tracker(int nmaps, int nreduces)
+	: job_tracker(nmaps, nreduces), _nmaps(nmaps), _nreduces(nreduces),
+	  _now(0), _version(0), _forecast(0)
+{
+}
+
+pool &shadow_tracker::follow_pool(const std::string &ns, sim_time mto, sim_time fto,
+				  double weight, int minmap, int minred,
+				  pool::sched_mode sched)
+{
+	pool &p = add_pool(ns, mto, fto, weight, minmap, minred, sched);
+	// the pools are kept in a deque, whose push_back never moves the
+	// existing elements, so the reference stays valid
+	_pools[p.id] = &p;
+	++_version;
+	return p;
+}
+
+int shadow_tracker::submit(uint64_t pid, uint64_t jid, uint64_t tid, double weight,
+			   task::task_type type, const task &t)
+{
+	if (_tasks.find(tid) != _tasks.end()) {
+		ULIB_WARNING("task %016llx has already been submitted", (unsigned long long)tid);
+		return -1;
+	}
+	ulib::open_hash_map<uint64_t, pool *>::iterator pit = _pools.find(pid);
+	if (pit == _pools.end()) {
+		ULIB_WARNING("pool %016llx has not been configured", (unsigned long long)pid);
+		return -1;
+	}
+	pool *p = pit.value();
+
+	ulib::open_hash_map<uint64_t, job_loc>::iterator jit = _jobs.find(jid);
+	size_t jidx;
+	if (jit == _jobs.end()) {
+		job nj;
+		nj.id = jid;
+		nj.ctime = t.ctime;
+		nj.fs_ctx_map.uid = jid;
+		nj.fs_ctx_reduce.uid = jid;
+		nj.fs_ctx_map.weight = weight;
+		nj.fs_ctx_reduce.weight = weight;
+		p->add_job(nj);
+		jidx = p->jobs.size() - 1;
+		job_loc loc = { p, jidx };
+		_jobs[jid] = loc;
+	} else {
+		if (jit.value().p != p) {
+			ULIB_WARNING("job %016llx submitted to another pool", (unsigned long long)jid);
+			return -1;
+		}
+		jidx = jit.value().idx;
+	}
+
+	job::task_container_type &tasks = p->jobs[jidx].tasks[type];
+	tasks.push_back(t, tid);
+	task_loc loc = { p, jidx, type, tasks.size() - 1 };
+	_tasks[tid] = loc;
+
+	_now = std::max(_now, t.ctime);
+	++_version;
+	return 0;
+}
+
+int shadow_tracker::start(uint64_t tid, sim_time now)
+{
+	ulib::open_hash_map<uint64_t, task_loc>::iterator it = _tasks.find(tid);
+	if (it == _tasks.end()) {
+		ULIB_WARNING("task %016llx has not been submitted", (unsigned long long)tid);
+		return -1;
+	}
+	task_loc &loc = it.value();
+	job::task_container_type &tasks = loc.p->jobs[loc.job].tasks[loc.type];
+	tasks.record_times();
+	tasks.set_stime(loc.idx, now);
+
+	_now = std::max(_now, now);
+	++_version;
+	return 0;
+}
+
+int shadow_tracker::finish(uint64_t tid, sim_time now)
+{
+	ulib::open_hash_map<uint64_t, task_loc>::iterator it = _tasks.find(tid);
+	if (it == _tasks.end()) {
+		ULIB_WARNING("task %016llx has not been submitted", (unsigned long long)tid);
+		return -1;
+	}
+	task_loc loc = it.value();
+	_tasks.erase(it);
+
+	// finished tasks are dropped, moving the last task in place
+	job &j = loc.p->jobs[loc.job];
+	job::task_container_type &tasks = j.tasks[loc.type];
+	tasks.remove(loc.idx);
+	if (loc.idx < tasks.size())
+		_tasks[tasks.id(loc.idx)].idx = loc.idx;
+
+	if (j.tasks[task::TASK_TYPE_MAP].empty() &&
+	    j.tasks[task::TASK_TYPE_REDUCE].empty())
+		remove_job(loc.p, loc.job);
+
+	_now = std::max(_now, now);
+	++_version;
+	return 0;
+}
+
+void shadow_tracker::remove_job(pool *p, size_t idx)
+{
+	_jobs.erase(p->jobs[idx].id);
+	if (idx != p->jobs.size() - 1) {
+		p->jobs[idx] = p->jobs.back();
+		job &j = p->jobs[idx];
+		_jobs[j.id].idx = idx;
+		for (int type = 0; type < task::TASK_TYPE_NUM; ++type)
+			for (size_t k = 0; k < j.tasks[type].size(); ++k)
+				_tasks[j.tasks[type].id(k)].job = idx;
+	}
+	p->jobs.pop_back();
+}
+
+void shadow_tracker::forecast()
+{
+	if (_forecast == _version)
+		return;
+
+	// fast-forward a copy of the unfinished tasks
+	engine eng(_nmaps, _nreduces, _now);
+	eng.set_progress(false);
+	eng.getpools() = getpools();
+	eng.process(true);
+
+	_job_pred.clear();
+	_pool_pred.clear();
+	for (engine::pool_container_type::const_iterator pit = eng.getpools().begin();
+	     pit != eng.getpools().end(); ++pit) {
+		sim_time pfin = -1;
+		for (pool::job_container_type::const_iterator jit = pit->jobs.begin();
+		     jit != pit->jobs.end(); ++jit) {
+			sim_time jfin = jit->last_finish();
+			_job_pred[jit->id] = jfin;
+			pfin = std::max(pfin, jfin);
+		}
+		_pool_pred[pit->id] = pfin;
+	}
+
+	_forecast = _version;
+}
+
+sim_time shadow_tracker::predict_job(uint64_t jid)
+{
+	forecast();
+	ulib::open_hash_map<uint64_t, sim_time>::const_iterator it = _job_pred.find(jid);
+	return it == _job_pred.end()? -1: it.value();
+}
+
+sim_time shadow_tracker::predict_pool(uint64_t pid)
+{
+	forecast();
+	ulib::open_hash_map<uint64_t, sim_time>::const_iterator it = _pool_pred.find(pid);
+	return it == _pool_pred.end()? -1: it.value();
+}
+
+}
@@ -14,6 +14,7 @@
 
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 #include <ulib/hash_func.h>
 #include <ulib/math_rand_prot.h>
 #include "job.hpp"
@@ -25,20 +26,242 @@ namespace colossal
 
 uint64_t task::id_from_str(const char *str)
 {
-	return hash_fast64(str, strlen(str), 0xdeedbeefdeedbeefull);
+	return id_from_str(str, strlen(str));
 }
 
-std::string task::to_str() const
+uint64_t task::id_from_str(const char *str, size_t len)
+{
+	return hash_fast64(str, len, 0xdeedbeefdeedbeefull);
+}
+
+uint64_t task::make_id(uint64_t jid, task_type type, size_t idx)
+{
+	uint64_t key[2] = { jid, (uint64_t)idx << 1 | type };
+	return hash_fast64(key, sizeof(key), 0xdeedbeefdeedbeefull);
+}
+
+std::string task::to_str(uint64_t id, task_type type) const
 {
         char buf[1024];
 
-        snprintf(buf, sizeof(buf), "%016llx,%f,%f,%f,%f,%s",
-                 id, ctime, ptime, stime, ftime,
+        snprintf(buf, sizeof(buf), "%016llx,%lld,%lld,%lld,%lld,%s",
+                 (unsigned long long)id, (long long)ctime, (long long)ptime,
+		 (long long)stime, (long long)ftime,
 		 type == TASK_TYPE_MAP? "MAP": "REDUCE");
 
         return buf;
 }
 
+task_list::task_list(const task_list &other)
+	: _base(other._base), _tasks(other._tasks),
+	  _x(other._x? new extra(*other._x): NULL),
+	  _last(other._last), _done(other._done)
+{
+}
+
+task_list &task_list::operator=(const task_list &other)
+{
+	if (this != &other) {
+		extra *x = other._x? new extra(*other._x): NULL;
+		delete _x;
+		_x = x;
+		_base  = other._base;
+		_tasks = other._tasks;
+		_last  = other._last;
+		_done  = other._done;
+	}
+	return *this;
+}
+
+task_list::~task_list()
+{
+	delete _x;
+}
+
+void task_list::shrink()
+{
+	if (_tasks.capacity() > _tasks.size())
+		std::vector<packed>(_tasks).swap(_tasks);
+	if (_x) {
+		if (_x->wide.capacity() > _x->wide.size())
+			std::vector<wide_task>(_x->wide).swap(_x->wide);
+		if (_x->ids.capacity() > _x->ids.size())
+			std::vector<uint64_t>(_x->ids).swap(_x->ids);
+		if (_x->times.capacity() > _x->times.size())
+			std::vector<sim_time>(_x->times).swap(_x->times);
+	}
+}
+
+task_list::extra *task_list::get_extra()
+{
+	if (_x == NULL)
+		_x = new extra;
+	return _x;
+}
+
+const task_list::wide_task *task_list::wide_at(size_t k) const
+{
+	wide_task key;
+	key.idx = k;
+	return &*std::lower_bound(_x->wide.begin(), _x->wide.end(), key);
+}
+
+task_list::wide_task *task_list::add_wide(size_t k)
+{
+	std::vector<wide_task> &w = get_extra()->wide;
+	wide_task key;
+	key.idx = k;
+	std::vector<wide_task>::iterator it = std::lower_bound(w.begin(), w.end(), key);
+	if (it == w.end() || it->idx != k) {
+		key.ctime = ctime(k);
+		key.ptime = ptime(k);
+		it = w.insert(it, key);
+	}
+	return &*it;
+}
+
+void task_list::drop_wide(size_t k)
+{
+	std::vector<wide_task> &w = _x->wide;
+	wide_task key;
+	key.idx = k;
+	w.erase(std::lower_bound(w.begin(), w.end(), key));
+}
+
+void task_list::push_back(const task &t)
+{
+	if (_tasks.empty())
+		_base = t.ctime;
+	size_t k = _tasks.size();
+	if (t.stime >= 0 || t.ftime >= 0)
+		record_times();
+	if (has_times()) {
+		_x->times.push_back(t.stime);
+		_x->times.push_back(-1);
+	}
+	if (has_ids())
+		_x->ids.push_back(0);
+	sim_time d = t.ctime - _base;
+	packed p = { CTIME_WIDE, PTIME_WIDE };
+	if (d > CTIME_WIDE && d <= 0x7fffffff)
+		p.ctime = d;
+	if (t.ptime >= 0 && t.ptime < PTIME_WIDE)
+		p.ptime = t.ptime;
+	if (p.ctime == CTIME_WIDE || p.ptime == PTIME_WIDE) {
+		wide_task w = { (uint32_t)k, t.ctime, t.ptime };
+		get_extra()->wide.push_back(w);
+	}
+	_tasks.push_back(p);
+	if (t.ftime >= 0)
+		set_ftime(k, t.ftime);
+}
+
+void task_list::push_back(const task &t, uint64_t id)
+{
+	if (!has_ids()) {
+		get_extra()->ids.resize(_tasks.size());
+		_x->keyed = true;
+	}
+	push_back(t);
+	_x->ids.back() = id;
+}
+
+void task_list::remove(size_t k)
+{
+	size_t last = _tasks.size() - 1;
+	if (is_wide(k))
+		drop_wide(k);
+	if (k != last) {
+		if (is_wide(last)) {
+			wide_task w = *wide_at(last);
+			drop_wide(last);
+			w.idx = k;
+			std::vector<wide_task> &v = _x->wide;
+			v.insert(std::lower_bound(v.begin(), v.end(), w), w);
+		}
+		_tasks[k] = _tasks[last];
+		if (has_ids())
+			_x->ids[k] = _x->ids[last];
+		if (has_times()) {
+			_x->times[2 * k] = _x->times[2 * last];
+			_x->times[2 * k + 1] = _x->times[2 * last + 1];
+		}
+	}
+	_tasks.pop_back();
+	if (has_ids())
+		_x->ids.pop_back();
+	if (has_times())
+		_x->times.resize(2 * _tasks.size());
+}
+
+task task_list::operator[](size_t k) const
+{
+	task t;
+	t.ctime = ctime(k);
+	t.ptime = ptime(k);
+	t.stime = stime(k);
+	t.ftime = ftime(k);
+	return t;
+}
+
+void task_list::set_ptime(size_t k, sim_time t)
+{
+	if (t >= 0 && t < PTIME_WIDE) {
+		_tasks[k].ptime = t;
+		return;
+	}
+	wide_task *w = add_wide(k);
+	w->ptime = t;
+	_tasks[k].ptime = PTIME_WIDE;
+}
+
+void task_list::set_stime(size_t k, sim_time t)
+{
+	if (has_times())
+		_x->times[2 * k] = t;
+}
+
+void task_list::set_ftime(size_t k, sim_time t)
+{
+	if (has_times()) {
+		sim_time &f = _x->times[2 * k + 1];
+		if (f < 0)
+			++_done;
+		f = t;
+	} else {
+		++_done;
+	}
+	_last = std::max(_last, t);
+}
+
+void task_list::record_times()
+{
+	if (!has_times()) {
+		get_extra()->times.resize(2 * _tasks.size(), -1);
+		_x->timed = true;
+	}
+}
+
+void task_list::clear_times(bool record)
+{
+	if (record) {
+		record_times();
+		std::fill(_x->times.begin(), _x->times.end(), -1);
+	} else if (has_times()) {
+		std::vector<sim_time>().swap(_x->times);
+		_x->timed = false;
+	}
+	_last = -1;
+	_done = 0;
+}
+
+task_desc::task_desc(job *j, pool *p, task::task_type type, size_t idx)
+	: _job(j), _pool(p), _tasks(&j->tasks[type]), _id(j->task_id(type, idx)),
+	  _stime(_tasks->stime(idx)), _ftime(_tasks->ftime(idx)),
+	  _idx(idx), _type(type), _refcnt(0), _flags(0)
+{
+}
+
 task_desc::ref::ref(task_desc *p)
         : _td(p)
 {
@@ -72,7 +295,7 @@ task_desc::ref &task_desc::ref::operator= (const task_desc::ref &other)
 
 task_desc::ref::operator size_t() const
 {
-	uint64_t h = _td->_task->id;
+	uint64_t h = _td->_id;
 	h = RAND_INT_MIX64(h) + _td->_job->id;
 	h = RAND_INT3_MIX64(h) + _td->_pool->id;
 	return RAND_INT3_MIX64(h);
@@ -80,7 +303,7 @@ task_desc::ref::operator size_t() const
 
 bool task_desc::ref::operator==(const task_desc::ref &other) const
 {
-	return _td->_task->id == other._td->_task->id &&
+	return _td->_id == other._td->_id &&
 		_td->_job->id == other._td->_job->id &&
 		_td->_pool->id == other._td->_pool->id;
 }
@@ -17,6 +17,8 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
+#include "common.hpp"
 
 namespace colossal
 {
@@ -39,20 +41,142 @@ struct task
 	};
 
 	static uint64_t id_from_str(const char *str);
+	static uint64_t id_from_str(const char *str, size_t len);
 
-        std::string to_str() const;
+	// Id of the task at idx among the tasks of a type of job jid,
+	// standing in for the trace ids that are not kept
+	static uint64_t make_id(uint64_t jid, task_type type, size_t idx);
 
-        uint64_t id;
-        double ctime;  // creation time
-        double ptime;  // processing time
-        double stime;  // start time
-        double ftime;  // finish time
-        task_type type;
+        std::string to_str(uint64_t id, task_type type) const;
+
+	// A task as added to or read from its job, see task_list
+	// The type is that of the job container holding the task.
+        sim_time ctime;  // creation time
+        sim_time ptime;  // processing time
+        sim_time stime;  // start time, < 0 if not started
+        sim_time ftime;  // finish time, < 0 if not finished
+};
+
+// Tasks of one type of a job in a compact layout
+// A task takes 8 bytes: its creation time as a 32-bit offset from that
+// of the first task, and its processing time in 32 bits. The rare times
+// out of range are kept in full on the side. The task ids are derived
+// from the index, see job::task_id(), unless the trace ids are kept,
+// and the start and finish times are only stored once recorded, see
+// record_times(). The latest finish and the number of finished tasks
+// are tracked either way.
+class task_list
+{
+public:
+	task_list() : _base(0), _x(NULL), _last(-1), _done(0) { }
+	task_list(const task_list &other);
+	task_list &operator=(const task_list &other);
+	~task_list();
+
+	size_t size() const { return _tasks.size(); }
+	bool empty() const { return _tasks.empty(); }
+	size_t capacity() const { return _tasks.capacity(); }
+	void reserve(size_t n) { _tasks.reserve(n); }
+	// Release the spare capacity
+	void shrink();
+
+	// Append a task, recording its start and finish times if any
+	void push_back(const task &t);
+	// Append a task with its trace id
+	void push_back(const task &t, uint64_t id);
+	// Move the last task in place of the task at k
+	// Meant for unfinished tasks, which the finish summary ignores.
+	void remove(size_t k);
+
+	task operator[](size_t k) const;
+
+	sim_time ctime(size_t k) const
+	{
+		int32_t d = _tasks[k].ctime;
+		return d == CTIME_WIDE? wide_at(k)->ctime: _base + d;
+	}
+
+	sim_time ptime(size_t k) const
+	{
+		uint32_t p = _tasks[k].ptime;
+		return p == PTIME_WIDE? wide_at(k)->ptime: (sim_time)p;
+	}
+
+	void set_ptime(size_t k, sim_time t);
+
+	sim_time stime(size_t k) const { return has_times()? _x->times[2 * k]: -1; }
+	sim_time ftime(size_t k) const { return has_times()? _x->times[2 * k + 1]: -1; }
+
+	// The start time is kept if the times are recorded, the finish
+	// time is counted in the summary as well
+	void set_stime(size_t k, sim_time t);
+	void set_ftime(size_t k, sim_time t);
+
+	// Store the start and finish times of each task from now on
+	void record_times();
+	bool has_times() const { return _x && _x->timed; }
+	// Unfinish all tasks, and drop their times unless recorded
+	void clear_times(bool record);
+
+	// Trace ids, if the tasks were added with theirs
+	bool has_ids() const { return _x && _x->keyed; }
+	uint64_t id(size_t k) const { return _x->ids[k]; }
+
+	// Finish of the latest finished task, < 0 if none
+	sim_time last_finish() const { return _last; }
+	// Number of finished tasks
+	size_t finished() const { return _done; }
+
+private:
+	static const int32_t  CTIME_WIDE = -0x7fffffff - 1;
+	static const uint32_t PTIME_WIDE = 0xffffffffu;
+
+	struct packed {
+		int32_t  ctime;  // from _base, CTIME_WIDE if out of range
+		uint32_t ptime;  // PTIME_WIDE if out of range
+	};
+
+	// Times of a task with either out of range
+	struct wide_task {
+		uint32_t idx;
+		sim_time ctime;
+		sim_time ptime;
+
+		bool operator<(const wide_task &other) const { return idx < other.idx; }
+	};
+
+	struct extra {
+		std::vector<wide_task> wide;   // by idx
+		std::vector<uint64_t>  ids;
+		std::vector<sim_time>  times;  // stime and ftime of each task
+		bool keyed;
+		bool timed;
+
+		extra() : keyed(false), timed(false) { }
+	};
+
+	bool is_wide(size_t k) const
+	{
+		return _tasks[k].ctime == CTIME_WIDE || _tasks[k].ptime == PTIME_WIDE;
+	}
+
+	extra *get_extra();
+	const wide_task *wide_at(size_t k) const;
+	wide_task *add_wide(size_t k);
+	void drop_wide(size_t k);
+
+	sim_time            _base;
+	std::vector<packed> _tasks;
+	extra              *_x;     // allocated on demand
+	sim_time            _last;
+	uint32_t            _done;
 };
 
 // Reference-counted task description class
 // Should only be instantiated using new, and then access the instance
 // using the ref member class
+// The start time is that of the latest attempt, so it is kept here
+// whether or not the times of the job are recorded.
 class task_desc
 {
 public:
@@ -61,9 +185,9 @@ public:
         public:
                 ref(task_desc *p);
                 ref(const ref &other);
-                virtual ref &operator= (const ref &other);
+                ref &operator= (const ref &other);
 
-                virtual ~ref();
+                ~ref();
 
 		void set_flag(task::task_flag flag)
 		{
@@ -85,10 +209,28 @@ public:
 			return _td->_flags & flag;
 		}
 
-                const task *gettask() const
-                {
-                        return _td->_task;
-                }
+		uint64_t id() const { return _td->_id; }
+		task::task_type type() const { return _td->_type; }
+		size_t idx() const { return _td->_idx; }
+
+		sim_time ctime() const { return _td->_tasks->ctime(_td->_idx); }
+		sim_time ptime() const { return _td->_tasks->ptime(_td->_idx); }
+		sim_time stime() const { return _td->_stime; }
+		sim_time ftime() const { return _td->_ftime; }
+
+		void set_ptime(sim_time t) { _td->_tasks->set_ptime(_td->_idx, t); }
+
+		void set_stime(sim_time t)
+		{
+			_td->_stime = t;
+			_td->_tasks->set_stime(_td->_idx, t);
+		}
+
+		void set_ftime(sim_time t)
+		{
+			_td->_ftime = t;
+			_td->_tasks->set_ftime(_td->_idx, t);
+		}
 
                 const job  *getjob() const
                 {
@@ -100,11 +242,6 @@ public:
                         return _td->_pool;
                 }
 
-                task *gettask()
-                {
-                        return _td->_task;
-                }
-
                 job  *getjob()
                 {
                         return _td->_job;
@@ -125,17 +262,21 @@ public:
 
         friend class ref;
 
-        task_desc(task *t, job *j, pool *p)
-		: _task(t), _job(j), _pool(p),
-		  _refcnt(0), _flags(0) { }
+	// The task at idx among the tasks of a type of job j
+        task_desc(job *j, pool *p, task::task_type type, size_t idx);
 
-        virtual ~task_desc() { }
+        ~task_desc() { }
 
 private:
-        task *_task;
-        job  *_job;
-        pool *_pool;
-        int   _refcnt;
+        job       *_job;
+        pool      *_pool;
+	task_list *_tasks;
+	uint64_t   _id;
+	sim_time   _stime;
+	sim_time   _ftime;
+	uint32_t   _idx;
+	task::task_type _type;
+        int        _refcnt;
 	unsigned int _flags;
 };
 
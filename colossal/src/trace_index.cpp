@@ -0,0 +1,243 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ulib/util_log.h>
+#include <ulib/search_line.h>
+#include "trace_index.hpp"
+
+namespace colossal
+{
+
+const sim_time trace_index::DEFAULT_BUCKET = 3600000 * TICKS_PER_MSEC;
+const int      trace_index::MAX_LINE_LEN   = 4096;
+
+static const char INDEX_MAGIC[8] = { 'C', 'L', 'S', 'I', 'D', 'X', '1', 0 };
+
+// Parse the creation time (the 5th field) of a NUL-terminated line
+static bool line_ctime(const char *line, sim_time *ctime)
+{
+	for (int i = 0; i < 4; ++i) {
+		line = strchr(line, '\t');
+		if (line == NULL)
+			return false;
+		++line;
+	}
+	char *end;
+	double ms = strtod(line, &end);
+	if (end == line)
+		return false;
+	*ctime = to_sim_time(ms * TICKS_PER_MSEC);
+	return true;
+}
+
+static inline int64_t bucket_of(sim_time t, sim_time bucket)
+{
+	return t >= 0? t / bucket: -((-t + bucket - 1) / bucket);
+}
+
+struct bucket_param {
+	int64_t  bucket;
+	sim_time width;
+};
+
+// line compare function for findfirstline()
+static int comp_bucket(const char *line, void *param)
+{
+	bucket_param *bp = (bucket_param *)param;
+	sim_time ctime;
+	if (!line_ctime(line, &ctime))
+		return 1;  // treat malformed lines as past the target
+	int64_t b = bucket_of(ctime, bp->width);
+	return b < bp->bucket? -1: (b > bp->bucket? 1: 0);
+}
+
+// Read the first or the last complete line at the end of the file
+static bool edge_ctime(int fd, off_t size, bool last, sim_time *ctime)
+{
+	char buf[trace_index::MAX_LINE_LEN + 1];
+	off_t off = last? std::max((off_t)0, size - trace_index::MAX_LINE_LEN): 0;
+	ssize_t nb = pread(fd, buf, trace_index::MAX_LINE_LEN, off);
+	if (nb <= 0)
+		return false;
+	buf[nb] = '\0';
+	if (!last) {
+		char *nl = strchr(buf, '\n');
+		if (nl)
+			*nl = '\0';
+		return line_ctime(buf, ctime);
+	}
+	// strip trailing newlines, then locate the start of the last line
+	while (nb > 0 && (buf[nb - 1] == '\n' || buf[nb - 1] == '\r'))
+		buf[--nb] = '\0';
+	char *line = strrchr(buf, '\n');
+	return line_ctime(line? line + 1: buf, ctime);
+}
+
+int trace_index::build(const char *trace, sim_time bucket)
+{
+	if (bucket <= 0) {
+		ULIB_WARNING("invalid index bucket %lld", (long long)bucket);
+		return -1;
+	}
+
+	int fd = ::open(trace, O_RDONLY);
+	if (fd == -1) {
+		ULIB_WARNING("cannot open %s for reading", trace);
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+
+	_bucket = bucket;
+	_size   = st.st_size;
+	_mtime  = st.st_mtime;
+	_entries.clear();
+
+	sim_time first, last;
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	if (!edge_ctime(fd, st.st_size, false, &first) ||
+	    !edge_ctime(fd, st.st_size, true, &last)) {
+		ULIB_WARNING("cannot parse the creation time in %s", trace);
+		close(fd);
+		return -1;
+	}
+	if (last < first) {
+		ULIB_WARNING("%s is not sorted by creation time", trace);
+		close(fd);
+		return -1;
+	}
+
+	// locate the first line of each non-empty bucket
+	bucket_param bp;
+	bp.width = bucket;
+	int64_t lastb = bucket_of(last, bucket);
+	for (bp.bucket = bucket_of(first, bucket); bp.bucket <= lastb; ++bp.bucket) {
+		ssize_t off = findfirstline(fd, comp_bucket, &bp, MAX_LINE_LEN);
+		if (off < 0)
+			continue;
+		if (_entries.size() && off <= _entries.back().offset) {
+			ULIB_WARNING("%s is not sorted by creation time", trace);
+			_entries.clear();
+			close(fd);
+			return -1;
+		}
+		entry e;
+		e.bucket = bp.bucket;
+		e.offset = off;
+		_entries.push_back(e);
+	}
+
+	close(fd);
+	return 0;
+}
+
+int trace_index::save(const char *file) const
+{
+	FILE *fp = fopen(file, "wb");
+	if (fp == NULL) {
+		ULIB_WARNING("cannot open %s for writing", file);
+		return -1;
+	}
+	int64_t hdr[4] = { _bucket, _size, _mtime, (int64_t)_entries.size() };
+	bool ok = fwrite(INDEX_MAGIC, sizeof(INDEX_MAGIC), 1, fp) == 1 &&
+		fwrite(hdr, sizeof(hdr), 1, fp) == 1 &&
+		(_entries.empty() ||
+		 fwrite(&_entries[0], sizeof(entry), _entries.size(), fp) == _entries.size());
+	if (fclose(fp) || !ok) {
+		ULIB_WARNING("failed to write index %s", file);
+		return -1;
+	}
+	return 0;
+}
+
+int trace_index::load(const char *file)
+{
+	FILE *fp = fopen(file, "rb");
+	if (fp == NULL)
+		return -1;
+	char magic[sizeof(INDEX_MAGIC)];
+	int64_t hdr[4];
+	if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+	    memcmp(magic, INDEX_MAGIC, sizeof(magic)) ||
+	    fread(hdr, sizeof(hdr), 1, fp) != 1 || hdr[0] <= 0 || hdr[3] < 0) {
+		fclose(fp);
+		return -1;
+	}
+	_bucket = hdr[0];
+	_size   = hdr[1];
+	_mtime  = hdr[2];
+	_entries.resize(hdr[3]);
+	if (hdr[3] &&
+	    fread(&_entries[0], sizeof(entry), _entries.size(), fp) != _entries.size()) {
+		_entries.clear();
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	return 0;
+}
+
+int trace_index::open(const char *trace, sim_time bucket)
+{
+	struct stat st;
+	if (stat(trace, &st)) {
+		ULIB_WARNING("cannot stat %s", trace);
+		return -1;
+	}
+
+	std::string idx = sidecar(trace);
+	if (load(idx.c_str()) == 0 && _bucket == bucket &&
+	    _size == st.st_size && _mtime == st.st_mtime)
+		return 0;
+
+	if (build(trace, bucket))
+		return -1;
+	// the index is still usable if it cannot be saved
+	save(idx.c_str());
+	return 0;
+}
+
+off_t trace_index::seek(sim_time t) const
+{
+	int64_t b = bucket_of(t, _bucket);
+	size_t lo = 0, hi = _entries.size();
+	while (lo < hi) {
+		size_t m = (lo + hi) / 2;
+		if (_entries[m].bucket < b)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	return lo < _entries.size()? _entries[lo].offset: _size;
+}
+
+std::string trace_index::sidecar(const char *trace)
+{
+	return std::string(trace) + ".idx";
+}
+
+}
@@ -0,0 +1,127 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#include <ulib/math_rand_prot.h>
+#include "pool.hpp"
+#include "transform.hpp"
+
+namespace colossal
+{
+
+// keeps the copies apart from those of scale_arrivals_transform
+static const uint64_t REPLICATE_SALT = 1ull << 32;
+
+workload_transform::workload_transform(const char *pool, uint64_t seed)
+	: _all(pool == NULL), _pid(pool? pool::id_from_str(pool): 0), _seed(seed)
+{ }
+
+double workload_transform::uniform(uint64_t jid, uint64_t salt) const
+{
+	uint64_t h = jid ^ _seed;
+	RAND_INT_MIX64(h);
+	h += salt;
+	RAND_INT_MIX64(h);
+	return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void workload_transform::replicate(const trace_task &in, uint64_t copy, uint64_t pid,
+				   sim_time jitter, std::vector<trace_task> *out) const
+{
+	trace_task c = in;
+	sim_time shift = to_sim_time(uniform(in.jid, copy) * jitter);
+	uint64_t salt = (copy ^ _seed) + pid;
+	RAND_INT_MIX64(salt);
+	uint64_t h = in.jid + salt;
+	c.pid = pid;
+	c.jid = RAND_INT_MIX64(h);
+	h = in.tid + salt;
+	c.tid = RAND_INT_MIX64(h);
+	c.t.ctime += shift;
+	if (c.t.stime >= 0) {
+		c.t.stime += shift;
+		c.t.ftime += shift;
+	}
+	if (c.deadline >= 0)
+		c.deadline += shift;
+	out->push_back(c);
+}
+
+void sample_transform::apply(const trace_task &in, std::vector<trace_task> *out)
+{
+	if (!selected(in) || uniform(in.jid, 0) < _fraction)
+		out->push_back(in);
+}
+
+void scale_arrivals_transform::apply(const trace_task &in, std::vector<trace_task> *out)
+{
+	if (!selected(in)) {
+		out->push_back(in);
+		return;
+	}
+	int copies = (int)_factor;
+	if (uniform(in.jid, 0) < _factor - copies)
+		++copies;
+	if (copies > 0)
+		out->push_back(in);
+	for (int i = 1; i < copies; ++i)
+		replicate(in, i, in.pid, _jitter, out);
+}
+
+void time_compress_transform::apply(const trace_task &in, std::vector<trace_task> *out)
+{
+	if (_origin < 0)
+		_origin = in.t.ctime;
+	trace_task c = in;
+	c.t.ctime = _origin + to_sim_time((in.t.ctime - _origin) / _factor);
+	if (c.t.stime >= 0) {
+		c.t.stime += c.t.ctime - in.t.ctime;
+		c.t.ftime += c.t.ctime - in.t.ctime;
+	}
+	if (c.deadline >= 0)
+		c.deadline = _origin + to_sim_time((in.deadline - _origin) / _factor);
+	out->push_back(c);
+}
+
+pool_replicate_transform::pool_replicate_transform(const char *src, const char *dst,
+						   int copies, sim_time jitter,
+						   uint64_t seed)
+	: workload_transform(src, seed), _dst(pool::id_from_str(dst)),
+	  _copies(copies), _jitter(jitter)
+{ }
+
+void pool_replicate_transform::apply(const trace_task &in, std::vector<trace_task> *out)
+{
+	out->push_back(in);
+	if (!selected(in))
+		return;
+	for (int i = 1; i <= _copies; ++i)
+		replicate(in, REPLICATE_SALT + i, _dst, _jitter, out);
+}
+
+void duration_scale_transform::apply(const trace_task &in, std::vector<trace_task> *out)
+{
+	if (!selected(in)) {
+		out->push_back(in);
+		return;
+	}
+	trace_task c = in;
+	c.t.ptime = to_sim_time(in.t.ptime * _factor);
+	if (_cap >= 0 && c.t.ptime > _cap)
+		c.t.ptime = _cap;
+	if (c.t.stime >= 0)
+		c.t.ftime = c.t.stime + c.t.ptime;
+	out->push_back(c);
+}
+
+}
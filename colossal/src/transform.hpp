@@ -0,0 +1,153 @@
+/* Colossal
+ * Copyright (c) 2014 Zilong Tan (eric.zltan@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, subject to the conditions listed
+ * in the Colossal LICENSE file. These conditions include: you must preserve this
+ * copyright notice, and you cannot mention the copyright holders in
+ * advertising related to the Software without their permission.  The Software
+ * is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This notice is a
+ * summary of the Colossal LICENSE file; the license in that file is legally
+ * binding.
+ */
+
+#ifndef _COLOSSAL_TRANSFORM_H
+#define _COLOSSAL_TRANSFORM_H
+
+#include <vector>
+#include <stdint.h>
+#include "common.hpp"
+#include "task.hpp"
+
+namespace colossal
+{
+
+// A task of a workload trace as it is loaded
+struct trace_task {
+	uint64_t pid;
+	uint64_t jid;
+	uint64_t tid;
+	double   weight;
+	sim_time deadline;  // < 0 if none
+	task::task_type type;
+	task     t;
+};
+
+// A stage of a workload transformation pipeline
+// The stages of a workload_loader are applied in order to each task as
+// it is merged into the pools, so a transformed trace is never written
+// out. Random choices are drawn from hashes of the seed and the job
+// id: the tasks of a job are treated alike, and the result does not
+// depend on the number of loader threads.
+class workload_transform
+{
+public:
+	// pool: name of the only pool transformed, NULL for all
+	workload_transform(const char *pool, uint64_t seed);
+	virtual ~workload_transform() { }
+
+	// Transform a task, appending the resulting tasks to out
+	virtual void apply(const trace_task &in, std::vector<trace_task> *out) = 0;
+
+protected:
+	bool selected(const trace_task &in) const { return _all || in.pid == _pid; }
+
+	// Uniform in [0, 1) for the job and the salt
+	double uniform(uint64_t jid, uint64_t salt) const;
+
+	// Append a copy of the task in pool pid, shifted by up to jitter
+	// The job and task ids of the copy are hashed from the originals,
+	// the copy number, the pool and the seed, so stages of the same
+	// kind need distinct seeds.
+	void replicate(const trace_task &in, uint64_t copy, uint64_t pid,
+		       sim_time jitter, std::vector<trace_task> *out) const;
+
+	bool     _all;
+	uint64_t _pid;
+	uint64_t _seed;
+};
+
+// Keep a fraction of the jobs
+class sample_transform : public workload_transform
+{
+public:
+	sample_transform(double fraction, const char *pool = NULL, uint64_t seed = 0)
+		: workload_transform(pool, seed), _fraction(fraction) { }
+
+	void apply(const trace_task &in, std::vector<trace_task> *out);
+
+private:
+	double _fraction;
+};
+
+// Scale the job arrival rate
+// A factor of 2.5 keeps each job, adds one copy of it and another
+// with a probability of 0.5, while a factor below one thins the jobs
+// out. Copies are shifted by up to jitter so that they do not arrive
+// together.
+class scale_arrivals_transform : public workload_transform
+{
+public:
+	scale_arrivals_transform(double factor, sim_time jitter = 0,
+				 const char *pool = NULL, uint64_t seed = 0)
+		: workload_transform(pool, seed), _factor(factor), _jitter(jitter) { }
+
+	void apply(const trace_task &in, std::vector<trace_task> *out);
+
+private:
+	double   _factor;
+	sim_time _jitter;
+};
+
+// Compress time by a factor from an origin
+// Creation times and deadlines move toward the origin, and the start
+// and finish times follow the creation time, so durations are kept.
+// The origin defaults to the creation time of the first task.
+class time_compress_transform : public workload_transform
+{
+public:
+	time_compress_transform(double factor, sim_time origin = -1)
+		: workload_transform(NULL, 0), _factor(factor), _origin(origin) { }
+
+	void apply(const trace_task &in, std::vector<trace_task> *out);
+
+private:
+	double   _factor;
+	sim_time _origin;
+};
+
+// Add copies of the jobs of a pool to another pool, or to itself
+class pool_replicate_transform : public workload_transform
+{
+public:
+	pool_replicate_transform(const char *src, const char *dst, int copies,
+				 sim_time jitter = 0, uint64_t seed = 0);
+
+	void apply(const trace_task &in, std::vector<trace_task> *out);
+
+private:
+	uint64_t _dst;
+	int      _copies;
+	sim_time _jitter;
+};
+
+// Scale task durations, optionally capping them
+// The finish time follows the start time.
+class duration_scale_transform : public workload_transform
+{
+public:
+	// cap: longest duration, < 0 for none
+	duration_scale_transform(double factor, sim_time cap = -1, const char *pool = NULL)
+		: workload_transform(pool, 0), _factor(factor), _cap(cap) { }
+
+	void apply(const trace_task &in, std::vector<trace_task> *out);
+
+private:
+	double   _factor;
+	sim_time _cap;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+//
+// Evaluate the predicted job completion times of a small trace under
+// calibrations of 4, 2 and 8 map slots in parallel, the trace having
+// run on 4.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+// A job of maps that ran in waves of the given width
+void add_job(pool &p, uint64_t id, int nmaps, int width)
+{
+	job j;
+	j.id = id;
+	j.ctime = 0;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = 0;
+		t.ptime = 100;
+		t.stime = i / width * 100;
+		t.ftime = t.stime + 100;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	p.add_job(j);
+}
+
+int main()
+{
+	job_tracker jt(4, 1);
+	pool &a = jt.add_pool("a", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	pool &b = jt.add_pool("b", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	add_job(a, 1, 4, 2);
+	add_job(b, 2, 2, 2);
+
+	accuracy_evaluator eval(jt.getpools(), 2);
+	eval.add(calibration("exact", 4, 1));
+	eval.add(calibration("small", 2, 1));
+	eval.add(calibration("large", 8, 1, 1000, 1000));
+	eval.run();
+	assert(eval.size() == 3);
+
+	// the trace is left as loaded
+	assert(a.jobs[0].tasks[task::TASK_TYPE_MAP][3].stime == 100);
+
+	const accuracy_stats &exact = eval.overall(0);
+	assert(exact.jobs == 2);
+	assert(double_equal(exact.mape, 0) && double_equal(exact.max, 0));
+
+	// a finishes at 300 rather than 200, and b at 200 rather than 100
+	const accuracy_stats &small = eval.overall(1);
+	assert(small.jobs == 2);
+	assert(double_equal(small.mape, 0.75) && double_equal(small.bias, 0.75));
+	assert(double_equal(small.p50, 0.5) && double_equal(small.p99, 1));
+	assert(double_equal(eval.pool_stats(1, 0).mape, 0.5));
+	assert(double_equal(eval.pool_stats(1, 1).max, 1));
+
+	// a finishes at 100 rather than 200
+	const accuracy_stats &large = eval.overall(2);
+	assert(double_equal(large.mape, 0.25) && double_equal(large.bias, -0.25));
+	assert(double_equal(eval.pool_stats(2, 0).bias, -0.5));
+
+	assert(eval.best() == 0);
+
+	printf("passed\n");
+
+	return 0;
+}
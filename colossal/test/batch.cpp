@@ -0,0 +1,96 @@
+//
+// Queue a wide job and make sure its waiting tasks take no refs, that
+// they are popped in trace order, and that a preempted task comes back
+// after the tasks seen before it. The tasks of a job created at
+// different times out of trace order are popped by creation time.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+int main()
+{
+	const int nmaps = 100000;
+	std::deque<pool> pools;
+	pools.push_back(pool("analyst", -1, -1, 1, 0, 0, pool::SCHED_FAIR));
+	job j;
+	j.id = 1;
+	j.ctime = 10;
+	j.fs_ctx_map.uid = j.id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = i < nmaps / 2? 10: 20;
+		t.ptime = 1 + i % 7;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	pools[0].add_job(j);
+
+	selector sel(pools.begin(), pools.end());
+	assert(sel.maps_left() == (size_t)nmaps && sel.refs() == 0);
+	assert(sel.map_min_ctime() == 10);
+
+	td_ref *first = sel.pop_map(10);
+	assert(first->idx() == 0);
+	assert(sel.maps_seen() == (size_t)nmaps / 2 && sel.refs() == 1);
+	assert(pools[0].fs_ctx_map.demand == nmaps / 2);
+
+	// preempted, and seen again before the later tasks
+	--pools[0].fs_ctx_map.alloc;
+	--pools[0].fs_ctx_map.demand;
+	--pools[0].jobs[0].fs_ctx_map.alloc;
+	--pools[0].jobs[0].fs_ctx_map.demand;
+	sel.add_preempted_map(first);
+	assert(sel.maps_left() == (size_t)nmaps / 2 + 1);
+
+	for (int i = 1; i < 100; ++i) {
+		td_ref *t = sel.pop_map(20);
+		assert(t->idx() == (size_t)i);
+	}
+	assert(sel.maps_seen() == (size_t)nmaps + 1);
+	assert(sel.refs() == 101);
+	// the preempted attempt is over, its copy stays
+	sel.release(first);
+	assert(sel.refs() == 100);
+	size_t last = 99;
+	for (int i = 99; i < nmaps; ++i) {
+		size_t k = sel.pop_map(20)->idx();
+		if (k == 0)
+			assert(last == (size_t)nmaps / 2 - 1);
+		else
+			assert(k == (last? last + 1: (size_t)nmaps / 2));
+		last = k;
+	}
+	assert(last == (size_t)nmaps - 1 && !sel.has_map());
+
+	// a task created at each tick, latest first in the trace
+	std::deque<pool> pools2;
+	pools2.push_back(pool("analyst", -1, -1, 1, 0, 0, pool::SCHED_FAIR));
+	job j2;
+	j2.id = 2;
+	j2.fs_ctx_map.uid = j2.id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = nmaps - i;
+		t.ptime = 1;
+		t.stime = -1;
+		t.ftime = -1;
+		j2.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	pools2[0].add_job(j2);
+	selector sel2(pools2.begin(), pools2.end());
+	assert(sel2.map_min_ctime() == 1);
+	sel2.see_maps(nmaps / 2);
+	assert(sel2.maps_seen() == (size_t)nmaps / 2 && sel2.refs() == 0);
+	for (int i = 1; i <= nmaps; ++i)
+		assert(sel2.pop_map(i)->ctime() == i);
+	assert(!sel2.has_map());
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+//
+// Take map slots away from the cluster while maps are running, then
+// add more than before. The latest started maps are requeued and
+// restart once the slots come back.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+job make_job()
+{
+	job j;
+	j.id = 1;
+	j.ctime = 0;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < 4; ++i) {
+		task t;
+		t.ctime = 0;
+		t.ptime = 100;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	return j;
+}
+
+int main()
+{
+	char file[] = "/tmp/colossal_capacity_XXXXXX";
+	int fd = mkstemp(file);
+	assert(fd != -1);
+	close(fd);
+	FILE *fp = fopen(file, "w");
+	assert(fp);
+	fprintf(fp, "# time\tmaps\treduces\n");
+	fprintf(fp, "%lf\t2\t1\n", 50.0 / TICKS_PER_MSEC);
+	fprintf(fp, "%lf\t6\t1\n", 60.0 / TICKS_PER_MSEC);
+	fclose(fp);
+
+	job_tracker jt(4, 1);
+	jt.set_progress(false);
+	assert(import_capacity(file, &jt) == 0);
+	unlink(file);
+
+	pool &p = jt.add_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	p.add_job(make_job());
+	jt.set_record_times(true);
+	jt.process();
+
+	const job::task_container_type &maps = p.jobs[0].tasks[task::TASK_TYPE_MAP];
+	int early = 0, late = 0;
+	for (size_t i = 0; i < maps.size(); ++i) {
+		if (maps[i].stime == 0 && maps[i].ftime == 100)
+			++early;
+		if (maps[i].stime == 60 && maps[i].ftime == 160)
+			++late;
+	}
+	assert(early == 2 && late == 2);
+	assert(p.jobs[0].work_left == 0);
+	assert(p.fs_ctx_map.alloc == 0 && p.fs_ctx_map.demand == 0);
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+//
+// Free slot lookup and block placement of the node model, and delay
+// scheduling of maps whose blocks are all on one busy node.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <algorithm>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+void test_lookup()
+{
+	cluster c(200, 20, 1, 1);
+	assert(c.racks() == 10);
+	assert(c.slots(task::TASK_TYPE_MAP) == 200);
+
+	// occupy all map slots but one
+	for (int i = 0; i < 200; ++i)
+		if (i != 150)
+			c.take(task::TASK_TYPE_MAP, i);
+
+	cluster::locality level;
+	int near[] = { 145 };
+	int far[] = { 3 };
+	assert(c.find(task::TASK_TYPE_MAP, NULL, 0, cluster::LOCALITY_OFF_RACK, &level) == 150);
+	assert(c.find(task::TASK_TYPE_MAP, near, 1, cluster::LOCALITY_RACK, &level) == 150);
+	assert(level == cluster::LOCALITY_RACK);
+	assert(c.find(task::TASK_TYPE_MAP, far, 1, cluster::LOCALITY_RACK, &level) == -1);
+	assert(c.find(task::TASK_TYPE_MAP, far, 1, cluster::LOCALITY_OFF_RACK, &level) == 150);
+	assert(level == cluster::LOCALITY_OFF_RACK);
+
+	c.take(task::TASK_TYPE_MAP, 150);
+	assert(c.find(task::TASK_TYPE_MAP, NULL, 0, cluster::LOCALITY_OFF_RACK, &level) == -1);
+	c.release(task::TASK_TYPE_MAP, 3);
+	assert(c.find(task::TASK_TYPE_MAP, far, 1, cluster::LOCALITY_NODE, &level) == 3);
+	assert(level == cluster::LOCALITY_NODE);
+	assert(c.find(task::TASK_TYPE_REDUCE, NULL, 0, cluster::LOCALITY_OFF_RACK, &level) == 0);
+
+	// synthesized replicas: one node, then two on another rack
+	int nodes[cluster::MAX_REPLICAS];
+	for (uint64_t id = 0; id < 1000; ++id) {
+		assert(c.blocks(id, nodes) == 3);
+		assert(c.rack_of(nodes[0]) != c.rack_of(nodes[1]));
+		assert(c.rack_of(nodes[1]) == c.rack_of(nodes[2]));
+		assert(nodes[1] != nodes[2]);
+	}
+	assert(c.add_block(7, 42) == 0);
+	assert(c.blocks(7, nodes) == 1 && nodes[0] == 42);
+	assert(c.add_block(7, 200) == -1);
+}
+
+job make_job()
+{
+	job j;
+	j.id = 1;
+	j.ctime = 0;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < 3; ++i) {
+		task t;
+		t.ctime = 0;
+		t.ptime = 100;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	return j;
+}
+
+// two single-node racks with a map slot each, and all blocks on node 0
+void run(sim_time delay, sim_time *ftime, job_tracker **out)
+{
+	cluster *c = new cluster(2, 1, 1, 1);
+	c->set_delay(delay);
+	c->set_inflation(1.5, 2.0);
+	job mj = make_job();
+	for (int i = 0; i < 3; ++i)
+		assert(c->add_block(mj.task_id(task::TASK_TYPE_MAP, i), 0) == 0);
+
+	job_tracker *jt = new job_tracker(1, 1);
+	jt->set_progress(false);
+	jt->set_cluster(c);
+	pool &p = jt->add_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	p.add_job(mj);
+	jt->set_record_times(true);
+	jt->process();
+
+	const job &j = p.jobs[0];
+	for (int i = 0; i < 3; ++i) {
+		task t = j.tasks[task::TASK_TYPE_MAP][i];
+		assert(t.ftime == t.stime + t.ptime);
+		ftime[i] = t.ftime;
+	}
+	std::sort(ftime, ftime + 3);
+	assert(j.work_left == 0);
+	assert(p.fs_ctx_map.alloc == 0 && p.fs_ctx_map.demand == 0);
+	assert(jt->getpools().size() == 1);
+	*out = jt;
+}
+
+int main()
+{
+	test_lookup();
+
+	sim_time ft[3];
+	job_tracker *jt;
+
+	// without delay, one map runs off-rack right away at twice the time
+	run(0, ft, &jt);
+	assert(ft[0] == 100 && ft[1] == 200 && ft[2] == 200);
+	assert(jt->launches(cluster::LOCALITY_NODE) == 2);
+	assert(jt->launches(cluster::LOCALITY_OFF_RACK) == 1);
+	delete jt;
+
+	// with a long delay, all maps wait for node 0
+	run(1000, ft, &jt);
+	assert(ft[0] == 100 && ft[1] == 200 && ft[2] == 300);
+	assert(jt->launches(cluster::LOCALITY_NODE) == 3);
+	delete jt;
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+//
+// Write decision logs of the same workload twice and with one more
+// slot, and diff them. Then round-trip synthetic decisions across
+// many blocks.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+job make_job(int id)
+{
+	job j;
+	j.id = id;
+	j.ctime = id * 7;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < 30; ++i) {
+		task t;
+		t.ctime = j.ctime;
+		t.ptime = 10 + (id * 31 + i * 17) % 50;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[i < 25? task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE].push_back(t);
+	}
+	return j;
+}
+
+size_t run(const char *file, int nmaps)
+{
+	job_tracker jt(nmaps, 4);
+	jt.set_progress(false);
+	assert(jt.set_decisions(file));
+	pool &p1 = jt.add_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	pool &p2 = jt.add_pool("adhoc", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	for (int i = 1; i <= 20; ++i)
+		(i % 2? p1: p2).add_job(make_job(i));
+	jt.set_record_times(true);
+	jt.process();
+
+	// each task is launched at its start and finished at its finish
+	std::map<uint64_t, task> tasks;
+	for (int k = 0; k < 2; ++k) {
+		const pool &p = k? p2: p1;
+		for (size_t i = 0; i < p.jobs.size(); ++i)
+			for (int type = 0; type < task::TASK_TYPE_NUM; ++type)
+				for (size_t m = 0; m < p.jobs[i].tasks[type].size(); ++m)
+					tasks[p.jobs[i].task_id((task::task_type)type, m)] = p.jobs[i].tasks[type][m];
+	}
+	decision_reader rd;
+	assert(rd.open(file) == 0);
+	decision d;
+	size_t n = 0;
+	int ret;
+	while ((ret = rd.next(&d)) > 0) {
+		std::map<uint64_t, task>::const_iterator it = tasks.find(d.id);
+		assert(it != tasks.end());
+		assert(d.time == (d.what == decision::LAUNCH? it->second.stime: it->second.ftime));
+		++n;
+	}
+	assert(ret == 0);
+	return n;
+}
+
+int main()
+{
+	char a[] = "/tmp/colossal_decision_XXXXXX";
+	char b[] = "/tmp/colossal_decision_XXXXXX";
+	int fd = mkstemp(a);
+	assert(fd != -1);
+	close(fd);
+	fd = mkstemp(b);
+	assert(fd != -1);
+	close(fd);
+
+	uint64_t pos;
+	assert(run(a, 8) == 20 * 30 * 2);
+	assert(run(b, 8) == 20 * 30 * 2);
+	assert(diff_decisions(a, b, &pos) == 0);
+	assert(pos == 20 * 30 * 2);
+	run(b, 9);
+	assert(diff_decisions(a, b, &pos) == 1);
+	assert(pos > 0 && pos < 20 * 30 * 2);
+
+	// synthetic decisions over many blocks, with backward steps
+	std::vector<decision> ds;
+	decision_writer wr;
+	assert(wr.open(a) == 0);
+	sim_time t = 1000;
+	for (int i = 0; i < 300000; ++i) {
+		decision d;
+		d.what = (decision::decision_kind)(rand() % 4);
+		d.type = (task::task_type)(rand() % 2);
+		t += rand() % 3? rand() % 10: rand() % 100000 - 20000;
+		d.time = t;
+		d.id = rand() % 2? ds.size() - rand() % std::min(ds.size() + 1, (size_t)64):
+			((uint64_t)rand() << 40) ^ rand();
+		wr.add(d.what, d.type, d.time, d.id);
+		ds.push_back(d);
+	}
+	assert(wr.size() == ds.size());
+	assert(wr.close() == 0);
+
+	decision_reader rd;
+	assert(rd.open(a) == 0);
+	decision d;
+	for (size_t i = 0; i < ds.size(); ++i) {
+		assert(rd.next(&d) == 1);
+		assert(d == ds[i]);
+	}
+	assert(rd.next(&d) == 0);
+
+	// a prefix diverges at its end
+	assert(wr.open(b) == 0);
+	for (size_t i = 0; i < 1000; ++i)
+		wr.add(ds[i].what, ds[i].type, ds[i].time, ds[i].id);
+	assert(wr.close() == 0);
+	assert(diff_decisions(a, b, &pos) == 1 && pos == 1000);
+
+	unlink(a);
+	unlink(b);
+
+	printf("passed\n");
+
+	return 0;
+}
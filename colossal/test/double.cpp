@@ -16,6 +16,7 @@ int main()
 	mod.add_job(j1);
 	mod.add_job(j2);
 
+	jt.set_record_times(true);
 	jt.process();
 
 	printf("------------ WORKLOAD ------------\n");
@@ -0,0 +1,152 @@
+//
+// Check the DRF fair shares on the example of the DRF paper and on
+// random pools against bisection, then run pools with differently
+// shaped containers in the container mode, with and without
+// preemption.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+// Resources used at a ratio
+resource usage(const std::vector<drf_user> &users, const resource &cap, double r)
+{
+	resource use;
+	for (size_t i = 0; i < users.size(); ++i) {
+		const fs_context *c = users[i].ctx;
+		double dom = users[i].size.dominant(cap);
+		double x = std::min((double)c->demand, std::max(c->weight * r / dom, c->minshare));
+		use += users[i].size * x;
+	}
+	return use;
+}
+
+void check_random()
+{
+	const int n = 300;
+	std::vector<fs_context> ctx(n);
+	std::vector<drf_user> users(n);
+	resource cap(2000000, 4000);
+	for (int i = 0; i < n; ++i) {
+		ctx[i].weight = 1 + rand() % 4;
+		ctx[i].minshare = rand() % 3;
+		ctx[i].demand = rand() % 50;
+		users[i].ctx = &ctx[i];
+		users[i].size = resource(256 + rand() % 4096, 1 + rand() % 4);
+	}
+	double r = compute_drf_shares(users, cap);
+
+	// the largest ratio within the capacity, by bisection
+	double lo = 0, hi = 1;
+	while (usage(users, cap, hi).fits(cap) && hi < 1e9)
+		hi *= 2;
+	for (int k = 0; k < 100; ++k) {
+		double m = (lo + hi) / 2;
+		if (usage(users, cap, m).fits(cap))
+			lo = m;
+		else
+			hi = m;
+	}
+	assert(fabs(r - lo) < 1e-6 * std::max(1.0, lo));
+
+	resource use;
+	for (int i = 0; i < n; ++i) {
+		assert(ctx[i].fairshare <= ctx[i].demand + PRECISION);
+		use += users[i].size * ctx[i].fairshare;
+	}
+	for (int k = 0; k < resource::RESOURCE_NUM; ++k)
+		assert(use[k] <= cap[k] * (1 + 1e-9));
+}
+
+job make_job(uint64_t id, sim_time ctime, int nmaps, sim_time ptime)
+{
+	job j;
+	j.id = id;
+	j.ctime = ctime;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = ctime;
+		t.ptime = ptime;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	return j;
+}
+
+int started(const pool &p, sim_time t)
+{
+	const job::task_container_type &maps = p.jobs[0].tasks[task::TASK_TYPE_MAP];
+	int n = 0;
+	for (size_t i = 0; i < maps.size(); ++i) {
+		assert(maps[i].ftime > 0);
+		if (maps[i].stime == t)
+			++n;
+	}
+	return n;
+}
+
+int main()
+{
+	// 9 CPUs and 18 GB shared by tasks of <1 CPU, 4 GB> and <3 CPUs, 1 GB>
+	resource cap(18, 9);
+	fs_context a, b;
+	a.demand = b.demand = 100;
+	a.uid = 1;
+	b.uid = 2;
+	std::vector<drf_user> users(2);
+	users[0].ctx = &a;
+	users[0].size = resource(4, 1);
+	users[1].ctx = &b;
+	users[1].size = resource(1, 3);
+	compute_drf_shares(users, cap);
+	assert(double_equal(a.fairshare, 3) && double_equal(b.fairshare, 2));
+
+	check_random();
+
+	// the same in the engine
+	{
+		job_tracker jt(1, 1);
+		jt.set_progress(false);
+		assert(jt.set_containers(cap, resource(1, 1), resource(1, 1)));
+		pool &pa = jt.add_pool("analyst", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+		pool &pb = jt.add_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+		pa.containers[task::TASK_TYPE_MAP] = resource(4, 1);
+		pb.containers[task::TASK_TYPE_MAP] = resource(1, 3);
+		pa.add_job(make_job(1, 0, 10, 100));
+		pb.add_job(make_job(2, 0, 10, 100));
+		jt.set_record_times(true);
+		jt.process();
+		assert(started(pa, 0) == 3 && started(pb, 0) == 2);
+		assert(pa.fs_ctx_map.alloc == 0 && pb.fs_ctx_map.alloc == 0);
+	}
+
+	// prod starves below its min share, and analyst gives up the CPUs
+	// of two prod tasks rather than two tasks
+	{
+		job_tracker jt(1, 1);
+		jt.set_progress(false);
+		assert(jt.set_containers(cap, resource(2, 1), resource(1, 1)));
+		pool &pa = jt.add_pool("analyst", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+		pool &pb = jt.add_pool("prod", 50, -1, 1, 2, 0, pool::SCHED_FAIR);
+		pb.containers[task::TASK_TYPE_MAP] = resource(1, 3);
+		pa.add_job(make_job(1, 0, 9, 1000));
+		pb.add_job(make_job(2, 10, 2, 100));
+		jt.set_record_times(true);
+		jt.process();
+		assert(started(pb, 60) == 2);
+		assert(started(pa, 0) == 3);
+	}
+
+	printf("passed\n");
+
+	return 0;
+}
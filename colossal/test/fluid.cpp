@@ -0,0 +1,118 @@
+//
+// Compare the fluid approximation with the engine, first where it is
+// exact and then on a random workload, and tune pools by it.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+void add_job(pool &p, uint64_t id, sim_time ctime, int nmaps, int nreduces, sim_time ptime)
+{
+	job j;
+	j.id = id;
+	j.ctime = ctime;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int type = 0; type < task::TASK_TYPE_NUM; ++type) {
+		int n = type == task::TASK_TYPE_MAP? nmaps: nreduces;
+		for (int k = 0; k < n; ++k) {
+			task t;
+			t.ctime = ctime;
+			t.ptime = ptime < 0? 1 + rand() % -ptime: ptime;
+			t.stime = -1;
+			t.ftime = -1;
+			j.tasks[type].push_back(t);
+		}
+	}
+	p.add_job(j);
+}
+
+sim_time finish(const job &j)
+{
+	sim_time fin = -1;
+	for (int type = 0; type < task::TASK_TYPE_NUM; ++type)
+		for (size_t k = 0; k < j.tasks[type].size(); ++k)
+			fin = std::max(fin, j.tasks[type][k].ftime);
+	return fin;
+}
+
+int main()
+{
+	// two pools splitting the slots evenly, and a FCFS pool
+	{
+		job_tracker jt(10, 10);
+		jt.set_progress(false);
+		pool &a = jt.add_pool("a", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+		pool &b = jt.add_pool("b", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+		add_job(a, 1, 0, 10, 0, 100);
+		add_job(b, 2, 0, 10, 0, 100);
+		engine::pool_container_type approx = jt.getpools();
+		fluid_model fm(10, 10);
+		fm.process(&approx);
+		jt.process();
+		assert(finish(approx[0].jobs[0]) == 200 && finish(approx[1].jobs[0]) == 200);
+		fluid_error err = fluid_model::error(approx, jt.getpools());
+		assert(err.jobs == 2 && err.max == 0);
+
+		engine::pool_container_type fcfs;
+		fcfs.push_back(pool("c", -1, -1, 1, 0, 0, pool::SCHED_FCFS));
+		add_job(fcfs[0], 3, 0, 10, 0, 100);
+		add_job(fcfs[0], 4, 0, 10, 0, 100);
+		fm.process(&fcfs);
+		assert(finish(fcfs[0].jobs[0]) == 100 && finish(fcfs[0].jobs[1]) == 200);
+	}
+
+	// random jobs in pools of different weights and min shares
+	{
+		job_tracker jt(40, 20);
+		jt.set_progress(false);
+		pool &a = jt.add_pool("analyst", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+		pool &m = jt.add_pool("modeling", -1, -1, 2, 5, 5, pool::SCHED_FAIR);
+		pool &p = jt.add_pool("prod", -1, -1, 4, 10, 5, pool::SCHED_FCFS);
+		pool *pools[] = { &a, &m, &p };
+		srand(1);
+		const int njobs = 300;
+		for (int i = 0; i < njobs; ++i)
+			add_job(*pools[i % 3], i + 1, i * 200, 1 + rand() % 40, rand() % 10, -500);
+		jt.scale_minshares();
+		engine::pool_container_type approx = jt.getpools();
+		fluid_model fm(40, 20);
+		fm.process(&approx);
+		jt.process();
+		fluid_error err = fluid_model::error(approx, jt.getpools());
+		printf("%d jobs in %d breakpoints, mape %.3f bias %.3f max %.3f\n",
+		       (int)err.jobs, (int)fm.breakpoints(), err.mape, err.bias, err.max);
+		assert(err.jobs == njobs);
+		assert(fm.breakpoints() <= 4 * njobs);
+		assert(err.mape < 0.2);
+	}
+
+	// tune the pools of the optimizer test by the fluid model
+	{
+		job_tracker jt(10, 10);
+		pool &batch = jt.add_pool("batch", -1, -1, 10, 0, 0, pool::SCHED_FAIR);
+		pool &sla = jt.add_pool("sla", -1, -1, 0.1, 0, 0, pool::SCHED_FAIR);
+		for (int i = 0; i < 20; ++i)
+			add_job(batch, 1000 + i, i * 50, 20, 0, 100);
+		for (int i = 0; i < 40; ++i)
+			add_job(sla, 2000 + i, i * 25, 2, 0, 10);
+
+		latency_objective obj(0.95);
+		obj.set_weight("batch", 0.1);
+		obj.set_sla("sla", 50);
+		pool_optimizer opt(10, 10, jt.getpools(), obj, 4);
+		opt.seed(1);
+		opt.set_fluid(true);
+		double init = opt.initial_value();
+		double best = opt.run(10);
+		assert(best < init);
+	}
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+//
+// Parse synthetic Hadoop job history files with one and several
+// threads, and load the written traces, in text and binary, into the
+// same pools.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string>
+#include <colossal/colossal.hpp>
+
+const char *queues[] = { "analyst", "modeling", "prod" };
+const char *prios[] = { "NORMAL", "HIGH", "VERY_HIGH" };
+
+int nattempts = 0;
+
+void gen_job(FILE *fp, int job, bool finish)
+{
+	long long t = 1409962533962ll + job * 1000;
+	fprintf(fp, "Meta VERSION=\"1\" .\n");
+	fprintf(fp, "Job JOBID=\"job_201408150243_%d\" JOBNAME=\"select \\\"a\\\"\n"
+		"from b\" USER=\"u\" SUBMIT_TIME=\"%lld\" JOBCONF=\"hdfs://x/job\\.xml\" "
+		"VIEW_JOB=\"*\" MODIFY_JOB=\"*\" JOB_QUEUE=\"%s\" .\n",
+		job, t, queues[job % 3]);
+	fprintf(fp, "Job JOBID=\"job_201408150243_%d\" JOB_PRIORITY=\"NORMAL\" .\n", job);
+	fprintf(fp, "Job JOBID=\"job_201408150243_%d\" LAUNCH_TIME=\"%lld\" TOTAL_MAPS=\"8\" "
+		"TOTAL_REDUCES=\"2\" JOB_STATUS=\"PREP\" .\n", job, t + 139);
+	fprintf(fp, "Job JOBID=\"job_201408150243_%d\" JOB_PRIORITY=\"%s\" .\n",
+		job, prios[job % 3]);
+	for (int i = 0; i < 10; ++i) {
+		const char *type = i == 0? "SETUP": (i < 8? "MAP": (i == 9? "CLEANUP": "REDUCE"));
+		const char *rec = i < 8? "MapAttempt": "ReduceAttempt";
+		char c = i < 8? 'm': 'r';
+		long long s = t + 500 + i * 37;
+		fprintf(fp, "Task TASKID=\"task_201408150243_%d_%c_%06d\" TASK_TYPE=\"%s\" "
+			"START_TIME=\"%lld\" SPLITS=\"\" .\n", job, c, i, type, s);
+		fprintf(fp, "%s TASK_TYPE=\"%s\" TASKID=\"task_201408150243_%d_%c_%06d\" "
+			"TASK_ATTEMPT_ID=\"attempt_201408150243_%d_%c_%06d_0\" START_TIME=\"%lld\" "
+			"TRACKER_NAME=\"tracker_slave7:localhost/127\\.0\\.0\\.1:36585\" HTTP_PORT=\"50060\" .\n",
+			rec, type, job, c, i, job, c, i, s);
+		if (i == 5)
+			continue;  // never finished
+		fprintf(fp, "%s TASK_TYPE=\"%s\" TASKID=\"task_201408150243_%d_%c_%06d\" "
+			"TASK_ATTEMPT_ID=\"attempt_201408150243_%d_%c_%06d_0\" TASK_STATUS=\"SUCCESS\" "
+			"FINISH_TIME=\"%lld\" HOSTNAME=\"/default/slave5\" STATE_STRING=\"\" "
+			"COUNTERS=\"{(FileSystemCounters)(FileSystemCounters)[(FILE_BYTES_READ)(FILE_BYTES_READ)(%d)]}\" .\n",
+			rec, type, job, c, i, job, c, i, s + 1000 + rand() % 5000, rand());
+		if (finish)
+			++nattempts;
+	}
+	if (finish)
+		fprintf(fp, "Job JOBID=\"job_201408150243_%d\" FINISH_TIME=\"%lld\" JOB_STATUS=\"SUCCESS\" "
+			"FINISHED_MAPS=\"7\" FINISHED_REDUCES=\"2\" FAILED_MAPS=\"0\" FAILED_REDUCES=\"0\" "
+			"MAP_COUNTERS=\"{}\" .\n", job, t + 90000);
+}
+
+void add_pools(colossal::job_tracker &jt)
+{
+	for (int i = 0; i < 3; ++i)
+		jt.add_pool(queues[i], -1, -1, 1, 1, 1, colossal::pool::SCHED_FAIR);
+}
+
+std::string pools_str(colossal::job_tracker &jt)
+{
+	std::string s;
+	colossal::job_tracker::pool_container_type::const_iterator it;
+	for (it = jt.getpools().begin(); it != jt.getpools().end(); ++it)
+		s += it->to_str() + "\n";
+	return s;
+}
+
+int main()
+{
+	// two concatenated history files, the later jobs first
+	char hist1[] = "/tmp/colossal_history_XXXXXX";
+	char hist2[] = "/tmp/colossal_history_XXXXXX";
+	char text[] = "/tmp/colossal_history_XXXXXX";
+	char bin[] = "/tmp/colossal_history_XXXXXX";
+	char *files[] = { hist1, hist2, text, bin };
+	for (int i = 0; i < 4; ++i) {
+		int fd = mkstemp(files[i]);
+		assert(fd != -1);
+		close(fd);
+	}
+	FILE *fp = fopen(hist1, "w");
+	assert(fp);
+	for (int j = 500; j < 1000; ++j)
+		gen_job(fp, j, j % 50 != 0);
+	fclose(fp);
+	fp = fopen(hist2, "w");
+	assert(fp);
+	for (int j = 0; j < 500; ++j)
+		gen_job(fp, j, j % 50 != 0);
+	fclose(fp);
+
+	std::string expected;
+	for (int n = 1; n <= 8; n *= 8) {
+		colossal::history_parser hp(n);
+		assert(hp.parse(hist1) == 0);
+		assert(hp.parse(hist2) == 0);
+		assert(hp.skipped() == 0);
+		assert(hp.write(text) == 0);
+		assert(hp.jobs() == 980);
+		assert(hp.attempts() == (size_t)nattempts);
+		assert(hp.write(bin, true) == 0);
+		assert(hp.attempts() == (size_t)nattempts);
+
+		// sorted by the launch time, with the last priority
+		char line[1024];
+		fp = fopen(text, "r");
+		assert(fp && fgets(line, sizeof(line), fp));
+		fclose(fp);
+		const char *first = "modeling\tjob_201408150243_1:HIGH\t"
+			"attempt_201408150243_1_m_000000_0\tMAP\t"
+			"1409962535101\t1409962535462\t";
+		assert(strncmp(line, first, strlen(first)) == 0);
+
+		colossal::job_tracker jt1(10, 10);
+		colossal::job_tracker jt2(10, 10);
+		add_pools(jt1);
+		add_pools(jt2);
+		colossal::workload_loader tl(colossal::workload_loader::FORMAT_STFT, 4);
+		colossal::workload_loader bl(colossal::workload_loader::FORMAT_STFT, 4);
+		assert(tl.load(text, &jt1.getpools()) == 0);
+		assert(bl.load(bin, &jt2.getpools()) == 0);
+		assert(tl.records() == (size_t)nattempts);
+		assert(bl.records() == (size_t)nattempts);
+		std::string s = pools_str(jt1);
+		assert(s == pools_str(jt2));
+		if (expected.empty())
+			expected = s;
+		assert(s == expected);
+	}
+
+	// a window of the binary trace
+	colossal::job_tracker jt3(10, 10);
+	add_pools(jt3);
+	colossal::workload_loader win(colossal::workload_loader::FORMAT_STFT, 2);
+	win.set_window(1409962633000ll * colossal::TICKS_PER_MSEC,
+		       1409962733000ll * colossal::TICKS_PER_MSEC);
+	assert(win.load(bin, &jt3.getpools()) == 0);
+	assert(win.records() == 98 * 9);
+
+	// a binary trace of another tick unit is refused
+	fp = fopen(bin, "r+b");
+	assert(fp && fseek(fp, 8, SEEK_SET) == 0);
+	uint64_t ticks = colossal::TICKS_PER_MSEC * 1000;
+	assert(fwrite(&ticks, sizeof(ticks), 1, fp) == 1);
+	fclose(fp);
+	colossal::job_tracker jt4(10, 10);
+	add_pools(jt4);
+	assert(win.load(bin, &jt4.getpools()) == -1);
+
+	for (int i = 0; i < 4; ++i)
+		unlink(files[i]);
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+//
+// Average the pool metrics over fixed intervals of simulated time,
+// and make sure the averages add up to the exact integrals: the total
+// allocation is the total run time of the tasks. The demand counts the
+// tasks from when the scheduler sees them, after their creation.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <math.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+job make_job(uint64_t id, sim_time ctime, int nmaps, sim_time ptime)
+{
+	job j;
+	j.id = id;
+	j.ctime = ctime;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = ctime;
+		t.ptime = ptime + i * 7;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	return j;
+}
+
+int main()
+{
+	char file[] = "/tmp/colossal_integral_XXXXXX";
+	int fd = mkstemp(file);
+	assert(fd != -1);
+	close(fd);
+
+	const sim_time interval = 30;
+	job_tracker jt(3, 1);
+	jt.set_progress(false);
+	assert(jt.set_metrics(file, 1, interval));
+	pool &a = jt.add_pool("analyst", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	pool &b = jt.add_pool("prod", -1, -1, 4, 2, 0, pool::SCHED_FAIR);
+	a.add_job(make_job(1, 0, 5, 100));
+	b.add_job(make_job(2, 45, 4, 60));
+	jt.set_record_times(true);
+	jt.process();
+
+	double run = 0, wait = 0;
+	sim_time end = 0;
+	for (int i = 0; i < 2; ++i) {
+		const pool &p = i? b: a;
+		const job::task_container_type &maps = p.jobs[0].tasks[task::TASK_TYPE_MAP];
+		for (size_t k = 0; k < maps.size(); ++k) {
+			assert(maps[k].ftime > 0);
+			run += maps[k].ftime - maps[k].stime;
+			wait += maps[k].ftime - maps[k].ctime;
+			if (maps[k].ftime > end)
+				end = maps[k].ftime;
+		}
+	}
+
+	// sum the averages times the interval lengths
+	FILE *fp = fopen(file, "r");
+	assert(fp);
+	char line[256], pname[64], type[16], name[64];
+	long long t, last = 0, prev = 0;
+	double value, alloc = 0, demand = 0, deficit = 0, below = 0;
+	int nkeys = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		assert(sscanf(line, "%lld\t%63s\t%15s\t%63s\t%lf", &t, pname, type, name, &value) == 5);
+		if (t != last) {
+			assert(t > last);
+			prev = last;
+			last = t;
+			++nkeys;
+			// all intervals but the last are full
+			assert(t - prev == interval || t == end);
+		}
+		if (strcmp(type, "map"))
+			continue;
+		if (!strcmp(name, "avgRunningTasks"))
+			alloc += value * (t - prev);
+		else if (!strcmp(name, "avgDemand"))
+			demand += value * (t - prev);
+		else if (!strcmp(name, "avgFairShareDeficit"))
+			deficit += value * (t - prev);
+		else if (!strcmp(name, "belowMinShare")) {
+			assert(value >= 0 && value <= 1);
+			below += value * (t - prev);
+		}
+	}
+	fclose(fp);
+	unlink(file);
+
+	assert(last == end);
+	assert(nkeys == (end + interval - 1) / interval);
+	assert(fabs(alloc - run) < 1e-3);
+	assert(demand > run && demand <= wait + 1e-3);
+	// prod arrives while analyst holds all the slots
+	assert(deficit > 0 && below > 0);
+
+	printf("passed\n");
+
+	return 0;
+}
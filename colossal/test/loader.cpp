@@ -0,0 +1,124 @@
+//
+// Load a generated trace sequentially and in parallel, and make sure
+// both produce the same pools, trimmed to size. Then load a time
+// window of it through the sidecar index, and a trace with job
+// deadlines.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <vector>
+#include <colossal/colossal.hpp>
+
+const char *pools[] = { "analyst", "modeling", "prod" };
+const char *prios[] = { "NORMAL", "HIGH", "VERY_HIGH" };
+
+std::vector<long long> ctimes;
+
+void gen_trace(const char *file, int nlines)
+{
+	FILE *fp = fopen(file, "w");
+	assert(fp);
+	long long t = 1403620325026ll;
+	for (int i = 0; i < nlines; ++i) {
+		int job = i / 37;
+		t += rand() % 100;
+		ctimes.push_back(t);
+		fprintf(fp, "%s\tjob_%d:%s\ttask_%d_%d\t%s\t%lld\t%lld\t%lld\n",
+			pools[job % 3], job, prios[job % 3], job, i,
+			rand() % 4? "MAP": "REDUCE", t, t + 7, t + 7 + rand() % 5000);
+	}
+	fclose(fp);
+}
+
+void add_pools(colossal::job_tracker &jt)
+{
+	for (int i = 0; i < 3; ++i)
+		jt.add_pool(pools[i], -1, -1, 1, 1, 1, colossal::pool::SCHED_FAIR);
+}
+
+int main()
+{
+	char file[] = "/tmp/colossal_loader_XXXXXX";
+	int fd = mkstemp(file);
+	assert(fd != -1);
+	close(fd);
+	gen_trace(file, 100000);
+
+	colossal::job_tracker jt1(10, 10);
+	colossal::job_tracker jt2(10, 10);
+	add_pools(jt1);
+	add_pools(jt2);
+
+	colossal::workload_loader seq(colossal::workload_loader::FORMAT_STFT, 1);
+	colossal::workload_loader par(colossal::workload_loader::FORMAT_STFT, 8);
+	assert(seq.load(file, &jt1.getpools()) == 0);
+	assert(par.load(file, &jt2.getpools()) == 0);
+	assert(seq.records() == 100000);
+	assert(par.records() == 100000);
+
+	colossal::job_tracker::pool_container_type::const_iterator p1 = jt1.getpools().begin();
+	colossal::job_tracker::pool_container_type::const_iterator p2 = jt2.getpools().begin();
+	for (; p1 != jt1.getpools().end(); ++p1, ++p2)
+		assert(p1->to_str() == p2->to_str());
+
+	// the task containers are left without spare capacity
+	for (p2 = jt2.getpools().begin(); p2 != jt2.getpools().end(); ++p2)
+		for (size_t i = 0; i < p2->jobs.size(); ++i)
+			for (int type = 0; type < colossal::task::TASK_TYPE_NUM; ++type)
+				assert(p2->jobs[i].tasks[type].capacity() == p2->jobs[i].tasks[type].size());
+
+	// a window in the middle of the trace, with small buckets
+	long long begin = ctimes[30000] * colossal::TICKS_PER_MSEC;
+	long long end = ctimes[60000] * colossal::TICKS_PER_MSEC;
+	size_t expected = 0;
+	for (size_t i = 0; i < ctimes.size(); ++i)
+		if (ctimes[i] * colossal::TICKS_PER_MSEC >= begin && ctimes[i] * colossal::TICKS_PER_MSEC < end)
+			++expected;
+
+	colossal::trace_index idx;
+	assert(idx.build(file, 60000 * colossal::TICKS_PER_MSEC) == 0);
+	assert(idx.size() > 1);
+	assert(idx.seek(begin) > 0);
+	assert(idx.seek(end) > idx.seek(begin));
+
+	colossal::job_tracker jt3(10, 10);
+	add_pools(jt3);
+	colossal::workload_loader win(colossal::workload_loader::FORMAT_STFT, 4);
+	win.set_window(begin, end);
+	assert(win.load(file, &jt3.getpools()) == 0);
+	assert(win.records() == expected);
+
+	// the sidecar is reused on the second load
+	std::string sidecar = colossal::trace_index::sidecar(file);
+	assert(access(sidecar.c_str(), R_OK) == 0);
+	assert(idx.open(file) == 0);
+	assert(idx.bucket() == colossal::trace_index::DEFAULT_BUCKET);
+
+	unlink(sidecar.c_str());
+	unlink(file);
+
+	// the optional deadline column
+	FILE *fp = fopen(file, "w");
+	assert(fp);
+	fprintf(fp, "prod\tjob_1:HIGH\ttask_1\tMAP\t100\t10\t500\n");
+	fprintf(fp, "prod\tjob_1:HIGH\ttask_2\tREDUCE\t100\t20\n");
+	fprintf(fp, "prod\tjob_2:HIGH\ttask_3\tMAP\t200\t30\n");
+	fclose(fp);
+	colossal::job_tracker jt4(10, 10);
+	add_pools(jt4);
+	colossal::workload_loader ptime(colossal::workload_loader::FORMAT_PTIME, 2);
+	assert(ptime.load(file, &jt4.getpools()) == 0);
+	assert(ptime.records() == 3);
+	const colossal::pool &prod = jt4.getpools().back();
+	assert(prod.jobs.size() == 2);
+	assert(prod.jobs[0].deadline == 500 * colossal::TICKS_PER_MSEC);
+	assert(prod.jobs[1].deadline == -1);
+	unlink(file);
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+//
+// Log records from several threads through a small ring, so that the
+// producers wait for the writer, then decode the binary log and check
+// it against the synchronous text. Also check the runtime filters and
+// the text mode.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <ulib/os_thread.h>
+#include <colossal/colossal.hpp>
+#include <colossal/log.hpp>
+
+using namespace colossal;
+
+const int NTHREADS = 4;
+const int NRECS = 5000;
+
+const char *names[] = { "map", "reduce", "a rather long pool name over the payload" };
+
+std::string expected(int i, int j)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "[I] @%lld\tthread %d: %s %016llx %.3f %u%%",
+		 (long long)j * 10, i, names[j % 3], (unsigned long long)j << 32,
+		 j / 7.0, (unsigned)-j);
+	return buf;
+}
+
+class producer : public ulib::thread
+{
+public:
+	producer(int i) : _i(i) { }
+
+	int run()
+	{
+		for (int j = 0; j < NRECS; ++j) {
+			NOTICE(KIND_ENGINE, (sim_time)j * 10, "thread %d: %s %016llx %.3f %u%%",
+			       _i, names[j % 3], (unsigned long long)j << 32, j / 7.0, (unsigned)-j);
+			NOTICE_POOL(KIND_PREEMPT, 2, j, "filtered by pool %d", j);
+		}
+		return 0;
+	}
+
+private:
+	int _i;
+};
+
+int main()
+{
+	char file[] = "/tmp/colossal_logger_XXXXXX";
+	int fd = mkstemp(file);
+	assert(fd != -1);
+	close(fd);
+
+	logger::add_pool(1);
+	assert(logger::start(file, true, 16) == 0);
+	assert(logger::start(file, true) == -1);
+	std::vector<producer *> producers;
+	for (int i = 0; i < NTHREADS; ++i) {
+		producers.push_back(new producer(i));
+		assert(producers.back()->start() == 0);
+	}
+	for (int i = 0; i < NTHREADS; ++i) {
+		producers[i]->join();
+		delete producers[i];
+	}
+	NOTICE_POOL(KIND_PREEMPT, 1, 7, "kept for pool %d", 1);
+	logger::set_level(LEVEL_WARNING);
+	NOTICE(KIND_ENGINE, 8, "filtered by level");
+	logger::set_level(LEVEL_DEBUG);
+	logger::set_kinds(~(1u << KIND_CAPACITY));
+	NOTICE(KIND_CAPACITY, 9, "filtered by kind");
+	logger::set_kinds(~0u);
+	logger::stop();
+	assert(logger::stalls() > 0);
+
+	// the records of each thread are in order
+	log_reader reader;
+	assert(reader.open(file) == 0);
+	log_record r;
+	std::string line;
+	int next[NTHREADS] = { 0 };
+	int n = 0, ret;
+	while ((ret = reader.next(&r)) > 0) {
+		line.clear();
+		reader.format(r)->render(r, &line);
+		++n;
+		if (r.kind == KIND_PREEMPT) {
+			assert(r.pool == 1 && line == "[I] @7\tkept for pool 1");
+			continue;
+		}
+		int i = atoi(line.c_str() + line.find("thread ") + 7);
+		assert(i >= 0 && i < NTHREADS);
+		std::string exp = expected(i, next[i]++);
+		// strings are truncated to fit the payload
+		if (next[i] % 3 == 0)
+			assert(exp.compare(0, line.find("thread"), line, 0, line.find("thread")) == 0);
+		else
+			assert(line == exp);
+	}
+	assert(ret == 0);
+	assert(n == NTHREADS * NRECS + 1);
+	for (int i = 0; i < NTHREADS; ++i)
+		assert(next[i] == NRECS);
+
+	// the text mode writes the same lines as the synchronous fallback
+	logger::clear_pools();
+	assert(logger::start(file, false) == 0);
+	WARNING(KIND_ENGINE, 42, "%d of %d %ss", 3, 4, "map");
+	logger::stop();
+	FILE *fp = fopen(file, "r");
+	assert(fp);
+	char buf[256];
+	assert(fgets(buf, sizeof(buf), fp));
+	assert(strcmp(buf, "[W] @42\t3 of 4 maps\n") == 0);
+	assert(fgets(buf, sizeof(buf), fp) == NULL);
+	fclose(fp);
+	unlink(file);
+
+	printf("passed\n");
+
+	return 0;
+}
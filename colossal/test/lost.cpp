@@ -0,0 +1,92 @@
+//
+// A pool starved for its min share preempts two tasks, either from
+// the pool above its fair share or the youngest in the cluster, and
+// the lost slot time and the restart overhead are accounted.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+void add_job(pool &p, uint64_t id, sim_time ctime, int nmaps, sim_time ptime)
+{
+	job j;
+	j.id = id;
+	j.ctime = ctime;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = ctime;
+		t.ptime = ptime;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	p.add_job(j);
+}
+
+void run(engine::victim_policy victims, sim_time overhead,
+	 const preempt_stats *expected, sim_time longest)
+{
+	job_tracker jt(10, 10);
+	jt.set_progress(false);
+	jt.set_preemption(victims, overhead);
+	pool &a = jt.add_pool("a", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	pool &b = jt.add_pool("b", -1, -1, 3, 0, 0, pool::SCHED_FAIR);
+	pool &c = jt.add_pool("c", 50, -1, 1, 2, 0, pool::SCHED_FAIR);
+	add_job(a, 1, 0, 5, 1000);
+	add_job(b, 2, 100, 5, 1000);
+	add_job(c, 3, 200, 2, 1000);
+	jt.set_record_times(true);
+	jt.process();
+
+	pool *pools[] = { &a, &b, &c };
+	for (int i = 0; i < 3; ++i) {
+		const preempt_stats &ps = pools[i]->preempts[task::TASK_TYPE_MAP];
+		assert(ps.preempted == expected[i].preempted);
+		assert(ps.lost == expected[i].lost);
+		assert(ps.overhead == expected[i].overhead);
+		assert(ps.useful == expected[i].useful);
+		assert(pools[i]->jobs[0].lost == ps.lost);
+		const job::task_container_type &maps = pools[i]->jobs[0].tasks[task::TASK_TYPE_MAP];
+		for (size_t k = 0; k < maps.size(); ++k) {
+			assert(maps[k].ptime == 1000);
+			assert(maps[k].ftime - maps[k].stime <= longest);
+		}
+	}
+	assert(c.jobs[0].tasks[task::TASK_TYPE_MAP][0].stime == 250);
+}
+
+int main()
+{
+	// c is below its min share from 200 on, and preempts at 250
+	// the fair shares are 3, 5 and 2: a loses two tasks
+	preempt_stats fair[3];
+	fair[0].preempted = 2;
+	fair[0].lost = 500;
+	fair[0].useful = 5000;
+	fair[1].useful = 5000;
+	fair[2].useful = 2000;
+	run(engine::VICTIM_FAIR, 0, fair, 1000);
+
+	// b has the youngest tasks, and loses two
+	preempt_stats young[3];
+	young[0].useful = 5000;
+	young[1].preempted = 2;
+	young[1].lost = 300;
+	young[1].useful = 5000;
+	young[2].useful = 2000;
+	run(engine::VICTIM_MIN_LOST, 0, young, 1000);
+
+	// the restarts take 30 longer
+	young[1].overhead = 60;
+	run(engine::VICTIM_MIN_LOST, 30, young, 1030);
+	assert(double_equal(young[1].efficiency(), 5000.0 / 5360));
+
+	printf("passed\n");
+
+	return 0;
+}
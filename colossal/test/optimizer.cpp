@@ -0,0 +1,63 @@
+//
+// Tune two pools sharing a small cluster, where the short jobs of the
+// SLA pool are stuck behind the long jobs of the batch pool.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+void add_jobs(pool &p, int njobs, int ntasks, sim_time gap, sim_time ptime, uint64_t base)
+{
+	for (int i = 0; i < njobs; ++i) {
+		job j;
+		j.id = base + i;
+		j.ctime = i * gap;
+		j.fs_ctx_map.uid = j.id;
+		j.fs_ctx_reduce.uid = j.id;
+		for (int k = 0; k < ntasks; ++k) {
+			task t;
+			t.ctime = j.ctime;
+			t.ptime = ptime;
+			t.stime = -1;
+			t.ftime = -1;
+			j.tasks[task::TASK_TYPE_MAP].push_back(t);
+		}
+		p.add_job(j);
+	}
+}
+
+int main()
+{
+	job_tracker jt(10, 10);
+	pool &batch = jt.add_pool("batch", -1, -1, 10, 0, 0, pool::SCHED_FAIR);
+	pool &sla = jt.add_pool("sla", -1, -1, 0.1, 0, 0, pool::SCHED_FAIR);
+	add_jobs(batch, 20, 20, 50, 100, 1000);
+	add_jobs(sla, 40, 2, 25, 10, 2000);
+
+	latency_objective obj(0.95);
+	obj.set_weight("batch", 0.1);
+	obj.set_sla("sla", 50);
+
+	pool_optimizer opt(10, 10, jt.getpools(), obj, 4);
+	opt.seed(1);
+	double init = opt.initial_value();
+	double best = opt.run(10);
+	printf("objective %.1f -> %.1f in %d evaluations\n", init, best, opt.evaluations());
+	assert(best < init);
+
+	// the best configuration must reproduce the best value
+	engine::pool_container_type tuned = jt.getpools();
+	opt.apply_best(&tuned);
+	job_tracker jt2(10, 10);
+	jt2.getpools() = tuned;
+	jt2.scale_minshares();
+	jt2.process();
+	assert(obj(jt2.getpools()) == best);
+
+	printf("passed\n");
+
+	return 0;
+}
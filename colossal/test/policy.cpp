@@ -0,0 +1,81 @@
+//
+// Run the same jobs on a single map slot under each intra-pool policy
+// and check the order in which the jobs finish.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+job make_job(uint64_t id, sim_time ctime, int nmaps, sim_time ptime, sim_time deadline)
+{
+	job j;
+	j.id = id;
+	j.ctime = ctime;
+	j.deadline = deadline;
+	j.fs_ctx_map.uid = id;
+	j.fs_ctx_reduce.uid = id;
+	for (int i = 0; i < nmaps; ++i) {
+		task t;
+		t.ctime = ctime;
+		t.ptime = ptime;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	return j;
+}
+
+// finish time of each job, in the order of the jobs
+void run(pool::sched_mode sched, sim_time *ftime)
+{
+	job_tracker jt(1, 1);
+	jt.set_progress(false);
+	pool &p = jt.add_pool("prod", -1, -1, 1, 0, 0, sched);
+	p.add_job(make_job(1, 0, 1, 30, 40));  // A
+	p.add_job(make_job(2, 0, 3, 4, -1));   // B
+	p.add_job(make_job(3, 5, 1, 10, 20));  // D
+	jt.set_record_times(true);
+	jt.process();
+
+	for (size_t i = 0; i < p.jobs.size(); ++i) {
+		ftime[i] = 0;
+		const job::task_container_type &maps = p.jobs[i].tasks[task::TASK_TYPE_MAP];
+		for (size_t k = 0; k < maps.size(); ++k)
+			if (maps[k].ftime > ftime[i])
+				ftime[i] = maps[k].ftime;
+		assert(p.jobs[i].work_left == 0);
+	}
+}
+
+int main()
+{
+	sim_time ft[3];
+
+	run(pool::SCHED_FCFS, ft);
+	assert(ft[0] == 30 && ft[1] == 42 && ft[2] == 52);
+
+	// B goes first, then D is shorter than B as a whole
+	run(pool::SCHED_SJF, ft);
+	assert(ft[1] == 22 && ft[2] == 18 && ft[0] == 52);
+
+	// the last map of B is shorter than D
+	run(pool::SCHED_SRPT, ft);
+	assert(ft[1] == 12 && ft[2] == 22 && ft[0] == 52);
+
+	// jobs without a deadline go last
+	run(pool::SCHED_EDF, ft);
+	assert(ft[0] == 30 && ft[2] == 40 && ft[1] == 52);
+
+	pool::sched_mode sched;
+	assert(pool::sched_from_str("srpt", &sched) == 0 && sched == pool::SCHED_SRPT);
+	assert(pool::sched_from_str("fifo", &sched) == 0 && sched == pool::SCHED_FCFS);
+	assert(pool::sched_from_str("lifo", &sched) == -1);
+	assert(std::string(pool::sched_str(pool::SCHED_EDF)) == "edf");
+
+	printf("passed\n");
+
+	return 0;
+}
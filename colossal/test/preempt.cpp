@@ -7,29 +7,23 @@ int main()
         colossal::job j2;
 
 	colossal::task t1;
-	t1.id = 1;
 	t1.ctime = 0;
 	t1.ptime = 3;
 	t1.stime = -1;
 	t1.ftime = -1;
-	t1.type = colossal::task::TASK_TYPE_MAP;
 
 
 	colossal::task t2;
-	t2.id = 2;
 	t2.ctime = 0;
 	t2.ptime = 3;
 	t2.stime = -1;
 	t2.ftime = -1;
-	t2.type = colossal::task::TASK_TYPE_MAP;
 
 	colossal::task t3;
-	t3.id = 3;
 	t3.ctime = 1;
 	t3.ptime = 2;
 	t3.stime = -1;
 	t3.ftime = -1;
-	t3.type = colossal::task::TASK_TYPE_MAP;
 
 	j1.id = 1;
 	j1.tasks[colossal::task::TASK_TYPE_MAP].push_back(t1);
@@ -46,6 +40,7 @@ int main()
 	mod.add_job(j1);
 	prod.add_job(j2);
 
+	jt.set_record_times(true);
 	jt.process();
 
 	printf("------------ WORKLOAD ------------\n");
@@ -29,6 +29,7 @@ int main()
 	prod.add_job(j2);
 
 	jt.scale_minshares();
+	jt.set_record_times(true);
 	jt.process();
 
 	printf("------------ WORKLOAD ------------\n");
@@ -0,0 +1,59 @@
+//
+// Profile a small run. Without -DCOLOSSAL_PROFILE the profiler is
+// compiled out and set_profile() must refuse.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+int main()
+{
+	job_generator gen(0.01, 3, 1, 0.6, 0, 0.1, 0.1, 0, 0);
+	gen.seed(1);
+
+	job_tracker jt(4, 2);
+	pool &p = jt.add_pool("prod", 10, 10, 1, 1, 1, pool::SCHED_FAIR);
+	for (int i = 0; i < 20; ++i)
+		p.add_job(gen());
+
+	const char *summary = "/tmp/colossal_profile.txt";
+	const char *trace = "/tmp/colossal_profile.tsv";
+	unlink(summary);
+	unlink(trace);
+
+	bool on = jt.set_profile(summary, trace, 1000 * TICKS_PER_MSEC);
+	jt.process();
+
+#ifdef COLOSSAL_PROFILE
+	assert(on);
+	char line[256];
+	FILE *fp = fopen(summary, "r");
+	assert(fp);
+	bool found = false;
+	while (fgets(line, sizeof(line), fp))
+		if (strncmp(line, "ev_create_map", 13) == 0)
+			found = true;
+	fclose(fp);
+	assert(found);
+	fp = fopen(trace, "r");
+	assert(fp);
+	assert(fgets(line, sizeof(line), fp));
+	assert(strncmp(line, "time\t", 5) == 0);
+	assert(fgets(line, sizeof(line), fp));
+	fclose(fp);
+	unlink(summary);
+	unlink(trace);
+#else
+	assert(!on);
+	assert(access(summary, F_OK) == -1);
+#endif
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -12,7 +12,7 @@ int main()
         colossal::job j2 = gen1();
         colossal::job j3 = gen1();
 
-	std::list<colossal::pool> pools;
+	std::deque<colossal::pool> pools;
 	pools.push_back(colossal::pool("analyst", 200, 200, 1, 10, 10, colossal::pool::SCHED_FAIR));
 	pools.push_back(colossal::pool("modeling", 200, 200, 1, 10, 10, colossal::pool::SCHED_FAIR));
 
@@ -23,29 +23,29 @@ int main()
 	colossal::selector sel(pools.begin(), pools.end());
 
 	colossal::task_desc::ref *task;
-	double t = 0;
+	colossal::sim_time t = 0;
 	while (sel.has_map()) {
-		ULIB_DEBUG("map min ctime=%f, @%f, popped=%lu, seen=%lu",
-			   sel.map_min_ctime(), t, sel.maps_popped(), sel.maps_seen());
+		ULIB_DEBUG("map min ctime=%lld, @%lld, popped=%lu, seen=%lu",
+			   (long long)sel.map_min_ctime(), (long long)t, sel.maps_popped(), sel.maps_seen());
 		sel.dump_seen_task_tree();
 		task = sel.pop_map(t++);
 		if (task == NULL)
 			ULIB_DEBUG("No task chosen");
 		else
-			printf("%s\n", task->gettask()->to_str().c_str());
+			printf("%s\n", task->getjob()->tasks[colossal::task::TASK_TYPE_MAP][task->idx()].to_str(task->id(), colossal::task::TASK_TYPE_MAP).c_str());
 	}
 
 	ULIB_DEBUG("Selected all maps ..., popped=%lu, seen=%lu", sel.maps_popped(), sel.maps_seen());
 
 	while (sel.has_reduce()) {
-		ULIB_DEBUG("reduce min ctime=%f, @%f, popped=%lu, seen=%lu",
-			   sel.reduce_min_ctime(), t, sel.reduces_popped(), sel.reduces_seen());
+		ULIB_DEBUG("reduce min ctime=%lld, @%lld, popped=%lu, seen=%lu",
+			   (long long)sel.reduce_min_ctime(), (long long)t, sel.reduces_popped(), sel.reduces_seen());
 		sel.dump_seen_task_tree();
 		task = sel.pop_reduce(t++);
 		if (task == NULL)
 			ULIB_DEBUG("No task chosen");
 		else
-			printf("%s\n", task->gettask()->to_str().c_str());
+			printf("%s\n", task->getjob()->tasks[colossal::task::TASK_TYPE_REDUCE][task->idx()].to_str(task->id(), colossal::task::TASK_TYPE_REDUCE).c_str());
 	}
 
 	sel.dump_seen_task_tree();
@@ -0,0 +1,61 @@
+//
+// Follow a small cluster with the shadow tracker and check the
+// predicted finish times.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+task make_task(sim_time ctime, sim_time ptime)
+{
+	task t;
+	t.ctime = ctime;
+	t.ptime = ptime;
+	t.stime = -1;
+	t.ftime = -1;
+	return t;
+}
+
+int main()
+{
+	shadow_tracker st(2, 1);
+	uint64_t pid = st.follow_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR).id;
+
+	// job 1 has three 10-tick maps and a 5-tick reduce, on two map slots
+	assert(st.submit(pid, 1, 11, 1, task::TASK_TYPE_MAP, make_task(0, 10)) == 0);
+	assert(st.submit(pid, 1, 12, 1, task::TASK_TYPE_MAP, make_task(0, 10)) == 0);
+	assert(st.submit(pid, 1, 13, 1, task::TASK_TYPE_MAP, make_task(0, 10)) == 0);
+	assert(st.submit(pid, 1, 14, 1, task::TASK_TYPE_REDUCE, make_task(0, 5)) == 0);
+	assert(st.submit(pid, 1, 14, 1, task::TASK_TYPE_REDUCE, make_task(0, 5)) == -1);
+	assert(st.predict_job(1) == 20);
+	assert(st.predict_pool(pid) == 20);
+
+	assert(st.start(11, 0) == 0);
+	assert(st.start(12, 0) == 0);
+	assert(st.start(14, 0) == 0);
+	assert(st.finish(14, 5) == 0);
+	assert(st.tasks() == 3);
+	assert(st.predict_job(1) == 20);
+
+	// the third map is late, and job 2 comes in
+	assert(st.finish(11, 12) == 0);
+	assert(st.start(13, 12) == 0);
+	assert(st.submit(pid, 2, 21, 1, task::TASK_TYPE_MAP, make_task(15, 4)) == 0);
+	// map 12 is overdue and finishes right away
+	assert(st.predict_job(2) == 19);
+	assert(st.predict_job(1) == 22);
+	assert(st.predict_pool(pid) == 22);
+
+	assert(st.finish(12, 15) == 0);
+	assert(st.finish(13, 22) == 0);
+	assert(st.jobs() == 1);
+	assert(st.predict_job(1) == -1);
+	assert(st.predict_job(2) == 26);
+
+	printf("passed\n");
+
+	return 0;
+}
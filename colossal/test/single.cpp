@@ -14,6 +14,7 @@ int main()
 
 	mod.add_job(j1);
 
+	jt.set_record_times(true);
 	jt.process();
 
 	printf("------------ WORKLOAD ------------\n");
@@ -0,0 +1,76 @@
+//
+// Run a job with four maps on two map slots and two short reduces,
+// without slow-start, with half of the maps and with all of them. The
+// reduces are created with the job, but under slow-start they start
+// only after enough maps have finished, and they cannot finish before
+// the last map.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+job make_job()
+{
+	job j;
+	j.id = 1;
+	j.ctime = 0;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < 6; ++i) {
+		task t;
+		t.ctime = 0;
+		t.ptime = i < 4? 100: 10;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[i < 4? task::TASK_TYPE_MAP: task::TASK_TYPE_REDUCE].push_back(t);
+	}
+	return j;
+}
+
+// Run the job, returning its first reduce
+task run(double slowstart)
+{
+	job_tracker jt(2, 2);
+	jt.set_progress(false);
+	jt.set_slowstart(slowstart);
+	pool &p = jt.add_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	p.add_job(make_job());
+	jt.set_record_times(true);
+	jt.process();
+
+	const job &j = p.jobs[0];
+	assert(j.work_left == 0);
+	assert(p.fs_ctx_map.alloc == 0 && p.fs_ctx_reduce.alloc == 0);
+	assert(p.fs_ctx_reduce.demand == 0);
+	const job::task_container_type &reduces = j.tasks[task::TASK_TYPE_REDUCE];
+	assert(reduces[0].stime == reduces[1].stime);
+	assert(reduces[0].ftime == reduces[1].ftime);
+	return reduces[0];
+}
+
+int main()
+{
+	task r = run(-1);
+	assert(r.stime == 0 && r.ftime == 10);
+
+	// released by the first two maps, then waiting for the shuffle
+	r = run(0.5);
+	assert(r.stime == 100 && r.ftime == 200);
+	assert(r.ptime == 100);
+
+	// released by the last map
+	r = run(1);
+	assert(r.stime == 200 && r.ftime == 210);
+
+	// only the shuffle
+	r = run(0);
+	assert(r.stime == 0 && r.ftime == 200);
+
+	printf("passed\n");
+
+	return 0;
+}
@@ -0,0 +1,83 @@
+//
+// A job with a straggling map, run with and without speculative
+// execution. The backup of the straggler should finish the job early.
+//
+
+#include <stdio.h>
+#include <assert.h>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+job make_job()
+{
+	job j;
+	j.id = 1;
+	j.ctime = 0;
+	j.fs_ctx_map.uid = j.id;
+	j.fs_ctx_reduce.uid = j.id;
+	for (int i = 0; i < 10; ++i) {
+		task t;
+		t.ctime = 0;
+		t.ptime = i == 0? 100: 10;
+		t.stime = -1;
+		t.ftime = -1;
+		j.tasks[task::TASK_TYPE_MAP].push_back(t);
+	}
+	return j;
+}
+
+sim_time run(bool spec, spec_stats *stats)
+{
+	job_tracker jt(10, 1);
+	jt.set_progress(false);
+	if (spec) {
+		spec_params params;
+		params.cap = 1.0;
+		params.min_runtime = 5;
+		params.interval = 5;
+		assert(jt.set_speculation(params));
+	}
+	pool &p = jt.add_pool("prod", -1, -1, 1, 0, 0, pool::SCHED_FAIR);
+	p.add_job(make_job());
+	jt.set_record_times(true);
+	jt.process();
+
+	const job &j = p.jobs[0];
+	sim_time ftime = 0;
+	for (size_t i = 0; i < j.tasks[task::TASK_TYPE_MAP].size(); ++i) {
+		task t = j.tasks[task::TASK_TYPE_MAP][i];
+		assert(t.ftime == t.stime + t.ptime);
+		if (t.ftime > ftime)
+			ftime = t.ftime;
+	}
+	assert(j.work_left == 0);
+	assert(j.fs_ctx_map.alloc == 0 && p.fs_ctx_map.alloc == 0);
+	assert(p.fs_ctx_map.demand == 0);
+	*stats = jt.speculation();
+	return ftime;
+}
+
+int main()
+{
+	spec_stats stats;
+
+	assert(run(false, &stats) == 100);
+	assert(stats.launched == 0);
+
+	// the backup runs as long as the other maps, from the first
+	// check after they finish
+	sim_time ftime = run(true, &stats);
+	assert(ftime >= 20 && ftime <= 25);
+	assert(stats.launched == 1 && stats.won == 1 && stats.killed == 0);
+	assert(stats.slot_time == 10);
+
+	spec_params bad;
+	bad.slow_ratio = 0;
+	job_tracker jt(1, 1);
+	assert(!jt.set_speculation(bad));
+
+	printf("passed\n");
+
+	return 0;
+}
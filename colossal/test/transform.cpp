@@ -0,0 +1,146 @@
+//
+// Load a generated trace through each transformation stage, and
+// check the transformed pools. A pipeline gives the same pools with
+// one and several loader threads.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <math.h>
+#include <string>
+#include <colossal/colossal.hpp>
+
+using namespace colossal;
+
+const char *pools[] = { "analyst", "modeling", "prod" };
+
+void gen_trace(const char *file, int njobs)
+{
+	FILE *fp = fopen(file, "w");
+	assert(fp);
+	long long t = 1403620325026ll;
+	for (int job = 0; job < njobs; ++job) {
+		t += rand() % 10000;
+		for (int i = 0; i < 8; ++i)
+			fprintf(fp, "%s\tjob_%d:NORMAL\ttask_%d_%d\t%s\t%lld\t%lld\t%lld\n",
+				pools[job % 3], job, job, i, i < 6? "MAP": "REDUCE",
+				t, t + 7, t + 7 + rand() % 50000);
+	}
+	fclose(fp);
+}
+
+struct loaded {
+	job_tracker jt;
+
+	loaded() : jt(10, 10)
+	{
+		for (int i = 0; i < 3; ++i)
+			jt.add_pool(pools[i], -1, -1, 1, 1, 1, pool::SCHED_FAIR);
+	}
+
+	const pool &get(int i) { return jt.getpools()[i]; }
+
+	size_t tasks(int i)
+	{
+		size_t n = 0;
+		for (size_t j = 0; j < get(i).jobs.size(); ++j)
+			n += get(i).jobs[j].tasks[0].size() + get(i).jobs[j].tasks[1].size();
+		return n;
+	}
+
+	std::string str()
+	{
+		std::string s;
+		for (int i = 0; i < 3; ++i)
+			s += get(i).to_str() + "\n";
+		return s;
+	}
+};
+
+int load(const char *file, loaded &l, workload_transform *t, int nthreads = 4)
+{
+	workload_loader loader(workload_loader::FORMAT_STFT, nthreads);
+	if (t)
+		loader.add_transform(t);
+	return loader.load(file, &l.jt.getpools());
+}
+
+int main()
+{
+	char file[] = "/tmp/colossal_transform_XXXXXX";
+	int fd = mkstemp(file);
+	assert(fd != -1);
+	close(fd);
+	gen_trace(file, 3000);
+
+	loaded base;
+	assert(load(file, base, NULL) == 0);
+	for (int i = 0; i < 3; ++i)
+		assert(base.get(i).jobs.size() == 1000);
+
+	// sampling keeps whole jobs
+	loaded sampled;
+	assert(load(file, sampled, new sample_transform(0.3, "prod", 7)) == 0);
+	size_t n = sampled.get(2).jobs.size();
+	assert(n > 250 && n < 350);
+	assert(sampled.tasks(2) == n * 8);
+	assert(sampled.get(0).jobs.size() == 1000);
+
+	// the prod pool grows 2.5x, with the copies jittered
+	loaded scaled;
+	assert(load(file, scaled, new scale_arrivals_transform(2.5, 60000, "prod", 1)) == 0);
+	n = scaled.get(2).jobs.size();
+	assert(n > 2400 && n < 2600);
+	assert(scaled.tasks(2) == n * 8);
+	assert(scaled.get(1).jobs.size() == 1000);
+
+	// compress the trace into 5/7 of its span
+	loaded compressed;
+	assert(load(file, compressed, new time_compress_transform(7.0 / 5)) == 0);
+	const job &b0 = base.get(0).jobs.front(), &b1 = base.get(0).jobs.back();
+	const job &c0 = compressed.get(0).jobs.front(), &c1 = compressed.get(0).jobs.back();
+	assert(c0.ctime == b0.ctime);
+	assert(fabs((c1.ctime - c0.ctime) - (b1.ctime - b0.ctime) * 5.0 / 7) <= 1);
+	assert(c1.tasks[1][0].ftime - c1.tasks[1][0].stime ==
+	       b1.tasks[1][0].ftime - b1.tasks[1][0].stime);
+
+	// copies of the analyst jobs in modeling
+	loaded replicated;
+	assert(load(file, replicated, new pool_replicate_transform("analyst", "modeling", 2, 1000, 3)) == 0);
+	assert(replicated.get(0).jobs.size() == 1000);
+	assert(replicated.get(1).jobs.size() == 3000);
+	assert(replicated.tasks(1) == 3 * base.tasks(1));
+
+	// cap the durations
+	loaded capped;
+	sim_time cap = 20000 * TICKS_PER_MSEC;
+	assert(load(file, capped, new duration_scale_transform(1.5, cap)) == 0);
+	for (int i = 0; i < 3; ++i)
+		for (size_t j = 0; j < capped.get(i).jobs.size(); ++j) {
+			task t = capped.get(i).jobs[j].tasks[1][0];
+			assert(t.ptime <= cap && t.ftime == t.stime + t.ptime);
+		}
+
+	// a pipeline is deterministic
+	std::string s[2];
+	for (int k = 0; k < 2; ++k) {
+		loaded l;
+		workload_loader loader(workload_loader::FORMAT_STFT, k? 8: 1);
+		loader.add_transform(new sample_transform(0.8, NULL, 5));
+		loader.add_transform(new scale_arrivals_transform(1.7, 30000, "analyst", 2));
+		loader.add_transform(new pool_replicate_transform("prod", "prod", 1, 5000, 9));
+		loader.add_transform(new time_compress_transform(2));
+		loader.add_transform(new duration_scale_transform(0.5, -1, "modeling"));
+		assert(loader.load(file, &l.jt.getpools()) == 0);
+		s[k] = l.str();
+	}
+	assert(s[0] == s[1]);
+
+	unlink(file);
+
+	printf("passed\n");
+
+	return 0;
+}